@@ -4,9 +4,8 @@
 #include "SysTickTimer.h"
 #include "math.h"
 #include "IRQnManage.h"
-#include <stdio.h>
-
-using std::snprintf;
+#include "FastFmt.h"
+#include "EventFlags.h"
 
 namespace NS_ADC { class ADC; ADC& GetStaticADC(); }
 static void ADC_ShowTimCallback() { NS_ADC::GetStaticADC().TIM_IRQnHandler(); }
@@ -120,7 +119,7 @@ namespace NS_ADC_DISPOSIT
 
 namespace NS_ADC
 {
-    const float ADC::stepPerVolt = 1240.9091f;
+    constexpr float ADC::stepPerVolt;
     void ADC::ShowBoardVal(uint8_t i) {
         if (this->maxVal[i] < snapBuf[i]) { this->maxVal[i] = snapBuf[i]; }
         if (this->minVal[i] > snapBuf[i]) { this->minVal[i] = snapBuf[i]; }
@@ -135,31 +134,12 @@ namespace NS_ADC
 
     // Return the Value of the Current(mA)
     double ADC::ShowVoltage(uint8_t line, uint8_t col, uint16_t ad_value, uint16_t ref_value, uint32_t gain) {
-        double difVoltage = (double)(ad_value - ref_value) / ADC::stepPerVolt;
-        double current = difVoltage * 1000.0 / gain;   // mA
-        uint8_t current_left;
-        uint16_t current_right;
-        const uint16_t str_size = 12;
-        char str_result[str_size] = "0.000mA   ";
-        double temp_current = current;
-        short signOfCurrent = 1;
-        if (ad_value < ref_value) {
-            signOfCurrent = -1;
-            current = -current;
-        }
-        if (current >  1) {
-            temp_current = current * signOfCurrent;
-            snprintf(str_result, str_size, "%3.3fmA ", temp_current);
-        } else if (current > 1e-3f) {
-            temp_current = current * 1e3 * signOfCurrent;
-            snprintf(str_result, str_size, "%3.3fuA ", temp_current);
-        } else if (current > 1e-6f) {
-            temp_current = current * 1e6 * signOfCurrent;
-            snprintf(str_result, str_size, "%3.3fnA ", temp_current);
-        }
+        char str_result[12];
+        uint32_t mag_pa = 0;
+        FormatCurrent(str_result, sizeof(str_result), ad_value, ref_value, gain, &mag_pa);
         OLED_ShowString(line, col, str_result);
-
-        return current;
+        // 返回值沿用 double 接口（currentBuf），只有这一次软件双精度换算
+        return (double)mag_pa * 1e-9;   // mA（幅值）
     }
 
     void ADC::Show(){
@@ -172,10 +152,38 @@ namespace NS_ADC
 
     void ADC::TIM_IRQnHandler(void){
         // 仅做“触发 + 快照”，避免在 ISR 内做 OLED I/O 与 snprintf/double 运算
-        for (uint16_t i = 0; i < this->params.nbr_of_channels; i++) {
-            snapBuf[i] = dmaBuf[i];
-        }
+        (void)ReadSequence(snapBuf.data(), this->params.nbr_of_channels);
         needOledRefresh = true;
+        NS_EVT::Post(NS_EVT::ADC_SNAP);
+    }
+
+    // 最短转换 14 个 ADC 时钟（1.5 采样 + 12.5），ADCCLK 上限 14MHz：每通道至少约 72 个内核周期。
+    // 拷贝耗时不超过“半区写满的最短时间”，DMA 就不可能绕一圈回到正在读的半区
+    static const uint32_t MIN_CONV_CYCLES = 72;
+
+    bool ADC::ReadSequence(uint16_t* out, uint8_t n) const {
+        const uint8_t nch = params.nbr_of_channels;
+        if (n > nch) n = nch;
+        if (!pingPong || dmaChannel == nullptr) {
+            for (uint8_t i = 0; i < n; ++i) out[i] = dmaBuf[i];
+            return false;
+        }
+
+        const uint16_t size = static_cast<uint16_t>(2u * nch);
+        const uint32_t guard = MIN_CONV_CYCLES * nch;
+        for (uint8_t attempt = 0; attempt < 3; ++attempt) {
+            // CNDTR 从 size 递减到 1 后重装：size - CNDTR 为下一个要写的位置
+            const uint16_t pos0 = static_cast<uint16_t>(size - dmaChannel->CNDTR);
+            const uint8_t  writing = (pos0 < nch) ? 0 : 1;
+            const uint16_t base = writing ? 0 : nch;
+            const uint32_t c0 = SysTickTimer::GetCycles();
+            for (uint8_t i = 0; i < n; ++i) out[i] = dmaBuf[base + i];
+            const uint32_t dt = SysTickTimer::GetCycles() - c0;
+            const uint16_t pos1 = static_cast<uint16_t>(size - dmaChannel->CNDTR);
+            if (((pos1 < nch) ? 0 : 1) == writing && dt < guard) return true;
+        }
+        tornReads = tornReads + 1;
+        return false;
     }
 
     void ADC::DMA_IRQnHandler(void){
@@ -185,12 +193,13 @@ namespace NS_ADC
     void ADC::Service(){
         if (!needOledRefresh) return;
         needOledRefresh = false;
+        if (!textEnabled) return;
 
         //2. 限制 OLED 刷新频率 (例如每 100ms 刷新一次)
         if (SysTickTimer::GetTick() - lastOledRefreshTime > 100) {
             lastOledRefreshTime = SysTickTimer::GetTick();
             
-            // 执行耗时的 OLED 操作
+            // 只写显存（标记脏页），由调用方 OLED_Flush 交给 DMA 后台刷屏
              for (uint16_t i = 0; i < this->params.nbr_of_channels; i++) {
             OLED_ShowNum(i + 1, 1, snapBuf[i], 4);
             this->currentBuf[i] = this->ShowVoltage(i + 1, 6, snapBuf[i], this->refValBuf[0], this->params.channels[i].gain);
@@ -308,7 +317,9 @@ namespace NS_ADC
         dma.DMA_PeripheralBaseAddr = (uint32_t)&(adc->DR);
         dma.DMA_MemoryBaseAddr = (uint32_t)dmaBuf.data();
         dma.DMA_DIR = DMA_DIR_PeripheralSRC;
-        dma.DMA_BufferSize = params.nbr_of_channels;
+        // 两个半区交替写入，读端总能拿到完整的上一轮（见 ReadSequence）
+        pingPong = (2u * params.nbr_of_channels <= dmaBuf.size());
+        dma.DMA_BufferSize = pingPong ? 2u * params.nbr_of_channels : params.nbr_of_channels;
         dma.DMA_PeripheralInc = DMA_PeripheralInc_Disable;
         dma.DMA_MemoryInc = DMA_MemoryInc_Enable;
         dma.DMA_PeripheralDataSize = DMA_PeripheralDataSize_HalfWord;
@@ -421,6 +432,26 @@ namespace NS_ADC
         
     }
 
+    void ADC::PowerDown() {
+        if (isPoweredDown) return;
+        Pause();
+        ADC_Cmd(adc, DISABLE);
+        isPoweredDown = true;
+    }
+
+    void ADC::PowerUp() {
+        if (!isPoweredDown) return;
+        ADC_Cmd(adc, ENABLE);
+        // 上电稳定时间 tSTAB 最长 1us
+        const uint32_t t0 = SysTickTimer::GetCycles();
+        while (SysTickTimer::GetCycles() - t0 < SystemCoreClock / 1000000U) {}
+        // 断电后校准值不保证保留，重新校准（DMA 仍处于暂停，校准码不会被搬走）
+        Calibrate();
+        Resume();
+        ADC_SoftwareStartConvCmd(adc, ENABLE);
+        isPoweredDown = false;
+    }
+
     uint16_t ADC::GetValue(uint8_t channel) {
         ADC_RegularChannelConfig(adc, params.channels[channel].channel, 1, 
             params.channels[channel].sampleTime);
@@ -3,6 +3,7 @@
 #include <array>
 #include <InitArg.h>
 #include "DACManager.h" // 确保包含 DACManager 以获取 CV_Controller 定义
+#include "FastFmt.h"
 
 namespace NS_ADC
 {
@@ -37,7 +38,7 @@ namespace NS_ADC
 
     class ADC {
     public:
-        static const float stepPerVolt;
+        static constexpr float stepPerVolt = 1240.9091f;   // 码/V（4095 / 3.3V），编译期常量，电流换算可在编译期折叠
         
         void ResetVoltRef(uint16_t ref_val) { this->staticRefVal = ref_val; }
         void ResetVoltRef(float volt_ref) { this->staticRefVal = volt_ref * ADC::stepPerVolt; }
@@ -59,17 +60,30 @@ namespace NS_ADC
         void Pause();           // 暂停功能
         void Resume();          // 重新开始功能
         bool IsPaused() const { return isPaused; }
+        // 低功耗：在 Pause 基础上关掉 ADC 模拟部分（ADON=0）；PowerUp 重新上电、校准并恢复连续转换
+        void PowerDown();
+        void PowerUp();
+        bool IsPoweredDown() const { return isPoweredDown; }
         
         // 获取转换值（阻塞模式）
         uint16_t GetValue(uint8_t channel);
         
         // 获取DMA模式下的数据指针
         const uint16_t* GetDmaBufferHeader() const { return &dmaBuf[0]; }
+
+        // 取同一轮扫描的各通道值（中断/主循环均可调用，不等待）。
+        // DMA 以两倍长度循环写 dmaBuf，总有一个半区是完整且暂时不会被写的上一轮；
+        // 拷贝前后 DMA 都没进入该半区、且拷贝足够快（没被长时间抢占）才返回 true。
+        // 通道数超过缓冲一半时退化为直接拷贝，返回 false。
+        bool ReadSequence(uint16_t* out, uint8_t n) const;
+        uint32_t GetTornReads() const { return tornReads; }
         const std::array<uint16_t, 16> &GetDmaBufferRef() const { return dmaBuf; }
         const double * GetCurrentBufHeader() const { return &currentBuf[0]; }
         const std::array<double, 16> &GetCurrentBufRef() const { return currentBuf; }
 
         const InitParams & GetInitParams() const { return params; }
+        // 当前参考电压对应的 ADC 码（静态参考或 DAC 动态参考的当前值）
+        uint16_t GetRefVal() const { return refValBuf ? refValBuf[0] : staticRefVal; }
         DMA_Channel_TypeDef * GetDmaChannel() { return this->dmaChannel; }
         const ShowParams & GetShowParams() const { return showParams; }
 
@@ -77,9 +91,15 @@ namespace NS_ADC
         void Calibrate();
 
         double ShowVoltage(uint8_t line, uint8_t col, uint16_t ad_value, uint16_t ref_val, uint32_t gain);
+        // ShowVoltage 的电流字符串（不碰硬件，主机基准 FastFmtBench.cpp 直接调用）：mA/uA/nA 三位定点，
+        // 补空格到 10 字符。mag_pa 取回幅值（pA，封顶 4e9）
+        static uint16_t FormatCurrent(char* out, uint16_t cap, uint16_t ad_value, uint16_t ref_value, uint32_t gain,
+                                      uint32_t* mag_pa = nullptr);
         void ShowBoardVal(uint8_t index);
         void ShowBoardVal();
         void Show();
+        // OLED 切到曲线视图时关闭文本页绘制（TIM3 快照照常，文本页的电流换算一并跳过）
+        void SetTextEnabled(bool on) { textEnabled = on; }
 
         void TIM_IRQnHandler(void);
         void DMA_IRQnHandler(void);
@@ -96,9 +116,11 @@ namespace NS_ADC
         
     private:
         volatile bool needOledRefresh = false;
+        volatile bool textEnabled = true;
         std::array<uint16_t, 16> snapBuf{};
 
         bool isPaused = false;  // 标记是否处于暂停状态
+        bool isPoweredDown = false;
         TIM_TypeDef* showTim = nullptr;
 
         CGM::VsMode vsMode = CGM::VsMode::STATIC;
@@ -118,12 +140,42 @@ namespace NS_ADC
         std::array<double, 16> currentBuf;
 
         uint32_t lastOledRefreshTime = 0;
+
+        bool pingPong = false;                  // dmaBuf 是否按两个半区循环
+        mutable volatile uint32_t tornReads = 0;
         
         void GpioConfig();
         void DmaConfig();
         void ShowConfig();
     };
 
+    // Cortex-M3 没有 FPU：换算全用整数。pV/码 在编译期由 stepPerVolt 折叠成常量，
+    // 运行时一次 32×32→64 乘法和一次 64/32 除法（__aeabi_uldivmod 库调用，无软浮点）
+    inline uint16_t ADC::FormatCurrent(char* out, uint16_t cap, uint16_t ad_value, uint16_t ref_value, uint32_t gain,
+                                       uint32_t* mag_pa) {
+        constexpr uint32_t PV_PER_CODE = static_cast<uint32_t>(1e12f / stepPerVolt + 0.5f);
+        const bool negative = ad_value < ref_value;
+        const uint32_t counts = negative ? (uint32_t)(ref_value - ad_value) : (uint32_t)(ad_value - ref_value);
+        const uint32_t g = gain ? gain : 1u;
+        const uint64_t pa = ((uint64_t)counts * PV_PER_CODE + g / 2u) / g;
+        const uint32_t mag = (pa < 4000000000ull) ? (uint32_t)pa : 4000000000u;
+        const int32_t sign = negative ? -1 : 1;
+        NS_FMT::FmtBuf f(out, cap);
+        // 3 位定点：mA 以 uA 为单位，uA 以 nA 为单位，nA 以 pA 为单位
+        if (mag > 1000000000u) {
+            f.Fixed(sign * (int32_t)((mag + 500000u) / 1000000u), 3).Str("mA");
+        } else if (mag > 1000000u) {
+            f.Fixed(sign * (int32_t)((mag + 500u) / 1000u), 3).Str("uA");
+        } else if (mag > 1000u) {
+            f.Fixed(sign * (int32_t)mag, 3).Str("nA");
+        } else {
+            f.Str("0.000mA");
+        }
+        f.PadTo(10);
+        if (mag_pa) *mag_pa = mag;
+        return f.size();
+    }
+
     // 【新增】单例访问接口
     ADC& GetStaticADC();
 
@@ -1,8 +1,13 @@
 #include "stm32f10x.h"      // Device header
 #include "BTCPP.h"
 #include "GPIO.h"
+#include "IRQnManage.h"
+#include "SysTickTimer.h"
+#include "EventFlags.h"
 #include <cstring>
 
+USART_Controller::AbortHook USART_Controller::s_abortHook = nullptr;
+
 // ===== 构造函数 & 复位配置 =====
 USART_Controller::USART_Controller(USART_TypeDef* usartx,
                                    BaudRate baudrate,
@@ -46,13 +51,19 @@ bool USART_Controller::Start() {
 }
 
 void USART_Controller::Continue() {
-    // 建议：NVIC 优先级/使能可在外部统一配置；这里仅开启 RXNE
-    USART_ITConfig(btParams.USART, USART_IT_RXNE, ENABLE);
+    // 建议：NVIC 优先级/使能可在外部统一配置；这里只开启中断源
+    // DMA 接收时字节由 DMA 搬运，只需 IDLE 通知“一段数据结束”；否则退回逐字节 RXNE
+    if (m_rxUseDma) {
+        USART_ITConfig(btParams.USART, USART_IT_IDLE, ENABLE);
+    } else {
+        USART_ITConfig(btParams.USART, USART_IT_RXNE, ENABLE);
+    }
     USART_Cmd(btParams.USART, ENABLE);
 }
 
 void USART_Controller::Stop() {
     USART_ITConfig(btParams.USART, USART_IT_RXNE, DISABLE);
+    USART_ITConfig(btParams.USART, USART_IT_IDLE, DISABLE);
     USART_Cmd(btParams.USART, DISABLE);
 }
 
@@ -64,6 +75,8 @@ bool USART_Controller::Init() {
     this->RCC_Config();
     this->GPIO_Config();
     this->USART_Config();
+    this->TxDmaConfig();
+    this->RxDmaConfig();
 
     return true;
 }
@@ -106,20 +119,183 @@ void USART_Controller::USART_Config() {
     USART_InitStruct.USART_WordLength          = USART_WordLength_8b;
     USART_InitStruct.USART_StopBits            = USART_StopBits_1;
     USART_InitStruct.USART_Parity              = USART_Parity_No;
-    USART_InitStruct.USART_HardwareFlowControl = USART_HardwareFlowControl_None;
+    USART_InitStruct.USART_HardwareFlowControl = m_flowControl ? USART_HardwareFlowControl_RTS_CTS
+                                                               : USART_HardwareFlowControl_None;
     USART_InitStruct.USART_Mode                = USART_Mode_Tx | USART_Mode_Rx;
 
     USART_Init(btParams.USART, &USART_InitStruct);
 }
 
-// ===== 发送相关 =====
+// CTS 下拉输入（低电平=允许发送，未接线时不至于把 TX 卡死），RTS 复用推挽
+void USART_Controller::FlowGPIO_Config() {
+    if (btParams.USART_CTS == 0 || btParams.USART_RTS == 0) return;
+    GPIO_InitTypeDef gpio{};
+    gpio.GPIO_Speed = GPIO_Speed_50MHz;
 
-// 统一的底层写函数：阻塞式发送任意字节流
-void USART_Controller::Write(const uint8_t* data, uint16_t length) {
-    if (data == nullptr || length == 0 || btParams.USART == nullptr) {
-        return;
-    }
+    gpio.GPIO_Pin  = btParams.USART_CTS;
+    gpio.GPIO_Mode = GPIO_Mode_IPD;
+    GPIO_Init(btParams.GPIOx, &gpio);
+
+    gpio.GPIO_Pin  = btParams.USART_RTS;
+    gpio.GPIO_Mode = GPIO_Mode_AF_PP;
+    GPIO_Init(btParams.GPIOx, &gpio);
+}
+
+// ===== 波特率 / 硬件流控 =====
+
+uint32_t USART_Controller::GetPclk() const {
+    RCC_ClocksTypeDef clocks;
+    RCC_GetClocksFreq(&clocks);
+    // USART1 挂在 APB2，其余挂在 APB1
+    return (btParams.USART == USART1) ? clocks.PCLK2_Frequency : clocks.PCLK1_Frequency;
+}
+
+bool USART_Controller::IsBaudSupported(uint32_t baud, uint32_t* actual) const {
+    if (baud == 0) return false;
+    const uint32_t pclk = GetPclk();
+    // F1 固定 16 倍过采样：USARTDIV >= 1
+    if (baud > pclk / 16) return false;
+
+    // BRR 以 1/16 为单位，与 USART_Init 的取整方式一致（四舍五入）
+    const uint32_t brr = (pclk + baud / 2) / baud;
+    if (brr < 16 || brr > 0xFFFF) return false;
+    const uint32_t real = pclk / brr;
+    if (actual) *actual = real;
+
+    const uint32_t err = (real > baud) ? (real - baud) : (baud - real);
+    return err * 50 <= baud;   // <= 2%
+}
+
+void USART_Controller::ApplyLineSettings(uint32_t baud, bool flow) {
+    // 等 TX 缓冲与最后一帧移出移位寄存器再改时序，避免对端收到半个字节
+    // 超时按当前波特率估算：每字节 10bit，再留 10ms 余量
+    const uint32_t drain_ms = 10 + static_cast<uint32_t>(TxPending()) * 10000u / (m_baudrate ? m_baudrate : 9600);
+    (void)Flush(drain_ms);
+    USART_Cmd(btParams.USART, DISABLE);
+
+    btParams.baudrate = baud;
+    m_baudrate        = baud;
+    m_flowControl     = flow;
+    if (flow) FlowGPIO_Config();
+    this->USART_Config();   // USART_Init 只改 BRR/CR1 帧格式/CR3 流控位，中断与 DMA 使能位保留
+
+    USART_Cmd(btParams.USART, ENABLE);
+}
+
+bool USART_Controller::SetBaudRate(uint32_t baud) {
+    if (!IsBaudSupported(baud)) return false;
+    ApplyLineSettings(baud, m_flowControl);
+    return true;
+}
+
+bool USART_Controller::SetFlowControl(bool enable) {
+    if (enable && (btParams.USART_CTS == 0 || btParams.USART_RTS == 0)) return false;
+    ApplyLineSettings(m_baudrate, enable);
+    return true;
+}
+
+bool USART_Controller::BeginBaudChange(uint32_t baud, bool flow, uint32_t timeout_ms) {
+    if (m_baudPending) return false;
+    if (!IsBaudSupported(baud)) return false;
+    if (flow && (btParams.USART_CTS == 0 || btParams.USART_RTS == 0)) return false;
+
+    m_prevBaudrate = m_baudrate;
+    m_prevFlow     = m_flowControl;
+    ApplyLineSettings(baud, flow);
+    // 切换前后收到的残字节按新波特率解析必然是乱码，丢掉
+    FlushRx();
 
+    m_baudDeadline = SysTickTimer::GetTick() + timeout_ms;
+    m_baudPending  = true;
+    return true;
+}
+
+bool USART_Controller::ConfirmBaudChange() {
+    if (!m_baudPending) return false;
+    m_baudPending = false;
+    return true;
+}
+
+bool USART_Controller::Service() {
+    if (!m_baudPending) return false;
+    if ((int32_t)(SysTickTimer::GetTick() - m_baudDeadline) < 0) return false;
+
+    // 对端没能以新波特率确认：回退
+    m_baudPending = false;
+    ApplyLineSettings(m_prevBaudrate, m_prevFlow);
+    FlushRx();
+    return true;
+}
+
+void USART_Controller::TxDmaConfig() {
+    DMA_Channel_TypeDef* ch = btParams.TX_DMA_Channel;
+    m_txHead = m_txTail = 0;
+    m_txDmaLen = 0;
+
+    // 只支持 DMA1 通道（DMA_IRQnManage 只管理 DMA1），否则退回阻塞发送
+    m_txUseDma = (ch != nullptr) && (DMA_IRQnManage::GetDmaChanIndexFromType(ch) < DMA_IRQnManage::Size_DMA);
+    if (!m_txUseDma) return;
+
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+    DMA_DeInit(ch);
+    DMA_InitTypeDef dma;
+    dma.DMA_PeripheralBaseAddr = (uint32_t)&(btParams.USART->DR);
+    dma.DMA_MemoryBaseAddr     = (uint32_t)m_txBuffer.data();
+    dma.DMA_DIR                = DMA_DIR_PeripheralDST;
+    dma.DMA_BufferSize         = 1;     // 每次 KickTx 时重设
+    dma.DMA_PeripheralInc      = DMA_PeripheralInc_Disable;
+    dma.DMA_MemoryInc          = DMA_MemoryInc_Enable;
+    dma.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    dma.DMA_MemoryDataSize     = DMA_MemoryDataSize_Byte;
+    dma.DMA_Mode               = DMA_Mode_Normal;
+    dma.DMA_Priority           = DMA_Priority_Medium;
+    dma.DMA_M2M                = DMA_M2M_Disable;
+    DMA_Init(ch, &dma);
+
+    DMA_ITConfig(ch, DMA_IT_TC, ENABLE);
+    USART_DMACmd(btParams.USART, USART_DMAReq_Tx, ENABLE);
+}
+
+// RX 循环 DMA：DMA 持续写 m_rxBuffer，CPU 只在 HT/TC/IDLE 时按块处理
+void USART_Controller::RxDmaConfig() {
+    DMA_Channel_TypeDef* ch = btParams.RX_DMA_Channel;
+    m_rxHead = m_rxTail = 0;
+    m_rxLinesIn = m_rxLinesOut = 0;
+    m_rxScanIn = m_rxScanOut = RxScan();
+    m_rxResync = false;
+
+    // 同 TX：只支持 DMA1 通道，否则退回 RXNE 逐字节中断
+    m_rxUseDma = (ch != nullptr) && (DMA_IRQnManage::GetDmaChanIndexFromType(ch) < DMA_IRQnManage::Size_DMA);
+    if (!m_rxUseDma) return;
+
+    RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+    DMA_Cmd(ch, DISABLE);
+    DMA_DeInit(ch);
+    DMA_InitTypeDef dma;
+    dma.DMA_PeripheralBaseAddr = (uint32_t)&(btParams.USART->DR);
+    dma.DMA_MemoryBaseAddr     = (uint32_t)m_rxBuffer.data();
+    dma.DMA_DIR                = DMA_DIR_PeripheralSRC;
+    dma.DMA_BufferSize         = m_bufferSize;
+    dma.DMA_PeripheralInc      = DMA_PeripheralInc_Disable;
+    dma.DMA_MemoryInc          = DMA_MemoryInc_Enable;
+    dma.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+    dma.DMA_MemoryDataSize     = DMA_MemoryDataSize_Byte;
+    dma.DMA_Mode               = DMA_Mode_Circular;
+    dma.DMA_Priority           = DMA_Priority_High;   // 接收优先于发送，避免 ORE
+    dma.DMA_M2M                = DMA_M2M_Disable;
+    DMA_Init(ch, &dma);
+
+    DMA_ITConfig(ch, DMA_IT_HT | DMA_IT_TC, ENABLE);
+    USART_DMACmd(btParams.USART, USART_DMAReq_Rx, ENABLE);
+    DMA_Cmd(ch, ENABLE);
+}
+
+// ===== 发送相关 =====
+
+// 阻塞式发送（无 DMA 通道时的退路）
+void USART_Controller::WriteBlocking(const uint8_t* data, uint16_t length) {
     for (uint16_t i = 0; i < length; ++i) {
         while (USART_GetFlagStatus(this->btParams.USART, USART_FLAG_TXE) == RESET) {
             // busy wait
@@ -133,6 +309,113 @@ void USART_Controller::Write(const uint8_t* data, uint16_t length) {
     }
 }
 
+uint16_t USART_Controller::TxPending() const {
+    const uint16_t head = m_txHead;
+    const uint16_t tail = m_txTail;
+    const uint16_t size = static_cast<uint16_t>(m_txBuffer.size());
+    return (head >= tail) ? static_cast<uint16_t>(head - tail)
+                          : static_cast<uint16_t>(size - (tail - head));
+}
+
+uint16_t USART_Controller::TxFree() const {
+    // 保留 1 字节区分满/空
+    return static_cast<uint16_t>(m_txBuffer.size() - 1 - TxPending());
+}
+
+// 统一的底层写函数：非阻塞，拷贝进 TX 环形缓冲后由 DMA 后台发出
+uint16_t USART_Controller::Write(const uint8_t* data, uint16_t length) {
+    if (data == nullptr || length == 0 || btParams.USART == nullptr) {
+        return 0;
+    }
+    if (!m_txUseDma) {
+        WriteBlocking(data, length);
+        return length;
+    }
+
+    const uint16_t size = static_cast<uint16_t>(m_txBuffer.size());
+    const uint16_t free = TxFree();
+    const uint16_t n = (length <= free) ? length : free;
+    if (n < length) {
+        m_txDropCount += static_cast<uint32_t>(length - n);
+    }
+
+    // 拷贝（最多两段），拷贝完成后再发布 head，保证 DMA 只看到完整数据
+    uint16_t head = m_txHead;
+    const uint16_t first = (static_cast<uint16_t>(size - head) < n) ? static_cast<uint16_t>(size - head) : n;
+    memcpy(&m_txBuffer[head], data, first);
+    if (n > first) {
+        memcpy(&m_txBuffer[0], data + first, n - first);
+    }
+    head = static_cast<uint16_t>(head + n);
+    if (head >= size) head = static_cast<uint16_t>(head - size);
+    m_txHead = head;
+
+    const uint16_t pending = TxPending();
+    if (pending > m_txHighWater) m_txHighWater = pending;
+
+    // KickTx 同时会在 DMA 中断里调用，这里短暂屏蔽中断保证互斥
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    KickTx();
+    __set_PRIMASK(primask);
+
+    return n;
+}
+
+bool USART_Controller::WriteFrame(const uint8_t* data, uint16_t length) {
+    if (data == nullptr || length == 0) return false;
+    if (m_txUseDma && length > TxFree()) {
+        m_txDropCount += length;
+        return false;
+    }
+    return Write(data, length) == length;
+}
+
+void USART_Controller::KickTx() {
+    if (m_txDmaLen != 0) return;            // DMA 正忙，完成中断里会继续
+
+    const uint16_t head = m_txHead;
+    const uint16_t tail = m_txTail;
+    if (head == tail) return;
+
+    // 只发送连续的一段；回绕部分在下一次完成中断中发送
+    const uint16_t size = static_cast<uint16_t>(m_txBuffer.size());
+    const uint16_t len  = (head > tail) ? static_cast<uint16_t>(head - tail)
+                                        : static_cast<uint16_t>(size - tail);
+
+    DMA_Channel_TypeDef* ch = btParams.TX_DMA_Channel;
+    DMA_Cmd(ch, DISABLE);
+    ch->CMAR  = (uint32_t)&m_txBuffer[tail];
+    ch->CNDTR = len;
+    m_txDmaLen = len;
+    DMA_Cmd(ch, ENABLE);
+}
+
+void USART_Controller::TxDmaIRQHandler() {
+    // DMA_IRQnManage 已清除 TC 标志
+    DMA_Cmd(btParams.TX_DMA_Channel, DISABLE);
+
+    const uint16_t size = static_cast<uint16_t>(m_txBuffer.size());
+    uint16_t tail = static_cast<uint16_t>(m_txTail + m_txDmaLen);
+    if (tail >= size) tail = static_cast<uint16_t>(tail - size);
+    m_txTail   = tail;
+    m_txDmaLen = 0;
+
+    KickTx();
+    NS_EVT::Post(NS_EVT::TX_DONE);
+}
+
+bool USART_Controller::Flush(uint32_t timeout_ms) {
+    const uint32_t start = SysTickTimer::GetTick();
+    while (m_txUseDma && (TxPending() != 0 || m_txDmaLen != 0)) {
+        if (SysTickTimer::GetTick() - start >= timeout_ms) return false;
+    }
+    while (USART_GetFlagStatus(btParams.USART, USART_FLAG_TC) == RESET) {
+        if (SysTickTimer::GetTick() - start >= timeout_ms) return false;
+    }
+    return true;
+}
+
 void USART_Controller::Send(const uint8_t* data, uint16_t length) {
     Write(data, length);
 }
@@ -169,22 +452,15 @@ uint16_t USART_Controller::Available() const {
     return static_cast<uint16_t>(size - (tail - head));
 }
 
-bool USART_Controller::HasLine() const {
-    uint16_t head = m_rxHead;
-    uint16_t tail = m_rxTail;
-    const uint16_t size = m_bufferSize;
-    if (size == 0) return false;
-
-    uint16_t idx = tail;
-    while (idx != head) {
-        if (m_rxBuffer[idx] == '\n') return true;
-        idx = IncIndex(idx, size);
-    }
-    return false;
-}
-
 void USART_Controller::FlushRx() {
-    m_rxTail = m_rxHead;
+    // head 与 linesIn 由中断推进，需成对快照
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    m_rxTail     = m_rxHead;
+    m_rxLinesOut = m_rxLinesIn;
+    m_rxScanIn   = m_rxScanOut = RxScan();
+    m_rxResync   = false;
+    __set_PRIMASK(primask);
     isRXNE = 0;
 }
 
@@ -192,7 +468,29 @@ bool USART_Controller::ReadLine(char* out, uint16_t out_max, bool* truncated) {
     if (truncated) *truncated = false;
     if (!out || out_max < 2) return false;
 
-    // 没有完整行就不消费数据，避免“半包”把命令拆碎
+    uint16_t len = 0;
+    bool binary = false;
+    while (ReadMessage(reinterpret_cast<uint8_t*>(out), out_max, &len, &binary, truncated)) {
+        if (!binary) return true;
+        ++m_binSkipCount;
+    }
+    out[0] = '\0';
+    return false;
+}
+
+bool USART_Controller::ReadMessage(uint8_t* out, uint16_t out_max, uint16_t* out_len, bool* binary, bool* truncated) {
+    if (truncated) *truncated = false;
+    if (out_len) *out_len = 0;
+    if (binary) *binary = false;
+    if (!out || out_max < 2) return false;
+
+    // 接收被覆盖过：缓冲内容已不可信，整体丢弃后从下一条消息重新同步
+    if (m_rxResync) {
+        FlushRx();
+        return false;
+    }
+
+    // 没有完整消息就不消费数据，避免“半包”把命令拆碎
     if (!HasLine()) return false;
 
     uint16_t head = m_rxHead;
@@ -201,39 +499,51 @@ bool USART_Controller::ReadLine(char* out, uint16_t out_max, bool* truncated) {
 
     uint16_t w = 0;
     bool cut = false;
+    bool ended = false;
+    bool bin = m_rxScanOut.inFrame;
 
     while (tail != head) {
-        char c = static_cast<char>(m_rxBuffer[tail]);
+        const uint8_t c = m_rxBuffer[tail];
         tail = IncIndex(tail, size);
 
-        if (c == '\n') {
-            break; // 一行结束
+        const bool wasFrame = m_rxScanOut.inFrame;
+        if (ScanRxByte(m_rxScanOut, c)) {
+            ended = true;
+            break; // 一条消息结束
         }
-        if (c == '\r') {
-            continue; // 兼容 CRLF
+        // 急停字节已由中断处理，不进入文本
+        if (!m_rxScanOut.inFrame && c == ABORT_BYTE) continue;
+        if (m_rxScanOut.inFrame) {
+            if (!wasFrame) {
+                // 帧起始：之前未以行结束符结尾的文本作废
+                bin = true;
+                w = 0;
+                cut = false;
+            }
+            if (c == 0x00) continue;
         }
 
-        if (w < static_cast<uint16_t>(out_max - 1)) {
+        // 文本行保留 1 字节给 '\0'
+        if (w < static_cast<uint16_t>(out_max - (bin ? 0 : 1))) {
             out[w++] = c;
         } else {
-            // out 空间不足：丢弃本行剩余部分直到 '\n'
-            cut = true;
-            while (tail != head) {
-                char cc = static_cast<char>(m_rxBuffer[tail]);
-                tail = IncIndex(tail, size);
-                if (cc == '\n') break;
-            }
-            break;
+            cut = true; // out 空间不足：继续扫描到消息尾，丢弃剩余部分
         }
     }
 
-    out[w] = '\0';
+    if (!bin) out[w] = '\0';
     m_rxTail = tail;
+    // 计数与缓冲内容不一致（理论上只在并发 Flush 时出现）：按已消费处理
+    if (ended || m_rxLinesOut != m_rxLinesIn) {
+        m_rxLinesOut = static_cast<uint16_t>(m_rxLinesOut + 1);
+    }
 
     if (cut) {
         ++m_lineOverflowCount;
         if (truncated) *truncated = true;
     }
+    if (out_len) *out_len = w;
+    if (binary) *binary = bin;
     return true;
 }
 
@@ -245,16 +555,29 @@ uint16_t USART_Controller::Receiver(uint8_t* buffer, uint16_t max_length) {
     uint16_t tail = m_rxTail;
     const uint16_t size = m_bufferSize;
 
+    uint16_t lines = 0;
+
     while ((head != tail) && (bytesRead < max_length)) {
-        buffer[bytesRead++] = m_rxBuffer[tail];
+        const uint8_t c = m_rxBuffer[tail];
+        buffer[bytesRead++] = c;
+        if (ScanRxByte(m_rxScanOut, c)) ++lines;
         tail = IncIndex(tail, size);
     }
     m_rxTail = tail;
+    // 绕过 ReadMessage 读走的消息边界也要计入，保持 HasLine() 与内容一致
+    m_rxLinesOut = static_cast<uint16_t>(m_rxLinesOut + lines);
     return bytesRead;
 }
 
 // ===== 中断 =====
+void USART_Controller::OnAbort(uint32_t t0_cycles) {
+    m_abortCount = static_cast<uint16_t>(m_abortCount + 1);
+    if (s_abortHook) s_abortHook(*this, t0_cycles);
+    NS_EVT::Post(NS_EVT::ABORT);
+}
+
 void USART_Controller::IRQHandler() {
+    const uint32_t t0 = SysTickTimer::GetCycles();
     if (btParams.USART == nullptr) return;
 
     // 先处理错误（FE/NE/ORE/PE），避免卡死在错误状态
@@ -274,6 +597,8 @@ void USART_Controller::IRQHandler() {
 
     if (USART_GetITStatus(btParams.USART, USART_IT_RXNE) != RESET) {
         uint8_t data = static_cast<uint8_t>(USART_ReceiveData(btParams.USART) & 0xFF);
+        // 急停优先于入队：缓冲满时也要生效
+        if (ScanAbort(m_rxScanIn, data)) OnAbort(t0);
 
         uint16_t head = m_rxHead;
         uint16_t next = IncIndex(head, m_bufferSize);
@@ -281,6 +606,11 @@ void USART_Controller::IRQHandler() {
         if (next != m_rxTail) {
             m_rxBuffer[head] = data;
             m_rxHead = next;
+            if (ScanRxByte(m_rxScanIn, data)) {
+                m_lineStamp.Write(SysTickTimer::GetMicros64());
+                m_rxLinesIn = static_cast<uint16_t>(m_rxLinesIn + 1);
+                NS_EVT::Post(NS_EVT::RX_LINE);
+            }
         } else {
             // 缓冲区满：丢弃该字节并统计
             ++m_rxOverflowCount;
@@ -290,6 +620,54 @@ void USART_Controller::IRQHandler() {
     }
 }
 
+void USART_Controller::RxDmaIRQHandler() {
+    if (m_rxUseDma) RxDmaService();
+}
+
+void USART_Controller::RxIdleIRQHandler() {
+    // IDLE 标志已由 USART_IRQnManage 按 SR->DR 顺序清除
+    isRXNE = 1;
+    if (m_rxUseDma) RxDmaService();
+}
+
+// DMA 写指针 = size - CNDTR；只扫描 [head, pos) 的新字节，每字节只看一次
+// HT/TC/IDLE 可能先后触发同一段数据，重复进入时新字节数为 0，直接返回
+void USART_Controller::RxDmaService() {
+    const uint32_t t0 = SysTickTimer::GetCycles();
+    const uint16_t size = m_bufferSize;
+    uint16_t pos = static_cast<uint16_t>(size - btParams.RX_DMA_Channel->CNDTR);
+    if (pos >= size) pos = 0;
+
+    uint16_t head = m_rxHead;
+    if (pos == head) return;
+
+    const uint16_t fresh = (pos > head) ? static_cast<uint16_t>(pos - head)
+                                        : static_cast<uint16_t>(size - head + pos);
+
+    // 新数据超过剩余空间：DMA 已覆盖未读内容，交给主循环整体重同步
+    const uint16_t tail = m_rxTail;
+    const uint16_t used = (head >= tail) ? static_cast<uint16_t>(head - tail)
+                                         : static_cast<uint16_t>(size - (tail - head));
+    if (fresh > static_cast<uint16_t>(size - 1 - used)) {
+        ++m_rxOverflowCount;
+        m_rxResync = true;
+    }
+
+    uint16_t lines = 0;
+    while (head != pos) {
+        const uint8_t c = m_rxBuffer[head];
+        if (ScanAbort(m_rxScanIn, c)) OnAbort(t0);
+        if (ScanRxByte(m_rxScanIn, c)) ++lines;
+        head = IncIndex(head, size);
+    }
+
+    if (lines != 0) m_lineStamp.Write(SysTickTimer::GetMicros64());
+    m_rxHead    = pos;
+    m_rxLinesIn = static_cast<uint16_t>(m_rxLinesIn + lines);
+    isRXNE = 1;
+    if (lines != 0 || m_rxResync) NS_EVT::Post(NS_EVT::RX_LINE);
+}
+
 // ===== 工具函数 =====
 uint32_t USART_Controller::Pow(uint32_t X, uint32_t Y) {
     uint32_t Result = 1;
@@ -3,18 +3,19 @@
 #include "stm32f10x.h"
 #include <stdio.h>
 #include <InitArg.h>
+#include "LockFree.h"
 #include "USART.h"
 #include <cstdarg>
 #include <array>
 #include <cstring>
 
-// USART 控制类：支持中断接收环形缓冲、阻塞式发送、按行读取、溢出统计
+// USART 控制类：支持中断接收环形缓冲、DMA 发送环形缓冲、按行读取、溢出统计
 class USART_Controller {
 public:
-    // 构造函数：指定 USART 外设和接收缓冲区大小（最大 256）
+    // 构造函数：指定 USART 外设和接收缓冲区大小（最大 512）
     USART_Controller(USART_TypeDef* USARTx = USART3,
                      BaudRate baudrate      = BaudRate::BAUD_115200,
-                     uint16_t buf_size      = 256);
+                     uint16_t buf_size      = 512);
 
     const USART::USART_Params& GetParams() const { return btParams; }
 
@@ -28,21 +29,66 @@ public:
     // RX 可读字节数（head/tail 差值）
     uint16_t Available() const;
 
-    // 当前 RX 缓冲区中是否存在一条以 '\n' 结束的完整行
-    bool HasLine() const;
+    // 当前 RX 缓冲区中是否存在一条完整消息（以 '\r' 或 '\n' 结束的文本行，或一个完整二进制帧）
+    // 消息边界由接收中断按块计数，这里是 O(1) 判断
+    bool HasLine() const { return m_rxLinesIn != m_rxLinesOut; }
+
+    // 最近一条完整消息到达的时刻（64 位微秒时间基准）：RXNE 模式按行，DMA 模式按接收块
+    uint64_t GetLineStampUs() const {
+        uint64_t us = 0;
+        return m_lineStamp.TryRead(us) ? us : 0;
+    }
+
+    // 待读取的完整消息数（CRLF 计为两行，第二行为空行）
+    uint16_t PendingLines() const { return static_cast<uint16_t>(m_rxLinesIn - m_rxLinesOut); }
 
     // 清空 RX 缓冲（丢弃所有已接收数据）
     void FlushRx();
 
-    // 按行读取：当且仅当缓冲区内存在 '\n' 时返回 true，并把一行写入 out（不含 '\r'/'\n'，自动 '\0' 结尾）
+    // 按行读取：当且仅当缓冲区内存在行结束符时返回 true，并把一行写入 out（不含 '\r'/'\n'，自动 '\0' 结尾）
+    // '\r' 与 '\n' 都视为行结束，CRLF 会额外得到一个空行，调用方跳过即可。
     // 若一行长度 >= out_max，会截断并丢弃本行剩余部分，truncated=true，同时 lineOverflowCount++。
+    // 遇到二进制帧时跳过（计入 binSkipCount），只返回文本行。
     bool ReadLine(char* out, uint16_t out_max, bool* truncated = nullptr);
 
+    // 按消息读取：文本行与二进制帧共用同一接收流。
+    // 二进制帧格式为 0x00 <COBS 编码数据> 0x00：0x00 从不出现在文本命令中，
+    // 因此帧内的 '\r'/'\n' 不会被当作行结束。连续的 0x00 视为帧间同步，帧前未结束的文本被丢弃。
+    // 返回 true 时 *binary 表示消息类型；文本行自动 '\0' 结尾（不计入 *out_len），
+    // 二进制帧为原始 COBS 数据（不含分隔符），由调用方解码。超长部分丢弃并置 truncated。
+    bool ReadMessage(uint8_t* out, uint16_t out_max, uint16_t* out_len, bool* binary, bool* truncated = nullptr);
+
     // 统计信息（便于定位“偶发半包/丢字节”）
     uint32_t GetRxOverflowCount() const { return m_rxOverflowCount; }   // 环形缓冲满导致丢字节
     uint32_t GetRxErrorCount() const    { return m_rxErrorCount; }      // ORE/FE/NE/PE 等错误计数
     uint32_t GetLineOverflowCount() const { return m_lineOverflowCount; } // ReadLine 截断计数
-    void ClearStats() { m_rxOverflowCount = m_rxErrorCount = m_lineOverflowCount = 0; }
+    uint32_t GetBinSkipCount() const    { return m_binSkipCount; }      // ReadLine 跳过的二进制帧
+    uint32_t GetTxDropCount() const     { return m_txDropCount; }       // TX 环形缓冲满导致丢弃的字节数
+    uint16_t GetTxHighWater() const     { return m_txHighWater; }       // TX 缓冲历史最高占用
+    void ClearStats() {
+        m_rxOverflowCount = m_rxErrorCount = m_lineOverflowCount = 0;
+        m_binSkipCount = 0;
+        m_txDropCount = 0;
+        m_txHighWater = 0;
+    }
+
+    // ===== 急停 =====
+    // 文本流中（二进制帧之外）连续 ABORT_LEN 个 ABORT_BYTE（Ctrl-X）由接收中断直接识别，
+    // 立即调用急停钩子（所有链路共用），不经主循环；这些字节不会出现在 ReadLine/ReadMessage 的结果里。
+    // t0_cycles 为识别所在中断入口处的 DWT 计数，供钩子统计延迟。
+    static const uint8_t ABORT_BYTE = 0x18;
+    static const uint8_t ABORT_LEN  = 3;
+    using AbortHook = void (*)(USART_Controller& link, uint32_t t0_cycles);
+    static void SetAbortHook(AbortHook hook) { s_abortHook = hook; }
+
+    // 主循环调用：自上次以来本链路是否收到过急停序列
+    bool ConsumeAbort() {
+        const uint16_t n = m_abortCount;
+        const bool hit = (n != m_abortSeen);
+        m_abortSeen = n;
+        return hit;
+    }
+    uint16_t GetAbortCount() const { return m_abortCount; }
 
     bool Start();
     void Continue();
@@ -51,18 +97,55 @@ public:
     // 初始化串口（RCC / GPIO / USART）
     bool Init();
 
+    // ===== 波特率 / 硬件流控 =====
+    // 由实际 PCLK 计算 BRR：要求 baud <= PCLK/16 且实际波特率误差 <= 2%
+    bool IsBaudSupported(uint32_t baud, uint32_t* actual = nullptr) const;
+    uint32_t GetBaudRate() const { return m_baudrate; }
+    uint32_t GetPclk() const;
+
+    // 立即切换波特率（先等 TX 发完）；不支持时返回 false 且保持原设置
+    bool SetBaudRate(uint32_t baud);
+
+    // RTS/CTS 硬件流控（需配置表中有 CTS/RTS 引脚）；立即生效
+    bool SetFlowControl(bool enable);
+    bool GetFlowControl() const { return m_flowControl; }
+
+    // 带握手的切换：先以旧波特率回复、切换，然后等待对端在 timeout_ms 内以新波特率确认
+    // （ConfirmBaudChange），超时由 Service() 自动回退到旧设置
+    bool BeginBaudChange(uint32_t baud, bool flow, uint32_t timeout_ms = 3000);
+    bool ConfirmBaudChange();
+    bool IsBaudChangePending() const { return m_baudPending; }
+
+    // 主循环调用：处理波特率握手超时回退。返回 true 表示刚刚发生了回退
+    bool Service();
+
     // 发送原始数据（阻塞式）
     void Send(const uint8_t* data, uint16_t length);
     void Send(const char* str);
 
-    // Printf 风格发送（依赖你已有的 My_USART_Printf）
+    // Printf 风格发送：格式化到栈上缓冲后进入 TX 环形缓冲（非阻塞，超长部分截断）
     template<typename... Args>
     void Printf(const char* format, Args... args) {
-        My_USART_Printf(this->btParams.USART, format, args...);
+        char buf[PRINTF_BUF_SIZE];
+        int n = snprintf(buf, sizeof(buf), format, args...);
+        if (n <= 0) return;
+        if (n >= (int)sizeof(buf)) n = (int)sizeof(buf) - 1;
+        Write(reinterpret_cast<const uint8_t*>(buf), static_cast<uint16_t>(n));
     }
 
-    // 底层写接口：直接发送任意字节流（JSON 等优先用这个）
-    void Write(const uint8_t* data, uint16_t length);
+    // 底层写接口（非阻塞）：拷贝进 TX 环形缓冲并由 DMA 后台发送，返回实际接收的字节数。
+    // 缓冲区不足时只接收能放下的部分，其余计入 TxDropCount。
+    uint16_t Write(const uint8_t* data, uint16_t length);
+
+    // 整帧写入：空间足够才整体接收，否则整帧丢弃（避免 JSON/二进制帧被截半）
+    bool WriteFrame(const uint8_t* data, uint16_t length);
+
+    // TX 缓冲剩余空间 / 待发送字节数
+    uint16_t TxFree() const;
+    uint16_t TxPending() const;
+
+    // 等待 TX 缓冲全部发出（含移位寄存器最后一帧），超时返回 false
+    bool Flush(uint32_t timeout_ms = 100);
 
     // 从环形接收缓冲区读取最多 max_length 字节（不等待、不保证读到一整行）
     uint16_t Receiver(uint8_t* buffer, uint16_t max_length);
@@ -70,6 +153,14 @@ public:
     // 中断处理函数（在 USARTx IRQHandler 中调用）
     void IRQHandler();
 
+    // TX DMA 传输完成中断（在 DMA_IRQnManage 的 TC 回调中调用）
+    void TxDmaIRQHandler();
+
+    // RX 循环 DMA：半满/全满（DMA HT/TC）与总线空闲（USART IDLE）中断中调用，
+    // 按块推进 head 并统计行结束符
+    void RxDmaIRQHandler();
+    void RxIdleIRQHandler();
+
     // 重新绑定 USART 和波特率
     void Reset(USART_TypeDef* usartx,
                BaudRate baudrate = BaudRate::BAUD_115200);
@@ -86,21 +177,110 @@ private:
 
     USART::USART_Params btParams{};
     uint32_t m_baudrate = 0;
+    bool     m_flowControl = false;
 
-    // 接收缓冲区（固定 256 字节），实际使用大小由 m_bufferSize 控制
-    std::array<uint8_t, 256> m_rxBuffer{};
-    uint16_t           m_bufferSize = 256;
+    // 波特率握手：待确认期间保存旧设置，超时回退
+    bool     m_baudPending   = false;
+    uint32_t m_prevBaudrate  = 0;
+    bool     m_prevFlow      = false;
+    uint32_t m_baudDeadline  = 0;
+
+    static const uint16_t PRINTF_BUF_SIZE = 192;
+
+    // 接收缓冲区（固定 512 字节），实际使用大小由 m_bufferSize 控制
+    // DMA 模式下它同时是循环 DMA 的目标缓冲
+    std::array<uint8_t, 512> m_rxBuffer{};
+    uint16_t           m_bufferSize = 512;
     volatile uint16_t  m_rxHead  = 0;
     volatile uint16_t  m_rxTail  = 0;
+    bool               m_rxUseDma = false;
+
+    // 消息计数：中断只写 m_rxLinesIn，主循环只写 m_rxLinesOut，二者之差即待读消息数
+    volatile uint16_t  m_rxLinesIn  = 0;
+    volatile uint16_t  m_rxLinesOut = 0;
+
+    // 文本/二进制帧状态机：中断与主循环各持一份，按同一字节序列推进，因此对消息边界的判断一致
+    struct RxScan {
+        bool inFrame = false;   // 已见到起始 0x00
+        bool body    = false;   // 帧内已有非 0 字节
+        uint8_t abortRun = 0;   // 帧外连续 ABORT_BYTE 个数（仅中断侧使用）
+    };
+    RxScan m_rxScanIn;          // 中断写
+    RxScan m_rxScanOut;         // 主循环写
+    // DMA 覆盖了未读数据：中断置位，主循环读取时整体丢弃重新同步
+    volatile bool      m_rxResync   = false;
+
+    // 急停：中断计数，主循环记录已处理到的值
+    static AbortHook   s_abortHook;
+    volatile uint16_t  m_abortCount = 0;
+    NS_LF::Seqlock<uint64_t> m_lineStamp;   // USART/DMA 中断写（同一优先级，单写者），主循环读
+    uint16_t           m_abortSeen  = 0;
 
     // 统计：RX 丢字节 / RX 错误 / 行截断
     volatile uint32_t m_rxOverflowCount = 0;
     volatile uint32_t m_rxErrorCount    = 0;
     volatile uint32_t m_lineOverflowCount = 0;
+    uint32_t          m_binSkipCount = 0;
+
+    // 发送环形缓冲：主循环写 head，DMA 完成中断推进 tail
+    // m_txDmaLen != 0 表示 DMA 正在发送 [tail, tail + m_txDmaLen)
+    std::array<uint8_t, 1024> m_txBuffer{};
+    volatile uint16_t m_txHead   = 0;
+    volatile uint16_t m_txTail   = 0;
+    volatile uint16_t m_txDmaLen = 0;
+    bool              m_txUseDma = false;
+
+    // 统计：TX 丢字节 / 最高占用
+    volatile uint32_t m_txDropCount = 0;
+    uint16_t          m_txHighWater = 0;
 
     void RCC_Config();
     void GPIO_Config();
     void USART_Config();
+    void FlowGPIO_Config();
+    void ApplyLineSettings(uint32_t baud, bool flow);
+    void TxDmaConfig();
+    void RxDmaConfig();
+
+    // 处理 DMA 自上次以来写入的新字节（仅在中断上下文调用）
+    void RxDmaService();
+
+    static bool IsLineEnd(uint8_t c) { return c == '\n' || c == '\r'; }
+
+    // 推进帧状态机，返回 true 表示 c 结束了一条消息（文本行结束符或帧尾 0x00）
+    static bool ScanRxByte(RxScan& st, uint8_t c) {
+        if (st.inFrame) {
+            if (c != 0x00) {
+                st.body = true;
+                return false;
+            }
+            if (!st.body) return false;         // 连续 0x00：帧间同步
+            st.inFrame = st.body = false;
+            return true;
+        }
+        if (c == 0x00) {
+            st.inFrame = true;
+            st.body = false;
+            return false;
+        }
+        return IsLineEnd(c);
+    }
+
+    // 急停序列识别：按接收前的帧状态判断，帧内字节与其他字节都会打断计数
+    static bool ScanAbort(RxScan& st, uint8_t c) {
+        if (st.inFrame || c != ABORT_BYTE) {
+            st.abortRun = 0;
+            return false;
+        }
+        if (++st.abortRun < ABORT_LEN) return false;
+        st.abortRun = 0;
+        return true;
+    }
+    void OnAbort(uint32_t t0_cycles);
+
+    // 启动下一段连续数据的 DMA 发送（调用方需保证与 DMA 中断互斥）
+    void KickTx();
+    void WriteBlocking(const uint8_t* data, uint16_t length);
 
     static uint16_t IncIndex(uint16_t idx, uint16_t mod) {
         ++idx;
@@ -120,3 +300,35 @@ inline USART_Controller& GetStaticBt(USART_TypeDef* USARTx = USART3) {
 inline void BT_IRQHandler() {
     GetStaticBt().IRQHandler();
 }
+
+// TX DMA 完成中断封装：注册到 DMA_IRQnManage（USART3 TX -> DMA1_Channel2）
+inline void BT_TxDmaIRQHandler() {
+    GetStaticBt().TxDmaIRQHandler();
+}
+
+// RX 循环 DMA 封装：DMA HT/TC（USART3 RX -> DMA1_Channel3）与 USART IDLE
+inline void BT_RxDmaIRQHandler() {
+    GetStaticBt().RxDmaIRQHandler();
+}
+inline void BT_RxIdleIRQHandler() {
+    GetStaticBt().RxIdleIRQHandler();
+}
+
+// 有线链路（台架全速原始数据）：USART1 PA9/PA10，TX -> DMA1_Channel4，RX -> DMA1_Channel5
+inline USART_Controller& GetStaticWired() {
+    static USART_Controller instance(USART1, BaudRate::BAUD_115200);
+    return instance;
+}
+
+inline void Wired_IRQHandler() {
+    GetStaticWired().IRQHandler();
+}
+inline void Wired_TxDmaIRQHandler() {
+    GetStaticWired().TxDmaIRQHandler();
+}
+inline void Wired_RxDmaIRQHandler() {
+    GetStaticWired().RxDmaIRQHandler();
+}
+inline void Wired_RxIdleIRQHandler() {
+    GetStaticWired().RxIdleIRQHandler();
+}
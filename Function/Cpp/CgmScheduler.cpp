@@ -0,0 +1,425 @@
+#include "CgmScheduler.h"
+#include "ADCManager.h"
+#include "DACManager.h"
+#include "IRQnManage.h"
+#include "SysTickTimer.h"
+#include "EventFlags.h"
+#include "FastFmt.h"
+
+namespace NS_CGM
+{
+    // RTC 计数频率：LSE 32768/32 = 1024Hz；LSI 约 40kHz/39 ≈ 1026Hz（LSI 本身有 ±几十 % 偏差）
+    static const uint32_t RTC_TARGET_HZ  = 1024;
+    static const uint32_t LSE_HZ         = 32768;
+    static const uint32_t LSI_HZ         = 40000;
+    static const uint32_t LSE_TIMEOUT_MS = 2000;
+    static const uint32_t LSI_TIMEOUT_MS = 10;
+    static const uint32_t MIN_SPACING_US = 20;     // 两次取样至少隔一轮扫描
+
+    static Config   s_cfg;
+    static Phase    s_phase = Phase::OFF;
+    static Totals   s_totals;
+    static bool     s_ownsDac = false;
+
+    static bool     s_rtcReady = false;
+    static bool     s_rtcLse = false;
+    static uint32_t s_rtcHz = RTC_TARGET_HZ;
+    static uint32_t s_rtcRem = 0;                   // RTC 计数换算毫秒的余数（跨多次 Stop 累计）
+
+    static volatile bool s_alarm = false;           // RTC 闹钟中断置位
+    static volatile bool s_linkWake = false;
+    static uint32_t s_wakeLines = 0;                // 串口唤醒 EXTI 线
+
+    static uint32_t s_cycleCnt = 0;                 // 本周期开始时的 RTC 计数（闹钟按它排）
+    static uint64_t s_cycleUs = 0;                  // 本周期开始时刻，0 表示还没有完整周期
+    static uint64_t s_sleepStartUs = 0;             // WFI 睡眠阶段开始
+    static uint64_t s_sleepUsAcc = 0;               // 本周期内的睡眠时间
+    static uint32_t s_settleStart = 0;
+    static uint32_t s_activityTick = 0;
+    static bool     s_listen = false;
+
+    static Cycle    s_lastCycle;
+    static bool     s_hasCycle = false;
+    static Result   s_log[LOG_SIZE];
+    static uint32_t s_seq = 0;
+
+    // ------------------------ 中断 ------------------------
+
+    static void OnAlarm() {
+        if (RTC_GetITStatus(RTC_IT_ALR) != RESET) RTC_ClearITPendingBit(RTC_IT_ALR);
+        s_alarm = true;
+        NS_EVT::Post(NS_EVT::CGM);
+    }
+
+    static void OnLinkWake() {
+        s_linkWake = true;
+        NS_EVT::Post(NS_EVT::CGM);
+    }
+
+    // ------------------------ RTC ------------------------
+
+    static bool WaitFlag(uint16_t flag, uint32_t timeout_ms) {
+        const uint32_t t0 = SysTickTimer::GetTick();
+        while (RCC_GetFlagStatus(flag) == RESET) {
+            if (SysTickTimer::GetTick() - t0 >= timeout_ms) return false;
+        }
+        return true;
+    }
+
+    // RTC 在备份域：时钟源（RTCSEL）只能由备份域复位改回，首次上电时选 LSE，起振失败退回 LSI。
+    // LSI 不在备份域，每次复位后都要重新打开
+    static bool InitRtc() {
+        if (s_rtcReady) return true;
+        RCC_APB1PeriphClockCmd(RCC_APB1Periph_PWR | RCC_APB1Periph_BKP, ENABLE);
+        PWR_BackupAccessCmd(ENABLE);
+
+        uint32_t sel = RCC->BDCR & RCC_BDCR_RTCSEL;
+        if (sel == 0) {
+            RCC_LSEConfig(RCC_LSE_ON);
+            if (WaitFlag(RCC_FLAG_LSERDY, LSE_TIMEOUT_MS)) {
+                RCC_RTCCLKConfig(RCC_RTCCLKSource_LSE);
+            } else {
+                RCC_LSEConfig(RCC_LSE_OFF);
+                RCC_LSICmd(ENABLE);
+                if (!WaitFlag(RCC_FLAG_LSIRDY, LSI_TIMEOUT_MS)) return false;
+                RCC_RTCCLKConfig(RCC_RTCCLKSource_LSI);
+            }
+            sel = RCC->BDCR & RCC_BDCR_RTCSEL;
+        } else if (sel == RCC_BDCR_RTCSEL_LSI) {
+            RCC_LSICmd(ENABLE);
+            if (!WaitFlag(RCC_FLAG_LSIRDY, LSI_TIMEOUT_MS)) return false;
+        } else if (sel == RCC_BDCR_RTCSEL_LSE) {
+            if (!WaitFlag(RCC_FLAG_LSERDY, LSE_TIMEOUT_MS)) return false;
+        } else {
+            return false;       // HSE/128 在 Stop 中停振，不能用作唤醒
+        }
+        RCC_RTCCLKCmd(ENABLE);
+
+        s_rtcLse = (sel == RCC_BDCR_RTCSEL_LSE);
+        const uint32_t src = s_rtcLse ? LSE_HZ : LSI_HZ;
+        const uint32_t prl = src / RTC_TARGET_HZ - 1u;
+        s_rtcHz = src / (prl + 1u);
+
+        RTC_WaitForSynchro();
+        RTC_WaitForLastTask();
+        RTC_SetPrescaler(prl);
+        RTC_WaitForLastTask();
+
+        // 闹钟经 EXTI17 上升沿进入 RTCAlarm 中断，同时是 Stop 的唤醒源
+        EXTI_InitTypeDef exti;
+        EXTI_StructInit(&exti);
+        exti.EXTI_Line = EXTI_Line17;
+        exti.EXTI_Mode = EXTI_Mode_Interrupt;
+        exti.EXTI_Trigger = EXTI_Trigger_Rising;
+        exti.EXTI_LineCmd = ENABLE;
+        EXTI_Init(&exti);
+        (void)EXTI_IRQnManage::Add(EXTI_IRQnManage::LINE_RTC_ALARM, OnAlarm, 2, 2);
+
+        s_rtcReady = true;
+        return true;
+    }
+
+#ifndef USE_CMSIS_RTOS2
+    static uint32_t RtcTicksToMs(uint32_t ticks) {
+        const uint64_t num = (uint64_t)ticks * 1000u + s_rtcRem;
+        s_rtcRem = (uint32_t)(num % s_rtcHz);
+        return (uint32_t)(num / s_rtcHz);
+    }
+#endif
+
+    // 下一次闹钟按周期起点排，唤醒时长不会累积成周期漂移；已经过点则尽快唤醒并计一次超时
+    static void ArmAlarm() {
+        const uint32_t now = RTC_GetCounter();
+        uint32_t due = s_cycleCnt + s_cfg.periodS * s_rtcHz;
+        if ((int32_t)(due - now) < 2) {
+            due = now + 2u;
+            ++s_totals.overruns;
+        }
+        s_alarm = false;
+        RTC_WaitForLastTask();
+        RTC_SetAlarm(due);
+        RTC_WaitForLastTask();
+    }
+
+    // ------------------------ 时钟 ------------------------
+
+#ifndef USE_CMSIS_RTOS2
+    // Stop 唤醒后系统时钟为 HSI（8MHz），HSE 与 PLL 已关闭；PLL 倍频、总线分频、ADC 分频与 Flash 等待周期
+    // 都在 CFGR/ACR 中保持不变，只需重新起振并切回 PLL
+    static void RestoreClocks() {
+        RCC_HSEConfig(RCC_HSE_ON);
+        while (RCC_WaitForHSEStartUp() != SUCCESS) {
+            ++s_totals.hseRetries;
+        }
+        RCC_PLLCmd(ENABLE);
+        while (RCC_GetFlagStatus(RCC_FLAG_PLLRDY) == RESET) {}
+        RCC_SYSCLKConfig(RCC_SYSCLKSource_PLLCLK);
+        while (RCC_GetSYSCLKSource() != 0x08) {}
+    }
+#endif
+
+    // ------------------------ 周期 ------------------------
+
+    static void CloseCycle(uint64_t now) {
+        if (s_cycleUs == 0) return;
+        const uint64_t span = now - s_cycleUs;
+        const uint64_t sleep = (s_sleepUsAcc < span) ? s_sleepUsAcc : span;
+        const uint64_t awake = span - sleep;
+        if (span == 0) return;
+
+        // mA·µs = nC；× V = nJ
+        const float sleepMa = s_lastCycle.stop ? s_cfg.stopUa * 0.001f : s_cfg.idleMa;
+        const float charge = s_cfg.runMa * (float)awake + sleepMa * (float)sleep;
+        const float energyUj = charge * s_cfg.vdd * 0.001f;
+
+        Cycle& c = s_lastCycle;
+        c.cycleUs  = (uint32_t)span;
+        c.awakeUs  = (uint32_t)awake;
+        c.dutyPpm  = (uint32_t)(awake * 1000000u / span);
+        c.energyUj = (uint32_t)(energyUj + 0.5f);
+        c.avgUa    = (uint32_t)(charge * 1000.0f / (float)span + 0.5f);
+        s_hasCycle = true;
+
+        ++s_totals.cycles;
+        s_totals.awakeUs  += awake;
+        s_totals.sleepUs  += sleep;
+        s_totals.energyUj += c.energyUj;
+    }
+
+    static void BeginCycle() {
+        const uint64_t now = SysTickTimer::GetMicros64();
+        if (s_phase == Phase::SLEEP && !s_lastCycle.stop) s_sleepUsAcc += now - s_sleepStartUs;
+        CloseCycle(now);
+        s_cycleUs = now;
+        s_sleepUsAcc = 0;
+        s_lastCycle.stop = false;
+        s_cycleCnt = RTC_GetCounter();
+        NS_ADC::GetStaticADC().PowerUp();
+        s_settleStart = SysTickTimer::GetTick();
+        s_phase = Phase::SETTLE;
+    }
+
+    // BURST 轮在 SPAN 内等间隔取样（DWT 计时忙等，窗口最长 200ms）
+    static void Acquire(Result& r) {
+        auto& adc = NS_ADC::GetStaticADC();
+        const auto& p = adc.GetInitParams();
+        const uint8_t nch = (p.nbr_of_channels < 3) ? p.nbr_of_channels : 3;
+        const uint32_t n = s_cfg.burst ? s_cfg.burst : 1;
+
+        uint32_t spacingUs = s_cfg.spanMs * 1000u / n;
+        if (spacingUs < MIN_SPACING_US) spacingUs = MIN_SPACING_US;
+        const uint32_t spacing = spacingUs * SysTickTimer::CyclesPerUs();
+
+        uint32_t sum[3] = {0, 0, 0};
+        uint16_t v[3] = {0, 0, 0};
+        uint32_t t = SysTickTimer::GetCycles();
+        for (uint32_t i = 0; i < n; ++i) {
+            while (SysTickTimer::GetCycles() - t < spacing) {}
+            t += spacing;
+            (void)adc.ReadSequence(v, nch);
+            for (uint8_t c = 0; c < nch; ++c) sum[c] += v[c];
+        }
+
+        r.us  = SysTickTimer::GetMicros64();
+        r.nch = nch;
+        r.n   = (uint16_t)n;
+        r.ref = adc.GetRefVal();
+        for (uint8_t c = 0; c < nch; ++c) {
+            r.avgX10[c] = (int32_t)((sum[c] * 10u + n / 2u) / n);
+            // pA = (码 - 参考码) × 1e12 / (码/V × Ω)，与遥测 I0..I2（nA）、ShowVoltage 同一换算
+            const uint32_t gain = (p.channels && p.channels[c].gain) ? p.channels[c].gain : 1u;
+            float pa = ((float)r.avgX10[c] * 0.1f - (float)r.ref) * 1.0e12f / (NS_ADC::ADC::stepPerVolt * (float)gain);
+            if (pa > 2.0e9f) pa = 2.0e9f;
+            if (pa < -2.0e9f) pa = -2.0e9f;
+            r.curPa[c] = (int32_t)pa;
+        }
+    }
+
+    // ------------------------ 接口 ------------------------
+
+    void SetConfig(const Config& cfg) {
+        s_cfg = cfg;
+#ifdef USE_CMSIS_RTOS2
+        s_cfg.lowPower = false;
+#endif
+    }
+
+    Status Start(const Config& cfg) {
+        if (s_phase != Phase::OFF) {
+            SetConfig(cfg);
+            return Status::OK;
+        }
+        auto& sys = NS_DAC::SystemController::GetInstance();
+        if (sys.IsRunning()) return Status::BUSY;
+        if (!InitRtc()) return Status::NO_RTC;
+
+        SetConfig(cfg);
+        // 偏置与扫描通道常量（IT 模式）整个测量期间保持输出，ADC 开始连续转换
+        sys.SetMode(NS_DAC::RunMode::IT);
+        sys.Start();
+        s_ownsDac = true;
+
+        RTC_ClearITPendingBit(RTC_IT_ALR);
+        RTC_WaitForLastTask();
+        RTC_ITConfig(RTC_IT_ALR, ENABLE);
+        RTC_WaitForLastTask();
+
+        s_totals = Totals();
+        s_hasCycle = false;
+        s_cycleUs = 0;
+        s_phase = Phase::OFF;
+        BeginCycle();
+        return Status::OK;
+    }
+
+    void Stop() {
+        if (s_phase == Phase::OFF) return;
+        RTC_ITConfig(RTC_IT_ALR, DISABLE);
+        RTC_WaitForLastTask();
+        s_alarm = false;
+        NS_ADC::GetStaticADC().PowerUp();
+        if (s_ownsDac) NS_DAC::SystemController::GetInstance().Stop();
+        s_ownsDac = false;
+        s_phase = Phase::OFF;
+    }
+
+    bool IsActive() { return s_phase != Phase::OFF; }
+    Phase GetPhase() { return s_phase; }
+    const Config& GetConfig() { return s_cfg; }
+    const Totals& GetTotals() { return s_totals; }
+    bool IsRtcLse() { return s_rtcLse; }
+    uint32_t GetRtcHz() { return s_rtcHz; }
+
+    void NoteActivity() {
+        s_activityTick = SysTickTimer::GetTick();
+        s_listen = true;
+    }
+
+    static bool Listening() {
+        if (s_listen && SysTickTimer::GetTick() - s_activityTick >= LISTEN_MS) s_listen = false;
+        return s_listen;
+    }
+
+    bool Service(uint32_t* wait_ms) {
+        if (s_linkWake) {
+            s_linkWake = false;
+            ++s_totals.linkWakes;
+            NoteActivity();
+        }
+        if (s_phase == Phase::OFF) return false;
+
+        if (s_phase == Phase::SLEEP) {
+            if (!s_alarm) return false;
+            s_alarm = false;
+            BeginCycle();
+        }
+
+        const uint32_t elapsed = SysTickTimer::GetTick() - s_settleStart;
+        if (elapsed < s_cfg.settleMs) {
+            const uint32_t left = s_cfg.settleMs - elapsed;
+            if (wait_ms && left < *wait_ms) *wait_ms = left;
+            return false;
+        }
+
+        Result& r = s_log[s_seq % LOG_SIZE];
+        r = Result();
+        Acquire(r);
+        r.seq = s_seq++;
+        r.hasCycle = s_hasCycle;
+        r.cycle = s_lastCycle;
+
+        NS_ADC::GetStaticADC().PowerDown();
+        ArmAlarm();
+        s_lastCycle.stop = s_cfg.lowPower;
+        s_sleepStartUs = SysTickTimer::GetMicros64();
+        s_phase = Phase::SLEEP;
+        return true;
+    }
+
+    bool CanStop() {
+#ifdef USE_CMSIS_RTOS2
+        return false;
+#else
+        return s_phase == Phase::SLEEP && s_cfg.lowPower && !s_alarm && !Listening();
+#endif
+    }
+
+    void Sleep() {
+#ifndef USE_CMSIS_RTOS2
+        if (!CanStop()) return;
+        // 关中断进入：WFI 照样被挂起的中断唤醒，但 ISR 等时钟恢复、时间基准补齐后才执行
+        __disable_irq();
+        if (s_alarm) {
+            __enable_irq();
+            return;
+        }
+        EXTI->PR = s_wakeLines;
+        EXTI->IMR |= s_wakeLines;
+        const uint32_t c0 = RTC_GetCounter();
+
+        PWR_EnterSTOPMode(PWR_Regulator_LowPower, PWR_STOPEntry_WFI);
+
+        RestoreClocks();
+        // Stop 期间 APB1 停止，RTC 寄存器要重新同步才能读到新的计数
+        RTC_WaitForSynchro();
+        const uint32_t ms = RtcTicksToMs(RTC_GetCounter() - c0);
+        SysTickTimer::AdvanceMs(ms);
+        s_sleepUsAcc += (uint64_t)ms * 1000u;
+        ++s_totals.stops;
+
+        // 串口唤醒线只在 Stop 期间打开（平时 RX 引脚一直在翻转）；挂起位留着，屏蔽后不会再分发
+        if (EXTI->PR & s_wakeLines) s_linkWake = true;
+        EXTI->IMR &= ~s_wakeLines;
+        __enable_irq();
+#endif
+    }
+
+    bool AddWakePin(GPIO_TypeDef* port, uint16_t pin) {
+        if (pin == 0 || (pin & (pin - 1u)) != 0) return false;
+        const uint8_t line = (uint8_t)(31u - __CLZ(pin));
+        const uint8_t portSource = (uint8_t)(((uintptr_t)port - GPIOA_BASE) / (GPIOB_BASE - GPIOA_BASE));
+        if (!EXTI_IRQnManage::Add(line, OnLinkWake, 2, 2)) return false;
+
+        RCC_APB2PeriphClockCmd(RCC_APB2Periph_AFIO, ENABLE);
+        GPIO_EXTILineConfig(portSource, line);
+        const uint32_t bit = 1u << line;
+        EXTI->IMR  &= ~bit;
+        EXTI->RTSR &= ~bit;
+        EXTI->FTSR |= bit;          // 起始位下降沿
+        s_wakeLines |= bit;
+        return true;
+    }
+
+    bool GetResult(uint8_t age, Result* out) {
+        if (age >= LOG_SIZE || age >= s_seq || !out) return false;
+        *out = s_log[(s_seq - 1u - age) % LOG_SIZE];
+        return true;
+    }
+
+    void FormatResult(const Result& r, NS_FMT::FmtBuf& f) {
+        static const char* const kRaw[3] = { " CH0=", " CH1=", " CH2=" };
+        static const char* const kCur[3] = { " I0=", " I1=", " I2=" };
+        f.Str("CGM #").U32(r.seq).Str(" US=").U64(r.us).Str(" N=").U32(r.n).Str(" REF=").U32(r.ref);
+        for (uint8_t c = 0; c < r.nch; ++c) {
+            f.Str(kRaw[c]).Fixed(r.avgX10[c], 1);
+            f.Str(kCur[c]).I32(r.curPa[c]).Str("pA");
+        }
+        if (r.hasCycle) {
+            const Cycle& c = r.cycle;
+            f.Str(" | CYCLE=").U32(c.cycleUs / 1000u).Str("ms AWAKE=").Fixed((int32_t)(c.awakeUs / 100u), 1)
+             .Str("ms DUTY=").Fixed((int32_t)(c.dutyPpm / 10u), 3).Str("% E=").U32(c.energyUj)
+             .Str("uJ IAVG=").U32(c.avgUa).Str("uA ").Str(c.stop ? "STOP" : "WFI");
+        }
+        f.Str("\r\n");
+    }
+
+    const char* PhaseToString(Phase p) {
+        switch (p) {
+        case Phase::OFF:    return "OFF";
+        case Phase::SETTLE: return "SETTLE";
+        case Phase::SLEEP:  return "SLEEP";
+        default: return "?";
+        }
+    }
+
+} // namespace NS_CGM
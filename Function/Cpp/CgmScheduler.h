@@ -0,0 +1,107 @@
+#pragma once
+#include "stm32f10x.h"
+#include <stdint.h>
+
+namespace NS_FMT { class FmtBuf; }
+
+// 低功耗周期测量（CGM）：偏置持续输出，两次测量之间 Stop 模式睡眠，RTC 闹钟唤醒。
+// 一个周期：
+//   RTC 闹钟 → 恢复 HSE/PLL 并按 RTC 补齐 SysTick 时间基准 → ADC 上电校准 → 等待 SETTLE
+//   → BURST 轮扫描在 SPAN 毫秒内等间隔取样求平均 → 两条链路上报并写入 RAM 记录 → ADC 断电 → Stop
+// 偏置通道（CH1）与扫描通道常量（IT 模式，CH2）在 Stop 中保持输出：DAC 输出是模拟保持，不需要时钟。
+// 能量按“运行电流 × 唤醒时间 + 睡眠电流 × 睡眠时间”估计：电流为板级标定常数（RUNMA/STOPUA/IDLEMA），
+// 时间为实测（Stop 时长由 RTC 计数，其余由 64 位时间基准）。每条测量附带上一个完整周期的估计。
+// USE_CMSIS_RTOS2：内核节拍在 Stop 中会停，不进 Stop，睡眠由空闲线程 WFI 完成（按 IDLEMA 计）。
+namespace NS_CGM
+{
+    struct Config {
+        uint32_t periodS  = 60;         // 测量周期（秒）
+        uint32_t settleMs = 200;        // 唤醒后到开始取样
+        uint32_t burst    = 32;         // 每次平均的扫描轮数
+        uint32_t spanMs   = 20;         // 取样窗口（20ms = 一个 50Hz 工频周期）
+        bool     lowPower = true;       // true：Stop 模式；false：只 WFI（调试时保留 SWD 与串口）
+        float    runMa    = 25.0f;      // 运行电流（72MHz，外设全开）
+        float    stopUa   = 500.0f;     // Stop 电流（含两路 DAC 输出缓冲与模拟前端）
+        float    idleMa   = 8.0f;       // WFI 睡眠电流
+        float    vdd      = 3.3f;
+        uint32_t capMah   = 200;        // 电池容量，只用于估算续航
+    };
+
+    enum class Phase : uint8_t { OFF = 0, SETTLE, SLEEP };
+    enum class Status : uint8_t { OK = 0, BUSY, NO_RTC };
+
+    // 上一个完整周期（两次唤醒之间）的时间与能量估计
+    struct Cycle {
+        uint32_t cycleUs = 0;
+        uint32_t awakeUs = 0;
+        uint32_t dutyPpm = 0;           // 唤醒占比（百万分之）
+        uint32_t energyUj = 0;
+        uint32_t avgUa = 0;
+        bool     stop = false;          // 睡眠是 Stop 模式（否则 WFI）
+    };
+
+    struct Result {
+        uint32_t seq = 0;
+        uint64_t us = 0;                // 取样完成时刻（64 位时间基准）
+        uint8_t  nch = 0;
+        uint16_t n = 0;                 // 实际平均的轮数
+        uint16_t ref = 0;               // 参考电压对应的 ADC 码
+        int32_t  avgX10[3] = {0, 0, 0}; // 平均 ADC 码 ×10
+        int32_t  curPa[3] = {0, 0, 0};  // 换算电流（pA）
+        bool     hasCycle = false;      // 第一次测量没有上一周期
+        Cycle    cycle;
+    };
+
+    struct Totals {
+        uint32_t cycles = 0;
+        uint32_t stops = 0;             // 进入 Stop 的次数（含被立即唤醒的）
+        uint32_t overruns = 0;          // 唤醒时长超过周期，下一次闹钟顺延
+        uint32_t linkWakes = 0;         // 串口 RX 唤醒
+        uint32_t hseRetries = 0;        // 唤醒后 HSE 起振重试
+        uint64_t awakeUs = 0;
+        uint64_t sleepUs = 0;
+        uint64_t energyUj = 0;
+    };
+
+    static const uint8_t  LOG_SIZE  = 16;
+    static const uint32_t LISTEN_MS = 5000;     // 收到命令或串口唤醒后保持唤醒，等待后续命令
+
+    // 开始周期测量：扫描通道切到 IT 常量输出并启动 DAC/ADC（已在运行时返回 BUSY）。
+    // 已开启时只更新配置，下一周期生效
+    Status Start(const Config& cfg);
+    // 只更新配置（开启中则下一周期生效）
+    void   SetConfig(const Config& cfg);
+    // 停止周期测量，关闭由 Start 启动的 DAC 输出，ADC 恢复上电
+    void   Stop();
+    bool   IsActive();
+    Phase  GetPhase();
+    const Config& GetConfig();
+    const Totals& GetTotals();
+    bool   IsRtcLse();
+    uint32_t GetRtcHz();
+
+    // 主循环（RTOS：命令线程）调用：推进状态机。返回 true 表示刚完成一次测量（GetResult(0) 取）；
+    // *wait_ms 收紧为状态机下次需要被调用的最长间隔
+    bool Service(uint32_t* wait_ms);
+
+    // 本周期已完成、不在命令等待窗口内，可以进 Stop（调用方先确认链路 TX 发完、没有待处理命令）
+    bool CanStop();
+    // 进入 Stop 睡到 RTC 闹钟或串口唤醒；返回时系统时钟与时间基准均已恢复。仅裸机构建
+    void Sleep();
+
+    // 收到命令时调用：LISTEN_MS 内不进 Stop
+    void NoteActivity();
+
+    // Stop 唤醒源：串口 RX 引脚下降沿。Stop 中 USART 无时钟，唤醒的那一行会丢失，
+    // 之后保持唤醒 LISTEN_MS，由对端重发
+    bool AddWakePin(GPIO_TypeDef* port, uint16_t pin);
+
+    // RAM 记录：age = 0 为最新
+    bool GetResult(uint8_t age, Result* out);
+
+    // 单行文本：CGM #seq US=.. N=.. CH0=.. I0=..pA ... [| CYCLE=..ms AWAKE=..ms DUTY=..% E=..uJ IAVG=..uA]
+    void FormatResult(const Result& r, NS_FMT::FmtBuf& f);
+
+    const char* PhaseToString(Phase p);
+
+} // namespace NS_CGM
@@ -0,0 +1,135 @@
+#include "CmdSchema.h"
+#include <cstdlib>
+#include <cstring>
+
+namespace NS_CMD
+{
+    uint32_t HashN(const char* s, uint16_t len) {
+        uint32_t h = FNV_OFFSET;
+        for (uint16_t i = 0; i < len && s[i]; ++i) {
+            h = (h ^ Upper(s[i])) * FNV_PRIME;
+        }
+        return h;
+    }
+
+    bool EqualsN(const char* s, uint16_t len, const char* name) {
+        uint16_t i = 0;
+        for (; i < len && name[i]; ++i) {
+            if (Upper(s[i]) != static_cast<uint8_t>(name[i])) return false;
+        }
+        return i == len && name[i] == '\0';
+    }
+
+    const KeySpec* Schema::Find(uint32_t hash) const {
+        for (uint8_t i = 0; i < count; ++i) {
+            if (keys[i].hash == hash) return &keys[i];
+        }
+        return nullptr;
+    }
+
+    const KeySpec* Schema::FindId(uint8_t id) const {
+        for (uint8_t i = 0; i < count; ++i) {
+            if (keys[i].id == id) return &keys[i];
+        }
+        return nullptr;
+    }
+
+    static ArgError CheckRange(const KeySpec& k, Arg* out) {
+        switch (k.type) {
+        case ArgType::F32:
+            if (out->f != out->f) return ArgError::BAD_VALUE;          // NaN
+            if (out->f < k.lo || out->f > k.hi) return ArgError::RANGE;
+            return ArgError::OK;
+        case ArgType::U32:
+            if (out->u < static_cast<uint32_t>(k.lo) || out->u > static_cast<uint32_t>(k.hi)) return ArgError::RANGE;
+            return ArgError::OK;
+        case ArgType::DIR:
+        case ArgType::SWAP:
+            return (out->u <= 1) ? ArgError::OK : ArgError::RANGE;
+        case ArgType::MODE:
+            return (out->u <= 2) ? ArgError::OK : ArgError::RANGE;
+        default:
+            return ArgError::BAD_VALUE;
+        }
+    }
+
+    ArgError Schema::ParseText(const char* token, Arg* out, const KeySpec** spec) const {
+        if (spec) *spec = nullptr;
+        if (!token || !out) return ArgError::BAD_VALUE;
+        const char* eq = ::strchr(token, '=');
+        if (!eq) return ArgError::UNKNOWN_KEY;
+
+        const uint16_t klen = static_cast<uint16_t>(eq - token);
+        const KeySpec* k = Find(HashN(token, klen));
+        if (!k || !EqualsN(token, klen, k->name)) return ArgError::UNKNOWN_KEY;
+        if (spec) *spec = k;
+
+        const char* v = eq + 1;
+        if (*v == '\0') return ArgError::BAD_VALUE;
+        char* endp = nullptr;
+        out->id = k->id;
+        out->type = k->type;
+
+        switch (k->type) {
+        case ArgType::F32:
+            out->f = ::strtof(v, &endp);
+            break;
+        case ArgType::U32:
+            if (*v == '-') return ArgError::RANGE;
+            out->u = static_cast<uint32_t>(::strtoul(v, &endp, 10));
+            break;
+        case ArgType::DIR: {
+            const uint16_t n = static_cast<uint16_t>(::strlen(v));
+            if (EqualsN(v, n, "FWD") || EqualsN(v, n, "FORWARD"))      out->u = 0;
+            else if (EqualsN(v, n, "REV") || EqualsN(v, n, "REVERSE")) out->u = 1;
+            else return ArgError::BAD_VALUE;
+            return ArgError::OK;
+        }
+        case ArgType::MODE: {
+            const uint16_t n = static_cast<uint16_t>(::strlen(v));
+            if (EqualsN(v, n, "CV"))       out->u = 0;
+            else if (EqualsN(v, n, "DPV")) out->u = 1;
+            else if (EqualsN(v, n, "IT"))  out->u = 2;
+            else return ArgError::BAD_VALUE;
+            return ArgError::OK;
+        }
+        case ArgType::SWAP: {
+            const uint16_t n = static_cast<uint16_t>(::strlen(v));
+            if (EqualsN(v, n, "STEP"))       out->u = 0;
+            else if (EqualsN(v, n, "CYCLE")) out->u = 1;
+            else return ArgError::BAD_VALUE;
+            return ArgError::OK;
+        }
+        default:
+            return ArgError::BAD_VALUE;
+        }
+        if (endp == v || *endp != '\0') return ArgError::BAD_VALUE;
+        return CheckRange(*k, out);
+    }
+
+    ArgError Schema::ParseBinary(uint8_t id, uint32_t raw, Arg* out, const KeySpec** spec) const {
+        if (spec) *spec = nullptr;
+        const KeySpec* k = FindId(id);
+        if (!k || !out) return ArgError::UNKNOWN_KEY;
+        if (spec) *spec = k;
+        out->id = k->id;
+        out->type = k->type;
+        if (k->type == ArgType::F32) {
+            ::memcpy(&out->f, &raw, sizeof(out->f));
+        } else {
+            out->u = raw;
+        }
+        return CheckRange(*k, out);
+    }
+
+    const char* ArgErrorToString(ArgError err) {
+        switch (err) {
+        case ArgError::OK:          return "OK";
+        case ArgError::UNKNOWN_KEY: return "unknown key";
+        case ArgError::BAD_VALUE:   return "bad value";
+        case ArgError::RANGE:       return "out of range";
+        default: return "?";
+        }
+    }
+
+} // namespace NS_CMD
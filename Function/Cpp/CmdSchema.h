@@ -0,0 +1,76 @@
+#pragma once
+#include <stdint.h>
+
+// 命令/参数键的编译期哈希与类型化参数表。
+// 名字在编译期算成 FNV-1a（大小写无关），分发处用 switch(hash)：两个名字哈希冲突时
+// case 标签重复直接编译失败，因此对已知名字集合是完美哈希；命中后再比对一次名字，
+// 排除未知输入恰好撞上已知哈希的情况。
+namespace NS_CMD
+{
+    static const uint32_t FNV_OFFSET = 2166136261u;
+    static const uint32_t FNV_PRIME  = 16777619u;
+
+    constexpr uint8_t Upper(char c) {
+        return static_cast<uint8_t>((c >= 'a' && c <= 'z') ? (c - 'a' + 'A') : c);
+    }
+
+    // 编译期哈希（C++11 constexpr 只能单条 return，故递归）
+    constexpr uint32_t Hash(const char* s, uint32_t h = FNV_OFFSET) {
+        return *s ? Hash(s + 1, (h ^ Upper(*s)) * FNV_PRIME) : h;
+    }
+
+    // 运行期哈希：对 s 的前 len 个字符
+    uint32_t HashN(const char* s, uint16_t len);
+
+    // 大小写无关比较 s[0..len) 与 name（name 为全大写常量）
+    bool EqualsN(const char* s, uint16_t len, const char* name);
+
+    // 参数值类型：数值按 [lo, hi] 校验；DIR/MODE/SWAP 为枚举（文本接受名字，二进制接受序号）
+    enum class ArgType : uint8_t { F32, U32, DIR, MODE, SWAP };
+
+    struct KeySpec {
+        uint32_t    hash;
+        const char* name;
+        uint8_t     id;         // 命令内的键编号，也是二进制帧中的键字节
+        ArgType     type;
+        float       lo;
+        float       hi;
+    };
+
+    struct Arg {
+        uint8_t id;
+        ArgType type;
+        union {
+            float    f;
+            uint32_t u;
+        };
+    };
+
+    enum class ArgError : uint8_t { OK = 0, UNKNOWN_KEY, BAD_VALUE, RANGE };
+
+    // 一条命令的参数表：键按声明顺序线性比较哈希（每条命令不超过十来个键）
+    struct Schema {
+        const KeySpec* keys;
+        uint8_t        count;
+
+        const KeySpec* Find(uint32_t hash) const;
+        const KeySpec* FindId(uint8_t id) const;
+
+        // 文本 "KEY=VALUE"：查表、按类型转换并校验范围；*spec 返回命中的键（用于报错）
+        ArgError ParseText(const char* token, Arg* out, const KeySpec** spec) const;
+        // 二进制 [键字节][4 字节小端值]：F32 为 IEEE754 位型，其余为无符号整数
+        ArgError ParseBinary(uint8_t id, uint32_t raw, Arg* out, const KeySpec** spec) const;
+    };
+
+    // 编译期校验：同一命令内键的哈希与编号都不重复（配合 static_assert 使用）
+    constexpr bool KeysUnique(const KeySpec* k, uint8_t n, uint8_t i = 0, uint8_t j = 1) {
+        return (i >= n) ? true
+             : (j >= n) ? KeysUnique(k, n, static_cast<uint8_t>(i + 1), static_cast<uint8_t>(i + 2))
+             : (k[i].hash != k[j].hash && k[i].id != k[j].id && KeysUnique(k, n, i, static_cast<uint8_t>(j + 1)));
+    }
+
+    static const uint8_t MAX_ARGS = 12;
+
+    const char* ArgErrorToString(ArgError err);
+
+} // namespace NS_CMD
@@ -4,150 +4,70 @@
 #include "stm32f10x_dma.h"
 #include "stm32f10x_dac.h"
 #include "GPIO.h"
+#include "SysTickTimer.h"
 
 namespace NS_DAC {
 
     // =========================================================
-    // 0. 硬件映射表
+    // DAC_ChanControllerT
+    // 硬件常量全部来自 HW（DacHw<>），不再在运行期查表或按通道分支
     // =========================================================
-    struct TIM_DMA_Mapping {
-        TIM_TypeDef* TIMx;
-        uint16_t DMA_Request;
-        DMA_Channel_TypeDef* DMA_Channel;
-    };
-    struct TIM_DAC_Mapping {
-        TIM_TypeDef* TIMx;
-        uint32_t trigger;
-    };
-
-    const TIM_DMA_Mapping timDmaMap[] = {
-        {TIM2, TIM_DMA_Update, DMA1_Channel2},
-        {TIM3, TIM_DMA_Update, DMA1_Channel3},
-        {TIM4, TIM_DMA_Update, DMA1_Channel7},
-#ifdef TIM5
-        {TIM5, TIM_DMA_Update, DMA2_Channel2},
-#endif
-#ifdef TIM6
-        {TIM6, TIM_DMA_Update, DMA1_Channel3},
-#endif
-#ifdef TIM7
-        {TIM7, TIM_DMA_Update, DMA2_Channel4}
-#endif
-    };
-
-    const TIM_DAC_Mapping timDacMap[] = {
-        {TIM2, DAC_Trigger_T2_TRGO},
-        {TIM3, DAC_Trigger_T3_TRGO},
-        {TIM4, DAC_Trigger_T4_TRGO},
-#ifdef TIM5
-        {TIM5, DAC_Trigger_T5_TRGO},
-#endif
-#ifdef TIM6
-        {TIM6, DAC_Trigger_T6_TRGO},
-#endif
-#ifdef TIM7
-        {TIM7, DAC_Trigger_T7_TRGO}
-#endif
-    };
-
-    // =========================================================
-    // DAC_ChanController
-    // =========================================================
-    DAC_ChanController::DAC_ChanController(const HW_Config& cfg) {
-        ResolveHardware(cfg);
-    }
-
-    void DAC_ChanController::ResolveHardware(const HW_Config& cfg) {
-        hw.dacChan = cfg.dacChan;
-        hw.tim = cfg.tim;
-
-        // 1. 设置 DAC 触发源
-        if (cfg.tim == nullptr) {
-            hw.dacTrigger = DAC_Trigger_Software;
-            hw.dmaChan = nullptr;
-            hw.timDmaSrc = TIM_DMA_Update; // 默认值
-            return; // Constant 模式不需要 DMA
-        }
-
-        // 查找 DAC Trigger (TIMx -> DAC_Trigger)
-        hw.dacTrigger = DAC_Trigger_Software;
-        for (const auto& map : timDacMap) {
-            if (map.TIMx == cfg.tim) { hw.dacTrigger = map.trigger; break; }
-        }
-
-        // 2. 【核心修正】正确设置 DMA Channel
-        // STM32F103 High-Density (RCT6) DAC DMA 映射是固定的：
-        // DAC_Channel_1 -> DMA2_Channel3
-        // DAC_Channel_2 -> DMA2_Channel4
-        if (hw.dacChan == DAC_Channel::CH1) {
-            hw.dmaChan = DMA2_Channel3;
-        } else if (hw.dacChan == DAC_Channel::CH2) {
-            hw.dmaChan = DMA2_Channel4;
-        } else {
-            hw.dmaChan = nullptr; // 异常保护
-        }
-
-        // 旧的查表代码是给 Timer 做 DMA 更新用的，不适用于 DAC_DMACmd 模式，已移除
-        hw.timDmaSrc = TIM_DMA_Update; 
-    }
-
-    void DAC_ChanController::InitAsCV(const CV_VoltParams& v, const CV_Params& c) {
+    template <typename HW>
+    void DAC_ChanControllerT<HW>::InitAsCV(const CV_VoltParams& v, const CV_Params& c) {
         dataMgr.SetupCV(v, c);
         dataMgr.SwitchMode(GenMode::CV_SCAN);
         useDMA = true;
     }
 
-    void DAC_ChanController::InitAsDPV(const DPV_Params& d) {
+    template <typename HW>
+    void DAC_ChanControllerT<HW>::InitAsDPV(const DPV_Params& d) {
         dataMgr.SetupDPV(d);
         dataMgr.SwitchMode(GenMode::DPV_PULSE);
         useDMA = false; // DPV：定时中断驱动，手写 DAC
     }
 
-    void DAC_ChanController::InitAsConstant(uint16_t val) {
+    template <typename HW>
+    void DAC_ChanControllerT<HW>::InitAsConstant(uint16_t val) {
         dataMgr.SetupConstant(val);
         dataMgr.SwitchMode(GenMode::CONSTANT);
         useDMA = false; // 常量：直接一次写入
     }
 
-    void DAC_ChanController::SetupGPIO() {
+    template <typename HW>
+    void DAC_ChanControllerT<HW>::SetupGPIO() {
         RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOA, ENABLE);
         GPIO_InitTypeDef gpio;
         gpio.GPIO_Mode = GPIO_Mode_AIN;
-        gpio.GPIO_Pin = (hw.dacChan == DAC_Channel::CH1) ? GPIO_Pin_4 : GPIO_Pin_5;
+        gpio.GPIO_Pin = HW::GPIO_PIN;
         GPIO_Init(GPIOA, &gpio);
     }
 
-    void DAC_ChanController::SetupDAC() {
+    template <typename HW>
+    void DAC_ChanControllerT<HW>::SetupDAC() {
         RCC_APB1PeriphClockCmd(RCC_APB1Periph_DAC, ENABLE);
         DAC_InitTypeDef dac;
         DAC_StructInit(&dac);
 
-        // DMA 模式：硬件触发；非 DMA 模式：软件触发
-        dac.DAC_Trigger = useDMA ? hw.dacTrigger : DAC_Trigger_Software;
+        // DMA 模式：定时器 TRGO 触发；非 DMA 模式：不用触发（TEN=0），写 DHR 即输出
+        dac.DAC_Trigger = (useDMA && HW::HAS_TIM) ? HW::TRIGGER : DAC_Trigger_None;
         dac.DAC_OutputBuffer = DAC_OutputBuffer_Disable;
 
-        DAC_Init((uint32_t)hw.dacChan, &dac);
-        DAC_Cmd((uint32_t)hw.dacChan, ENABLE);
-
-        if (useDMA) {
-            DAC_DMACmd((uint32_t)hw.dacChan, ENABLE);
-        } else {
-            DAC_DMACmd((uint32_t)hw.dacChan, DISABLE);
-        }
+        DAC_Init(HW::DAC_CH, &dac);
+        DAC_Cmd(HW::DAC_CH, ENABLE);
+        DAC_DMACmd(HW::DAC_CH, useDMA ? ENABLE : DISABLE);
     }
 
-    void DAC_ChanController::SetupDMA() {
-        if (!useDMA || hw.dmaChan == nullptr) return;
+    template <typename HW>
+    void DAC_ChanControllerT<HW>::SetupDMA() {
+        if (!useDMA) return;
 
         // 强制开启 DMA2 时钟，防止误判
         RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA2, ENABLE);
 
-        DMA_DeInit(hw.dmaChan);
+        DMA_DeInit(HW::Dma());
         DMA_InitTypeDef dma;
         dma.DMA_MemoryBaseAddr = (uint32_t)dataMgr.GetDMAAddr();
-        dma.DMA_PeripheralBaseAddr = (hw.dacChan == DAC_Channel::CH1)
-            ? (uint32_t)&DAC->DHR12R1
-            : (uint32_t)&DAC->DHR12R2;
+        dma.DMA_PeripheralBaseAddr = HW::DHR_ADDR;
 
         dma.DMA_DIR = DMA_DIR_PeripheralDST;
         dma.DMA_BufferSize = 1;
@@ -159,57 +79,49 @@ namespace NS_DAC {
         dma.DMA_Priority = DMA_Priority_High;
         dma.DMA_M2M = DMA_M2M_Disable;
 
-        DMA_Init(hw.dmaChan, &dma);
-        DMA_Cmd(hw.dmaChan, ENABLE);
+        DMA_Init(HW::Dma(), &dma);
+        DMA_Cmd(HW::Dma(), ENABLE);
     }
 
-    void DAC_ChanController::SetupTIM(float period) {
-        if (hw.tim == nullptr) return;
+    template <typename HW>
+    void DAC_ChanControllerT<HW>::SetupTIM(float period) {
+        if (!HW::HAS_TIM) return;
 
         // Robust TIM init: reset registers and clear flags/counter each start.
         // This avoids edge cases where the first START outputs only mid-code (2048)
         // and the waveform begins only after STOP/START.
-        if (hw.tim == TIM2) RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM2, ENABLE);
-        if (hw.tim == TIM3) RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM3, ENABLE);
-        if (hw.tim == TIM4) RCC_APB1PeriphClockCmd(RCC_APB1Periph_TIM4, ENABLE);
+        RCC_APB1PeriphClockCmd(HW::TIM_RCC, ENABLE);
 
-        TIM::InitTIM(hw.tim, period);
+        TIM::InitTIM(HW::Tim(), period);
 
-        TIM_SelectOutputTrigger(hw.tim, TIM_TRGOSource_Update);
-
-        
+        TIM_SelectOutputTrigger(HW::Tim(), TIM_TRGOSource_Update);
 
         // Enable update interrupt (used for CV/DPV waveform stepping).
-        TIM_ITConfig(hw.tim, TIM_IT_Update, ENABLE);
+        TIM_ITConfig(HW::Tim(), TIM_IT_Update, ENABLE);
+
+        TIM_SetCounter(HW::Tim(), 0);
+        TIM_ClearITPendingBit(HW::Tim(), TIM_IT_Update);
 
-        TIM_SetCounter(hw.tim, 0);
-        TIM_ClearITPendingBit(hw.tim, TIM_IT_Update);
-        
-        TIM_Cmd(hw.tim, DISABLE);
+        TIM_Cmd(HW::Tim(), DISABLE);
     }
 
-    void DAC_ChanController::Start() {
+    template <typename HW>
+    void DAC_ChanControllerT<HW>::Start() {
+        isParked = false;
+        stepCount = 0;
+        lastStep.Write(StepStamp());
         SetupGPIO();
         SetupDAC();
         SetupDMA();
 
         const GenMode mode = dataMgr.GetMode();
 
-        // 1) 先把当前值写入 DAC（避免首次周期输出为旧值）
-        const uint16_t initVal = dataMgr.GetCurrentData();
-        if (hw.dacChan == DAC_Channel::CH1) {
-            DAC_SetChannel1Data(DAC_Align_12b_R, initVal);
-        } else {
-            DAC_SetChannel2Data(DAC_Align_12b_R, initVal);
-        }
-
-        if (!useDMA) {
-            // 软件触发立即更新输出
-            DAC_SoftwareTriggerCmd((uint32_t)hw.dacChan, ENABLE);
-        }
+        // 1) 先把当前值写入 DAC（避免首次周期输出为旧值；非 DMA 模式 TEN=0，写入即输出）
+        *HW::Dhr() = dataMgr.GetCurrentData();
+        sink = useDMA ? &discard : HW::Dhr();
 
         // 2) 决定是否需要启用定时器
-        const bool needTim = (hw.tim != nullptr) && (mode == GenMode::CV_SCAN || mode == GenMode::DPV_PULSE);
+        const bool needTim = HW::HAS_TIM && (mode == GenMode::CV_SCAN || mode == GenMode::DPV_PULSE);
 
         if (needTim) {
             float period = 0.001f; // default 1ms (DPV)
@@ -220,58 +132,96 @@ namespace NS_DAC {
             SetupTIM(period);
 
             // Clear any stale pending state BEFORE enabling.
-            TIM_SetCounter(hw.tim, 0);
-            TIM_ClearITPendingBit(hw.tim, TIM_IT_Update);
-            NVIC_ClearPendingIRQ(TIM_IRQnManage::GetIRQn(hw.tim, TIM::IT::UP));
+            TIM_SetCounter(HW::Tim(), 0);
+            TIM_ClearITPendingBit(HW::Tim(), TIM_IT_Update);
+            NVIC_ClearPendingIRQ(HW::IRQN);
 
             // Enable timer, then force one UPDATE event to kick the trigger chain once.
-            TIM_Cmd(hw.tim, ENABLE);
-            TIM_GenerateEvent(hw.tim, TIM_EventSource_Update);
+            TIM_Cmd(HW::Tim(), ENABLE);
+            TIM_GenerateEvent(HW::Tim(), TIM_EventSource_Update);
         }
 
         isPaused = false;
     }
 
-    void DAC_ChanController::Stop() {
-        if (hw.tim) TIM_Cmd(hw.tim, DISABLE);
-        DAC_Cmd((uint32_t)hw.dacChan, DISABLE);
-        if (useDMA && hw.dmaChan) DMA_Cmd(hw.dmaChan, DISABLE);
+    template <typename HW>
+    void DAC_ChanControllerT<HW>::Stop() {
+        if (HW::HAS_TIM) TIM_Cmd(HW::Tim(), DISABLE);
+        DAC_Cmd(HW::DAC_CH, DISABLE);
+        if (useDMA) DMA_Cmd(HW::Dma(), DISABLE);
     }
 
-    void DAC_ChanController::Pause() {
+    template <typename HW>
+    void DAC_ChanControllerT<HW>::Pause() {
         if (isPaused) return;
-        if (hw.tim) TIM_Cmd(hw.tim, DISABLE);
+        if (HW::HAS_TIM) TIM_Cmd(HW::Tim(), DISABLE);
         isPaused = true;
     }
 
-    void DAC_ChanController::Resume() {
-        if (!isPaused) return;
-        if (hw.tim) TIM_Cmd(hw.tim, ENABLE);
+    template <typename HW>
+    void DAC_ChanControllerT<HW>::Resume() {
+        if (!isPaused || isParked) return;
+        if (HW::HAS_TIM) TIM_Cmd(HW::Tim(), ENABLE);
         isPaused = false;
     }
 
-    void DAC_ChanController::TIM_IRQHandler() {
-        // 注意：TIM_IRQnManage 已经完成“标志位判断 + 清除”
-        const bool changed = dataMgr.UpdateNextStep();
+    template <typename HW>
+    void DAC_ChanControllerT<HW>::OnSwapped() {
+        if (HW::HAS_TIM && dataMgr.GetMode() == GenMode::CV_SCAN) {
+            // 当前更新事件之后才装载新 ARR（无预装载时计数器已从 0 开始，新周期从本步起生效）
+            float period = dataMgr.GetCV().cvParams.duration;
+            if (period <= 0.0f) period = 0.001f;
+            TIM_SetAutoreload(HW::Tim(), TIM::PeriodToArr(period));
+        }
+        SystemController::GetInstance().RecordSwap(dataMgr.GetCurrentData());
+    }
 
-        // 非 DMA：仅在值发生变化时写 DAC（减小 SPI/OLED 干扰与抖动）
-        if (!useDMA && changed) {
-            const uint16_t val = dataMgr.GetCurrentData();
-            if (hw.dacChan == DAC_Channel::CH1)
-                DAC_SetChannel1Data(DAC_Align_12b_R, val);
-            else
-                DAC_SetChannel2Data(DAC_Align_12b_R, val);
+    template <typename HW>
+    void DAC_ChanControllerT<HW>::WriteNow(uint16_t val) {
+        dataMgr.SetConstantNow(val);
+        if (dataMgr.GetMode() != GenMode::CONSTANT) return;
+        *HW::Dhr() = val;       // 常量模式 TEN=0：写入即输出
+    }
 
-            DAC_SoftwareTriggerCmd((uint32_t)hw.dacChan, ENABLE);
-        }
+    template <typename HW>
+    void DAC_ChanControllerT<HW>::Park(uint16_t code) {
+        if (HW::HAS_TIM) HW::Tim()->CR1 &= (uint16_t)~TIM_CR1_CEN;
+        isParked = true;
+        isPaused = false;
+        sink = &discard;
+
+        DAC->CR &= ~((DAC_CR_TEN1 | DAC_CR_DMAEN1) << HW::CR_SHIFT);
+        if (useDMA) HW::Dma()->CCR &= (uint16_t)~DMA_CCR1_EN;
+
+        *HW::Dhr() = code;
+    }
+
+    template <typename HW>
+    void DAC_ChanControllerT<HW>::TIM_IRQHandler() {
+        // 注意：TIM_IRQnManage 已经完成“标志位判断 + 清除”
+        // 急停前已挂起的一次更新中断：不再改输出
+        if (isParked) return;
+        (void)dataMgr.UpdateNextStep();
+        if (dataMgr.ConsumeSwapped()) OnSwapped();
+
+        // 非 DMA：写 DHR（TEN=0 即输出，值不变时写入无影响）；DMA 模式写到 discard
+        *sink = dataMgr.GetCurrentData();
+
+        StepStamp st;
+        st.us = SysTickTimer::GetMicros64();
+        st.count = ++stepCount;
+        lastStep.Write(st);
     }
 
+    // 只有这两种绑定，显式实例化后成员定义留在本文件
+    template class DAC_ChanControllerT<ScanHw>;
+    template class DAC_ChanControllerT<BiasHw>;
+
     // =========================================================
     // 全局实例
     // =========================================================
-    // Scan：TIM2；Constant：不占用定时器，避免与 ADC 显示定时器冲突
-    DAC_ChanController DAC_Manager::Chan_Scan({DAC_Channel::CH2, TIM2});
-    DAC_ChanController DAC_Manager::Chan_Constant({DAC_Channel::CH1, nullptr});
+    ScanChan DAC_Manager::Chan_Scan;
+    BiasChan DAC_Manager::Chan_Constant;
 
     void DAC_Manager::Init() {}
 
@@ -295,6 +245,87 @@ namespace NS_DAC {
     void SystemController::SetScanConstantVal(uint16_t val) { cachedScanConstantVal = val; }
     void SystemController::SetBiasConstantVal(uint16_t val) { cachedBiasConstantVal = val; }
 
+    bool SystemController::StageCV(const CV_VoltParams& v, const CV_Params& c, SwapAt at) {
+        SetCVParams(v, c);
+        if (!isRunning || currentMode != RunMode::CV) return false;
+        DAC_Manager::Chan_Scan.GetDataMgr().StageCV(v, c, at);
+        return true;
+    }
+
+    bool SystemController::StageDPV(const DPV_Params& d, SwapAt at) {
+        SetDPVParams(d);
+        if (!isRunning || currentMode != RunMode::DPV) return false;
+        DAC_Manager::Chan_Scan.GetDataMgr().StageDPV(d, at);
+        return true;
+    }
+
+    bool SystemController::IsStagePending() const {
+        return DAC_Manager::Chan_Scan.GetDataMgr().IsStagePending();
+    }
+
+    bool SystemController::ApplyBiasNow(uint16_t val) {
+        SetBiasConstantVal(val);
+        if (!isRunning) return false;
+        DAC_Manager::Chan_Constant.WriteNow(val);
+        return true;
+    }
+
+    bool SystemController::ApplyScanConstantNow(uint16_t val) {
+        SetScanConstantVal(val);
+        if (!isRunning || currentMode != RunMode::IT) return false;
+        DAC_Manager::Chan_Scan.WriteNow(val);
+        RecordSwap(val);
+        return true;
+    }
+
+    void SystemController::RecordSwap(uint16_t code) {
+        // TIM2 中断也会调用：主循环调用时关中断，保证三项成组更新
+        const uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        SwapEvent ev;
+        swapCounter = static_cast<uint16_t>(swapCounter + 1);
+        ev.id = swapCounter;
+        ev.tick = SysTickTimer::GetTick();
+        ev.us = SysTickTimer::GetMicros64();
+        ev.code = code;
+        lastSwap.Write(ev);
+        __set_PRIMASK(primask);
+    }
+
+    SwapEvent SystemController::GetLastSwap() const {
+        // 写者在关中断里整段写完，读者（主循环/线程）不可能打断写者，Read 不会空转
+        return lastSwap.Read();
+    }
+
+    void SystemController::Abort(uint32_t t0_cycles) {
+        // USART RX 中断（中止字节序列）与主循环 / 线程的 ABORT 命令都会调用：关中断整段执行，
+        // 停 DAC、写 lastAbort（单写者 Seqlock）与状态位不会被另一个调用者打断
+        const uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        if (isRunning) {
+            const uint16_t code = GetSafeCode();
+            DAC_Manager::Chan_Scan.Park(code);
+
+            AbortInfo info;
+            info.cycles = SysTickTimer::GetCycles() - t0_cycles;
+            info.tick = SysTickTimer::GetTick();
+            info.us = SysTickTimer::GetMicros64();
+            info.code = code;
+            lastAbort.Write(info);
+            isRunning = false;
+            isPaused = false;
+            abortPending = true;
+        }
+        __set_PRIMASK(primask);
+    }
+
+    bool SystemController::ConsumeAbort(AbortInfo* out) {
+        if (!abortPending) return false;
+        abortPending = false;
+        if (out) *out = lastAbort.Read();
+        return true;
+    }
+
     void SystemController::Start() {
         // Start ADC first
         NS_ADC::GetStaticADC().StartConversion();
@@ -319,8 +350,12 @@ namespace NS_DAC {
         // This avoids a first-run edge case where Code12 stays at mid-code (2048)
         // until the user performs STOP/START again.
         if (currentMode == RunMode::CV || currentMode == RunMode::DPV) {
-            TIM_IRQnManage::Add(TIM2, TIM::IT::UP, [](){ DAC_Manager::Chan_Scan.TIM_IRQHandler(); }, 1, 1);
-            NVIC_ClearPendingIRQ(TIM_IRQnManage::GetIRQn(TIM2, TIM::IT::UP));
+            TIM_IRQnManage::Add(ScanHw::Tim(), TIM::IT::UP, [](){ DAC_Manager::Chan_Scan.TIM_IRQHandler(); }, 1, 1);
+            NVIC_ClearPendingIRQ(ScanHw::IRQN);
+#if defined(TIM2_IRQ_DIRECT)
+            // 引用 IRQnManage.cpp 的握手符号：它没有看到宏（仍提供 TIM2_IRQHandler）时链接失败
+            (void)*static_cast<const volatile uint8_t*>(&TIM2_IRQ_DIRECT_in_IRQnManage);
+#endif
         }
 
         DAC_Manager::Chan_Scan.Start();
@@ -328,7 +363,7 @@ namespace NS_DAC {
 
         // Kick one UPDATE event after everything is running (safe even if redundant).
         if (currentMode == RunMode::CV || currentMode == RunMode::DPV) {
-            TIM_GenerateEvent(TIM2, TIM_EventSource_Update);
+            TIM_GenerateEvent(ScanHw::Tim(), TIM_EventSource_Update);
         }
 
         isRunning = true;
@@ -365,3 +400,19 @@ namespace NS_DAC {
     }
 
 } // namespace NS_DAC
+
+#if defined(TIM2_IRQ_DIRECT) && !defined(TIM2_IRQ_DIRECT_AT_HEADER)
+#error "TIM2_IRQ_DIRECT must be a project-wide define (eide.yml defineList / -D), not a #define in a source file"
+#endif
+#if defined(TIM2_IRQ_DIRECT)
+extern "C" const uint8_t TIM2_IRQ_DIRECT_in_DACManager = 1;
+
+// TIM2 直连模式：更新中断直接进入扫描通道的步进，不经过 TIM_IRQnManage 的回调表。
+// Add(TIM2, UP, ...) 仍照常调用（负责 NVIC 优先级与中断使能），表中的登记不会被用到。
+static void ScanStepIRQ() { NS_DAC::DAC_Manager::Chan_Scan.TIM_IRQHandler(); }
+
+extern "C" void TIM2_IRQHandler(void) {
+    static_assert(NS_DAC::ScanHw::TIM_INDEX == TIM::Index::T2, "TIM2_IRQ_DIRECT: scan channel is not on TIM2");
+    TIM_IRQnManage::DirectIRQ<TIM::Index::T2, TIM::IT::UP, &ScanStepIRQ>(TIM2);
+}
+#endif
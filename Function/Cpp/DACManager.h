@@ -1,6 +1,8 @@
 #pragma once
 #include "stm32f10x.h"
 #include "WaveDataManager.h"
+#include "stm32f10x_dac.h"
+#include <stddef.h>
 #include <IRQnManage.h>
 
 namespace NS_DAC {
@@ -10,32 +12,113 @@ namespace NS_DAC {
     // 运行模式定义 (对外接口)
     enum class RunMode { CV, DPV, IT };
 
-    // 硬件配置参数包
-    // tim 允许为 nullptr：表示该通道不依赖定时器触发/中断（例如偏置常量输出）
-    struct HW_Config {
-        DAC_Channel dacChan;
-        TIM_TypeDef* tim;
+    // 运行中参数替换记录：id 自增，tick 为 SysTick 毫秒，us 为 64 位微秒时间基准，code 为替换后第一步输出的 12bit Code
+    struct SwapEvent {
+        uint16_t id = 0;
+        uint32_t tick = 0;
+        uint64_t us = 0;
+        uint16_t code = 0;
     };
 
-    // 单个 DAC 通道控制器
-    class DAC_ChanController {
-    private:
-        // 实际解析后的硬件资源
-        struct ResolvedHW {
-            DAC_Channel dacChan;
-            TIM_TypeDef* tim;
-            DMA_Channel_TypeDef* dmaChan;
-            uint32_t dacTrigger;
-            uint16_t timDmaSrc;
-        } hw;
+    // 急停记录：cycles 为识别急停的中断入口到 DAC 停稳的 DWT 周期数
+    struct AbortInfo {
+        uint32_t cycles = 0;
+        uint32_t tick = 0;
+        uint64_t us = 0;
+        uint16_t code = 0;
+    };
+
+    // ---------------- 编译期硬件绑定 ----------------
+    // 不用定时器的通道（例如偏置常量输出）
+    constexpr TIM::Index NO_TIM = TIM::Index::END;
+
+    namespace detail {
+        constexpr uint32_t TimBase(TIM::Index t) {
+            return (t == TIM::Index::T2) ? TIM2_BASE : (t == TIM::Index::T3) ? TIM3_BASE
+                 : (t == TIM::Index::T4) ? TIM4_BASE : (t == TIM::Index::T5) ? TIM5_BASE
+                 : (t == TIM::Index::T6) ? TIM6_BASE : (t == TIM::Index::T7) ? TIM7_BASE : 0u;
+        }
+        constexpr uint32_t TimDacTrigger(TIM::Index t) {
+            return (t == TIM::Index::T2) ? DAC_Trigger_T2_TRGO : (t == TIM::Index::T3) ? DAC_Trigger_T3_TRGO
+                 : (t == TIM::Index::T4) ? DAC_Trigger_T4_TRGO : (t == TIM::Index::T5) ? DAC_Trigger_T5_TRGO
+                 : (t == TIM::Index::T6) ? DAC_Trigger_T6_TRGO : (t == TIM::Index::T7) ? DAC_Trigger_T7_TRGO
+                 : DAC_Trigger_None;
+        }
+        constexpr IRQn_Type TimIRQn(TIM::Index t) {
+            return (t == TIM::Index::T2) ? TIM2_IRQn : (t == TIM::Index::T3) ? TIM3_IRQn
+                 : (t == TIM::Index::T4) ? TIM4_IRQn : (t == TIM::Index::T5) ? TIM5_IRQn
+                 : (t == TIM::Index::T6) ? TIM6_IRQn : (t == TIM::Index::T7) ? TIM7_IRQn : IRQN_NONE;
+        }
+        constexpr uint32_t TimRcc(TIM::Index t) {
+            return (t == TIM::Index::T2) ? RCC_APB1Periph_TIM2 : (t == TIM::Index::T3) ? RCC_APB1Periph_TIM3
+                 : (t == TIM::Index::T4) ? RCC_APB1Periph_TIM4 : (t == TIM::Index::T5) ? RCC_APB1Periph_TIM5
+                 : (t == TIM::Index::T6) ? RCC_APB1Periph_TIM6 : (t == TIM::Index::T7) ? RCC_APB1Periph_TIM7 : 0u;
+        }
+    } // namespace detail
+
+    // 一个 DAC 通道 + 触发定时器的全部硬件资源，全部为编译期常量：
+    // DHR 地址、DMA 通道、触发源、IRQn、GPIO 引脚、CR 位偏移，无运行期查表。
+    template <DAC_Channel Ch, TIM::Index T>
+    struct DacHw {
+        static_assert(T == NO_TIM || (T >= TIM::Index::T2 && T <= TIM::Index::T7),
+                      "DacHw: DAC trigger timer must be TIM2..TIM7 (or NO_TIM)");
+
+        static constexpr DAC_Channel CHAN    = Ch;
+        static constexpr uint32_t    DAC_CH  = static_cast<uint32_t>(Ch);
+        static constexpr bool        IS_CH1  = (Ch == DAC_Channel::CH1);
+        static constexpr uint32_t    DHR_ADDR = DAC_BASE + (IS_CH1 ? offsetof(DAC_TypeDef, DHR12R1)
+                                                                 : offsetof(DAC_TypeDef, DHR12R2));
+        static constexpr uint32_t    CR_SHIFT = IS_CH1 ? 0u : 16u;
+        static constexpr uint16_t    GPIO_PIN = IS_CH1 ? GPIO_Pin_4 : GPIO_Pin_5;
+
+        // DAC 的 DMA 请求映射由硬件固定：CH1 -> DMA2_Channel3，CH2 -> DMA2_Channel4
+        static constexpr DMA::User      DMA_USER  = IS_CH1 ? DMA::User::DAC_CH1 : DMA::User::DAC_CH2;
+        static constexpr DMA::ChanIndex DMA_INDEX = IS_CH1 ? DMA::ChanIndex::D2CH3 : DMA::ChanIndex::D2CH4;
+        static constexpr uint32_t       DMA_ADDR  = IS_CH1 ? DMA2_Channel3_BASE : DMA2_Channel4_BASE;
+        static_assert(DMA::ClaimOf(DMA_USER) == DMA_INDEX,
+                      "DacHw: DAC DMA channel is not registered to this DAC channel in DMA::kClaims");
 
+        static constexpr TIM::Index TIM_INDEX = T;
+        static constexpr bool       HAS_TIM   = (T != NO_TIM);
+        static constexpr uint32_t   TIM_ADDR  = detail::TimBase(T);
+        static constexpr uint32_t   TRIGGER   = detail::TimDacTrigger(T);
+        static constexpr IRQn_Type  IRQN      = detail::TimIRQn(T);
+        static constexpr uint32_t   TIM_RCC   = detail::TimRcc(T);
+
+        static TIM_TypeDef* Tim()                { return reinterpret_cast<TIM_TypeDef*>(TIM_ADDR); }
+        static DMA_Channel_TypeDef* Dma()        { return reinterpret_cast<DMA_Channel_TypeDef*>(DMA_ADDR); }
+        static volatile uint32_t* Dhr()          { return reinterpret_cast<volatile uint32_t*>(DHR_ADDR); }
+    };
+
+    // 本板的两个通道：扫描通道 CH2 由 TIM2 触发；偏置通道 CH1 不占用定时器（避免与 ADC 显示定时器冲突）
+    using ScanHw = DacHw<DAC_Channel::CH2, TIM::Index::T2>;
+    using BiasHw = DacHw<DAC_Channel::CH1, NO_TIM>;
+    static_assert(ScanHw::DAC_CH != BiasHw::DAC_CH, "DAC: scan and bias must use different DAC channels");
+
+    // 最近一次定时器步进：us 为 64 位微秒时间基准，count 为本次 Start 以来的步数
+    struct StepStamp {
+        uint64_t us = 0;
+        uint32_t count = 0;
+    };
+
+    // 单个 DAC 通道控制器：硬件由 HW（DacHw<>）在编译期给定
+    template <typename HW>
+    class DAC_ChanControllerT {
+    private:
         WaveDataManager dataMgr;
 
         bool isPaused = false;
         bool useDMA = true;      // 当前模式是否使用 DMA
+        volatile bool isParked = false;  // 急停后：定时器中断不再写 DAC，直到下次 Start
 
-        // 自动查找硬件映射
-        void ResolveHardware(const HW_Config& cfg);
+        // 中断里每步的唯一一次写：非 DMA 模式指向 DHR（TEN=0，写入后一个 APB 周期即输出），
+        // DMA 模式由 DMA 在触发时搬运，指向 discard。Start/Park 时切换，中断里不再判断模式
+        volatile uint32_t* sink = &discard;
+        volatile uint32_t discard = 0;
+
+        // 定时器中断写、主循环读
+        NS_LF::Seqlock<StepStamp> lastStep;
+        uint32_t stepCount = 0;
 
         // 底层驱动
         void SetupGPIO();
@@ -43,8 +126,13 @@ namespace NS_DAC {
         void SetupDMA();
         void SetupTIM(float period);
 
+        // 中断内：参数已替换，按新步长周期改 ARR 并登记替换事件
+        void OnSwapped();
+
     public:
-        explicit DAC_ChanController(const HW_Config& cfg);
+        using Hw = HW;
+
+        DAC_ChanControllerT() = default;
 
         // 初始化配置
         void InitAsCV(const CV_VoltParams& v, const CV_Params& c);
@@ -60,14 +148,29 @@ namespace NS_DAC {
         // 由 IRQnManage 分发调用：此处不要再读/清 TIM 标志位
         void TIM_IRQHandler();
 
+        // 常量模式运行中直接改输出，不重启 DAC/DMA/ADC
+        void WriteNow(uint16_t val);
+
+        // 急停（中断上下文可用）：关定时器、断开 DAC 的触发与 DMA，把输出停在 code。
+        // 只写寄存器，不调用库函数初始化；TEN=0 时写 DHR 后一个 APB 周期即到 DOR
+        void Park(uint16_t code);
+
         WaveDataManager& GetDataMgr() { return dataMgr; }
+
+        StepStamp GetLastStep() const {
+            StepStamp st;
+            return lastStep.TryRead(st) ? st : StepStamp();
+        }
     };
 
+    using ScanChan = DAC_ChanControllerT<ScanHw>;
+    using BiasChan = DAC_ChanControllerT<BiasHw>;
+
     // 全局实例容器
     class DAC_Manager {
     public:
-        static DAC_ChanController Chan_Scan;     // 扫描通道
-        static DAC_ChanController Chan_Constant; // 偏置通道
+        static ScanChan Chan_Scan;     // 扫描通道
+        static BiasChan Chan_Constant; // 偏置通道
         static void Init();
     };
 
@@ -90,6 +193,15 @@ namespace NS_DAC {
         uint16_t cachedScanConstantVal = 2048;
         uint16_t cachedBiasConstantVal = 2048;
 
+        // 最近一次运行中替换：中断与主循环都可能写（写入处关中断互斥），读端走 seqlock
+        uint16_t swapCounter = 0;
+        NS_LF::Seqlock<SwapEvent> lastSwap;
+
+        // 急停：安全码由 ABORT SAFE= 设置，0xFFFF 表示跟随偏置通道（工作电极与参比之间 0V）
+        uint16_t safeCode = 0xFFFF;
+        volatile bool abortPending = false;
+        NS_LF::Seqlock<AbortInfo> lastAbort;   // 接收中断写，主循环读
+
         SystemController() = default;
 
     public:
@@ -106,6 +218,31 @@ namespace NS_DAC {
         void SetBiasConstantVal(uint16_t val);
 
         RunMode GetMode() const { return currentMode; }
+        bool IsRunning() const { return isRunning; }
+
+        // 运行中热切换：更新缓存，且当前模式一致时暂存到扫描通道，在 at 指定的边界由 TIM2 中断原子替换。
+        // 返回 true 表示已暂存（运行中且模式一致）；否则只更新缓存，下次 START 生效
+        bool StageCV(const CV_VoltParams& v, const CV_Params& c, SwapAt at);
+        bool StageDPV(const DPV_Params& d, SwapAt at);
+        bool IsStagePending() const;
+
+        // 运行中立即生效的常量：偏置通道随时可改；Scan 常量仅 IT 模式下立即输出。返回是否已写入硬件
+        bool ApplyBiasNow(uint16_t val);
+        bool ApplyScanConstantNow(uint16_t val);
+
+        // 登记一次替换（中断或主循环）；GetLastSwap 取最近一次
+        void RecordSwap(uint16_t code);
+        SwapEvent GetLastSwap() const;
+
+        // 急停（串口接收中断调用）：扫描通道停在安全码，偏置通道保持不变；未运行时无动作。
+        // 主循环随后用 ConsumeAbort 取记录并完成 STOP 的其余收尾（不再关 DAC，保持安全码输出）
+        void Abort(uint32_t t0_cycles);
+        bool ConsumeAbort(AbortInfo* out);
+        AbortInfo GetLastAbort() const { return lastAbort.Read(); }
+
+        void     SetSafeCode(uint16_t code) { safeCode = code; }
+        uint16_t GetSafeCode() const { return (safeCode <= 4095) ? safeCode : cachedBiasConstantVal; }
+        bool     IsSafeCodeAuto() const { return safeCode > 4095; }
 
         void Start();
         void Stop();
@@ -39,9 +39,26 @@ void DPVController::SetParams(const DPV_Params& p) {
     codePulse = DacMath::DeltaVoltToCodeSigned(params.pulseAmp);
 }
 
+void DPVController::Retune(const DPV_Params& p) {
+    const int32_t base = currentBaseCode;
+    SetParams(p);
+    currentBaseCode = base;
+
+    // 方向按新终点相对当前阶梯重新判定
+    const int32_t mag = (codeStep > 0) ? codeStep : -codeStep;
+    codeStep = (codeEnd >= currentBaseCode) ? mag : -mag;
+
+    const uint16_t phaseLen = (state == DPV_State::WAIT_PULSE_TIME) ? pulseWidthMs : baseTimeMs;
+    if (timerCount >= phaseLen) timerCount = (uint16_t)(phaseLen - 1);
+    if (state == DPV_State::WAIT_PULSE_TIME) {
+        currentOutputCode = DacMath::Clamp12(currentBaseCode + codePulse);
+    }
+}
+
 void DPVController::Start() {
     sampleFlags = 0;
     timerCount = 0;
+    stepStarted = false;
 
     state = DPV_State::WAIT_BASE_TIME;
     currentOutputCode = DacMath::Clamp12(currentBaseCode);
@@ -100,6 +117,7 @@ bool DPVController::StepTick() {
         currentOutputCode = DacMath::Clamp12(currentBaseCode);
 
         state = DPV_State::WAIT_BASE_TIME;
+        stepStarted = true;
         dacChanged = true;
     }
 
@@ -41,10 +41,21 @@ private:
     uint16_t sampleLeadMs = 1;
 
     volatile uint8_t sampleFlags = 0; // bit0=I1, bit1=I2
+    bool stepStarted = false;         // 本 tick 进入了新阶梯
     uint16_t currentOutputCode   = 2048;
 
 public:
     void SetParams(const DPV_Params& p);
+
+    // 运行中换参：保留当前阶梯电位与阶段，替换终点/步长/脉冲/时序（阶段计时越界时钳位）
+    void Retune(const DPV_Params& p);
+
+    // 本 tick 是否刚进入新阶梯（读后清零）
+    bool ConsumeStepStarted() {
+        const bool f = stepStarted;
+        stepStarted = false;
+        return f;
+    }
     void Start();
     void Stop();
 
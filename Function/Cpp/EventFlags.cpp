@@ -0,0 +1,138 @@
+#include "EventFlags.h"
+#include "stm32f10x.h"
+#include "SysTickTimer.h"
+
+#ifdef USE_CMSIS_RTOS2
+#include "rtx_os.h"
+#endif
+
+namespace NS_EVT
+{
+    static volatile uint32_t s_posted = 0;
+
+    // 负载窗口（只在睡眠所在的上下文读写：裸机为主循环，RTOS 为空闲线程）
+    static const uint32_t WINDOW_US = 1000000u;
+    static uint32_t s_winStartUs = 0;
+    static uint32_t s_idleUs     = 0;
+    static uint32_t s_wakeups    = 0;
+    static uint32_t s_timeouts   = 0;
+    static Load     s_load       = {};
+
+    static void RollWindow(uint32_t now_us) {
+        const uint32_t span = now_us - s_winStartUs;
+        if (span < WINDOW_US) return;
+        const uint32_t idle = (s_idleUs > span) ? span : s_idleUs;
+        s_load.idlePermille = static_cast<uint16_t>((uint64_t)idle * 1000u / span);
+        s_load.wakeups  = s_wakeups;
+        s_load.timeouts = s_timeouts;
+        s_load.windowMs = span / 1000u;
+        s_load.posted   = s_posted;
+        s_winStartUs = now_us;
+        s_idleUs = s_wakeups = s_timeouts = 0;
+    }
+
+    // 调用前已关中断：WFI 照常被挂起的中断唤醒，唤醒源的 ISR 在开中断后才执行，
+    // 所以 t1 就是睡眠结束时间（RTOS 下也不会先切到被唤醒的线程再回来计时）
+    static void SleepMasked() {
+        const uint32_t t0 = SysTickTimer::GetMicros();
+        __DSB();
+        __WFI();
+        const uint32_t t1 = SysTickTimer::GetMicros();
+        __enable_irq();
+        s_idleUs += t1 - t0;
+    }
+
+    const Load& GetLoad() {
+        return s_load;
+    }
+
+#ifndef USE_CMSIS_RTOS2
+
+    static volatile uint32_t s_flags = 0;
+
+    void Post(uint32_t bits) {
+        // 读-改-写须原子：不同优先级的中断会互相打断（几条指令的关中断窗口）
+        const uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        s_flags  = s_flags | bits;
+        s_posted = s_posted + 1;
+        __set_PRIMASK(primask);
+    }
+
+    uint32_t Wait(uint32_t timeout_ms, uint32_t mask) {
+        const uint32_t start = SysTickTimer::GetTick();
+        uint32_t got = 0;
+        for (;;) {
+            // 关中断后再检查标志：检查与 WFI 之间到达的中断保持挂起，WFI 立即返回，不会丢事件
+            __disable_irq();
+            got = s_flags & mask;
+            if (got != 0) {
+                s_flags = s_flags & ~got;
+                __enable_irq();
+                ++s_wakeups;
+                break;
+            }
+            if (SysTickTimer::GetTick() - start >= timeout_ms) {
+                __enable_irq();
+                ++s_timeouts;
+                got = TIMEOUT;
+                break;
+            }
+            SleepMasked();
+        }
+        RollWindow(SysTickTimer::GetMicros());
+        return got;
+    }
+
+#else
+
+    // RTOS：事件标志由内核对象承载，各线程只等待自己关心的位；睡眠集中在空闲线程
+    static uint32_t         s_evtMem[(osRtxEventFlagsCbSize + 3) / 4];
+    static osEventFlagsId_t s_evt = nullptr;
+
+    void Init() {
+        osEventFlagsAttr_t attr = {};
+        attr.name    = "evt";
+        attr.cb_mem  = s_evtMem;
+        attr.cb_size = sizeof(s_evtMem);
+        s_evt = osEventFlagsNew(&attr);
+    }
+
+    void Post(uint32_t bits) {
+        // 内核启动前（初始化阶段的中断）没有等待者，直接丢弃；线程起来后第一轮会主动查一遍
+        if (s_evt == nullptr) return;
+        const osKernelState_t st = osKernelGetState();
+        if (st != osKernelRunning && st != osKernelLocked) return;
+        (void)osEventFlagsSet(s_evt, bits);
+        s_posted = s_posted + 1;
+    }
+
+    uint32_t Wait(uint32_t timeout_ms, uint32_t mask) {
+        const uint32_t got = osEventFlagsWait(s_evt, mask, osFlagsWaitAny, timeout_ms);
+        if (got & osFlagsError) {
+            ++s_timeouts;
+            return TIMEOUT;
+        }
+        ++s_wakeups;
+        return got;
+    }
+
+    void IdleSleep() {
+        __disable_irq();
+        SleepMasked();
+        RollWindow(SysTickTimer::GetMicros());
+    }
+
+#endif // USE_CMSIS_RTOS2
+
+} // namespace NS_EVT
+
+#ifdef USE_CMSIS_RTOS2
+// 替换 RTX_Config.c 中的弱定义：没有就绪线程时进入 WFI，同时统计空闲时间
+extern "C" __NO_RETURN void osRtxIdleThread(void* argument) {
+    (void)argument;
+    for (;;) {
+        NS_EVT::IdleSleep();
+    }
+}
+#endif
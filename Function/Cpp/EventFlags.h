@@ -0,0 +1,47 @@
+#pragma once
+#include <stdint.h>
+
+// 主循环事件标志：中断里 Post 置位，主循环 Wait 在 WFI 中睡到有事件（或超时）为止。
+// 标志按位累积、一次取走，同一事件在被处理前多次发生只算一次（处理函数本身都是“排空”式）。
+namespace NS_EVT
+{
+    enum : uint32_t {
+        RX_LINE  = 1u << 0,     // 某条链路收齐一条消息（或 RX 需要重同步）
+        ABORT    = 1u << 1,     // 急停序列，DAC 已在中断里停好
+        TX_DONE  = 1u << 2,     // TX DMA 完成一段，输出端又有余量
+        SAMPLE   = 1u << 3,     // TIM4 向广播环写入一个样本
+        ADC_SNAP = 1u << 4,     // TIM3 OLED 快照就绪
+        KEY      = 1u << 5,     // 按键
+        STREAM   = 1u << 6,     // RTOS：命令线程发来流控制消息
+        CGM      = 1u << 7,     // RTC 闹钟：周期测量到期（或串口唤醒了 Stop）
+        TIMEOUT  = 1u << 31,    // Wait 超时返回（不是中断事件）
+    };
+
+    static const uint32_t ALL = 0x7FFFFFFFu;
+
+    // 中断/主循环均可调用
+    void Post(uint32_t bits);
+
+    // 取走 mask 中已置位的事件；没有则关中断后 WFI 睡眠，直到有事件或 timeout_ms 到期。
+    // SysTick 每 1ms 唤醒一次，只用于检查超时，不算事件。
+    // USE_CMSIS_RTOS2：由 RTOS 事件标志实现，调用线程阻塞，睡眠由空闲线程负责。
+    uint32_t Wait(uint32_t timeout_ms, uint32_t mask = ALL);
+
+#ifdef USE_CMSIS_RTOS2
+    // 创建内核事件标志（osKernelInitialize 之后、任何线程 Wait 之前）
+    void Init();
+    // 空闲线程调用：一次 WFI 睡眠并计入空闲时间
+    void IdleSleep();
+#endif
+
+    // 负载统计：按 1s 窗口计算 WFI 中度过的时间占比（RTOS 下 wakeups/timeouts 为所有线程之和）
+    struct Load {
+        uint16_t idlePermille;  // 上一窗口空闲占比（‰）
+        uint32_t wakeups;       // 上一窗口中 Wait 因事件返回的次数
+        uint32_t timeouts;      // 上一窗口中 Wait 超时返回的次数
+        uint32_t windowMs;      // 上一窗口实际长度
+        uint32_t posted;        // 累计 Post 的事件位（按事件计，不去重）
+    };
+    const Load& GetLoad();
+
+} // namespace NS_EVT
@@ -0,0 +1,106 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// 轻量格式化：只做整数 / 定点小数 / 十六进制 / 字符串拼接，不走 newlib 的 snprintf
+// （snprintf 带 %f 时会拉进软浮点与上 KB 栈，热路径上一次就是几十微秒）。
+// 写满后后续内容静默截断，Overflowed() 可查；结果始终以 '\0' 结尾。
+namespace NS_FMT
+{
+    class FmtBuf {
+    public:
+        FmtBuf(char* buf, uint16_t cap) : m_buf(buf), m_cap(cap) {
+            if (m_cap) m_buf[0] = '\0';
+        }
+        template<size_t N>
+        explicit FmtBuf(char (&buf)[N]) : FmtBuf(buf, static_cast<uint16_t>(N)) {}
+
+        const char* c_str() const { return m_buf; }
+        const uint8_t* data() const { return reinterpret_cast<const uint8_t*>(m_buf); }
+        uint16_t size() const { return m_len; }
+        bool Overflowed() const { return m_overflow; }
+        void Clear() { m_len = 0; m_overflow = false; if (m_cap) m_buf[0] = '\0'; }
+
+        FmtBuf& Char(char c) {
+            if (m_len + 1 < m_cap) {
+                m_buf[m_len++] = c;
+                m_buf[m_len] = '\0';
+            } else {
+                m_overflow = true;
+            }
+            return *this;
+        }
+
+        FmtBuf& Str(const char* s) {
+            if (!s) return *this;
+            while (*s) Char(*s++);
+            return *this;
+        }
+
+        // 十进制无符号；width>0 时左侧补 pad 到 width 位
+        FmtBuf& U32(uint32_t v, uint8_t width = 0, char pad = ' ') {
+            char tmp[10];
+            uint8_t n = 0;
+            do {
+                tmp[n++] = static_cast<char>('0' + v % 10);
+                v /= 10;
+            } while (v);
+            while (width > n) { Char(pad); --width; }
+            while (n) Char(tmp[--n]);
+            return *this;
+        }
+
+        // 64 位：按 10^9 拆段，只在超过 32 位时做 64 位除法
+        FmtBuf& U64(uint64_t v) {
+            if (v <= 0xFFFFFFFFu) return U32(static_cast<uint32_t>(v));
+            U64(v / 1000000000u);
+            return U32(static_cast<uint32_t>(v % 1000000000u), 9, '0');
+        }
+
+        FmtBuf& I32(int32_t v, uint8_t width = 0) {
+            const uint32_t mag = (v < 0) ? (0u - static_cast<uint32_t>(v)) : static_cast<uint32_t>(v);
+            if (v < 0) {
+                Char('-');
+                if (width) --width;
+            }
+            return U32(mag, width);
+        }
+
+        // 定点小数：value 为放大 10^decimals 后的整数，如 Fixed(-1234, 3) -> "-1.234"
+        FmtBuf& Fixed(int32_t value, uint8_t decimals) {
+            uint32_t scale = 1;
+            for (uint8_t i = 0; i < decimals; ++i) scale *= 10;
+            const uint32_t mag = (value < 0) ? (0u - static_cast<uint32_t>(value)) : static_cast<uint32_t>(value);
+            if (value < 0) Char('-');
+            U32(mag / scale);
+            if (decimals) {
+                Char('.');
+                U32(mag % scale, decimals, '0');
+            }
+            return *this;
+        }
+
+        // 十六进制大写，digits 为固定位数（1..8）
+        FmtBuf& Hex(uint32_t v, uint8_t digits = 8) {
+            static const char kHex[] = "0123456789ABCDEF";
+            if (digits == 0 || digits > 8) digits = 8;
+            for (int8_t i = static_cast<int8_t>(digits - 1); i >= 0; --i) {
+                Char(kHex[(v >> (i * 4)) & 0x0F]);
+            }
+            return *this;
+        }
+
+        // 右侧补空格到总长度 len（用于覆盖 OLED 上一帧残留字符）
+        FmtBuf& PadTo(uint16_t len, char pad = ' ') {
+            while (m_len < len && !m_overflow) Char(pad);
+            return *this;
+        }
+
+    private:
+        char*    m_buf;
+        uint16_t m_cap;
+        uint16_t m_len = 0;
+        bool     m_overflow = false;
+    };
+
+} // namespace NS_FMT
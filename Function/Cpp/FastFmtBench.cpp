@@ -0,0 +1,151 @@
+// 主机基准：出厂代码路径与 snprintf 拼同样的三种行，先逐条比对输出，再比耗时。
+// 不进固件工程（eide.yml 不列出），只在主机上编译运行（与 Telemetry.cpp 一起编译，USART 在下方打桩）：
+//   g++ -std=c++11 -O2 -w -DUSE_STDPERIPH_DRIVER -DSTM32F10X_HD -I. -IStart -ILibrary -IUser -IHardware
+//       -IFunction/Cpp -ISystem -I.cmsis/include Function/Cpp/FastFmtBench.cpp Function/Cpp/Telemetry.cpp
+//       -o fastfmt_bench && ./fastfmt_bench
+// 三种行：
+// - JSON 遥测行：NS_TLM::TelemetryEncoder::Push（JSON、FIELDS_LEGACY、EVERY=1，BuildPlan 生成的字段计划）。
+//   FmtBuf 一列是完整的 Push（拼行 + 写 TX + 存入重传窗口），snprintf 一列只拼行，差距是下限
+// - 命令回显：与 main.cpp SendAck 相同的拼接
+// - OLED 电流字符串：NS_ADC::ADC::FormatCurrent（ShowVoltage 实际调用），对照改写前的 double + %.3f
+#include "Telemetry.h"
+#include "BTCPP.h"
+#include "ADCManager.h"
+#include "FastFmt.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+// ---- USART 打桩：WriteFrame 把最近一帧留在 g_tx ----
+static char     g_tx[300];
+static uint16_t g_txLen = 0;
+USART_Controller::USART_Controller(USART_TypeDef*, BaudRate, uint16_t) {}
+bool USART_Controller::WriteFrame(const uint8_t* data, uint16_t length) {
+    if (length >= sizeof(g_tx)) return false;
+    ::memcpy(g_tx, data, length);
+    g_tx[length] = '\0';
+    g_txLen = length;
+    return true;
+}
+uint16_t USART_Controller::TxFree() const { return 1024; }
+
+namespace
+{
+    const int kIters = 200000;
+
+    volatile uint32_t g_sink = 0;       // 防止循环被优化掉
+
+    NS_TLM::Sample MakeSample(uint32_t i) {
+        NS_TLM::Sample s{};
+        s.ms = i * 50u;
+        s.ch[0] = static_cast<uint16_t>((i * 7u) & 0x0FFF);
+        s.ch[1] = static_cast<uint16_t>((i * 13u + 100u) & 0x0FFF);
+        s.ch[2] = static_cast<uint16_t>(4095u - (i & 0x0FFF));
+        s.code = static_cast<uint16_t>(i % 4096u);
+        return s;
+    }
+
+    // ---- JSON 遥测行 ----
+    uint16_t JsonPrintf(char* out, uint16_t cap, uint16_t seq, const NS_TLM::Sample& s) {
+        const int n = snprintf(out, cap, "{\"Seq\":%u,\"Ms\":%lu,\"Uric\":%u,\"Ascorbic\":%u,\"Glucose\":%u,\"Code12\":%u}\n",
+            (unsigned)seq, (unsigned long)s.ms, (unsigned)s.ch[0], (unsigned)s.ch[1], (unsigned)s.ch[2], (unsigned)(s.code & 0x0FFF));
+        return static_cast<uint16_t>(n);
+    }
+
+    // ---- 命令回显 ----
+    uint16_t AckFmt(char* out, uint16_t cap, const char* line) {
+        NS_FMT::FmtBuf f(out, cap);
+        f.Str("ACK: ").Str(line).Str("\r\n");
+        return f.size();
+    }
+    uint16_t AckPrintf(char* out, uint16_t cap, const char* line) {
+        return static_cast<uint16_t>(snprintf(out, cap, "ACK: %s\r\n", line));
+    }
+
+    // ---- OLED 电流 ----
+    // 改写前的做法：double 电流 + %.3f，量程阈值相同
+    uint16_t CurrentPrintf(char* out, uint16_t cap, uint16_t ad, uint16_t ref, uint32_t gain) {
+        const double ma = ((double)ad - (double)ref) / NS_ADC::ADC::stepPerVolt * 1000.0 / gain;
+        const double mag = ma < 0 ? -ma : ma;
+        int n;
+        if (mag > 1)         n = snprintf(out, cap, "%.3fmA", ma);
+        else if (mag > 1e-3) n = snprintf(out, cap, "%.3fuA", ma * 1e3);
+        else if (mag > 1e-6) n = snprintf(out, cap, "%.3fnA", ma * 1e6);
+        else                 n = snprintf(out, cap, "0.000mA");
+        while (n < 10 && n + 1 < cap) out[n++] = ' ';
+        out[n] = '\0';
+        return static_cast<uint16_t>(n);
+    }
+
+    // 整数与 double 的舍入可能让最后一位差 1，单位与其余字符必须相同
+    bool SameCurrent(const char* a, const char* b) {
+        if (::strcmp(a, b) == 0) return true;
+        const char* ua = ::strchr(a, 'A');
+        const char* ub = ::strchr(b, 'A');
+        if (!ua || !ub || ua - a != ub - b || ua[-1] != ub[-1]) return false;
+        const double d = ::atof(a) - ::atof(b);
+        return d < 0.0015 && d > -0.0015;
+    }
+
+    template <typename Fn>
+    double TimeNs(Fn fn) {
+        const auto t0 = std::chrono::steady_clock::now();
+        for (int i = 0; i < kIters; ++i) g_sink += fn(static_cast<uint32_t>(i));
+        const auto t1 = std::chrono::steady_clock::now();
+        return std::chrono::duration<double, std::nano>(t1 - t0).count() / kIters;
+    }
+
+    const char* const kAckLines[] = {
+        "START",
+        "CV HIGH=0.8 LOW=-0.8 OFF=1.65 DUR=0.05 RATE=0.05 DIR=FWD AT=CYCLE",
+        "STREAM RATE=200 POLICY=DECIM FIELDS=MS+CH0+CH1+CH2+CODE",
+    };
+    const uint32_t kGains[] = { 1000u, 100000u, 10000000u };
+}
+
+int main() {
+    static USART_Controller link;
+    static NS_TLM::TelemetryEncoder enc;
+    enc.SetFormat(NS_TLM::Format::JSON);
+    enc.BuildPlan(NS_TLM::ChannelInfo{});
+    char a[400], b[400];
+    int mismatches = 0;
+
+    // 输出比对
+    for (uint32_t i = 0; i < 5000; ++i) {
+        const NS_TLM::Sample s = MakeSample(i * 977u);
+        const uint16_t seq = enc.GetNextSeq();
+        enc.Push(link, s);
+        JsonPrintf(b, sizeof(b), seq, s);
+        if (::strcmp(g_tx, b) != 0) { ++mismatches; std::printf("JSON  %s  vs  %s", g_tx, b); }
+    }
+    for (const char* line : kAckLines) {
+        AckFmt(a, sizeof(a), line);
+        AckPrintf(b, sizeof(b), line);
+        if (::strcmp(a, b) != 0) { ++mismatches; std::printf("ACK   %s  vs  %s", a, b); }
+    }
+    for (uint32_t g : kGains) {
+        for (uint32_t ad = 0; ad < 4096; ++ad) {
+            NS_ADC::ADC::FormatCurrent(a, 12, (uint16_t)ad, 2048, g);
+            CurrentPrintf(b, 12, (uint16_t)ad, 2048, g);
+            if (!SameCurrent(a, b)) { ++mismatches; std::printf("CUR   ad=%u gain=%u [%s] vs [%s]\n", (unsigned)ad, (unsigned)g, a, b); }
+        }
+    }
+
+    // 耗时
+    std::printf("%-8s %12s %12s\n", "line", "shipped ns", "snprintf ns");
+    std::printf("%-8s %12.1f %12.1f\n", "JSON",
+        TimeNs([&](uint32_t i) { enc.Push(link, MakeSample(i)); return (uint32_t)g_txLen; }),
+        TimeNs([&](uint32_t i) { return JsonPrintf(b, 96, (uint16_t)i, MakeSample(i)); }));
+    std::printf("%-8s %12.1f %12.1f\n", "ACK",
+        TimeNs([&](uint32_t i) { return AckFmt(a, sizeof(a), kAckLines[i % 3]); }),
+        TimeNs([&](uint32_t i) { return AckPrintf(b, sizeof(b), kAckLines[i % 3]); }));
+    std::printf("%-8s %12.1f %12.1f\n", "CURRENT",
+        TimeNs([&](uint32_t i) { return NS_ADC::ADC::FormatCurrent(a, 12, (uint16_t)(i & 0x0FFF), 2048, kGains[i % 3]); }),
+        TimeNs([&](uint32_t i) { return CurrentPrintf(b, 12, (uint16_t)(i & 0x0FFF), 2048, kGains[i % 3]); }));
+
+    std::printf("%s (%d mismatches)\n", mismatches ? "FAIL" : "OK", mismatches);
+    return mismatches ? 1 : 0;
+}
@@ -0,0 +1,651 @@
+#include "FlashLog.h"
+#include "StreamSink.h"
+#include "Telemetry.h"
+#include "BTCPP.h"
+#include "FastFmt.h"
+#include "DACManager.h"
+#include "CgmScheduler.h"
+#include <string.h>
+
+namespace NS_LOG
+{
+    static const uint32_t MAGIC = 0x31474F4Cu;      // "LOG1"
+
+    // 页头（24 字节）：记录区写完之后才写，magic 最后写
+    struct PageHeader {
+        uint32_t magic;
+        uint32_t seq;
+        uint16_t run;
+        uint16_t count;         // 记录数
+        uint32_t t0Ms;          // 第一条记录
+        uint32_t t1Ms;          // 最后一条记录
+        uint16_t len;           // 记录区字节数
+        uint16_t crc;           // 页头（crc 之前）+ 记录区的 CRC16
+    };
+    static_assert(sizeof(PageHeader) == 24, "NS_LOG: page header layout");
+
+    static const uint16_t HDR_SIZE  = sizeof(PageHeader);
+    static const uint16_t DATA_SIZE = PAGE_SIZE - HDR_SIZE;
+    static const uint16_t REC_MAX   = 5 * 5;        // 5 个 varint，每个最多 5 字节
+    static const uint16_t PROG_CHUNK = 64;          // 每次 Service 编程的半字数（调用方被占用约 3.4~4.5ms）
+    static_assert(PROG_CHUNK * 2 <= DATA_SIZE, "NS_LOG: program chunk");
+
+    // 补发：每次 Service 最多发几帧，TX 缓冲至少留多少给实时流
+    static const uint8_t  BF_FRAMES_PER_SERVICE = 4;
+    static const uint16_t BF_TX_RESERVE = 256;
+    static const uint8_t  BF_BATCH = 8;
+
+    struct Record {
+        uint32_t ms;
+        uint16_t ch[3];
+        uint16_t code;
+    };
+
+    // 时间索引：每个槽位一项，开机扫描页头建立，写完一页更新
+    struct IndexEntry {
+        uint32_t seq;
+        uint32_t t0Ms;
+        uint32_t t1Ms;
+        uint16_t run;
+        uint16_t count;
+        bool     valid;
+    };
+
+    // WAIT：已封存，等目标槽位是空白页（运行中不擦除，只能等预擦除或 STOP）
+    enum class Phase : uint8_t { IDLE = 0, WAIT, PROGRAM, HEADER };
+
+    // 解码游标：页内偏移 + 上一条记录（差值基准）
+    struct Cursor {
+        uint32_t seq;
+        uint16_t off;
+        uint16_t rec;
+        Record   prev;
+    };
+
+    static Config s_cfg;
+    static Stats  s_stats;
+    static IndexEntry s_index[PAGES];
+
+    // 暂存页：页头字段单独保存，记录区与 flash 中的页布局相同
+    static PageHeader s_stageHdr{};
+    static uint8_t    s_stage[DATA_SIZE];
+    static Record     s_stagePrev{};
+
+    static Phase    s_phase = Phase::IDLE;
+    static bool     s_held = false;             // 当前封存页已因没有空白槽位等待过（HELD 只计一次）
+    static uint32_t s_blank = 0;                // 每个槽位一位：已擦除、可直接编程
+    static uint16_t s_progOff = 0;              // 已编程的记录区字节
+    static bool     s_armed = false;            // 有过一次 START（之前广播环没有数据）
+    static uint32_t s_cursor = 0;
+    static uint16_t s_run = 0;
+
+    // 平均窗口
+    static uint32_t s_sum[3] = {0, 0, 0};
+    static uint16_t s_winN = 0;
+
+    static bool     s_pendingValid = false;     // 暂存页满时手上那一条，等新页打开再写
+    static Record   s_pending{};
+
+    // 补发
+    static USART_Controller* s_bfLink = nullptr;
+    static bool     s_bfBin = false;
+    static uint16_t s_bfRun = 0;
+    static uint32_t s_bfSince = 0;
+    static Cursor   s_bfCur{};
+    static uint16_t s_bfCurRun = 0;
+    static uint16_t s_bfPageCount = 0;          // 当前页的记录数（被覆盖时计入 lost）
+    static Backfill s_bf;
+    static uint8_t  s_raw[9 + BF_BATCH * REC_MAX + 2];
+    static uint8_t  s_wire[NS_TLM::FrameCodec::CobsMaxLen(sizeof(s_raw)) + 1];
+
+    static inline uint32_t PageAddr(uint32_t seq) { return BASE + (seq % PAGES) * PAGE_SIZE; }
+
+    static const PageHeader* FlashHeader(uint32_t seq) {
+        return reinterpret_cast<const PageHeader*>(PageAddr(seq));
+    }
+
+    // ------------------------ 编码 ------------------------
+
+    static uint16_t PutVarint(uint8_t* p, uint32_t v) {
+        uint16_t n = 0;
+        while (v >= 0x80) {
+            p[n++] = static_cast<uint8_t>(v | 0x80);
+            v >>= 7;
+        }
+        p[n++] = static_cast<uint8_t>(v);
+        return n;
+    }
+
+    static bool GetVarint(const uint8_t* p, uint16_t len, uint16_t* off, uint32_t* v) {
+        uint32_t r = 0;
+        for (uint8_t shift = 0; shift < 35 && *off < len; shift = static_cast<uint8_t>(shift + 7)) {
+            const uint8_t b = p[(*off)++];
+            r |= static_cast<uint32_t>(b & 0x7F) << shift;
+            if ((b & 0x80) == 0) {
+                *v = r;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static inline uint32_t ZigZag(int32_t v) { return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31); }
+    static inline int32_t  UnZigZag(uint32_t v) { return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1u); }
+
+    static uint16_t EncodeRecord(uint8_t* p, const Record& r, const Record& prev) {
+        uint16_t n = PutVarint(p, r.ms - prev.ms);
+        for (uint8_t c = 0; c < 3; ++c) n = static_cast<uint16_t>(n + PutVarint(p + n, ZigZag((int32_t)r.ch[c] - (int32_t)prev.ch[c])));
+        n = static_cast<uint16_t>(n + PutVarint(p + n, ZigZag((int32_t)r.code - (int32_t)prev.code)));
+        return n;
+    }
+
+    static bool DecodeRecord(const uint8_t* p, uint16_t len, uint16_t* off, Record* r) {
+        uint32_t v = 0;
+        if (!GetVarint(p, len, off, &v)) return false;
+        r->ms += v;
+        for (uint8_t c = 0; c < 3; ++c) {
+            if (!GetVarint(p, len, off, &v)) return false;
+            r->ch[c] = static_cast<uint16_t>(r->ch[c] + UnZigZag(v));
+        }
+        if (!GetVarint(p, len, off, &v)) return false;
+        r->code = static_cast<uint16_t>(r->code + UnZigZag(v));
+        return true;
+    }
+
+    static uint16_t PageCrc(const PageHeader& h, const uint8_t* data) {
+        const uint16_t crc = NS_TLM::FrameCodec::Crc16(reinterpret_cast<const uint8_t*>(&h), HDR_SIZE - 2);
+        return NS_TLM::FrameCodec::Crc16(data, h.len, crc);
+    }
+
+    // ------------------------ 索引 ------------------------
+
+    static bool ValidFlashPage(uint8_t slot, IndexEntry* e) {
+        const PageHeader& h = *reinterpret_cast<const PageHeader*>(BASE + slot * PAGE_SIZE);
+        if (h.magic != MAGIC || (h.seq % PAGES) != slot || h.len > DATA_SIZE || h.count == 0) return false;
+        if (PageCrc(h, reinterpret_cast<const uint8_t*>(&h) + HDR_SIZE) != h.crc) return false;
+        e->seq = h.seq;
+        e->run = h.run;
+        e->count = h.count;
+        e->t0Ms = h.t0Ms;
+        e->t1Ms = h.t1Ms;
+        e->valid = true;
+        return true;
+    }
+
+    static uint32_t OldestSeq() {
+        uint32_t oldest = s_stageHdr.seq;
+        for (uint8_t i = 0; i < PAGES; ++i) {
+            if (s_index[i].valid && s_index[i].seq < oldest) oldest = s_index[i].seq;
+        }
+        return oldest;
+    }
+
+    static void OpenStage() {
+        s_stageHdr = PageHeader{};
+        s_stageHdr.seq = s_stats.nextSeq;
+        s_phase = Phase::IDLE;
+        s_held = false;
+    }
+
+    static bool IsBlank(uint32_t addr) {
+        const uint32_t* p = reinterpret_cast<const uint32_t*>(addr);
+        for (uint16_t i = 0; i < PAGE_SIZE / 4; ++i) {
+            if (p[i] != 0xFFFFFFFFu) return false;
+        }
+        return true;
+    }
+
+    // 采样与波形都停着（CGM 不开流，只看 DAC 不够）：擦除期间 20~40ms 的取指停顿不会推迟任何实时中断
+    static bool Quiet() {
+        return !NS_STREAM::GetStaticStream().IsActive() && !NS_DAC::SystemController::GetInstance().IsRunning()
+            && !NS_CGM::IsActive();
+    }
+
+    // 擦除一个槽位（只在 Quiet 时调用，失败由调用方计数）；先作废索引，补发读到这一页会按 lost 跳过
+    static bool EraseSlot(uint8_t slot) {
+        s_index[slot].valid = false;
+        const uint32_t addr = BASE + slot * PAGE_SIZE;
+        if (!IsBlank(addr)) {
+            FLASH_Unlock();
+            FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPRTERR);
+            const FLASH_Status st = FLASH_ErasePage(addr);
+            FLASH_Lock();
+            ++s_stats.erases;
+            if (st != FLASH_COMPLETE) return false;
+        }
+        s_blank |= 1u << slot;
+        return true;
+    }
+
+    // 空闲时把写入位置之后 PREP 个槽位擦好（每次 Service 最多擦一页），运行中的整页写入只编程
+    static void Prepare() {
+        if (!s_cfg.enabled || !Quiet()) return;
+        for (uint8_t k = 0; k < s_cfg.prep; ++k) {
+            const uint8_t slot = static_cast<uint8_t>((s_stageHdr.seq + k) % PAGES);
+            if (s_blank & (1u << slot)) continue;
+            if (!EraseSlot(slot)) ++s_stats.errors;
+            return;
+        }
+    }
+
+    static uint8_t BlankAhead() {
+        uint8_t n = 0;
+        while (n < PAGES && (s_blank & (1u << ((s_stageHdr.seq + n) % PAGES)))) ++n;
+        return n;
+    }
+
+    void Init() {
+        uint32_t newest = 0;
+        bool any = false;
+        s_run = 0;
+        s_blank = 0;
+        for (uint8_t i = 0; i < PAGES; ++i) {
+            s_index[i] = IndexEntry{};
+            if (IsBlank(BASE + i * PAGE_SIZE)) s_blank |= 1u << i;
+            if (!ValidFlashPage(i, &s_index[i])) continue;
+            if (!any || s_index[i].seq > newest) newest = s_index[i].seq;
+            if (s_index[i].run > s_run) s_run = s_index[i].run;
+            any = true;
+        }
+        s_stats.nextSeq = any ? newest + 1u : 0u;
+        OpenStage();
+    }
+
+    void SetConfig(const Config& cfg) {
+        s_cfg = cfg;
+        if (s_cfg.decim == 0) s_cfg.decim = 1;
+        if (s_cfg.decim > MAX_DECIM) s_cfg.decim = MAX_DECIM;
+        if (s_cfg.prep == 0) s_cfg.prep = 1;
+        if (s_cfg.prep > MAX_PREP) s_cfg.prep = MAX_PREP;
+        s_winN = 0;
+        s_sum[0] = s_sum[1] = s_sum[2] = 0;
+    }
+
+    const Config& GetConfig() { return s_cfg; }
+
+    // ------------------------ 写入 ------------------------
+
+    static void Seal() {
+        if (s_stageHdr.count == 0 || s_phase != Phase::IDLE) return;
+        s_stageHdr.magic = MAGIC;
+        s_stageHdr.crc = PageCrc(s_stageHdr, s_stage);
+        s_progOff = 0;
+        s_phase = Phase::WAIT;
+    }
+
+    // 暂存页写满返回 false（已封存，记录留在 s_pending）
+    static bool Append(const Record& r) {
+        if (s_stageHdr.count == 0) {
+            s_stageHdr.run = s_run;
+            s_stageHdr.t0Ms = r.ms;
+            s_stagePrev = Record{r.ms, {0, 0, 0}, 0};
+        }
+        uint8_t tmp[REC_MAX];
+        const uint16_t n = EncodeRecord(tmp, r, s_stagePrev);
+        if (s_stageHdr.len + n > DATA_SIZE) {
+            Seal();
+            return false;
+        }
+        ::memcpy(&s_stage[s_stageHdr.len], tmp, n);
+        s_stageHdr.len = static_cast<uint16_t>(s_stageHdr.len + n);
+        ++s_stageHdr.count;
+        s_stageHdr.t1Ms = r.ms;
+        s_stagePrev = r;
+        ++s_stats.records;
+        return true;
+    }
+
+    static bool ProgramHalfWords(uint32_t addr, const uint8_t* data, uint16_t halfwords) {
+        FLASH_Status st = FLASH_COMPLETE;
+        FLASH_Unlock();
+        for (uint16_t i = 0; i < halfwords && st == FLASH_COMPLETE; ++i) {
+            const uint16_t v = static_cast<uint16_t>(data[2 * i] | (data[2 * i + 1] << 8));
+            st = FLASH_ProgramHalfWord(addr + 2u * i, v);
+        }
+        FLASH_Lock();
+        return st == FLASH_COMPLETE;
+    }
+
+    // 写页失败：放弃该页（槽位留给下一圈，下次空闲时重新擦除），继续用下一个序号
+    static void CommitFailed() {
+        ++s_stats.errors;
+        ++s_stats.nextSeq;
+        OpenStage();
+    }
+
+    // 分段写入：WAIT（槽位须已擦除）→ PROGRAM（每次 PROG_CHUNK 半字）→ HEADER（magic 最后）→ 校验、更新索引
+    static void StepCommit() {
+        const uint32_t addr = PageAddr(s_stageHdr.seq);
+        const uint8_t slot = static_cast<uint8_t>(s_stageHdr.seq % PAGES);
+        IndexEntry& e = s_index[slot];
+        switch (s_phase) {
+        case Phase::WAIT: {
+            if (!(s_blank & (1u << slot))) {
+                // 运行中没有预擦除的槽位：不擦除，暂存页留在 RAM，采集暂停（广播环被覆盖的计入 DROP）
+                if (!Quiet()) {
+                    if (!s_held) {
+                        s_held = true;
+                        ++s_stats.held;
+                    }
+                    return;
+                }
+                if (!EraseSlot(slot)) {
+                    CommitFailed();
+                    return;
+                }
+            }
+            // 开始编程：槽位不再是空白页
+            e.valid = false;
+            s_blank &= ~(1u << slot);
+            s_phase = Phase::PROGRAM;
+            return;
+        }
+        case Phase::PROGRAM: {
+            const uint16_t total = static_cast<uint16_t>((s_stageHdr.len + 1u) & ~1u);
+            if (s_stageHdr.len & 1u) s_stage[s_stageHdr.len] = 0xFF;    // 末尾补齐半字
+            uint16_t bytes = static_cast<uint16_t>(total - s_progOff);
+            if (bytes > PROG_CHUNK * 2) bytes = PROG_CHUNK * 2;
+            if (!ProgramHalfWords(addr + HDR_SIZE + s_progOff, &s_stage[s_progOff], static_cast<uint16_t>(bytes / 2))) {
+                CommitFailed();
+                return;
+            }
+            s_progOff = static_cast<uint16_t>(s_progOff + bytes);
+            if (s_progOff >= total) s_phase = Phase::HEADER;
+            return;
+        }
+        case Phase::HEADER: {
+            const uint8_t* h = reinterpret_cast<const uint8_t*>(&s_stageHdr);
+            // magic（前 4 字节）最后写：掉电时页头不完整，开机扫描视为无效页
+            if (!ProgramHalfWords(addr + 4, h + 4, (HDR_SIZE - 4) / 2) || !ProgramHalfWords(addr, h, 2)) {
+                CommitFailed();
+                return;
+            }
+            if (!ValidFlashPage(static_cast<uint8_t>(s_stageHdr.seq % PAGES), &e)) {
+                CommitFailed();
+                return;
+            }
+            ++s_stats.pages;
+            ++s_stats.nextSeq;
+            OpenStage();
+            return;
+        }
+        default:
+            return;
+        }
+    }
+
+    void Rewind(const NS_STREAM::StreamSource& src) {
+        Seal();
+        ++s_run;
+        s_armed = true;
+        s_cursor = src.GetHead();
+        s_winN = 0;
+        s_sum[0] = s_sum[1] = s_sum[2] = 0;
+        s_pendingValid = false;
+    }
+
+    static void Collect() {
+        const auto& src = NS_STREAM::GetStaticStream();
+        if (!s_cfg.enabled || !s_armed) {
+            Seal();                 // LOG OFF：已暂存的记录照样写进 flash
+            s_cursor = src.GetHead();
+            return;
+        }
+        if (s_pendingValid) {
+            if (!Append(s_pending)) return;
+            s_pendingValid = false;
+        }
+        const uint32_t head = src.GetHead();
+        uint32_t lag = head - s_cursor;
+        if (lag > NS_STREAM::StreamSource::QUEUE_SIZE) {
+            s_stats.dropped += lag - NS_STREAM::StreamSource::QUEUE_SIZE;
+            s_cursor = head - NS_STREAM::StreamSource::QUEUE_SIZE;
+        }
+        while (s_cursor != head && s_phase == Phase::IDLE) {
+            NS_TLM::Sample smp;
+            const bool ok = src.Read(s_cursor, smp);
+            ++s_cursor;
+            if (!ok) {
+                ++s_stats.dropped;
+                continue;
+            }
+            for (uint8_t c = 0; c < 3; ++c) s_sum[c] += smp.ch[c];
+            if (++s_winN < s_cfg.decim) continue;
+
+            Record r;
+            r.ms = smp.ms;
+            for (uint8_t c = 0; c < 3; ++c) r.ch[c] = static_cast<uint16_t>((s_sum[c] + s_winN / 2u) / s_winN);
+            r.code = smp.code;
+            s_winN = 0;
+            s_sum[0] = s_sum[1] = s_sum[2] = 0;
+            if (!Append(r)) {
+                s_pending = r;
+                s_pendingValid = true;
+            }
+        }
+        // STOP：未满的暂存页也写进 flash，断电不丢
+        if (!src.IsActive() && s_cursor == head) Seal();
+    }
+
+    // ------------------------ 补发 ------------------------
+
+    // 取序号 seq 的页：暂存页直接读 RAM，其余从 flash（索引确认仍是这一页）
+    static bool GetPage(uint32_t seq, PageHeader* h, const uint8_t** data) {
+        if (seq == s_stageHdr.seq) {
+            *h = s_stageHdr;
+            *data = s_stage;
+            return true;
+        }
+        const IndexEntry& e = s_index[seq % PAGES];
+        if (!e.valid || e.seq != seq) return false;
+        *h = *FlashHeader(seq);
+        *data = reinterpret_cast<const uint8_t*>(PageAddr(seq)) + HDR_SIZE;
+        return true;
+    }
+
+    static bool Before(uint16_t run, uint32_t ms) {
+        return run < s_bfRun || (run == s_bfRun && ms < s_bfSince);
+    }
+
+    // 下一条不早于 (run, since) 的记录；追上写入位置返回 false
+    static bool NextRecord(Record* out, uint16_t* run) {
+        for (;;) {
+            PageHeader h;
+            const uint8_t* d = nullptr;
+            Cursor& c = s_bfCur;
+            if (!GetPage(c.seq, &h, &d)) {
+                // 读到一半被新数据覆盖（或本来就无效）：跳到仍然有效的最旧页
+                if (c.rec < s_bfPageCount) s_bf.lost += s_bfPageCount - c.rec;
+                const uint32_t oldest = OldestSeq();
+                c.seq = (c.seq + 1u > oldest) ? c.seq + 1u : oldest;
+                c.off = 0;
+                c.rec = 0;
+                s_bfPageCount = 0;
+                continue;
+            }
+            s_bfPageCount = h.count;
+            if (c.rec >= h.count) {
+                if (c.seq == s_stageHdr.seq) return false;
+                ++c.seq;
+                c.off = 0;
+                c.rec = 0;
+                continue;
+            }
+            if (c.rec == 0) {
+                c.prev = Record{h.t0Ms, {0, 0, 0}, 0};
+                s_bfCurRun = h.run;
+            }
+            if (!DecodeRecord(d, h.len, &c.off, &c.prev)) {
+                s_bf.lost += h.count - c.rec;
+                c.rec = h.count;
+                continue;
+            }
+            ++c.rec;
+            if (Before(s_bfCurRun, c.prev.ms)) continue;
+            *out = c.prev;
+            *run = s_bfCurRun;
+            return true;
+        }
+    }
+
+    static void FinishBackfill() {
+        char buf[64];
+        NS_FMT::FmtBuf f(buf);
+        f.Str("BACKFILL END N=").U32(s_bf.sent).Str(" LOST=").U32(s_bf.lost).Str("\r\n");
+        s_bfLink->Send(f.c_str());
+        s_bf.active = false;
+    }
+
+    static bool SendJson(const Record& r, uint16_t run) {
+        char buf[112];
+        NS_FMT::FmtBuf f(buf);
+        f.Str("{\"Bf\":").U32(run).Str(",\"Ms\":").U32(r.ms)
+         .Str(",\"Uric\":").U32(r.ch[0]).Str(",\"Ascorbic\":").U32(r.ch[1]).Str(",\"Glucose\":").U32(r.ch[2])
+         .Str(",\"Code12\":").U32(r.code).Str("}\r\n");
+        if (s_bfLink->TxFree() < f.size() + BF_TX_RESERVE) return false;
+        s_bfLink->Send(f.c_str());
+        return true;
+    }
+
+    // 一帧最多 BF_BATCH 条；换 run 时提前结束本帧（帧头只有一个 run）
+    static uint16_t BuildFrame(Record* first, uint16_t run, uint8_t* n_out) {
+        uint16_t len = 9;
+        uint8_t n = 0;
+        Record prev{first->ms, {0, 0, 0}, 0};
+        s_raw[0] = FRAME_BACKFILL;
+        s_raw[1] = 0;
+        s_raw[2] = static_cast<uint8_t>(run);
+        s_raw[3] = static_cast<uint8_t>(run >> 8);
+        ::memcpy(&s_raw[4], &first->ms, 4);
+        Record r = *first;
+        uint16_t rrun = run;
+        for (;;) {
+            len = static_cast<uint16_t>(len + EncodeRecord(&s_raw[len], r, prev));
+            prev = r;
+            if (++n >= BF_BATCH) break;
+            // 下一条不同 run 时留给下一帧：先看一眼，不是同一 run 就退回游标
+            const Cursor save = s_bfCur;
+            const uint16_t saveRun = s_bfCurRun;
+            const uint16_t savePage = s_bfPageCount;
+            if (!NextRecord(&r, &rrun)) break;
+            if (rrun != run) {
+                s_bfCur = save;
+                s_bfCurRun = saveRun;
+                s_bfPageCount = savePage;
+                break;
+            }
+        }
+        s_raw[8] = n;
+        const uint16_t crc = NS_TLM::FrameCodec::Crc16(s_raw, len);
+        s_raw[len++] = static_cast<uint8_t>(crc);
+        s_raw[len++] = static_cast<uint8_t>(crc >> 8);
+        *n_out = n;
+        uint16_t w = NS_TLM::FrameCodec::CobsEncode(s_raw, len, s_wire);
+        s_wire[w++] = 0x00;
+        return w;
+    }
+
+    static void ServiceBackfill() {
+        if (!s_bf.active) return;
+        const uint16_t worst = static_cast<uint16_t>(sizeof(s_wire) + BF_TX_RESERVE);
+        for (uint8_t i = 0; i < BF_FRAMES_PER_SERVICE; ++i) {
+            if (s_bfLink->TxFree() < (s_bfBin ? worst : BF_TX_RESERVE + 112)) return;
+            // 在取记录前保存游标：JSON 行放不下时退回
+            const Cursor save = s_bfCur;
+            Record r;
+            uint16_t run = 0;
+            if (!NextRecord(&r, &run)) {
+                FinishBackfill();
+                return;
+            }
+            if (s_bfBin) {
+                uint8_t n = 0;
+                const uint16_t w = BuildFrame(&r, run, &n);
+                (void)s_bfLink->WriteFrame(s_wire, w);
+                s_bf.sent += n;
+            } else if (SendJson(r, run)) {
+                ++s_bf.sent;
+            } else {
+                s_bfCur = save;
+                return;
+            }
+        }
+    }
+
+    Status StartBackfill(USART_Controller& link, uint16_t run, uint32_t since_ms) {
+        // 按索引找第一页末尾不早于 (run, since) 的页，没有就看暂存页
+        const uint32_t oldest = OldestSeq();
+        bool found = false;
+        uint32_t seq = oldest;
+        for (; seq <= s_stageHdr.seq; ++seq) {
+            PageHeader h;
+            const uint8_t* d = nullptr;
+            if (!GetPage(seq, &h, &d) || h.count == 0) continue;
+            if (h.run > run || (h.run == run && h.t1Ms >= since_ms)) {
+                found = true;
+                break;
+            }
+        }
+        if (!found) return Status::EMPTY;
+
+        const NS_STREAM::StreamSink* sink = NS_STREAM::FindSink(link);
+        s_bfLink = &link;
+        s_bfBin = sink && sink->Encoder().GetFormat() == NS_TLM::Format::BIN;
+        s_bfRun = run;
+        s_bfSince = since_ms;
+        s_bfCur = Cursor{seq, 0, 0, Record{}};
+        s_bfPageCount = 0;
+        s_bf = Backfill{};
+        s_bf.active = true;
+        return Status::OK;
+    }
+
+    void StopBackfill() {
+        s_bf.active = false;
+    }
+
+    // ------------------------ 其他 ------------------------
+
+    void Service() {
+        if (s_phase != Phase::IDLE) {
+            StepCommit();
+        } else {
+            Collect();
+            if (s_phase == Phase::IDLE) Prepare();
+        }
+        ServiceBackfill();
+    }
+
+    Status Erase() {
+        if (s_phase != Phase::IDLE || !Quiet()) return Status::BUSY;
+        s_bf.active = false;
+        for (uint8_t i = 0; i < PAGES; ++i) {
+            if (!EraseSlot(i)) ++s_stats.errors;
+        }
+        // 序号继续递增：下一页仍写在原来的下一个槽位，磨损均衡不受影响
+        s_pendingValid = false;
+        OpenStage();
+        return Status::OK;
+    }
+
+    Stats GetStats() {
+        Stats st = s_stats;
+        st.valid = 0;
+        for (uint8_t i = 0; i < PAGES; ++i) {
+            if (s_index[i].valid) ++st.valid;
+        }
+        st.oldestSeq = OldestSeq();
+        st.run = s_run;
+        st.stageBytes = s_stageHdr.len;
+        st.stageRecords = s_stageHdr.count;
+        st.committing = (s_phase != Phase::IDLE);
+        st.holding = (s_phase == Phase::WAIT) && !(s_blank & (1u << (s_stageHdr.seq % PAGES)));
+        st.blankAhead = BlankAhead();
+        // 槽位轮流写，每个槽位每一圈擦一次：圈数即每页擦写次数的估计
+        st.cycles = (s_stats.nextSeq + PAGES - 1u) / PAGES;
+        return st;
+    }
+
+    Backfill GetBackfill() { return s_bf; }
+
+} // namespace NS_LOG
@@ -0,0 +1,97 @@
+#pragma once
+#include <stdint.h>
+
+class USART_Controller;
+namespace NS_STREAM { class StreamSource; }
+
+// 闪存样本日志：链路断开期间的样本写进空闲 flash，重连后用 BACKFILL 补发。
+// - 区域 0x08030000~0x0803EFFF（30 页 × 2KB，链接器 IROM 已缩到 0x30000）；0x0803F000 起留给参数页
+// - 作为广播环的又一个读者（自己的游标），样本按 DECIM 平均后压缩进 RAM 暂存页：
+//   记录 = ms 差值 varint + 三个通道与 DAC 码相对上一记录的 zigzag varint（页内第一条的 ms 相对页头首时间戳，其余相对 0），
+//   噪声级变化每条约 5 字节，一页约 400 条
+// - 擦除只在空闲时做（采样与波形都停着）：每次 Service 最多预擦一页，保持写入位置之后 PREP 页是空白页。
+//   整页擦除取指停顿 20~40ms，运行中绝不擦除。代价：最旧的 PREP 页提前被擦掉，可补发的最多 PAGES - PREP 页
+// - 暂存页满（或 STOP）时整页写入，运行中只编程：每次 Service 编程 64 个半字。每个半字编程约 52~70us 取指停顿，
+//   半字之间中断照常响应（中断延迟最多增加约 70us），但调用方（主循环 / tlm 线程）每段被占用约 3.4~4.5ms，
+//   一页约 16 段。记录区写完最后写页头，页头带 CRC，掉电写了一半的页开机时丢弃
+// - 运行中写到没有空白槽位（一次运行超过 PREP 页）：暂存页留在 RAM 等到 STOP 再擦除写入，
+//   这期间不再收样本（被广播环覆盖的计入 dropped），HELD 计数
+// - 默认关闭：每写满一页就擦一页，200Hz、DECIM=1 约 2 秒一页、1 分钟整区轮一圈，连续运行约一周即到
+//   F103 页寿命（约 1 万次）；长时间记录应加大 DECIM（DECIM=100 约 3 分钟一页）。
+//   WEAR 按页序号估计每页已擦写的圈数
+// - 页序号 seq 单调递增，槽位 = seq % PAGES，循环写入即磨损均衡；开机扫描页头建立
+//   时间索引（每页 run、首末时间戳），BACKFILL 按索引直接定位到起始页
+// - 时间戳为样本时间轴（相对本次 START 的 ms，与流中 Ms 相同），run 为开机以来的第几次 START
+//   （跨重启累加，取 flash 中最大值继续）
+namespace NS_LOG
+{
+    static const uint32_t BASE      = 0x08030000u;
+    static const uint16_t PAGE_SIZE = 2048;
+    static const uint8_t  PAGES     = 30;
+    static const uint16_t MAX_DECIM = 1000;
+    static const uint8_t  MAX_PREP  = PAGES - 1;   // 至少留一页给最旧的数据
+
+    // 补发二进制帧（与 NS_TLM 的样本帧/事件帧同一类型编号空间，COBS + CRC16 同样的线上格式）：
+    //   [0] type = FRAME_BACKFILL  [1] flags = 0  [2..3] run  [4..7] 基准 ms  [8] N
+    //   之后 N 条记录：ms 相对上一条的 varint（第一条相对基准），CH0..CH2/CODE 相对上一条的 zigzag varint
+    //   （帧内第一条相对 0），末尾 CRC16
+    // JSON 链路每条记录一行：{"Bf":run,"Ms":t,"Uric":..,"Ascorbic":..,"Glucose":..,"Code12":..}
+    static const uint8_t FRAME_BACKFILL = 0x03;
+
+    struct Config {
+        bool     enabled = false;
+        uint16_t decim   = 1;           // 每条记录平均的样本数
+        uint8_t  prep    = 8;           // 写入位置之后保持擦好的页数（一次运行不擦除最多能写的页）
+    };
+
+    struct Stats {
+        uint32_t records = 0;           // 写入暂存页的记录
+        uint32_t pages = 0;             // 本次开机写入 flash 的页
+        uint32_t dropped = 0;           // 落后广播环超过一圈被覆盖的样本
+        uint32_t errors = 0;            // 擦除/编程/回读校验失败
+        uint32_t erases = 0;            // 本次开机擦除的页
+        uint32_t held = 0;              // 运行中没有空白槽位、等到 STOP 才写入的页
+        uint8_t  valid = 0;             // flash 中有效页数
+        uint32_t oldestSeq = 0;
+        uint32_t nextSeq = 0;           // 暂存页的序号（下一个写入的页）
+        uint16_t run = 0;
+        uint16_t stageBytes = 0;
+        uint16_t stageRecords = 0;
+        bool     committing = false;
+        bool     holding = false;       // 暂存页正在等空白槽位
+        uint8_t  blankAhead = 0;        // 写入位置起连续的空白页
+        uint32_t cycles = 0;            // 每页擦写圈数估计（页序号 / PAGES，LOG ERASE 后重启会从 0 算起）
+    };
+
+    struct Backfill {
+        bool     active = false;
+        uint32_t sent = 0;              // 已发出的记录
+        uint32_t lost = 0;              // 读到一半被新数据覆盖的记录
+    };
+
+    enum class Status : uint8_t { OK = 0, EMPTY, BUSY };
+
+    // 开机调用：扫描页头建立索引，确定下一个写入位置与 run
+    void Init();
+
+    void SetConfig(const Config& cfg);
+    const Config& GetConfig();
+
+    // 新一次 START（NS_STREAM::SetStreaming(fresh)）：封存上一次的暂存页，run + 1，游标对齐 head
+    void Rewind(const NS_STREAM::StreamSource& src);
+
+    // 主循环 / tlm 线程调用（与输出端同一上下文）：收样本、分段写 flash、补发
+    void Service();
+
+    // 补发 (run, since_ms) 之后的全部记录（含暂存页中尚未写入 flash 的），追上写入位置后结束。
+    // 只用该链路 TX 的富余空间，不影响实时流；已在补发时改为新的请求
+    Status StartBackfill(USART_Controller& link, uint16_t run, uint32_t since_ms);
+    void   StopBackfill();
+
+    // 擦除全部日志页（阻塞约 30 × 20ms，之后全部槽位都是空白页）；正在写页、采样或波形（含 CGM）运行中返回 BUSY
+    Status Erase();
+
+    Stats    GetStats();
+    Backfill GetBackfill();
+
+} // namespace NS_LOG
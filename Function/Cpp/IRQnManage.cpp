@@ -13,26 +13,57 @@ std::array<TIM_IRQnManage::IRQnStruct, TIM_IRQnManage::Size_TIM> TIM_IRQnManage:
     TIM_IRQnManage::IRQnStruct{TIM8}
 };
 
+volatile TIM_IRQnManage::Probe TIM_IRQnManage::probeT2 = {0, 0, 0xFFFFFFFFu, 0, 0};
+volatile bool TIM_IRQnManage::probeReset = false;
+
+// O(1)：TIM2~TIM7 在 APB1 上按 0x400 连续排布，TIM1/TIM8 单独比较
 uint8_t TIM_IRQnManage::GetHandlerIndexFromType(TIM_TypeDef *TIMx) {
-    uint8_t idx = Size_TIM; // invalid
-    for (uint8_t i = 0; i < Handlers.size(); i++) {
-        if (TIMx == Handlers[i].TIMx) {
-            idx = i;
-            break;
-        }
+    const uintptr_t addr = reinterpret_cast<uintptr_t>(TIMx);
+    if (addr >= TIM2_BASE && addr <= TIM7_BASE && ((addr - TIM2_BASE) & 0x3FFu) == 0) {
+        return static_cast<uint8_t>(To_uint8(TIM::Index::T2) + ((addr - TIM2_BASE) >> 10));
     }
-    return idx;
+    if (TIMx == TIM1) return To_uint8(TIM::Index::T1);
+    if (TIMx == TIM8) return To_uint8(TIM::Index::T8);
+    return Size_TIM; // invalid
 }
 
+// O(1)：IT 为单个 SR 位，位号即下标
 uint8_t TIM_IRQnManage::GetTimItIndexFromType(TIM::IT tim_it) {
-    uint8_t idx = To_uint8(TIM::IT_Index::END); // invalid
-    for (uint8_t i = 0; i < TIM::ITMap.size(); i++) {
-        if (TIM::ITMap[i] == tim_it) {
-            idx = i;
-            break;
-        }
+    const uint32_t it = To_uint16(tim_it);
+    if (it == 0 || (it & (it - 1u)) != 0 || (it & IT_MASK) == 0) {
+        return To_uint8(TIM::IT_Index::END); // invalid：不是单个位，或不在 UP..COM 之内
     }
-    return idx;
+    return static_cast<uint8_t>(31u - __CLZ(it));
+}
+
+TIM_IRQnManage::Probe TIM_IRQnManage::GetProbeT2() {
+    Probe p;
+    p.count  = probeT2.count;
+    p.lastCyc = probeT2.lastCyc;
+    p.minCyc = probeT2.minCyc;
+    p.maxCyc = probeT2.maxCyc;
+    p.sumCyc = probeT2.sumCyc;
+    if (p.count == 0) p.minCyc = 0;
+    return p;
+}
+
+#if defined(TIM2_IRQ_DIRECT) && !defined(TIM2_IRQ_DIRECT_AT_HEADER)
+#error "TIM2_IRQ_DIRECT must be a project-wide define (eide.yml defineList / -D), not a #define in a source file"
+#endif
+#if defined(TIM2_IRQ_DIRECT)
+extern "C" const uint8_t TIM2_IRQ_DIRECT_in_IRQnManage = 1;
+#endif
+
+TIM_IRQnManage::DispatchMode TIM_IRQnManage::GetModeT2() {
+#if defined(TIM2_IRQ_DIRECT)
+    // 引用 DACManager.cpp 的握手符号：它没有看到宏（不提供 TIM2_IRQHandler）时链接失败
+    (void)*static_cast<const volatile uint8_t*>(&TIM2_IRQ_DIRECT_in_DACManager);
+    return DispatchMode::DIRECT;
+#elif defined(TIM_IRQ_LEGACY_SCAN)
+    return DispatchMode::LEGACY_SCAN;
+#else
+    return DispatchMode::TABLE;
+#endif
 }
 
 static inline bool IsTimIt_Update(uint16_t it) {
@@ -102,22 +133,15 @@ bool TIM_IRQnManage::Add(TIM_TypeDef *TIMx,
                          uint8_t sub_priority,
                          FunctionalState state)
 {
-    // (1) 绑定回调
+    // (1) 绑定回调（同一中断源只允许注册一次）
     bool result = false;
-    for (auto& item : TIM_IRQnManage::Handlers) {
-        if (item.TIMx == TIMx) {
-            const auto it_index = GetTimItIndexFromType(tim_it);
-            if (it_index >= To_uint8(TIM::IT_Index::END)) {
-                result = false;
-                break;
-            }
-            if (item.itFuncs[it_index] != nullptr) {
-                result = false;
-                break;
-            }
-            item.itFuncs[it_index] = func;
+    const uint8_t tim_index = GetHandlerIndexFromType(TIMx);
+    const uint8_t it_index = GetTimItIndexFromType(tim_it);
+    if (tim_index < Size_TIM && it_index < Size_TIM_IT) {
+        auto& slot = TIM_IRQnManage::Handlers[tim_index].itFuncs[it_index];
+        if (slot == nullptr) {
+            slot = func;
             result = true;
-            break;
         }
     }
 
@@ -127,22 +151,49 @@ bool TIM_IRQnManage::Add(TIM_TypeDef *TIMx,
 }
 
 
-// TIM 分发：遍历 ITMap，发现置位就清除并执行回调
+#if defined(TIM_IRQ_LEGACY_SCAN)
+// TIM 分发（旧）：遍历 ITMap，逐项 TIM_GetITStatus，发现置位就清除并执行回调
 template<TIM::Index tim_index>
 static void HandlerTIM_IRQ(TIM_TypeDef* TIMx) {
+    const uint32_t t0 = DWT->CYCCNT;
     for(uint8_t i = 0; i < TIM::ITMap.size(); ++i) {
         const uint16_t tim_it = To_uint16(TIM::ITMap[i]);
         if(TIM_GetITStatus(TIMx, tim_it) != RESET) {
             TIM_ClearITPendingBit(TIMx, tim_it);
             if (auto & func = TIM_IRQnManage::GetHandlers(tim_index).itFuncs[i]) {
+                TIM_IRQnManage::RecordEntry<tim_index>(t0);
                 func();
             }
         }
     }
 }
+#else
+// TIM 分发：SR & DIER 只读一次，一次写清本次取到的位；再按位号（低位先，UP 优先）查表调用
+template<TIM::Index tim_index>
+static void HandlerTIM_IRQ(TIM_TypeDef* TIMx) {
+    const uint32_t t0 = DWT->CYCCNT;
+    uint32_t pending = TIMx->SR & TIMx->DIER & TIM_IRQnManage::IT_MASK;
+    TIMx->SR = static_cast<uint16_t>(~pending);     // rc_w0：只清本次取到的位，之后新置的位留给下一次
+    void (* const * funcs)() = TIM_IRQnManage::GetHandlers(tim_index).itFuncs;
+    bool first = true;
+    while (pending) {
+        const uint32_t bit = __CLZ(__RBIT(pending));    // 最低置位的位号
+        pending &= pending - 1u;
+        if (auto func = funcs[bit]) {
+            if (first) {
+                TIM_IRQnManage::RecordEntry<tim_index>(t0);
+                first = false;
+            }
+            func();
+        }
+    }
+}
+#endif
 
-// ---- 常规定时器（单 IRQ 线） ----
+// TIMx_IRQ_DIRECT：该向量由别处用 DirectIRQ<> 直接提供（见 IRQnManage.h）
+#if !defined(TIM2_IRQ_DIRECT)
 extern "C" void TIM2_IRQHandler(void) { HandlerTIM_IRQ<TIM::Index::T2>(TIM2); }
+#endif
 extern "C" void TIM3_IRQHandler(void) { HandlerTIM_IRQ<TIM::Index::T3>(TIM3); }
 extern "C" void TIM4_IRQHandler(void) { HandlerTIM_IRQ<TIM::Index::T4>(TIM4); }
 extern "C" void TIM5_IRQHandler(void) { HandlerTIM_IRQ<TIM::Index::T5>(TIM5); }
@@ -410,3 +461,50 @@ static void HandleUSART_IRQ(USART_TypeDef* usart)
 extern "C" void USART1_IRQHandler(void) { HandleUSART_IRQ<USART::Index::US1>(USART1); }
 extern "C" void USART2_IRQHandler(void) { HandleUSART_IRQ<USART::Index::US2>(USART2); }
 extern "C" void USART3_IRQHandler(void) { HandleUSART_IRQ<USART::Index::US3>(USART3); }
+
+
+// ========================= EXTI IRQnManage =========================
+
+void (*EXTI_IRQnManage::Handlers[EXTI_IRQnManage::Size_EXTI])() = {nullptr};
+
+IRQn EXTI_IRQnManage::GetIRQn(uint8_t line) {
+    static const IRQn kLow[5] = { EXTI0_IRQn, EXTI1_IRQn, EXTI2_IRQn, EXTI3_IRQn, EXTI4_IRQn };
+    if (line <= 4)  return kLow[line];
+    if (line <= 9)  return EXTI9_5_IRQn;
+    if (line <= 15) return EXTI15_10_IRQn;
+    if (line == 16) return PVD_IRQn;
+    if (line == 17) return RTCAlarm_IRQn;
+    return USBWakeUp_IRQn;
+}
+
+bool EXTI_IRQnManage::Add(uint8_t line,
+                          void (*func)(void),
+                          uint8_t pre_priority,
+                          uint8_t sub_priority,
+                          FunctionalState state)
+{
+    if (line >= Size_EXTI || Handlers[line] != nullptr) return false;
+    Handlers[line] = func;
+    MyNVIC::SetPriority(GetIRQn(line), pre_priority, sub_priority, state);
+    return true;
+}
+
+void EXTI_IRQnManage::Dispatch(uint8_t first, uint8_t last) {
+    const uint32_t range = ((2u << last) - 1u) & ~((1u << first) - 1u);
+    uint32_t pending = EXTI->PR & EXTI->IMR & range;
+    EXTI->PR = pending;                         // 写 1 清除
+    while (pending) {
+        const uint8_t line = static_cast<uint8_t>(__CLZ(__RBIT(pending)));
+        pending &= pending - 1u;
+        if (auto func = Handlers[line]) func();
+    }
+}
+
+extern "C" void EXTI0_IRQHandler(void)     { EXTI_IRQnManage::Dispatch(0, 0); }
+extern "C" void EXTI1_IRQHandler(void)     { EXTI_IRQnManage::Dispatch(1, 1); }
+extern "C" void EXTI2_IRQHandler(void)     { EXTI_IRQnManage::Dispatch(2, 2); }
+extern "C" void EXTI3_IRQHandler(void)     { EXTI_IRQnManage::Dispatch(3, 3); }
+extern "C" void EXTI4_IRQHandler(void)     { EXTI_IRQnManage::Dispatch(4, 4); }
+extern "C" void EXTI9_5_IRQHandler(void)   { EXTI_IRQnManage::Dispatch(5, 9); }
+extern "C" void EXTI15_10_IRQHandler(void) { EXTI_IRQnManage::Dispatch(10, 15); }
+extern "C" void RTCAlarm_IRQHandler(void)  { EXTI_IRQnManage::Dispatch(17, 17); }
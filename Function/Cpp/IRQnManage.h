@@ -7,16 +7,41 @@
 // - 本文件用于“中断分发/回调注册”层：把 (外设实例 + 中断源) -> 回调函数。
 // - 适配 STM32F103（标准库 SPL）。
 
+// TIM 分发（O(1)）：
+// - TIM_IT_xxx 的取值就是 SR/DIER 中的位，IT_Index 的序号就是位号（下方 static_assert 保证），
+//   因此回调表按位号直接索引；中断里只读一次 SR & DIER，按置位逐个取最低位调用，不再逐项查询。
+// - 定时器序号由外设地址算出（TIM2~TIM7 在 APB1 上按 0x400 连续排布），Add 不再线性查找。
+// - 直连模式：TIMx_IRQ_DIRECT 必须是全工程宏（.eide/eide.yml 的 defineList，即编译器 -DTIMx_IRQ_DIRECT），
+//   不能在某个源文件里 #define：IRQnManage.cpp 看到它就不再提供该向量，由 DACManager.cpp（TIM2）
+//   用 DirectIRQ<> 自己提供，回调作为模板参数在编译期内联，无函数指针间接调用。
+//   只有一边看到宏会重复定义或缺少 TIM2_IRQHandler（后者静默落进默认死循环），因此：
+//   在本头文件之后才 #define 的由 TIM2_IRQ_DIRECT_AT_HEADER 检查报 #error；两个源文件各定义一个
+//   握手符号并引用对方的，只有一个文件定义了宏时链接报未定义符号 TIM2_IRQ_DIRECT_in_xxx。
+// - TIM_IRQ_LEGACY_SCAN：恢复旧的逐项 TIM_GetITStatus 扫描，仅用于前后对比 IRQSTAT 数据。
+//   对比方法：默认 / -DTIM_IRQ_LEGACY_SCAN / -DTIM2_IRQ_DIRECT 三种构建各跑一次 CV，IRQSTAT 读 TIM2
+//   入口到回调的 DWT 周期（min/avg/max）；实测数据需上板取得，仓库中尚未记录。
 class TIM_IRQnManage
 {
 public:
     static const uint8_t Size_TIM = To_uint8(TIM::Index::END);
+    static const uint8_t Size_TIM_IT = To_uint8(TIM::IT_Index::END);
+    static const uint16_t IT_MASK = static_cast<uint16_t>((1u << Size_TIM_IT) - 1u);   // UP..COM
+
+    // 向量入口到回调被调用之间的 DWT 周期数（只统计 TIM2：CV/DPV 步进，最热的中断）
+    struct Probe {
+        uint32_t count;
+        uint32_t lastCyc;
+        uint32_t minCyc;
+        uint32_t maxCyc;
+        uint64_t sumCyc;
+    };
+    enum class DispatchMode : uint8_t { TABLE = 0, DIRECT, LEGACY_SCAN };
 
 private:
     struct IRQnStruct
     {
         const TIM_TypeDef *TIMx = nullptr;
-        void (*itFuncs[To_uint8(TIM::IT_Index::END)])() = {nullptr};
+        void (*itFuncs[To_uint8(TIM::IT_Index::END)])() = {nullptr};   // 按 SR 位号索引
 
         IRQnStruct() = default;
         IRQnStruct(TIM_TypeDef *timx) : TIMx(timx) {
@@ -27,6 +52,8 @@ private:
     };
 
     static std::array<IRQnStruct, Size_TIM> Handlers;
+    static volatile Probe probeT2;
+    static volatile bool probeReset;
 
     static uint8_t GetHandlerIndexFromType(TIM_TypeDef *TIMx);
     static uint8_t GetTimItIndexFromType(TIM::IT it);
@@ -58,8 +85,60 @@ public:
     {
         MyNVIC::SetPriority(GetIRQn(TIMx, tim_it), pre_priority, sub_priority, state);
     }
+
+    // ---- 开销统计 ----
+    // 在中断里调用：t0 为向量函数第一条语句读到的 CYCCNT
+    template<TIM::Index tim_index>
+    static inline void RecordEntry(uint32_t t0) {
+        if (tim_index != TIM::Index::T2) return;    // 编译期折叠：其他定时器零开销
+        const uint32_t dt = DWT->CYCCNT - t0;
+        if (probeReset) {
+            probeT2.count = 0;
+            probeT2.sumCyc = 0;
+            probeT2.minCyc = 0xFFFFFFFFu;
+            probeT2.maxCyc = 0;
+            probeReset = false;
+        }
+        probeT2.lastCyc = dt;
+        if (dt < probeT2.minCyc) probeT2.minCyc = dt;
+        if (dt > probeT2.maxCyc) probeT2.maxCyc = dt;
+        probeT2.sumCyc = probeT2.sumCyc + dt;
+        probeT2.count = probeT2.count + 1;
+    }
+
+    // 主循环读取：各字段分别读取，统计值允许与正在进行的一次中断略有出入
+    static Probe GetProbeT2();
+    static void ResetProbeT2() { probeReset = true; }
+    static DispatchMode GetModeT2();
+
+    // 直连模式的向量体：只检查/清除一个中断源，回调在编译期绑定
+    template<TIM::Index tim_index, TIM::IT tim_it, void (*Func)()>
+    static inline void DirectIRQ(TIM_TypeDef *TIMx) {
+        const uint32_t t0 = DWT->CYCCNT;
+        const uint16_t bit = To_uint16(tim_it);
+        if ((TIMx->SR & bit) == 0) return;
+        TIMx->SR = static_cast<uint16_t>(~bit);     // rc_w0：写 0 清除，写 1 不影响其他位
+        RecordEntry<tim_index>(t0);
+        Func();
+    }
 };
 
+// TIM2 直连模式的一致性握手（见文件头）
+#if defined(TIM2_IRQ_DIRECT)
+#define TIM2_IRQ_DIRECT_AT_HEADER 1
+extern "C" const uint8_t TIM2_IRQ_DIRECT_in_IRQnManage;    // IRQnManage.cpp 定义
+extern "C" const uint8_t TIM2_IRQ_DIRECT_in_DACManager;    // DACManager.cpp 定义
+#endif
+
+// 位号即表下标：TIM_IT_xxx 必须等于 1 << IT_Index
+static_assert(To_uint16(TIM::IT::UP)  == (1u << To_uint8(TIM::IT_Index::UP))  &&
+              To_uint16(TIM::IT::CC1) == (1u << To_uint8(TIM::IT_Index::CC1)) &&
+              To_uint16(TIM::IT::CC2) == (1u << To_uint8(TIM::IT_Index::CC2)) &&
+              To_uint16(TIM::IT::CC3) == (1u << To_uint8(TIM::IT_Index::CC3)) &&
+              To_uint16(TIM::IT::CC4) == (1u << To_uint8(TIM::IT_Index::CC4)) &&
+              To_uint16(TIM::IT::COM) == (1u << To_uint8(TIM::IT_Index::COM)),
+              "TIM::IT bit position must equal TIM::IT_Index");
+
 
 // ========================= DMA IRQnManage =========================
 
@@ -155,3 +234,30 @@ public:
         MyNVIC::SetPriority(GetIRQn(USARTx), pre_priority, sub_priority, state);
     }
 };
+
+
+// ========================= EXTI IRQnManage =========================
+
+// EXTI 按线号登记回调：0~15 为 GPIO（端口映射由调用方用 GPIO_EXTILineConfig 配置），17 为 RTC 闹钟。
+// 触发沿与 IMR 也由调用方配置；这里只负责 NVIC 与分发。共用向量（9_5、15_10）按 PR & IMR 逐位分发，
+// 挂起位在回调前清除。
+class EXTI_IRQnManage
+{
+public:
+    static const uint8_t Size_EXTI = 19;        // 0~15 GPIO，16 PVD，17 RTC 闹钟，18 USB 唤醒
+    static const uint8_t LINE_RTC_ALARM = 17;
+
+    static bool Add(uint8_t line,
+                    void (*func)(void),
+                    uint8_t pre_priority,
+                    uint8_t sub_priority,
+                    FunctionalState state = ENABLE);
+
+    static IRQn GetIRQn(uint8_t line);
+
+    // 分发 [first, last] 线上已挂起且未屏蔽的中断（供向量函数调用）
+    static void Dispatch(uint8_t first, uint8_t last);
+
+private:
+    static void (*Handlers[Size_EXTI])();
+};
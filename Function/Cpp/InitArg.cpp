@@ -60,7 +60,7 @@ namespace TIM {
         RCCPeriphTim(timx);
         TIM_TimeBaseInitTypeDef TIM_TimeBaseStructure;
         // 10k/s stepDuration ms
-        TIM_TimeBaseStructure.TIM_Period = 10000 * (MyCompare<float>(period, 6)) - 1;     
+        TIM_TimeBaseStructure.TIM_Period = PeriodToArr(period);
         // 72MHz/7200 = 10kHz
         TIM_TimeBaseStructure.TIM_Prescaler = 7200-1;      
         TIM_TimeBaseStructure.TIM_ClockDivision = TIM_CKD_DIV1;
@@ -69,6 +69,10 @@ namespace TIM {
         TIM_TimeBaseInit(timx, &TIM_TimeBaseStructure);
     }
 
+    uint16_t PeriodToArr(float period){
+        return static_cast<uint16_t>(10000 * (MyCompare<float>(period, 6)) - 1);
+    }
+
     void TIM_ITConfig(TIM_TypeDef * timx, IT tim_it, FunctionalState state){
         TIM_ITConfig(timx, static_cast<uint16_t>(tim_it), state);
     }
@@ -213,9 +217,9 @@ namespace USART
 
     const std::array<USART_Params, 3> USART_ConfigMap = {
         {
-            { USART1, RCC_APB2Periph_USART1, RCC_APB2Periph_GPIOA, GPIOA, GPIO_Pin_9, GPIO_Pin_10, 115200, USART1_IRQn, DMA1_Channel4, DMA1_Channel5 },
-            { USART2, RCC_APB1Periph_USART2, RCC_APB2Periph_GPIOA, GPIOA, GPIO_Pin_2, GPIO_Pin_3, 115200, USART2_IRQn, DMA1_Channel6, DMA1_Channel7 },
-            { USART3, RCC_APB1Periph_USART3, RCC_APB2Periph_GPIOB, GPIOB, GPIO_Pin_10, GPIO_Pin_11, 115200, USART3_IRQn, DMA1_Channel2, DMA1_Channel3 }
+            { USART1, RCC_APB2Periph_USART1, RCC_APB2Periph_GPIOA, GPIOA, GPIO_Pin_9, GPIO_Pin_10, 115200, USART1_IRQn, DMA1_Channel4, DMA1_Channel5, GPIO_Pin_11, GPIO_Pin_12 },
+            { USART2, RCC_APB1Periph_USART2, RCC_APB2Periph_GPIOA, GPIOA, GPIO_Pin_2, GPIO_Pin_3, 115200, USART2_IRQn, DMA1_Channel6, DMA1_Channel7, GPIO_Pin_0, GPIO_Pin_1 },
+            { USART3, RCC_APB1Periph_USART3, RCC_APB2Periph_GPIOB, GPIOB, GPIO_Pin_10, GPIO_Pin_11, 115200, USART3_IRQn, DMA1_Channel2, DMA1_Channel3, GPIO_Pin_13, GPIO_Pin_14 }
         }
     };
 
@@ -26,7 +26,9 @@ void JustShow(const char * str = "Just Show", uint8_t row = 4, uint8_t col = 1);
 
 const float PI = 3.1415926535f;
 
-enum class BaudRate:uint32_t {BAUD_9600 = 9600, BAUD_19200 = 19200, BAUD_38400 = 38400, BAUD_57600 = 57600, BAUD_115200 = 115200};
+enum class BaudRate:uint32_t {BAUD_9600 = 9600, BAUD_19200 = 19200, BAUD_38400 = 38400, BAUD_57600 = 57600, BAUD_115200 = 115200,
+                              BAUD_230400 = 230400, BAUD_460800 = 460800, BAUD_921600 = 921600,
+                              BAUD_1000000 = 1000000, BAUD_1500000 = 1500000, BAUD_2000000 = 2000000};
 enum class BufSize:uint16_t {BUF_32 = 32, BUF_64 = 64, BUF_128 = 128, BUF_256 = 256, BUF_END};
 
 namespace CGM
@@ -192,6 +194,11 @@ namespace TIM
      */
     void InitTIM(TIM_TypeDef * timx, float period, uint8_t repeatCounter = 0);
 
+    /**
+     * @brief   定时周期(秒) -> 10kHz 计数基准下的 ARR 值（与 InitTIM 相同的换算与钳位）
+     */
+    uint16_t PeriodToArr(float period);
+
     // 重构
     void TIM_ITConfig(TIM_TypeDef * timx, IT tim_it, FunctionalState state);
     
@@ -245,6 +252,39 @@ namespace DMA
     void RCCDmaClockCmd(DMA_TypeDef * dmax, FunctionalState state);
 
     void DMA_ITConfig(DMA_Channel_TypeDef * dmay_chanx, IT dma_it, FunctionalState state);
+
+    // ---- 编译期 DMA 通道登记 ----
+    // 本板固定占用的 DMA 通道：新增 DMA 用户先在这里登记，同一通道登记两次直接编译失败；
+    // 模板化的外设绑定（如 NS_DAC::DacHw）再用 static_assert 核对自己解析出的通道与登记一致。
+    enum class User : uint8_t { ADC_1, BT_TX, BT_RX, WIRED_TX, WIRED_RX, OLED_TX, DAC_CH1, DAC_CH2, END };
+    struct Claim { User user; ChanIndex chan; };
+    constexpr Claim kClaims[] = {
+        { User::ADC_1,    ChanIndex::D1CH1 },   // ADC1 规则组
+        { User::BT_TX,    ChanIndex::D1CH2 },   // USART3 TX
+        { User::BT_RX,    ChanIndex::D1CH3 },   // USART3 RX
+        { User::WIRED_TX, ChanIndex::D1CH4 },   // USART1 TX
+        { User::WIRED_RX, ChanIndex::D1CH5 },   // USART1 RX
+        { User::OLED_TX,  ChanIndex::D1CH6 },   // I2C1 TX（OLED 刷屏；与 USART2 TX 共用请求线，USART2 未用）
+        { User::DAC_CH1,  ChanIndex::D2CH3 },   // DAC 通道 1（DMA 请求映射由硬件固定）
+        { User::DAC_CH2,  ChanIndex::D2CH4 },   // DAC 通道 2
+    };
+    constexpr uint8_t kClaimCount = sizeof(kClaims) / sizeof(kClaims[0]);
+
+    // 登记在 ch 上的用户数
+    constexpr uint8_t ClaimsOn(ChanIndex ch, uint8_t i = 0) {
+        return (i >= kClaimCount) ? 0
+             : static_cast<uint8_t>((kClaims[i].chan == ch ? 1 : 0) + ClaimsOn(ch, static_cast<uint8_t>(i + 1)));
+    }
+    constexpr bool ClaimsUnique(uint8_t i = 0) {
+        return (i >= kClaimCount) || (ClaimsOn(kClaims[i].chan) == 1 && ClaimsUnique(static_cast<uint8_t>(i + 1)));
+    }
+    // 用户 u 登记的通道；未登记返回 END
+    constexpr ChanIndex ClaimOf(User u, uint8_t i = 0) {
+        return (i >= kClaimCount) ? ChanIndex::END
+             : (kClaims[i].user == u) ? kClaims[i].chan
+             : ClaimOf(u, static_cast<uint8_t>(i + 1));
+    }
+    static_assert(ClaimsUnique(), "DMA: two users claim the same DMA channel (see DMA::kClaims)");
 } // namespace DMA
 
 namespace USART
@@ -283,6 +323,8 @@ namespace USART
         IRQn USARTx_IRQn;
         DMA_Channel_TypeDef * TX_DMA_Channel;
         DMA_Channel_TypeDef * RX_DMA_Channel;
+        uint16_t USART_CTS;             // 硬件流控 CTS 引脚（与 TX/RX 同一 GPIOx）
+        uint16_t USART_RTS;             // 硬件流控 RTS 引脚
     };
     extern const std::array<USART_Params, 3> USART_ConfigMap;
 
@@ -0,0 +1,260 @@
+#include "JsonCfg.h"
+#include "CmdSchema.h"
+#include <cstring>
+
+namespace NS_JSON
+{
+    static bool IsSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+    static bool IsDigit(char c) { return c >= '0' && c <= '9'; }
+
+    // ------------------------ Tokenizer ------------------------
+
+    bool Tokenizer::ParseNumber(Token& t) {
+        // -?digits[.digits][(e|E)[+-]digits]，手写累加，不依赖 strtof 与 '\0' 结尾
+        bool neg = false;
+        if (m_pos < m_len && m_s[m_pos] == '-') {
+            neg = true;
+            ++m_pos;
+        }
+        if (m_pos >= m_len || !IsDigit(m_s[m_pos])) return false;
+
+        float v = 0.0f;
+        while (m_pos < m_len && IsDigit(m_s[m_pos])) v = v * 10.0f + (float)(m_s[m_pos++] - '0');
+
+        t.integral = true;
+        if (m_pos < m_len && m_s[m_pos] == '.') {
+            ++m_pos;
+            if (m_pos >= m_len || !IsDigit(m_s[m_pos])) return false;
+            float scale = 0.1f;
+            while (m_pos < m_len && IsDigit(m_s[m_pos])) {
+                v += scale * (float)(m_s[m_pos++] - '0');
+                scale *= 0.1f;
+            }
+            t.integral = false;
+        }
+        if (m_pos < m_len && (m_s[m_pos] == 'e' || m_s[m_pos] == 'E')) {
+            ++m_pos;
+            bool eneg = false;
+            if (m_pos < m_len && (m_s[m_pos] == '+' || m_s[m_pos] == '-')) eneg = (m_s[m_pos++] == '-');
+            if (m_pos >= m_len || !IsDigit(m_s[m_pos])) return false;
+            int e = 0;
+            while (m_pos < m_len && IsDigit(m_s[m_pos])) {
+                if (e < 40) e = e * 10 + (m_s[m_pos] - '0');
+                ++m_pos;
+            }
+            for (int i = 0; i < e; ++i) v = eneg ? v * 0.1f : v * 10.0f;
+            t.integral = false;
+        }
+        t.type = Tok::NUMBER;
+        t.num = neg ? -v : v;
+        return true;
+    }
+
+    Token Tokenizer::Next() {
+        Token t;
+        while (m_pos < m_len && IsSpace(m_s[m_pos])) ++m_pos;
+        if (m_pos >= m_len || m_s[m_pos] == '\0') return t;   // END
+
+        const char c = m_s[m_pos];
+        switch (c) {
+        case '{': ++m_pos; t.type = Tok::OBJ_BEGIN; return t;
+        case '}': ++m_pos; t.type = Tok::OBJ_END;   return t;
+        case '[': ++m_pos; t.type = Tok::ARR_BEGIN; return t;
+        case ']': ++m_pos; t.type = Tok::ARR_END;   return t;
+        case ':': ++m_pos; t.type = Tok::COLON;     return t;
+        case ',': ++m_pos; t.type = Tok::COMMA;     return t;
+        case '"': {
+            const uint16_t start = ++m_pos;
+            while (m_pos < m_len && m_s[m_pos] != '"') {
+                // 转义只跳过，不还原（配置中的字符串只有键名与枚举名）
+                if (m_s[m_pos] == '\\') ++m_pos;
+                ++m_pos;
+            }
+            if (m_pos >= m_len) {
+                t.type = Tok::ERROR;
+                return t;
+            }
+            t.type = Tok::STRING;
+            t.str = m_s + start;
+            t.len = static_cast<uint16_t>(m_pos - start);
+            ++m_pos;
+            return t;
+        }
+        default:
+            break;
+        }
+
+        static const struct { const char* word; Tok type; } kWords[] = {
+            { "true", Tok::TRUE_ }, { "false", Tok::FALSE_ }, { "null", Tok::NUL },
+        };
+        for (const auto& w : kWords) {
+            const uint16_t n = static_cast<uint16_t>(::strlen(w.word));
+            if (m_len - m_pos >= n && ::strncmp(m_s + m_pos, w.word, n) == 0) {
+                m_pos = static_cast<uint16_t>(m_pos + n);
+                t.type = w.type;
+                return t;
+            }
+        }
+
+        if (!ParseNumber(t)) t.type = Tok::ERROR;
+        return t;
+    }
+
+    // ------------------------ Parser ------------------------
+
+    static void Fail(Result* res, Error err, uint16_t pos, const char* key, uint16_t klen) {
+        if (!res) return;
+        res->err = err;
+        res->pos = pos;
+        uint16_t n = 0;
+        if (key) {
+            for (; n < klen && n < sizeof(res->key) - 1; ++n) res->key[n] = key[n];
+        }
+        res->key[n] = '\0';
+    }
+
+    static const Binding* FindKey(const Binding* table, uint8_t count, const char* s, uint16_t len, uint8_t* index) {
+        const uint32_t h = NS_CMD::HashN(s, len);
+        for (uint8_t i = 0; i < count; ++i) {
+            if (table[i].hash == h && NS_CMD::EqualsN(s, len, table[i].name)) {
+                if (index) *index = i;
+                return &table[i];
+            }
+        }
+        return nullptr;
+    }
+
+    static Error Store(const Binding& b, const Token& v, uint8_t* base) {
+        uint8_t* p = base + b.offset;
+        switch (b.type) {
+        case ValType::F32: {
+            if (v.type != Tok::NUMBER) return Error::TYPE;
+            if (v.num < b.lo || v.num > b.hi) return Error::RANGE;
+            ::memcpy(p, &v.num, sizeof(float));
+            return Error::OK;
+        }
+        case ValType::U16:
+        case ValType::U32: {
+            if (v.type != Tok::NUMBER || !v.integral) return Error::TYPE;
+            if (v.num < b.lo || v.num > b.hi) return Error::RANGE;
+            if (b.type == ValType::U16) {
+                const uint16_t u = static_cast<uint16_t>(v.num);
+                ::memcpy(p, &u, sizeof(u));
+            } else {
+                const uint32_t u = static_cast<uint32_t>(v.num);
+                ::memcpy(p, &u, sizeof(u));
+            }
+            return Error::OK;
+        }
+        case ValType::BOOL:
+            if (v.type != Tok::TRUE_ && v.type != Tok::FALSE_) return Error::TYPE;
+            *p = (v.type == Tok::TRUE_) ? 1 : 0;
+            return Error::OK;
+        case ValType::ENUM:
+            if (v.type == Tok::NUMBER && v.integral) {
+                if (v.num < 0.0f || v.num >= (float)b.nameCount) return Error::RANGE;
+                *p = static_cast<uint8_t>(v.num);
+                return Error::OK;
+            }
+            if (v.type != Tok::STRING) return Error::TYPE;
+            for (uint8_t i = 0; i < b.nameCount; ++i) {
+                if (NS_CMD::EqualsN(v.str, v.len, b.names[i])) {
+                    *p = i;
+                    return Error::OK;
+                }
+            }
+            return Error::RANGE;
+        default:
+            return Error::TYPE;
+        }
+    }
+
+    // 解析一个对象体（调用时 OBJ_BEGIN 已被取走）
+    static bool ParseObject(Tokenizer& tk, const Binding* table, uint8_t count, uint8_t* base,
+                            uint8_t depth, Result* res, uint32_t* seen) {
+        Token t = tk.Next();
+        if (t.type == Tok::OBJ_END) return true;
+
+        for (;;) {
+            if (t.type != Tok::STRING) {
+                Fail(res, Error::SYNTAX, tk.Pos(), nullptr, 0);
+                return false;
+            }
+            const Token key = t;
+            uint8_t idx = 0;
+            const Binding* b = FindKey(table, count, key.str, key.len, &idx);
+            if (!b) {
+                Fail(res, Error::UNKNOWN_KEY, tk.Pos(), key.str, key.len);
+                return false;
+            }
+            if (tk.Next().type != Tok::COLON) {
+                Fail(res, Error::SYNTAX, tk.Pos(), key.str, key.len);
+                return false;
+            }
+
+            const Token v = tk.Next();
+            if (b->type == ValType::OBJECT) {
+                if (v.type != Tok::OBJ_BEGIN) {
+                    Fail(res, Error::TYPE, tk.Pos(), key.str, key.len);
+                    return false;
+                }
+                if (depth >= MAX_DEPTH) {
+                    Fail(res, Error::DEPTH, tk.Pos(), key.str, key.len);
+                    return false;
+                }
+                if (!ParseObject(tk, b->child, b->childCount, base, static_cast<uint8_t>(depth + 1), res, nullptr)) {
+                    return false;
+                }
+            } else {
+                const Error err = Store(*b, v, base);
+                if (err != Error::OK) {
+                    Fail(res, (v.type == Tok::ERROR) ? Error::SYNTAX : err, tk.Pos(), key.str, key.len);
+                    return false;
+                }
+            }
+            if (seen && idx < 32) *seen |= (1u << idx);
+
+            t = tk.Next();
+            if (t.type == Tok::OBJ_END) return true;
+            if (t.type != Tok::COMMA) {
+                Fail(res, Error::SYNTAX, tk.Pos(), nullptr, 0);
+                return false;
+            }
+            t = tk.Next();
+        }
+    }
+
+    bool Parse(const char* json, uint16_t len, const Binding* table, uint8_t count, void* base, Result* res) {
+        if (res) *res = Result();
+        if (!json || !table || !base) {
+            Fail(res, Error::SYNTAX, 0, nullptr, 0);
+            return false;
+        }
+        Tokenizer tk(json, len);
+        if (tk.Next().type != Tok::OBJ_BEGIN) {
+            Fail(res, Error::SYNTAX, tk.Pos(), nullptr, 0);
+            return false;
+        }
+        uint32_t seen = 0;
+        if (!ParseObject(tk, table, count, static_cast<uint8_t*>(base), 1, res, &seen)) return false;
+        if (tk.Next().type != Tok::END) {
+            Fail(res, Error::SYNTAX, tk.Pos(), nullptr, 0);
+            return false;
+        }
+        if (res) res->seen = seen;
+        return true;
+    }
+
+    const char* ErrorToString(Error err) {
+        switch (err) {
+        case Error::OK:          return "OK";
+        case Error::SYNTAX:      return "syntax error";
+        case Error::DEPTH:       return "nested too deep";
+        case Error::UNKNOWN_KEY: return "unknown key";
+        case Error::TYPE:        return "wrong type";
+        case Error::RANGE:       return "out of range";
+        default: return "?";
+        }
+    }
+
+} // namespace NS_JSON
@@ -0,0 +1,72 @@
+#pragma once
+#include <stdint.h>
+#include <stddef.h>
+
+// 零分配 JSON 配置解析：流式分词 + 固定键表，直接写入已有参数结构体。
+// 不建树、不拷贝字符串、不用异常；键名大小写无关（与 NS_CMD 相同的 FNV-1a 哈希）。
+// 只支持配置对象需要的子集：对象（最多 MAX_DEPTH 层）、数值、true/false、枚举名字符串。
+namespace NS_JSON
+{
+    enum class Tok : uint8_t {
+        END = 0, OBJ_BEGIN, OBJ_END, ARR_BEGIN, ARR_END, COLON, COMMA,
+        STRING, NUMBER, TRUE_, FALSE_, NUL, ERROR
+    };
+
+    struct Token {
+        Tok         type = Tok::END;
+        const char* str  = nullptr;     // STRING：引号内原文（不反转义）
+        uint16_t    len  = 0;
+        float       num  = 0.0f;        // NUMBER
+        bool        integral = false;   // NUMBER 无小数点/指数
+    };
+
+    // 分词器：在 [s, s+len) 上逐个取 token，位置可用于报错
+    class Tokenizer {
+    public:
+        Tokenizer(const char* s, uint16_t len) : m_s(s), m_len(len) {}
+        Token Next();
+        uint16_t Pos() const { return m_pos; }
+
+    private:
+        const char* m_s;
+        uint16_t    m_len;
+        uint16_t    m_pos = 0;
+
+        bool ParseNumber(Token& t);
+    };
+
+    // 值类型：数值按 [lo, hi] 校验；ENUM 接受 names 中的名字（大小写无关）或序号，存为 uint8_t；
+    // OBJECT 只划分键的作用域，子表中的 offset 仍相对顶层结构体
+    enum class ValType : uint8_t { F32, U16, U32, BOOL, ENUM, OBJECT };
+
+    struct Binding {
+        uint32_t           hash;
+        const char*        name;
+        ValType            type;
+        uint16_t           offset;
+        float              lo;
+        float              hi;
+        const Binding*     child;       // OBJECT：子键表；ENUM：nullptr
+        uint8_t            childCount;
+        const char* const* names;       // ENUM：枚举名表
+        uint8_t            nameCount;
+    };
+
+    enum class Error : uint8_t { OK = 0, SYNTAX, DEPTH, UNKNOWN_KEY, TYPE, RANGE };
+
+    struct Result {
+        Error    err  = Error::OK;
+        uint16_t pos  = 0;              // 出错的字符位置
+        uint32_t seen = 0;              // 顶层键表中出现过的键（按表序号置位）
+        char     key[16] = {0};         // 出错的键名（截断）
+    };
+
+    static const uint8_t MAX_DEPTH = 2;
+
+    // 解析一个 JSON 对象到 base 指向的结构体。失败时 base 可能已被部分写入：
+    // 调用方应传入副本，成功后再整体提交（全有或全无）。
+    bool Parse(const char* json, uint16_t len, const Binding* table, uint8_t count, void* base, Result* res);
+
+    const char* ErrorToString(Error err);
+
+} // namespace NS_JSON
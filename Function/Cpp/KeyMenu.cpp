@@ -0,0 +1,170 @@
+#include "KeyMenu.h"
+#include "Key.h"
+#include "OledPlot.h"
+#include "SysTickTimer.h"
+#include "LockFree.h"
+#include "FastFmt.h"
+#include "OLED.h"
+#include <string.h>
+
+namespace NS_MENU
+{
+    enum Item : uint8_t { ITEM_RUN = 0, ITEM_PAUSE, ITEM_MODE, ITEM_VIEW, ITEM_EXIT, ITEM_COUNT };
+
+    static const uint8_t ROWS = 3;      // 第 1 行是标题，下面 3 行为菜单项窗口
+    static const uint8_t COLS = 16;
+
+    // 发布给 Render 的整屏内容（16 列 × 4 行，已补齐空格）
+    struct Screen {
+        uint8_t open;
+        char    line[1 + ROWS][COLS + 1];
+    };
+
+    static const char* const kModeNames[3] = { "CV", "DPV", "IT" };
+
+    // Poll 所在上下文
+    static bool     s_open = false;
+    static uint8_t  s_cursor = 0;
+    static uint32_t s_lastTick = 0;
+    static NS_PLOT::View s_view = NS_PLOT::View::TEXT;    // 打开时取当前视图，执行 VIEW 后跟着改
+    static Screen   s_published{};
+
+    // Render 所在上下文
+    static NS_LF::Seqlock<Screen> s_screen;
+    static uint32_t s_drawnSeq = 0;
+    static bool     s_shown = false;
+
+    static NS_PLOT::View NextView(NS_PLOT::View v) {
+        return (v == NS_PLOT::View::TEXT) ? NS_PLOT::View::IV
+             : (v == NS_PLOT::View::IV)   ? NS_PLOT::View::TREND : NS_PLOT::View::TEXT;
+    }
+
+    static uint8_t NextMode(NS_DAC::RunMode m) {
+        return static_cast<uint8_t>((static_cast<uint8_t>(m) + 1u) % 3u);
+    }
+
+    static void FormatItem(uint8_t item, const Status& st, NS_FMT::FmtBuf& f) {
+        switch (item) {
+        case ITEM_RUN:   f.Str((st.running || st.paused) ? "STOP" : "START"); break;
+        case ITEM_PAUSE: f.Str(st.paused ? "RESUME" : "PAUSE"); break;
+        case ITEM_MODE:  f.Str("MODE ").Str(kModeNames[static_cast<uint8_t>(st.mode) % 3u]); break;
+        case ITEM_VIEW:  f.Str("VIEW ").Str(NS_PLOT::ViewToString(s_view)); break;
+        default:         f.Str("EXIT"); break;
+        }
+    }
+
+    // 内容有变化才写入 Seqlock，Render 按序号判断是否重画
+    static void Publish(const Status& st) {
+        Screen s{};
+        s.open = s_open ? 1 : 0;
+        if (s_open) {
+            NS_FMT::FmtBuf f(s.line[0]);
+            f.Str("MENU ").Str(st.paused ? "PAUSED" : st.running ? "RUNNING" : "IDLE").PadTo(COLS);
+            const uint8_t first = (s_cursor < ROWS) ? 0 : static_cast<uint8_t>(s_cursor - (ROWS - 1));
+            for (uint8_t r = 0; r < ROWS; ++r) {
+                NS_FMT::FmtBuf g(s.line[1 + r]);
+                const uint8_t item = static_cast<uint8_t>(first + r);
+                if (item < ITEM_COUNT) {
+                    g.Char(item == s_cursor ? '>' : ' ');
+                    FormatItem(item, st, g);
+                }
+                g.PadTo(COLS);
+            }
+        }
+        if (::memcmp(&s, &s_published, sizeof(s)) == 0) return;
+        s_published = s;
+        s_screen.Write(s);
+    }
+
+    static bool RunStop(const Status& st, NS_FMT::FmtBuf& f) {
+        f.Str((st.running || st.paused) ? "STOP" : "START");
+        return true;
+    }
+
+    // 执行当前项：返回 true 表示产生了命令
+    static bool Select(const Status& st, NS_FMT::FmtBuf& f) {
+        switch (s_cursor) {
+        case ITEM_RUN:
+            return RunStop(st, f);
+        case ITEM_PAUSE:
+            f.Str(st.paused ? "RESUME" : "PAUSE");
+            return true;
+        case ITEM_MODE:
+            f.Str("MODE ").Str(kModeNames[NextMode(st.mode)]);
+            return true;
+        case ITEM_VIEW:
+            s_view = NextView(s_view);
+            f.Str("VIEW ").Str(NS_PLOT::ViewToString(s_view));
+            return true;
+        default:
+            s_open = false;
+            return false;
+        }
+    }
+
+    static bool Handle(const KeyEvent& e, const Status& st, NS_FMT::FmtBuf& f) {
+        if (!s_open) {
+            if (e.Key == 2 && e.Action == KEY_LONG) return RunStop(st, f);
+            if (e.Action == KEY_SHORT) {
+                s_open = true;
+                s_cursor = 0;
+                s_view = NS_PLOT::GetConfig().view;
+            }
+            return false;
+        }
+        if (e.Key == 1) {
+            if (e.Action == KEY_LONG) {
+                s_open = false;
+            } else {
+                s_cursor = static_cast<uint8_t>((s_cursor + 1u) % ITEM_COUNT);
+            }
+            return false;
+        }
+        if (e.Action == KEY_LONG) return RunStop(st, f);
+        if (e.Action == KEY_SHORT) return Select(st, f);
+        return false;
+    }
+
+    bool Poll(const Status& st, char* cmd, uint16_t cap) {
+        NS_FMT::FmtBuf f(cmd, cap);
+        f.Clear();
+        const uint32_t now = SysTickTimer::GetTick();
+        bool produced = false;
+        KeyEvent e;
+        while (!produced && Key_GetEvent(&e)) {
+            s_lastTick = now;
+            produced = Handle(e, st, f);
+        }
+        if (s_open && now - s_lastTick >= MENU_TIMEOUT_MS) s_open = false;
+        // 命令执行后状态才变：下一次 Poll 用新状态重新发布
+        Publish(st);
+        return produced && f.size() != 0;
+    }
+
+    void Render() {
+        const uint32_t seq = s_screen.Sequence();
+        if (seq == s_drawnSeq) return;
+        Screen s;
+        if (!s_screen.TryRead(s)) return;
+        s_drawnSeq = seq;
+        if (!s.open) {
+            if (s_shown) {
+                s_shown = false;
+                NS_PLOT::Suspend(false);
+            }
+            return;
+        }
+        if (!s_shown) {
+            s_shown = true;
+            NS_PLOT::Suspend(true);
+        }
+        for (uint8_t r = 0; r < 1 + ROWS; ++r) {
+            OLED_ShowString(static_cast<uint8_t>(r + 1), 1, s.line[r]);
+        }
+    }
+
+    bool IsOpen() {
+        return s_open;
+    }
+
+} // namespace NS_MENU
@@ -0,0 +1,29 @@
+#pragma once
+#include <stdint.h>
+#include "DACManager.h"
+
+// 两键菜单：按键事件翻译成控制台文本命令（START/STOP/PAUSE/RESUME/MODE/VIEW），
+// 由调用方交给 EchemConsole::ProcessLine 执行，校验与状态切换和串口命令完全一致。
+//   菜单关闭：KEY1/KEY2 短按打开菜单；KEY2 长按 = START/STOP
+//   菜单打开：KEY1 短按/连发 = 下一项，KEY1 长按 = 关闭，KEY2 短按 = 执行，KEY2 长按 = START/STOP
+// 无操作 MENU_TIMEOUT_MS 自动关闭。菜单打开期间曲线视图暂停绘制（数据照收），关闭后整屏恢复。
+namespace NS_MENU
+{
+    struct Status {
+        bool running = false;           // START/RESUME
+        bool paused  = false;
+        NS_DAC::RunMode mode = NS_DAC::RunMode::CV;
+    };
+
+    static const uint32_t MENU_TIMEOUT_MS = 10000;
+
+    // 主循环（RTOS：命令线程）调用：取按键事件，产生一条命令时写入 cmd 并返回 true；
+    // 事件取完或只是移动光标/开关菜单时返回 false。也负责超时关闭
+    bool Poll(const Status& st, char* cmd, uint16_t cap);
+
+    // 主循环（RTOS：ui 线程）在 NS_PLOT::Service 之前调用：菜单内容有变化才重画
+    void Render();
+
+    bool IsOpen();
+
+} // namespace NS_MENU
@@ -0,0 +1,211 @@
+#pragma once
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+
+// 中断与主循环（或线程）之间的无锁交接原语，全部在头文件中实现：
+// - SpscRing<T, N>：单生产者/单消费者环形队列，N 为 2 的幂；两端索引各占一个缓存行，
+//                   并各自缓存对端索引，只有看起来满/空时才去读对端
+// - Seqlock<T>    ：多字状态快照，写者不等待，读者发现写到一半就重试
+// - AtomicFlags<T>：LDREX/STREX 置位/取走，替代“ISR 里 |=、主循环读后清零”的竞争写法
+// 目标平台用 CMSIS 内建函数；其他平台（主机上跑压力测试，见 LockFreeTest.cpp）用 GCC __atomic 内建函数。
+#if defined(__ARM_ARCH)
+#include "stm32f10x.h"
+#define NS_LF_TARGET 1
+#else
+#define NS_LF_TARGET 0
+#endif
+
+#ifndef NS_LF_CACHE_LINE
+#if NS_LF_TARGET
+// Cortex-M3 没有数据缓存，按字对齐即可，不为缓存行浪费 RAM
+#define NS_LF_CACHE_LINE 4
+#else
+#define NS_LF_CACHE_LINE 64
+#endif
+#endif
+
+namespace NS_LF
+{
+    static const uint32_t CACHE_LINE = NS_LF_CACHE_LINE;
+
+    // 数据内存屏障（同时是编译器屏障）
+    inline void Barrier() {
+#if NS_LF_TARGET
+        __DMB();
+#else
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+#endif
+    }
+
+    namespace detail
+    {
+#if NS_LF_TARGET
+        inline uint8_t  Ldrex(volatile uint8_t* p)  { return __LDREXB(p); }
+        inline uint16_t Ldrex(volatile uint16_t* p) { return __LDREXH(p); }
+        inline uint32_t Ldrex(volatile uint32_t* p) { return __LDREXW(p); }
+        inline bool Strex(uint8_t v, volatile uint8_t* p)   { return __STREXB(v, p) == 0; }
+        inline bool Strex(uint16_t v, volatile uint16_t* p) { return __STREXH(v, p) == 0; }
+        inline bool Strex(uint32_t v, volatile uint32_t* p) { return __STREXW(v, p) == 0; }
+
+        // 读-改-写：STREX 失败（期间发生过异常进出或其他独占访问）就重来。返回旧值
+        template <typename T, typename F>
+        inline T Update(volatile T* p, F f) {
+            T old;
+            do {
+                old = Ldrex(p);
+            } while (!Strex(static_cast<T>(f(old)), p));
+            Barrier();
+            return old;
+        }
+#else
+        template <typename T, typename F>
+        inline T Update(volatile T* p, F f) {
+            T old = __atomic_load_n(p, __ATOMIC_RELAXED);
+            while (!__atomic_compare_exchange_n(p, &old, static_cast<T>(f(old)), true,
+                                                __ATOMIC_SEQ_CST, __ATOMIC_RELAXED)) {
+            }
+            return old;
+        }
+#endif
+    } // namespace detail
+
+    // ------------------------ AtomicFlags ------------------------
+
+    // 事件位：任意上下文 Set，消费者 Take 一次取走（取与清之间不会丢掉新置的位）
+    template <typename T>
+    class AtomicFlags {
+        static_assert(std::is_unsigned<T>::value && (sizeof(T) == 1 || sizeof(T) == 2 || sizeof(T) == 4),
+                      "AtomicFlags: T must be uint8_t/uint16_t/uint32_t");
+    public:
+        void Set(T bits)   { (void)detail::Update(&m_v, [bits](T v) { return static_cast<T>(v | bits); }); }
+        void Clear(T bits) { (void)detail::Update(&m_v, [bits](T v) { return static_cast<T>(v & ~bits); }); }
+
+        // 取走 mask 中已置位的位并清零，返回取走的位
+        T Take(T mask = static_cast<T>(~static_cast<T>(0))) {
+            const T old = detail::Update(&m_v, [mask](T v) { return static_cast<T>(v & ~mask); });
+            return static_cast<T>(old & mask);
+        }
+
+        T Peek() const { return m_v; }
+
+    private:
+        volatile T m_v = 0;
+    };
+
+    // ------------------------ SpscRing ------------------------
+
+    // 生产者只写 head，消费者只写 tail；两者都是自由递增的 32 位计数，差值即元素个数。
+    // 满时 Push 返回 false（不覆盖），由生产者决定丢弃并计数。
+    template <typename T, uint32_t N>
+    class SpscRing {
+        static_assert(N >= 2 && (N & (N - 1)) == 0, "SpscRing: N must be a power of two");
+    public:
+        static const uint32_t CAPACITY = N;
+
+        // 生产者
+        bool Push(const T& v) {
+            const uint32_t h = m_prod.head;
+            if (h - m_prod.tailCache >= N) {
+                m_prod.tailCache = m_cons.tail;
+                if (h - m_prod.tailCache >= N) return false;
+            }
+            m_buf[h & (N - 1)] = v;
+            Barrier();              // 先写元素再发布 head
+            m_prod.head = h + 1;
+            return true;
+        }
+
+        // 消费者
+        bool Pop(T& out) {
+            const uint32_t t = m_cons.tail;
+            if (m_cons.headCache == t) {
+                m_cons.headCache = m_prod.head;
+                if (m_cons.headCache == t) return false;
+            }
+            Barrier();              // 看到 head 之后再读元素
+            out = m_buf[t & (N - 1)];
+            Barrier();              // 读完元素再归还槽位
+            m_cons.tail = t + 1;
+            return true;
+        }
+
+        // 消费者：查看队首但不取走
+        bool Peek(T& out) const {
+            const uint32_t t = m_cons.tail;
+            if (m_prod.head == t) return false;
+            Barrier();
+            out = m_buf[t & (N - 1)];
+            return true;
+        }
+
+        // 任一端可调用；结果只是某一时刻的近似值
+        uint32_t Size() const { return m_prod.head - m_cons.tail; }
+        bool Empty() const    { return Size() == 0; }
+
+        // 只能在生产者静止时由消费者调用（例如关掉产生数据的中断之后）
+        void Reset() {
+            m_cons.tail = m_cons.headCache = m_prod.head;
+        }
+
+    private:
+        struct alignas(NS_LF_CACHE_LINE) ProducerSide {
+            volatile uint32_t head = 0;
+            uint32_t          tailCache = 0;    // 生产者看到的 tail（只由生产者读写）
+        };
+        struct alignas(NS_LF_CACHE_LINE) ConsumerSide {
+            volatile uint32_t tail = 0;
+            uint32_t          headCache = 0;    // 消费者看到的 head（只由消费者读写）
+        };
+
+        ProducerSide m_prod;
+        ConsumerSide m_cons;
+        T            m_buf[N];
+    };
+
+    // ------------------------ Seqlock ------------------------
+
+    // 单写者：写前序号变奇数、写完变偶数；读者拷贝前后序号相同且为偶数才算一致。
+    // 多个写者之间须自行互斥（例如写入处关中断）。
+    // 读者优先级高于写者时（读者可能打断写到一半的写者），只能用 TryRead，否则会一直重试。
+    template <typename T>
+    class Seqlock {
+        static_assert(std::is_trivially_copyable<T>::value, "Seqlock: T must be trivially copyable");
+    public:
+        void Write(const T& v) {
+            const uint32_t s = m_seq;
+            m_seq = s + 1;
+            Barrier();
+            ::memcpy(&m_data, &v, sizeof(T));
+            Barrier();
+            m_seq = s + 2;
+        }
+
+        bool TryRead(T& out, uint32_t retries = 4) const {
+            for (uint32_t i = 0; i <= retries; ++i) {
+                const uint32_t s0 = m_seq;
+                if (s0 & 1u) continue;
+                Barrier();
+                ::memcpy(&out, &m_data, sizeof(T));
+                Barrier();
+                if (m_seq == s0) return true;
+            }
+            return false;
+        }
+
+        T Read() const {
+            T v;
+            while (!TryRead(v, 16)) {
+            }
+            return v;
+        }
+
+        // 写入次数 × 2（偶数表示当前没有写者）
+        uint32_t Sequence() const { return m_seq; }
+
+    private:
+        volatile uint32_t m_seq = 0;
+        T                 m_data{};
+    };
+
+} // namespace NS_LF
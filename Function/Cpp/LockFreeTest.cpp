@@ -0,0 +1,218 @@
+// 主机压力测试：LockFree.h 走 GCC __atomic 分支，用真线程代替“中断 / 主循环”两端。
+// 不进固件工程（eide.yml 不列出），只在主机上编译运行：
+//   g++ -std=c++14 -O2 -Wall -Wextra -pthread -IFunction/Cpp Function/Cpp/LockFreeTest.cpp -o lockfree_test && ./lockfree_test
+// - SpscRing   ：生产者 / 消费者各一个线程，检查顺序、不丢不重、元素不撕裂，队满队空都会频繁出现
+// - Seqlock    ：一个写者连续写多字记录，多个读者校验每次读到的记录自洽（撕裂读必须被重试挡住）
+// - AtomicFlags：多个线程并发 Set 各自的位，消费者 Take；每次 Set 都必须被取到（不丢位）
+#include "LockFree.h"
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <thread>
+#include <vector>
+
+namespace
+{
+    int g_failures = 0;
+
+    void Check(bool ok, const char* what) {
+        if (!ok) {
+            ++g_failures;
+            std::printf("FAIL: %s\n", what);
+        }
+    }
+
+    // ------------------------ SpscRing ------------------------
+
+    struct Item {
+        uint32_t seq;
+        uint32_t inv;           // ~seq
+        uint64_t wide;          // seq * 常数，跨两个字
+    };
+
+    const uint64_t kWideMul = 0x9E3779B97F4A7C15ull;
+
+    void TestSpsc() {
+        const uint32_t kCount = 2000000;
+        static NS_LF::SpscRing<Item, 64> ring;
+        uint32_t fullHits = 0;
+        uint32_t emptyHits = 0;
+        bool orderOk = true;
+        bool itemOk = true;
+        bool peekOk = true;
+
+        std::thread producer([&] {
+            for (uint32_t i = 0; i < kCount; ++i) {
+                const Item it = { i, ~i, i * kWideMul };
+                while (!ring.Push(it)) {
+                    ++fullHits;
+                    std::this_thread::yield();
+                }
+            }
+        });
+        std::thread consumer([&] {
+            uint32_t expect = 0;
+            while (expect < kCount) {
+                Item peeked;
+                const bool havePeek = ring.Peek(peeked);
+                Item it;
+                if (!ring.Pop(it)) {
+                    ++emptyHits;
+                    std::this_thread::yield();
+                    continue;
+                }
+                if (havePeek && peeked.seq != it.seq) peekOk = false;
+                if (it.seq != expect) orderOk = false;
+                if (it.inv != ~it.seq || it.wide != it.seq * kWideMul) itemOk = false;
+                expect = it.seq + 1;
+            }
+        });
+        producer.join();
+        consumer.join();
+
+        Check(orderOk, "SpscRing: out of order, lost or duplicated item");
+        Check(itemOk, "SpscRing: torn item");
+        Check(peekOk, "SpscRing: Peek differs from the following Pop");
+        Check(ring.Empty(), "SpscRing: not empty after draining");
+        std::printf("SpscRing    items=%u full=%u empty=%u\n", (unsigned)kCount, (unsigned)fullHits, (unsigned)emptyHits);
+    }
+
+    // ------------------------ Seqlock ------------------------
+
+    struct Record {
+        uint32_t id;
+        uint32_t words[255];    // 全部等于 id * (k + 1)，读到混合值即为撕裂；1KB 拷贝让单核主机上也常被抢占在中途
+    };
+
+    bool Consistent(const Record& r) {
+        for (uint32_t k = 0; k < 255; ++k) {
+            if (r.words[k] != r.id * (k + 1)) return false;
+        }
+        return true;
+    }
+
+    void TestSeqlock() {
+        const uint32_t kWrites = 2000000;
+        const unsigned kReaders = 3;
+        static NS_LF::Seqlock<Record> lock;
+        std::atomic<bool> done(false);
+        std::atomic<uint32_t> torn(0);
+        std::atomic<uint32_t> backwards(0);
+        std::atomic<uint64_t> reads(0);
+        std::atomic<uint64_t> retries(0);
+
+        std::thread writer([&] {
+            Record r;
+            for (uint32_t i = 1; i <= kWrites; ++i) {
+                r.id = i;
+                for (uint32_t k = 0; k < 255; ++k) r.words[k] = i * (k + 1);
+                lock.Write(r);
+            }
+            done = true;
+        });
+        std::vector<std::thread> readers;
+        for (unsigned n = 0; n < kReaders; ++n) {
+            readers.emplace_back([&] {
+                uint32_t last = 0;
+                uint64_t ok = 0;
+                uint64_t busy = 0;
+                while (!done) {
+                    Record r;
+                    if (!lock.TryRead(r, 0)) {
+                        ++busy;
+                        std::this_thread::yield();
+                        continue;
+                    }
+                    ++ok;
+                    if (!Consistent(r)) ++torn;
+                    if (r.id < last) ++backwards;
+                    last = r.id;
+                }
+                const Record r = lock.Read();
+                if (!Consistent(r) || r.id != kWrites) ++torn;
+                reads += ok;
+                retries += busy;
+            });
+        }
+        writer.join();
+        for (auto& t : readers) t.join();
+
+        Check(torn == 0, "Seqlock: torn read accepted");
+        Check(backwards == 0, "Seqlock: reader saw an older record after a newer one");
+        Check(lock.Sequence() == 2u * kWrites, "Seqlock: sequence is not 2 x writes");
+        std::printf("Seqlock     writes=%u reads=%llu rejected=%llu torn=%u\n", (unsigned)kWrites,
+            (unsigned long long)reads.load(), (unsigned long long)retries.load(), (unsigned)torn.load());
+    }
+
+    // ------------------------ AtomicFlags ------------------------
+
+    // 每个 setter 置自己的位后等消费者确认取到，再置下一次；一次 Set 被并发的 Take/Set 冲掉就会超时
+    template <typename T>
+    void TestFlags(const char* name) {
+        const unsigned kSetters = 4;
+        const uint32_t kRounds = 50000;
+        static NS_LF::AtomicFlags<T> flags;
+        std::atomic<uint32_t> acked[kSetters];
+        for (auto& a : acked) a = 0;
+        std::atomic<bool> stop(false);
+        std::atomic<uint32_t> lost(0);
+        std::atomic<uint32_t> extra(0);
+
+        std::thread consumer([&] {
+            while (!stop) {
+                const T got = flags.Take();
+                if (got == 0) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                for (unsigned i = 0; i < kSetters; ++i) {
+                    if (got & static_cast<T>(1u << i)) ++acked[i];
+                }
+                // 高位由 setter 置后立即 Clear，这里不应取到
+                if (got & static_cast<T>(~static_cast<T>((1u << kSetters) - 1u))) ++extra;
+            }
+        });
+        std::vector<std::thread> setters;
+        for (unsigned i = 0; i < kSetters; ++i) {
+            setters.emplace_back([&, i] {
+                const T bit = static_cast<T>(1u << i);
+                const T noise = static_cast<T>(1u << (kSetters + i));
+                for (uint32_t r = 1; r <= kRounds; ++r) {
+                    flags.Set(bit);
+                    // 同一字上的并发 Set/Clear 不能影响别人的位
+                    flags.Clear(noise);
+                    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+                    while (acked[i] < r) {
+                        if (std::chrono::steady_clock::now() > deadline) {
+                            ++lost;
+                            return;
+                        }
+                        std::this_thread::yield();
+                    }
+                }
+            });
+        }
+        for (auto& t : setters) t.join();
+        stop = true;
+        consumer.join();
+
+        uint32_t total = 0;
+        for (auto& a : acked) total += a;
+        Check(lost == 0, "AtomicFlags: a Set was lost");
+        Check(extra == 0, "AtomicFlags: took a bit nobody left set");
+        Check(total == kSetters * kRounds, "AtomicFlags: take count differs from set count");
+        std::printf("AtomicFlags<%s> sets=%u taken=%u lost=%u\n", name,
+            (unsigned)(kSetters * kRounds), (unsigned)total, (unsigned)lost.load());
+    }
+}
+
+int main() {
+    TestSpsc();
+    TestSeqlock();
+    TestFlags<uint8_t>("u8");
+    TestFlags<uint16_t>("u16");
+    TestFlags<uint32_t>("u32");
+    std::printf("%s (%d failures)\n", g_failures ? "FAIL" : "OK", g_failures);
+    return g_failures ? 1 : 0;
+}
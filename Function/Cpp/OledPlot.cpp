@@ -0,0 +1,434 @@
+#include "OledPlot.h"
+#include "ADCManager.h"
+#include "StreamSink.h"
+#include "Telemetry.h"
+#include "SysTickTimer.h"
+#include "LockFree.h"
+#include "FastFmt.h"
+#include "OLED.h"
+
+namespace NS_PLOT
+{
+    // 绘图区：Y 16~63（第 2~7 页），X 0~127
+    static const uint8_t  AREA_Y0    = 16;
+    static const uint8_t  AREA_H     = 48;
+    static const uint8_t  AREA_PAGE0 = 2;
+    static const uint8_t  AREA_PAGES = 6;
+    static const uint8_t  AREA_W     = 128;
+
+    static const uint8_t  IV_CAP     = 128;     // 满了就两两合并
+    static const uint8_t  TREND_GAP  = 4;       // 扫掠时新点前方清空的列数
+    static const uint16_t MAX_PER_SERVICE = 64; // 每次 Service 最多处理的样本数
+    static const uint32_t TITLE_MS   = 250;     // 标题行刷新间隔
+    static const int32_t  MIN_SPAN_PA = 1000;   // Y 轴最小跨度（1nA）
+    static const int32_t  MIN_SPAN_CODE = 32;   // IV X 轴最小跨度（DAC 码）
+
+    // 请求位：其他上下文只置位，由 Service 执行
+    enum : uint8_t { REQ_CONFIG = 1u << 0, REQ_RESET = 1u << 1 };
+
+    struct Point {
+        int16_t x;
+        int32_t y;
+    };
+
+    struct Axis {
+        int32_t lo = 0;
+        int32_t hi = 0;
+    };
+
+    struct CgmPoint {
+        int32_t pa[MAX_CH];
+    };
+
+    // 跨上下文的交接
+    static NS_LF::AtomicFlags<uint8_t>          s_req;
+    static NS_LF::Seqlock<Config>               s_pendingCfg;
+    static NS_LF::Seqlock<NS_TLM::ChannelInfo>  s_pendingInfo;
+    static NS_LF::SpscRing<CgmPoint, 8>         s_cgmRing;
+    static Config                               s_cfgShadow;   // GetConfig 返回最近一次 SetConfig
+
+    // 以下只在 Service 上下文访问
+    static Config   s_cfg;
+    static float    s_paPerCode[MAX_CH] = {0.0f, 0.0f, 0.0f};
+    static uint16_t s_ref = 0;
+    static uint32_t s_cursor = 0;
+    static Stats    s_stats;
+
+    static Axis     s_xAxis;
+    static Axis     s_yAxis;
+    static bool     s_axisValid = false;
+    static int32_t  s_lastY = 0;
+    static bool     s_hasLastY = false;
+    static uint32_t s_titleTick = 0;
+    static bool     s_suspended = false;    // 菜单占用屏幕：照常收点，不画
+
+    // IV
+    static Point    s_iv[IV_CAP];
+    static uint8_t  s_ivN = 0;
+    static uint16_t s_ivDecim = 1;
+    static uint16_t s_accN = 0;
+    static int32_t  s_accX = 0;
+    static int64_t  s_accY = 0;
+
+    // TREND：按列存储，s_trendCount 为累计点数（列 = 计数 % 128）
+    static int32_t  s_trend[AREA_W];
+    static uint32_t s_trendCount = 0;
+
+    // ------------------------ 坐标 ------------------------
+
+    static uint8_t MapX(int32_t v) {
+        const int32_t span = s_xAxis.hi - s_xAxis.lo;
+        int32_t px = (int32_t)(((int64_t)(v - s_xAxis.lo) * (AREA_W - 1)) / span);
+        if (px < 0) px = 0;
+        if (px > AREA_W - 1) px = AREA_W - 1;
+        return (uint8_t)px;
+    }
+
+    static uint8_t MapY(int32_t v) {
+        const int32_t span = s_yAxis.hi - s_yAxis.lo;
+        int32_t py = (int32_t)(((int64_t)(v - s_yAxis.lo) * (AREA_H - 1)) / span);
+        if (py < 0) py = 0;
+        if (py > AREA_H - 1) py = AREA_H - 1;
+        return (uint8_t)(AREA_Y0 + (AREA_H - 1) - py);
+    }
+
+    // v 落在轴外时向外扩展四分之一跨度（扩展是几何级的，一次扫描只重画几次）；返回是否扩展
+    static bool Expand(Axis& a, int32_t v, int32_t min_span) {
+        if (v >= a.lo && v <= a.hi) return false;
+        int32_t margin = (a.hi - a.lo) / 4;
+        if (margin < min_span / 4) margin = min_span / 4;
+        if (v < a.lo) a.lo = v - margin;
+        if (v > a.hi) a.hi = v + margin;
+        return true;
+    }
+
+    // 以第一个点为中心，跨度取 |v|/2 与最小跨度中较大者
+    static void InitAxis(Axis& a, int32_t v, int32_t min_span) {
+        int32_t half = ((v < 0) ? -v : v) / 4;
+        if (half < min_span / 2) half = min_span / 2;
+        a.lo = v - half;
+        a.hi = v + half;
+    }
+
+    // ------------------------ 绘制 ------------------------
+
+    static void DrawZeroLine() {
+        if (s_yAxis.lo > 0 || s_yAxis.hi < 0) return;
+        const uint8_t y = MapY(0);
+        for (uint8_t x = 0; x < AREA_W; x += 4) OLED_DrawPixel(x, y, 1);
+    }
+
+    static void ClearArea() {
+        OLED_ClearArea(0, AREA_PAGE0, AREA_W, AREA_PAGES);
+    }
+
+    static bool TrendDrawn(uint8_t col) {
+        if (s_trendCount < AREA_W) return col < s_trendCount;
+        const uint8_t newest = (uint8_t)((s_trendCount - 1) % AREA_W);
+        const uint8_t ahead = (uint8_t)((col + AREA_W - newest) % AREA_W);
+        return ahead == 0 || ahead > TREND_GAP;
+    }
+
+    static void Redraw() {
+        if (s_suspended) return;
+        ClearArea();
+        s_stats.redraws = s_stats.redraws + 1;
+        if (!s_axisValid) return;
+        DrawZeroLine();
+        if (s_cfg.view == View::IV) {
+            for (uint8_t i = 0; i < s_ivN; ++i) {
+                const uint8_t x = MapX(s_iv[i].x);
+                const uint8_t y = MapY(s_iv[i].y);
+                if (i == 0) {
+                    OLED_DrawPixel(x, y, 1);
+                } else {
+                    OLED_DrawLine(MapX(s_iv[i - 1].x), MapY(s_iv[i - 1].y), x, y);
+                }
+            }
+        } else if (s_cfg.view == View::TREND) {
+            for (uint8_t col = 0; col < AREA_W; ++col) {
+                if (!TrendDrawn(col)) continue;
+                const uint8_t y = MapY(s_trend[col]);
+                if (col > 0 && TrendDrawn((uint8_t)(col - 1)) &&
+                    (s_trendCount < AREA_W || col != (s_trendCount % AREA_W))) {
+                    OLED_DrawLine((uint8_t)(col - 1), MapY(s_trend[col - 1]), col, y);
+                } else {
+                    OLED_DrawPixel(col, y, 1);
+                }
+            }
+        }
+    }
+
+    // 电流按量级选单位，3 位定点（与 ADC 文本页相同的写法）
+    static void FmtCurrent(NS_FMT::FmtBuf& f, int32_t pa) {
+        const int32_t a = (pa < 0) ? -pa : pa;
+        if (a >= 1000000000) {
+            f.Fixed(pa / 1000000, 3).Str("mA");
+        } else if (a >= 1000000) {
+            f.Fixed(pa / 1000, 3).Str("uA");
+        } else if (a >= 1000) {
+            f.Fixed(pa, 3).Str("nA");
+        } else {
+            f.I32(pa).Str("pA");
+        }
+    }
+
+    static void DrawTitle(bool force) {
+        const uint32_t now = SysTickTimer::GetTick();
+        if (s_suspended) return;
+        if (!force && now - s_titleTick < TITLE_MS) return;
+        s_titleTick = now;
+        char buf[20];
+        NS_FMT::FmtBuf f(buf);
+        f.Str(s_cfg.view == View::IV ? "IV" : "TR").U32(s_cfg.ch).Char(' ');
+        if (s_hasLastY) FmtCurrent(f, s_lastY);
+        f.PadTo(16);
+        OLED_ShowString(1, 1, f.c_str());
+    }
+
+    // ------------------------ IV ------------------------
+
+    // 相邻两点合并为一点，抽取倍数翻倍
+    static void CompactIv() {
+        uint8_t n = 0;
+        for (uint8_t i = 0; i + 1 < s_ivN; i += 2) {
+            s_iv[n].x = (int16_t)((s_iv[i].x + s_iv[i + 1].x) / 2);
+            s_iv[n].y = (int32_t)(((int64_t)s_iv[i].y + s_iv[i + 1].y) / 2);
+            ++n;
+        }
+        if (s_ivN & 1u) s_iv[n++] = s_iv[s_ivN - 1];
+        s_ivN = n;
+        s_ivDecim = (uint16_t)(s_ivDecim * 2);
+    }
+
+    static void AddIv(int16_t x, int32_t y) {
+        bool redraw = false;
+        if (!s_axisValid) {
+            s_xAxis.lo = x - MIN_SPAN_CODE / 2;
+            s_xAxis.hi = x + MIN_SPAN_CODE / 2;
+            InitAxis(s_yAxis, y, MIN_SPAN_PA);
+            s_axisValid = true;
+            redraw = true;
+        }
+        redraw |= Expand(s_xAxis, x, MIN_SPAN_CODE);
+        redraw |= Expand(s_yAxis, y, MIN_SPAN_PA);
+        if (s_ivN >= IV_CAP) {
+            CompactIv();
+            redraw = true;
+        }
+        s_iv[s_ivN].x = x;
+        s_iv[s_ivN].y = y;
+        ++s_ivN;
+        s_stats.points = s_stats.points + 1;
+
+        if (redraw) {
+            Redraw();
+        } else if (s_suspended) {
+            return;
+        } else if (s_ivN >= 2) {
+            OLED_DrawLine(MapX(s_iv[s_ivN - 2].x), MapY(s_iv[s_ivN - 2].y), MapX(x), MapY(y));
+        } else {
+            OLED_DrawPixel(MapX(x), MapY(y), 1);
+        }
+    }
+
+    // ------------------------ TREND ------------------------
+
+    static void AddTrend(int32_t y) {
+        const uint8_t col = (uint8_t)(s_trendCount % AREA_W);
+        s_trend[col] = y;
+        s_trendCount = s_trendCount + 1;
+        s_stats.points = s_stats.points + 1;
+
+        bool redraw = false;
+        if (!s_axisValid) {
+            InitAxis(s_yAxis, y, MIN_SPAN_PA);
+            s_axisValid = true;
+            redraw = true;
+        }
+        redraw |= Expand(s_yAxis, y, MIN_SPAN_PA);
+        if (redraw) {
+            Redraw();
+            return;
+        }
+        if (s_suspended) return;
+        // 先清掉本列（上一圈的旧点）与前方空白，再连上前一列
+        OLED_ClearArea(col, AREA_PAGE0, (uint8_t)(TREND_GAP + 1), AREA_PAGES);
+        if (s_yAxis.lo <= 0 && s_yAxis.hi >= 0) {
+            const uint8_t zy = MapY(0);
+            for (uint8_t x = col; x <= col + TREND_GAP && x < AREA_W; ++x) {
+                if ((x & 3u) == 0) OLED_DrawPixel(x, zy, 1);
+            }
+        }
+        if (col > 0) {
+            OLED_DrawLine((uint8_t)(col - 1), MapY(s_trend[col - 1]), col, MapY(y));
+        } else {
+            OLED_DrawPixel(col, MapY(y), 1);
+        }
+    }
+
+    // ------------------------ 样本 ------------------------
+
+    static void ResetData() {
+        s_axisValid = false;
+        s_hasLastY = false;
+        s_ivN = 0;
+        s_ivDecim = 1;
+        s_accN = 0;
+        s_accX = 0;
+        s_accY = 0;
+        s_trendCount = 0;
+        s_stats.points = 0;
+    }
+
+    static int32_t ToPa(uint16_t code) {
+        return (int32_t)((float)((int32_t)code - (int32_t)s_ref) * s_paPerCode[s_cfg.ch]);
+    }
+
+    static void Feed(const NS_TLM::Sample& s) {
+        const int32_t y = ToPa(s.ch[s_cfg.ch]);
+        s_lastY = y;
+        s_hasLastY = true;
+        const uint16_t block = (s_cfg.view == View::IV) ? s_ivDecim : s_cfg.avg;
+        s_accX += s.code;
+        s_accY += y;
+        if (++s_accN < block) return;
+        const int32_t ax = s_accX / s_accN;
+        const int32_t ay = (int32_t)(s_accY / s_accN);
+        s_accN = 0;
+        s_accX = 0;
+        s_accY = 0;
+        if (s_cfg.view == View::IV) {
+            AddIv((int16_t)ax, ay);
+        } else {
+            AddTrend(ay);
+        }
+    }
+
+    static void DrainStream() {
+        const auto& src = NS_STREAM::GetStaticStream();
+        const uint32_t head = src.GetHead();
+        // 新一次 START 时 head 归零
+        if ((int32_t)(head - s_cursor) < 0) s_cursor = 0;
+        if (head - s_cursor > NS_STREAM::StreamSource::QUEUE_SIZE) {
+            const uint32_t next = head - NS_STREAM::StreamSource::QUEUE_SIZE / 2;
+            s_stats.skipped = s_stats.skipped + (next - s_cursor);
+            s_cursor = next;
+        }
+        NS_TLM::Sample s;
+        for (uint16_t n = 0; n < MAX_PER_SERVICE && s_cursor != head; ++n) {
+            if (!src.Read(s_cursor, s)) {
+                // 拷贝途中被覆盖：跳到还安全的位置
+                const uint32_t next = src.GetHead() - NS_STREAM::StreamSource::QUEUE_SIZE / 2;
+                s_stats.skipped = s_stats.skipped + (next - s_cursor);
+                s_cursor = next;
+                return;
+            }
+            ++s_cursor;
+            Feed(s);
+        }
+    }
+
+    // 整屏恢复当前视图：TEXT 重画标签，数值由 ADC::Service 下次刷新补上
+    static void Restore() {
+        auto& adc = NS_ADC::GetStaticADC();
+        OLED_Clear();
+        if (s_cfg.view == View::TEXT) {
+            adc.Show();
+            adc.SetTextEnabled(true);
+            return;
+        }
+        adc.SetTextEnabled(false);
+        Redraw();
+        DrawTitle(true);
+    }
+
+    static void ApplyConfig(const Config& cfg) {
+        const bool viewChanged = (cfg.view != s_cfg.view);
+        s_cfg = cfg;
+        ResetData();
+        if (s_suspended) return;
+        if (viewChanged || s_cfg.view != View::TEXT) Restore();
+    }
+
+    // ------------------------ 接口 ------------------------
+
+    void SetConfig(const Config& cfg) {
+        s_cfgShadow = cfg;
+        s_pendingCfg.Write(cfg);
+        s_req.Set(REQ_CONFIG);
+    }
+
+    const Config& GetConfig() { return s_cfgShadow; }
+
+    void Prepare(const NS_TLM::ChannelInfo& info) {
+        s_pendingInfo.Write(info);
+        s_req.Set(REQ_RESET);
+    }
+
+    void PushCgm(const int32_t* cur_pa, uint8_t nch) {
+        CgmPoint p = {{0, 0, 0}};
+        for (uint8_t i = 0; i < nch && i < MAX_CH; ++i) p.pa[i] = cur_pa[i];
+        (void)s_cgmRing.Push(p);    // Service 每次都会取空；只有 ui 长时间停住才会丢
+    }
+
+    void Service() {
+        const uint8_t req = s_req.Take();
+        if (req & REQ_RESET) {
+            const NS_TLM::ChannelInfo info = s_pendingInfo.Read();
+            s_ref = info.ref;
+            for (uint8_t i = 0; i < MAX_CH; ++i) {
+                // pA / 码 = 1e12 / (码/伏 × 跨阻)
+                s_paPerCode[i] = (info.gain[i] != 0) ? 1e12f / (NS_ADC::ADC::stepPerVolt * (float)info.gain[i]) : 0.0f;
+            }
+            s_cursor = NS_STREAM::GetStaticStream().GetHead();
+            ResetData();
+            if (s_cfg.view != View::TEXT) Redraw();
+        }
+        if (req & REQ_CONFIG) ApplyConfig(s_pendingCfg.Read());
+
+        CgmPoint p;
+        while (s_cgmRing.Pop(p)) {
+            if (s_cfg.view != View::TREND) continue;
+            s_lastY = p.pa[s_cfg.ch];
+            s_hasLastY = true;
+            AddTrend(p.pa[s_cfg.ch]);
+        }
+
+        if (s_cfg.view == View::TEXT) {
+            // 游标跟着 head 走，切到曲线视图时不会先补画一大段旧样本
+            s_cursor = NS_STREAM::GetStaticStream().GetHead();
+            return;
+        }
+        DrainStream();
+        DrawTitle(false);
+    }
+
+    void Suspend(bool on) {
+        if (on == s_suspended) return;
+        s_suspended = on;
+        if (on) {
+            NS_ADC::GetStaticADC().SetTextEnabled(false);
+        } else {
+            Restore();
+        }
+    }
+
+    Stats GetStats() {
+        Stats st = s_stats;
+        st.decim = s_ivDecim;
+        st.stored = (s_cfg.view == View::IV) ? s_ivN
+                  : (uint8_t)((s_trendCount < AREA_W) ? s_trendCount : AREA_W);
+        return st;
+    }
+
+    const char* ViewToString(View v) {
+        switch (v) {
+        case View::TEXT:  return "TEXT";
+        case View::IV:    return "IV";
+        case View::TREND: return "TREND";
+        default: return "?";
+        }
+    }
+
+} // namespace NS_PLOT
@@ -0,0 +1,53 @@
+#pragma once
+#include <stdint.h>
+
+namespace NS_TLM { struct ChannelInfo; }
+
+// OLED 曲线视图：第 1 行（Y 0~15）为标题与最新电流，Y 16~63 为绘图区。
+// - IV   ：本次扫描的 I-E 曲线（X = DAC 码，Y = 所选通道电流），点缓冲满时相邻两点合并、抽取倍数翻倍
+// - TREND：电流趋势（扫掠式：从左画到右，回到左边覆盖最旧的列，新点前方留几列空白）
+//          扫描运行时每 AVG 个样本平均成一个点；CGM 周期测量时每次测量一个点
+// 数据从广播环按自己的游标读取（与输出端相同的方式），采样中断不做任何额外工作；
+// 每个新点只画一条线段，只有坐标轴需要扩展或抽取翻倍时才整块重画。
+// 所有绘制都在 Service 所在的上下文（主循环 / RTOS ui 线程）；其他上下文只投递请求。
+namespace NS_PLOT
+{
+    enum class View : uint8_t { TEXT = 0, IV, TREND };
+
+    struct Config {
+        View     view = View::TEXT;
+        uint8_t  ch   = 0;              // 绘制的 ADC 通道
+        uint16_t avg  = 10;             // TREND：每个点平均的样本数
+    };
+
+    struct Stats {
+        uint32_t points  = 0;           // 画出的点
+        uint32_t redraws = 0;           // 整块重画次数
+        uint32_t skipped = 0;           // 落后超过广播环一圈而跳过的样本
+        uint16_t decim   = 1;           // IV 当前抽取倍数
+        uint8_t  stored  = 0;           // 点缓冲中的点数
+    };
+
+    static const uint8_t  MAX_CH  = 3;
+    static const uint16_t MAX_AVG = 1000;
+
+    // 任意上下文调用：下次 Service 时生效（切换视图会清屏重画）
+    void SetConfig(const Config& cfg);
+    const Config& GetConfig();
+
+    // 新一次 START：清空点缓冲，按通道跨阻换算电流
+    void Prepare(const NS_TLM::ChannelInfo& info);
+
+    // CGM 每次测量的各通道电流（pA）
+    void PushCgm(const int32_t* cur_pa, uint8_t nch);
+
+    // 主循环 / ui 线程调用：读取新样本并增量绘制，随后由 OLED_Flush 送屏
+    void Service();
+
+    // Service 所在上下文调用：屏幕交给菜单时暂停绘制（数据照收），恢复时整屏重画当前视图
+    void Suspend(bool on);
+
+    Stats GetStats();
+    const char* ViewToString(View v);
+
+} // namespace NS_PLOT
@@ -0,0 +1,150 @@
+#include "ParamStore.h"
+#include "stm32f10x.h"
+#include "Telemetry.h"
+
+namespace NS_PARAM
+{
+    static const uint32_t MAGIC = 0x314D5250u;      // "PRM1"
+
+    // 块头（16 字节）：数据写完之后才写，magic 最后写
+    struct BlockHeader {
+        uint32_t magic;
+        uint32_t gen;
+        uint16_t version;
+        uint16_t len;
+        uint16_t crc;           // gen/version/len + 数据的 CRC16
+        uint16_t reserved;      // 0xFFFF
+    };
+    static_assert(sizeof(BlockHeader) == 16, "NS_PARAM: block header layout");
+
+    static const uint16_t HDR_SIZE  = sizeof(BlockHeader);
+    static const uint16_t DATA_SIZE = PAGE_SIZE - HDR_SIZE;
+
+    static const uint32_t kPages[2] = { PAGE_A, PAGE_B };
+
+    static const BlockHeader& Header(uint8_t page) {
+        return *reinterpret_cast<const BlockHeader*>(kPages[page]);
+    }
+
+    static uint16_t BlockCrc(const BlockHeader& h, const uint8_t* data) {
+        const uint8_t* p = reinterpret_cast<const uint8_t*>(&h);
+        const uint16_t crc = NS_TLM::FrameCodec::Crc16(p + 4, 8);
+        return NS_TLM::FrameCodec::Crc16(data, h.len, crc);
+    }
+
+    static bool ValidPage(uint8_t page) {
+        const BlockHeader& h = Header(page);
+        if (h.magic != MAGIC || h.len > DATA_SIZE) return false;
+        return BlockCrc(h, reinterpret_cast<const uint8_t*>(kPages[page] + HDR_SIZE)) == h.crc;
+    }
+
+    // 代号回绕比较
+    static bool Newer(uint32_t a, uint32_t b) {
+        return static_cast<int32_t>(a - b) > 0;
+    }
+
+    // 最新的有效页，没有返回 -1
+    static int8_t NewestPage() {
+        const bool va = ValidPage(0);
+        const bool vb = ValidPage(1);
+        if (va && vb) return Newer(Header(1).gen, Header(0).gen) ? 1 : 0;
+        return va ? 0 : vb ? 1 : -1;
+    }
+
+    static bool IsBlank(uint32_t addr) {
+        const uint32_t* p = reinterpret_cast<const uint32_t*>(addr);
+        for (uint16_t i = 0; i < PAGE_SIZE / 4; ++i) {
+            if (p[i] != 0xFFFFFFFFu) return false;
+        }
+        return true;
+    }
+
+    static bool ErasePage(uint32_t addr) {
+        if (IsBlank(addr)) return true;
+        FLASH_Unlock();
+        FLASH_ClearFlag(FLASH_FLAG_EOP | FLASH_FLAG_PGERR | FLASH_FLAG_WRPRTERR);
+        const FLASH_Status st = FLASH_ErasePage(addr);
+        FLASH_Lock();
+        return st == FLASH_COMPLETE;
+    }
+
+    // 按半字编程 len 字节，奇数长度末尾补 0xFF
+    static bool Program(uint32_t addr, const uint8_t* data, uint16_t len) {
+        FLASH_Status st = FLASH_COMPLETE;
+        FLASH_Unlock();
+        for (uint16_t i = 0; i < len && st == FLASH_COMPLETE; i = static_cast<uint16_t>(i + 2u)) {
+            const uint16_t hi = (i + 1u < len) ? data[i + 1] : 0xFFu;
+            st = FLASH_ProgramHalfWord(addr + i, static_cast<uint16_t>(data[i] | (hi << 8)));
+        }
+        FLASH_Lock();
+        return st == FLASH_COMPLETE;
+    }
+
+    Status Load(uint16_t version, void* out, uint16_t len) {
+        const int8_t page = NewestPage();
+        if (page < 0) return Status::EMPTY;
+        const BlockHeader& h = Header(static_cast<uint8_t>(page));
+        if (h.version != version || h.len != len) return Status::VERSION;
+        const uint8_t* src = reinterpret_cast<const uint8_t*>(kPages[page] + HDR_SIZE);
+        uint8_t* dst = static_cast<uint8_t*>(out);
+        for (uint16_t i = 0; i < len; ++i) dst[i] = src[i];
+        return Status::OK;
+    }
+
+    Status Save(uint16_t version, const void* data, uint16_t len) {
+        if (len > DATA_SIZE) return Status::TOO_BIG;
+        const int8_t newest = NewestPage();
+        const uint8_t target = (newest == 0) ? 1 : 0;
+        const uint32_t addr = kPages[target];
+
+        BlockHeader h;
+        h.magic = MAGIC;
+        h.gen = (newest < 0) ? 1u : Header(static_cast<uint8_t>(newest)).gen + 1u;
+        h.version = version;
+        h.len = len;
+        h.reserved = 0xFFFFu;
+        h.crc = BlockCrc(h, static_cast<const uint8_t*>(data));
+
+        // 数据 → 块头（magic 之后的部分）→ magic；任何一步失败该页都不会被当作有效
+        const uint8_t* hp = reinterpret_cast<const uint8_t*>(&h);
+        if (!ErasePage(addr)
+            || !Program(addr + HDR_SIZE, static_cast<const uint8_t*>(data), len)
+            || !Program(addr + 4u, hp + 4, HDR_SIZE - 4u)
+            || !Program(addr, hp, 4u)) {
+            return Status::FLASH_ERR;
+        }
+        return (NewestPage() == static_cast<int8_t>(target)) ? Status::OK : Status::FLASH_ERR;
+    }
+
+    Status Erase() {
+        const int8_t newest = NewestPage();
+        const uint8_t first = (newest == 0) ? 1 : 0;
+        if (!ErasePage(kPages[first])) return Status::FLASH_ERR;
+        if (!ErasePage(kPages[first ^ 1u])) return Status::FLASH_ERR;
+        return Status::OK;
+    }
+
+    Info GetInfo() {
+        Info info;
+        const int8_t page = NewestPage();
+        if (page < 0) return info;
+        const BlockHeader& h = Header(static_cast<uint8_t>(page));
+        info.valid = true;
+        info.page = static_cast<uint8_t>(page);
+        info.gen = h.gen;
+        info.version = h.version;
+        info.len = h.len;
+        return info;
+    }
+
+    const char* StatusToString(Status s) {
+        switch (s) {
+        case Status::OK:      return "OK";
+        case Status::EMPTY:   return "EMPTY";
+        case Status::VERSION: return "VERSION";
+        case Status::TOO_BIG: return "TOO_BIG";
+        default:              return "FLASH_ERR";
+        }
+    }
+
+} // namespace NS_PARAM
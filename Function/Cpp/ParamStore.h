@@ -0,0 +1,38 @@
+#pragma once
+#include <stdint.h>
+
+// 参数块持久化：两个专用 flash 页轮流写（双缓冲），掉电时至少保留上一份完整的参数。
+// - 页 A 0x0803F000、页 B 0x0803F800（链接器 IROM 已缩到 0x30000，日志区之后）
+// - 页内 = 16 字节块头 + 参数数据；块头带 magic、版本、代号 gen、长度与 CRC16，magic 最后写
+// - 保存写到“非最新”的那一页（先擦除），写完回读校验；新页完整之前旧页不动
+// - 读取时两页都校验，取 gen 较新的有效页；直接读映射的 flash，开机恢复只是一次 CRC（约 100 字节）
+// - 版本号由调用方给出：数据结构变了就换版本，旧块不会被按新结构解释
+namespace NS_PARAM
+{
+    static const uint32_t PAGE_A    = 0x0803F000u;
+    static const uint32_t PAGE_B    = 0x0803F800u;
+    static const uint16_t PAGE_SIZE = 2048;
+
+    enum class Status : uint8_t { OK = 0, EMPTY, VERSION, TOO_BIG, FLASH_ERR };
+
+    struct Info {
+        bool     valid = false;
+        uint8_t  page = 0;              // 0 = A，1 = B
+        uint32_t gen = 0;               // 每次保存 + 1
+        uint16_t version = 0;
+        uint16_t len = 0;
+    };
+
+    // 取最新的有效块；版本或长度不符返回 VERSION（out 不动）
+    Status Load(uint16_t version, void* out, uint16_t len);
+
+    // 阻塞写入（擦除约 20ms + 编程）；写入期间取指停顿，调用方应在采样停止时调用
+    Status Save(uint16_t version, const void* data, uint16_t len);
+
+    // 擦除两页（较旧的先擦：中途掉电最多回到擦除前的状态）
+    Status Erase();
+
+    Info GetInfo();
+    const char* StatusToString(Status s);
+
+} // namespace NS_PARAM
@@ -0,0 +1,307 @@
+#include "StreamSink.h"
+#include "BTCPP.h"
+#include "DACManager.h"
+#include "ADCManager.h"
+#include "IRQnManage.h"
+#include "SysTickTimer.h"
+#include "EventFlags.h"
+#include "FlashLog.h"
+
+namespace NS_STREAM { StreamSource& GetStaticStream(); }
+static void Stream_TimCallback() { NS_STREAM::GetStaticStream().TIM_IRQnHandler(); }
+
+namespace NS_STREAM
+{
+    // 一次 Push 最多产生的 TX 字节数（BIN 满批次帧约 230B），留足余量才取样本，
+    // 否则样本留在广播环里，由该输出端的背压策略处理
+    static const uint16_t TX_RESERVE = 256;
+
+    // ------------------------ StreamSource ------------------------
+
+    StreamSource::StreamSource(const Params& params) : m_params(params) {
+        if (m_params.rateHz == 0) m_params.rateHz = 1;
+        if (m_params.rateHz > MAX_RATE_HZ) m_params.rateHz = MAX_RATE_HZ;
+    }
+
+    void StreamSource::Init(const NS_ADC::ADC* adc, const uint16_t* code_ref) {
+        m_adc     = adc;
+        m_codeRef = code_ref;
+        TimConfig();
+    }
+
+    void StreamSource::TimConfig() {
+        if (m_params.TIMx == nullptr) return;
+        TIM_TypeDef* tim = m_params.TIMx;
+
+        TIM_Cmd(tim, DISABLE);
+        TIM::InitTIM(tim, 1.0f / m_params.rateHz);
+        TIM::TIM_ITConfig(tim, TIM::IT::UP, ENABLE);
+        // 低于 DAC 步进(TIM2) 与串口，高于 OLED 刷新快照(TIM3)
+        (void)TIM_IRQnManage::Add(tim, TIM::IT::UP, Stream_TimCallback, 2, 1, ENABLE);
+        TIM_ClearITPendingBit(tim, TIM_IT_Update);
+        TIM_Cmd(tim, ENABLE);
+    }
+
+    bool StreamSource::SetRate(uint16_t rate_hz) {
+        if (rate_hz == 0 || rate_hz > MAX_RATE_HZ) return false;
+        m_params.rateHz = rate_hz;
+        TimConfig();
+        return true;
+    }
+
+    void StreamSource::SetActive(bool active, bool fresh) {
+        if (!active) {
+            m_active = false;
+            // 若是因背压暂停的扫描：STOP/PAUSE 已由控制台接管，不再自动恢复
+            m_hold = false;
+            return;
+        }
+        if (fresh) {
+            m_active = false;
+            m_head = 0;
+            m_t0 = SysTickTimer::GetTick();
+            m_t0Us = SysTickTimer::GetMicros64();
+        }
+        m_active = true;
+    }
+
+    bool StreamSource::Read(uint32_t idx, NS_TLM::Sample& out) const {
+        out = m_queue[idx & (QUEUE_SIZE - 1)];
+        // 拷贝完成后再看 head：槽 idx 只会在写第 idx+QUEUE_SIZE 个样本时被覆盖，
+        // 而中断总是先写槽再发布 head，拷贝期间若被覆盖则此处必然看到 head 越界
+        __DMB();
+        return (m_head - idx) <= QUEUE_SIZE;
+    }
+
+    void StreamSource::TIM_IRQnHandler() {
+        if (!m_active || m_hold || m_adc == nullptr) return;
+
+        const uint32_t head = m_head;
+        NS_TLM::Sample& s = m_queue[head & (QUEUE_SIZE - 1)];
+        s.ms    = SysTickTimer::GetTick() - m_t0;
+        s.us    = SysTickTimer::GetMicros64() - m_t0Us;
+        // 三个通道取自同一轮扫描；code 是单个对齐半字，读本身是原子的
+        uint16_t ch[3] = { 0, 0, 0 };
+        (void)m_adc->ReadSequence(ch, 3);
+        s.ch[0] = ch[0];
+        s.ch[1] = ch[1];
+        s.ch[2] = ch[2];
+        s.code  = m_codeRef ? static_cast<uint16_t>(*m_codeRef & 0x0FFF) : 0;
+
+        // 先写样本再发布 head
+        __DMB();
+        m_head = head + 1;
+        NS_EVT::Post(NS_EVT::SAMPLE);
+    }
+
+    // ------------------------ StreamSink ------------------------
+
+    StreamSink::StreamSink(const char* name, USART_Controller& link, bool enabled, Policy policy)
+        : m_name(name), m_link(link), m_enabled(enabled), m_policy(policy) {}
+
+    void StreamSink::SetEnabled(bool enabled) {
+        if (enabled == m_enabled) return;
+        if (!enabled) {
+            // 关闭前把未满的二进制批次发出
+            m_encoder.Flush(m_link);
+        } else {
+            // 从当前样本开始接收，不补发关闭期间的数据
+            Rewind(GetStaticStream());
+        }
+        m_enabled = enabled;
+    }
+
+    void StreamSink::SetPolicy(Policy policy) {
+        m_policy = policy;
+        m_decim = 1;
+        m_decimPhase = 0;
+    }
+
+    void StreamSink::ClearStats() {
+        m_sent = m_dropped = m_decimated = 0;
+        m_highWater = 0;
+    }
+
+    void StreamSink::Prepare(const StreamSource& src, const NS_TLM::ChannelInfo& info) {
+        if (m_rateHz != 0) {
+            // 目标速率换算成抽取窗口（向上取整，保证不超过目标速率）
+            uint32_t n = (src.GetRate() + m_rateHz - 1) / m_rateHz;
+            if (n == 0) n = 1;
+            if (n > 255) n = 255;
+            m_encoder.SetDecim(static_cast<uint8_t>(n));
+        }
+        m_encoder.BuildPlan(info);
+        m_encoder.Reset();
+        Rewind(src);
+    }
+
+    void StreamSink::Rewind(const StreamSource& src) {
+        m_cursor = src.GetHead();
+        m_evtSeen = NS_DAC::SystemController::GetInstance().GetLastSwap().id;
+        m_decim = 1;
+        m_decimPhase = 0;
+    }
+
+    void StreamSink::Service(const StreamSource& src) {
+        auto& sys = NS_DAC::SystemController::GetInstance();
+        if (!m_enabled) {
+            m_cursor = src.GetHead();
+            m_evtSeen = sys.GetLastSwap().id;
+            return;
+        }
+
+        // 主机请求的重传优先于新样本，但只用 TX 的空闲空间，不阻塞采样
+        m_encoder.ServiceResend(m_link);
+
+        const uint32_t head = src.GetHead();
+        uint32_t lag = head - m_cursor;
+        if (lag > StreamSource::QUEUE_SIZE) {
+            // 已被覆盖的部分直接跳过
+            m_dropped += lag - StreamSource::QUEUE_SIZE;
+            m_cursor = head - StreamSource::QUEUE_SIZE;
+            lag = StreamSource::QUEUE_SIZE;
+        }
+        if (lag > m_highWater) m_highWater = static_cast<uint16_t>(lag);
+
+        if (m_policy == Policy::DECIM) {
+            // 落后 > 3/4 倍数翻倍，< 1/4 减半
+            if (lag > StreamSource::QUEUE_SIZE * 3 / 4 && m_decim < MAX_DECIM) m_decim = static_cast<uint8_t>(m_decim * 2);
+            else if (lag < StreamSource::QUEUE_SIZE / 4 && m_decim > 1)        m_decim = static_cast<uint8_t>(m_decim / 2);
+        }
+
+        const NS_DAC::SwapEvent swap = sys.GetLastSwap();
+        bool evtPending = (swap.id != m_evtSeen);
+        NS_TLM::Event evt;
+        evt.id   = swap.id;
+        evt.ms   = src.ToStreamMs(swap.tick);
+        evt.us   = src.ToStreamUs(swap.us);
+        evt.code = swap.code;
+
+        NS_TLM::Sample s;
+        while (m_cursor != head && m_link.TxFree() >= TX_RESERVE) {
+            const bool valid = src.Read(m_cursor, s);
+            ++m_cursor;
+            if (!valid) {
+                ++m_dropped;
+                continue;
+            }
+            if (evtPending && static_cast<int32_t>(s.ms - evt.ms) >= 0) {
+                m_encoder.PushEvent(m_link, evt);
+                m_evtSeen = evt.id;
+                evtPending = false;
+            }
+            if (m_policy == Policy::DECIM && ++m_decimPhase < m_decim) {
+                ++m_decimated;
+                continue;
+            }
+            m_decimPhase = 0;
+            m_encoder.Push(m_link, s);
+            ++m_sent;
+            sys.UpdateTick();
+        }
+
+        // 已追上 head 仍未遇到更晚的样本（采样暂停/速率很低）：事件直接发出，不等下一个样本
+        if (evtPending && m_cursor == head && m_link.TxFree() >= TX_RESERVE) {
+            m_encoder.PushEvent(m_link, evt);
+            m_evtSeen = evt.id;
+        }
+
+        // 停止后排空：把未满的二进制批次发出
+        if (!src.IsActive() && m_cursor == src.GetHead()) {
+            m_encoder.Flush(m_link);
+        }
+    }
+
+    const char* StreamSink::PolicyToString(Policy policy) {
+        switch (policy) {
+        case Policy::DROP:  return "DROP";
+        case Policy::DECIM: return "DECIM";
+        case Policy::PAUSE: return "PAUSE";
+        default: return "?";
+        }
+    }
+
+    // ------------------------ 单例与调度 ------------------------
+
+    StreamSource& GetStaticStream() {
+        static StreamSource stream;
+        return stream;
+    }
+
+    StreamSink& GetSink(uint8_t idx) {
+        // 手机端（BT）与台架有线端（USART1）默认都开启，各自用 SINK 命令配置
+        static StreamSink sinks[SINK_COUNT] = {
+            { "BT",    GetStaticBt() },
+            { "WIRED", GetStaticWired() },
+        };
+        return sinks[(idx < SINK_COUNT) ? idx : 0];
+    }
+
+    StreamSink* FindSink(const USART_Controller& link) {
+        for (uint8_t i = 0; i < SINK_COUNT; ++i) {
+            if (&GetSink(i).Link() == &link) return &GetSink(i);
+        }
+        return nullptr;
+    }
+
+    StreamSink* FindSink(const char* name) {
+        if (name == nullptr) return nullptr;
+        for (uint8_t i = 0; i < SINK_COUNT; ++i) {
+            const char* a = GetSink(i).GetName();
+            const char* b = name;
+            while (*a && *b) {
+                char c = *b;
+                if (c >= 'a' && c <= 'z') c = static_cast<char>(c - 'a' + 'A');
+                if (*a != c) break;
+                ++a;
+                ++b;
+            }
+            if (*a == '\0' && *b == '\0') return &GetSink(i);
+        }
+        return nullptr;
+    }
+
+    void SetStreaming(bool active, bool fresh) {
+        auto& src = GetStaticStream();
+        src.SetActive(active, fresh);
+        if (active && fresh) {
+            for (uint8_t i = 0; i < SINK_COUNT; ++i) {
+                GetSink(i).ClearStats();
+                GetSink(i).Rewind(src);
+            }
+            NS_LOG::Rewind(src);
+        }
+    }
+
+    void PrepareSinks(const NS_TLM::ChannelInfo& info) {
+        const auto& src = GetStaticStream();
+        for (uint8_t i = 0; i < SINK_COUNT; ++i) GetSink(i).Prepare(src, info);
+    }
+
+    void ServiceSinks() {
+        auto& src = GetStaticStream();
+        auto& sys = NS_DAC::SystemController::GetInstance();
+
+        uint32_t pauseLag = 0;
+        for (uint8_t i = 0; i < SINK_COUNT; ++i) {
+            auto& sink = GetSink(i);
+            sink.Service(src);
+            if (sink.IsEnabled() && sink.GetPolicy() == Policy::PAUSE) {
+                const uint32_t lag = sink.GetLag(src);
+                if (lag > pauseLag) pauseLag = lag;
+            }
+        }
+
+        // PAUSE：最慢的 PAUSE 输出端落后到 3/4 时暂停扫描与采样，追到 1/4 后恢复
+        if (src.IsActive() && !src.IsHeld() && pauseLag >= StreamSource::QUEUE_SIZE * 3 / 4) {
+            sys.Pause();
+            src.SetHold(true);
+        } else if (src.IsHeld() && pauseLag <= StreamSource::QUEUE_SIZE / 4) {
+            src.SetHold(false);
+            sys.Resume();
+        }
+    }
+
+    bool IsLinkPaused() { return GetStaticStream().IsHeld(); }
+
+} // namespace NS_STREAM
@@ -0,0 +1,165 @@
+#pragma once
+#include "stm32f10x.h"
+#include <array>
+#include <InitArg.h>
+#include "Telemetry.h"
+
+class USART_Controller;
+namespace NS_ADC { class ADC; }
+
+namespace NS_STREAM
+{
+    // 背压策略：某个输出端（链路）跟不上采样时怎么办，每个输出端各自选择
+    //   DROP  ：该输出端落后超过一整圈时跳到最旧的未覆盖样本，被覆盖的计入 dropped
+    //   DECIM ：自适应抽取，落后越多抽取倍数越大（1,2,4..64），跳过的样本计入 decimated
+    //   PAUSE ：最慢的 PAUSE 输出端落后达到 3/4 队列时暂停 DAC 扫描与采样，落后回落到 1/4 队列及以下
+    //           才自动继续；中间留出迟滞，避免在阈值附近反复启停（实验时间轴被拉长，但不丢点）
+    enum class Policy : uint8_t { DROP = 0, DECIM = 1, PAUSE = 2 };
+
+    struct Params {
+        TIM_TypeDef* TIMx = TIM4;       // 采样定时器（10kHz 计数基准）
+        uint16_t rateHz   = 20;         // 采样率 1..1000 Hz
+
+        Params() = default;
+        Params(TIM_TypeDef* timx, uint16_t rate_hz) : TIMx(timx), rateHz(rate_hz) {}
+    };
+
+    // 采集源：定时器中断按固定速率取 ADC/DAC 快照写入广播环（中断只写 head，从不等待读者）。
+    // 各输出端只持有自己的读游标，样本只写一次、不按输出端复制。
+    // head 为自由递增的 32 位计数，游标与 head 之差即落后量，超过 QUEUE_SIZE 说明已被覆盖。
+    class StreamSource {
+    public:
+        static const uint16_t QUEUE_SIZE = 128;     // 必须是 2 的幂
+        static const uint16_t MAX_RATE_HZ = 1000;
+
+        explicit StreamSource(const Params& params = Params());
+
+        // 绑定数据源并配置定时器（不启动）
+        void Init(const NS_ADC::ADC* adc, const uint16_t* code_ref);
+
+        // 运行/停止采样；fresh=true 时 head 归零、清计数与时间基准（新一次 START）
+        void SetActive(bool active, bool fresh = false);
+        bool IsActive() const { return m_active; }
+
+        bool SetRate(uint16_t rate_hz);
+        uint16_t GetRate() const { return m_params.rateHz; }
+
+        // PAUSE 输出端暂停 DAC 时同时暂停产出，避免覆盖其未读样本
+        void SetHold(bool hold) { m_hold = hold; }
+        bool IsHeld() const     { return m_hold; }
+
+        uint32_t GetHead() const { return m_head; }
+
+        // 读取第 idx 个样本；拷贝后若发现该槽已被中断覆盖则返回 false
+        bool Read(uint32_t idx, NS_TLM::Sample& out) const;
+
+        // 定时器中断回调
+        void TIM_IRQnHandler();
+
+        uint32_t GetProduced() const { return m_head; }
+
+        // SysTick 毫秒 / 64 位微秒 -> 样本时间轴（相对本次 START）
+        uint32_t ToStreamMs(uint32_t tick) const { return tick - m_t0; }
+        uint64_t ToStreamUs(uint64_t us) const   { return us - m_t0Us; }
+
+    private:
+        Params m_params;
+
+        const NS_ADC::ADC* m_adc  = nullptr;
+        const uint16_t* m_codeRef = nullptr;
+
+        volatile bool m_active = false;
+        volatile bool m_hold   = false;
+        uint32_t m_t0 = 0;
+        uint64_t m_t0Us = 0;
+
+        std::array<NS_TLM::Sample, QUEUE_SIZE> m_queue{};
+        volatile uint32_t m_head = 0;       // 中断写
+
+        void TimConfig();
+    };
+
+    // 输出端：一条链路 + 自己的编码器（格式/字段/抽取/序号/重传窗口）+ 自己的背压策略与读游标。
+    // 主循环 Service() 在该链路 TX 有余量时从广播环取样本交给编码器，各输出端互不阻塞。
+    class StreamSink {
+    public:
+        static const uint8_t MAX_DECIM = 64;
+
+        StreamSink(const char* name, USART_Controller& link, bool enabled = true, Policy policy = Policy::DROP);
+
+        const char* GetName() const { return m_name; }
+        USART_Controller& Link() const { return m_link; }
+        NS_TLM::TelemetryEncoder& Encoder() { return m_encoder; }
+        const NS_TLM::TelemetryEncoder& Encoder() const { return m_encoder; }
+
+        void SetEnabled(bool enabled);
+        bool IsEnabled() const { return m_enabled; }
+
+        void   SetPolicy(Policy policy);
+        Policy GetPolicy() const { return m_policy; }
+
+        // 目标输出速率：0 表示全速；否则在 Prepare 时按采样率换算成编码器的抽取倍数（EVERY）
+        void     SetRate(uint16_t rate_hz) { m_rateHz = rate_hz; }
+        uint16_t GetRate() const { return m_rateHz; }
+
+        // START 时调用：生成字段计划、重置序号与游标
+        void Prepare(const StreamSource& src, const NS_TLM::ChannelInfo& info);
+
+        // 游标对齐到当前 head（新一次 START 或重新开启时）
+        void Rewind(const StreamSource& src);
+
+        // 主循环调用：尽可能多地把样本交给编码器；
+        // 运行中参数替换事件插在第一个时间戳不早于替换时刻的样本之前（两次 Service 间多次替换只报最后一次）
+        void Service(const StreamSource& src);
+
+        uint32_t GetLag(const StreamSource& src) const { return src.GetHead() - m_cursor; }
+
+        // 统计
+        uint32_t GetSent() const      { return m_sent; }
+        uint32_t GetDropped() const   { return m_dropped; }
+        uint32_t GetDecimated() const { return m_decimated; }
+        uint16_t GetHighWater() const { return m_highWater; }
+        uint8_t  GetDecim() const     { return m_decim; }
+        void ClearStats();
+
+        static const char* PolicyToString(Policy policy);
+
+    private:
+        const char* m_name;
+        USART_Controller& m_link;
+        NS_TLM::TelemetryEncoder m_encoder;
+
+        bool     m_enabled;
+        Policy   m_policy;
+        uint16_t m_rateHz = 0;
+
+        uint32_t m_cursor = 0;
+        uint16_t m_evtSeen = 0;     // 已报告的最后一个替换事件 id
+
+        // DECIM：抽取倍数按本输出端的落后量调整
+        uint8_t m_decim = 1;
+        uint8_t m_decimPhase = 0;
+
+        uint32_t m_sent = 0;
+        uint32_t m_dropped = 0;
+        uint32_t m_decimated = 0;
+        uint16_t m_highWater = 0;
+    };
+
+    static const uint8_t SINK_COUNT = 2;
+
+    // 单例访问接口
+    StreamSource& GetStaticStream();
+    StreamSink& GetSink(uint8_t idx);                       // 0 = BT(USART3)，1 = WIRED(USART1)
+    StreamSink* FindSink(const USART_Controller& link);
+    StreamSink* FindSink(const char* name);
+
+    // 运行/停止采样；fresh=true 时各输出端游标与统计一并归零
+    void SetStreaming(bool active, bool fresh);
+    // START 时为所有输出端生成字段计划
+    void PrepareSinks(const NS_TLM::ChannelInfo& info);
+    // 主循环调用：逐个服务输出端，并按 PAUSE 输出端的落后量暂停/恢复 DAC 扫描
+    void ServiceSinks();
+    bool IsLinkPaused();
+
+} // namespace NS_STREAM
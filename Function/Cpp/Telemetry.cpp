@@ -0,0 +1,529 @@
+#include "Telemetry.h"
+#include "BTCPP.h"
+#include "FastFmt.h"
+#include "ADCManager.h"
+#include <cstring>
+
+namespace NS_TLM
+{
+    // =========================================================
+    // FrameCodec
+    // =========================================================
+
+    uint16_t FrameCodec::Crc16(const uint8_t* data, uint16_t len, uint16_t crc) {
+        // 逐位计算，免查表（帧长 < 256，开销可忽略，省 512B flash）
+        for (uint16_t i = 0; i < len; ++i) {
+            crc ^= static_cast<uint16_t>(data[i]) << 8;
+            for (uint8_t b = 0; b < 8; ++b) {
+                crc = (crc & 0x8000) ? static_cast<uint16_t>((crc << 1) ^ 0x1021)
+                                     : static_cast<uint16_t>(crc << 1);
+            }
+        }
+        return crc;
+    }
+
+    uint16_t FrameCodec::CobsEncode(const uint8_t* in, uint16_t len, uint8_t* out) {
+        uint16_t w = 1;          // 下一个写入位置
+        uint16_t codeIdx = 0;    // 当前块长度字节的位置
+        uint8_t  code = 1;
+
+        for (uint16_t i = 0; i < len; ++i) {
+            if (in[i] == 0) {
+                out[codeIdx] = code;
+                codeIdx = w++;
+                code = 1;
+            } else {
+                out[w++] = in[i];
+                if (++code == 0xFF) {
+                    out[codeIdx] = code;
+                    codeIdx = w++;
+                    code = 1;
+                }
+            }
+        }
+        out[codeIdx] = code;
+        return w;
+    }
+
+    uint16_t FrameCodec::CobsDecode(const uint8_t* in, uint16_t len, uint8_t* out, uint16_t out_max) {
+        uint16_t r = 0, w = 0;
+        while (r < len) {
+            const uint8_t code = in[r++];
+            if (code == 0) return 0;
+            for (uint8_t i = 1; i < code; ++i) {
+                if (r >= len || w >= out_max || in[r] == 0) return 0;
+                out[w++] = in[r++];
+            }
+            // 非 0xFF 块之后隐含一个 0，最后一块除外
+            if (code != 0xFF && r < len) {
+                if (w >= out_max) return 0;
+                out[w++] = 0;
+            }
+        }
+        return w;
+    }
+
+    // =========================================================
+    // RetransmitRing
+    // =========================================================
+
+    int16_t RetransmitRing::Find(uint16_t seq) const {
+        // 序号在窗口内连续递增：直接由与最旧序号的差值定位，O(1)
+        if (m_count == 0) return -1;
+        const uint16_t d = static_cast<uint16_t>(seq - m_entries[m_first].seq);
+        if (d >= m_count) return -1;
+        const uint8_t idx = static_cast<uint8_t>((m_first + d) % MAX_FRAMES);
+        return (m_entries[idx].seq == seq) ? idx : -1;
+    }
+
+    void RetransmitRing::DropOldest() {
+        if (m_count == 0) return;
+        m_used = static_cast<uint16_t>(m_used - m_entries[m_first].len);
+        m_first = static_cast<uint8_t>((m_first + 1) % MAX_FRAMES);
+        --m_count;
+    }
+
+    void RetransmitRing::Store(uint16_t seq, const uint8_t* data, uint16_t len) {
+        if (len == 0 || len > STORE_SIZE) return;
+        // 序号不连续（Reset 之后等）时清空，保证 Find 的差值定位成立
+        if (m_count && static_cast<uint16_t>(NewestSeq() + 1) != seq) Clear();
+
+        while (m_count == MAX_FRAMES || m_used + len > STORE_SIZE) DropOldest();
+
+        Entry& e = m_entries[(m_first + m_count) % MAX_FRAMES];
+        e.seq = seq;
+        e.off = m_writeOff;
+        e.len = len;
+
+        const uint16_t first = (len <= STORE_SIZE - m_writeOff) ? len : static_cast<uint16_t>(STORE_SIZE - m_writeOff);
+        memcpy(&m_store[m_writeOff], data, first);
+        if (first < len) memcpy(&m_store[0], data + first, len - first);
+
+        m_writeOff = static_cast<uint16_t>((m_writeOff + len) % STORE_SIZE);
+        m_used = static_cast<uint16_t>(m_used + len);
+        ++m_count;
+    }
+
+    uint16_t RetransmitRing::FrameLen(uint16_t seq) const {
+        const int16_t idx = Find(seq);
+        return (idx < 0) ? 0 : m_entries[idx].len;
+    }
+
+    uint16_t RetransmitRing::Fetch(uint16_t seq, uint8_t* out, uint16_t out_max) const {
+        const int16_t idx = Find(seq);
+        if (idx < 0) return 0;
+        const Entry& e = m_entries[idx];
+        if (e.len > out_max) return 0;
+
+        const uint16_t first = (e.len <= STORE_SIZE - e.off) ? e.len : static_cast<uint16_t>(STORE_SIZE - e.off);
+        memcpy(out, &m_store[e.off], first);
+        if (first < e.len) memcpy(out + first, &m_store[0], e.len - first);
+        return e.len;
+    }
+
+    // =========================================================
+    // TelemetryEncoder
+    // =========================================================
+
+    void TelemetryEncoder::Reset() {
+        m_count = 0;
+        m_decimCount = 0;
+        m_seq = 0;
+        m_ring.Clear();
+        m_resendActive = false;
+    }
+
+    void TelemetryEncoder::Emit(USART_Controller& usart, const uint8_t* data, uint16_t len) {
+        // TX 缓冲满时整帧丢弃，但帧仍进入重传窗口，主机可按序号缺口找回
+        if (usart.WriteFrame(data, len)) {
+            ++m_framesSent;
+        } else {
+            ++m_framesDropped;
+        }
+        m_ring.Store(m_seq, data, len);
+        ++m_seq;
+    }
+
+    bool TelemetryEncoder::RequestResend(uint16_t from, uint16_t to) {
+        if (m_ring.Empty()) return false;
+        uint16_t span = static_cast<uint16_t>(to - from);
+        if (span >= MAX_RESEND_SPAN) {
+            span = MAX_RESEND_SPAN - 1;
+            to = static_cast<uint16_t>(from + span);
+        }
+        // 与窗口 [oldest, newest] 没有交集：无可回放（序号按 16 位回绕比较）
+        const uint16_t oldest = m_ring.OldestSeq();
+        const uint16_t window = static_cast<uint16_t>(m_ring.NewestSeq() - oldest);
+        const bool hit = static_cast<uint16_t>(from - oldest) <= window ||
+                         static_cast<uint16_t>(to - oldest) <= window ||
+                         static_cast<uint16_t>(oldest - from) <= span;
+        if (!hit) return false;
+        m_resendNext = from;
+        m_resendLast = to;
+        m_resendActive = true;
+        return true;
+    }
+
+    void TelemetryEncoder::ServiceResend(USART_Controller& usart) {
+        while (m_resendActive) {
+            const uint16_t seq = m_resendNext;
+            const uint16_t len = m_ring.FrameLen(seq);
+            if (len == 0) {
+                ++m_resendMissing;
+            } else {
+                if (usart.TxFree() < len) return;   // 等下次 Service，不阻塞
+                const uint16_t n = m_ring.Fetch(seq, m_wire.data(), static_cast<uint16_t>(m_wire.size()));
+                if (n && usart.WriteFrame(m_wire.data(), n)) ++m_framesResent;
+            }
+            if (seq == m_resendLast) {
+                m_resendActive = false;
+            } else {
+                m_resendNext = static_cast<uint16_t>(seq + 1);
+            }
+        }
+    }
+
+    void TelemetryEncoder::SetFormat(Format fmt) {
+        if (fmt != m_format) m_count = 0;
+        m_format = fmt;
+    }
+
+    void TelemetryEncoder::SetEncoding(Encoding enc) {
+        if (enc != m_encoding) m_count = 0;
+        m_encoding = enc;
+    }
+
+    void TelemetryEncoder::SetBatch(uint8_t n) {
+        if (n < 1) n = 1;
+        if (n > MAX_BATCH) n = MAX_BATCH;
+        m_batch = n;
+        m_count = 0;
+    }
+
+    // ---------------- 字段计划 ----------------
+
+    static const char* const kFieldNames[] = {
+        "MS", "CH0", "CH1", "CH2", "I0", "I1", "I2", "CODE", "GAIN", "MIN", "MAX", "US"
+    };
+    // JSON 键名：原始码沿用旧上位机的分析物名称
+    static const char* const kRawKeys[3]  = { "Uric", "Ascorbic", "Glucose" };
+    static const char* const kCurKeys[3]  = { "I0", "I1", "I2" };
+    static const char* const kGainKeys[3] = { "Gain0", "Gain1", "Gain2" };
+    static const char* const kMinKeys[3]  = { "Min0", "Min1", "Min2" };
+    static const char* const kMaxKeys[3]  = { "Max0", "Max1", "Max2" };
+
+    bool TelemetryEncoder::SetFields(uint16_t mask) {
+        mask &= static_cast<uint16_t>(FieldBit(Field::END) - 1);
+        if (mask == 0) return false;
+        m_fieldsCfg = mask;
+        return true;
+    }
+
+    void TelemetryEncoder::AddOp(OpKind kind, uint8_t ch, uint8_t bits, int32_t k, const char* key) {
+        if (m_opCount >= MAX_OPS) return;
+        Op& op = m_ops[m_opCount++];
+        op.kind = kind;
+        op.ch   = ch;
+        op.bits = bits;
+        op.k    = k;
+        op.key  = key;
+    }
+
+    void TelemetryEncoder::BuildPlan(const ChannelInfo& info) {
+        const uint16_t f = m_fieldsCfg;
+        m_fields = f;
+        m_decim  = m_decimCfg;
+        m_ref    = info.ref;
+        m_opCount = 0;
+
+        auto has = [f](Field x) { return (f & FieldBit(x)) != 0; };
+
+        if (has(Field::MS)) AddOp(OpKind::MS, 0, 16, 0, "Ms");
+        for (uint8_t c = 0; c < 3; ++c) {
+            if (has(static_cast<Field>(To_uint8(Field::CH0) + c))) AddOp(OpKind::RAW, c, 12, 0, kRawKeys[c]);
+        }
+        for (uint8_t c = 0; c < 3; ++c) {
+            if (!has(static_cast<Field>(To_uint8(Field::I0) + c))) continue;
+            // nA/码 = 1e9 / (码/V * Ω)（与 ShowVoltage、OLED 曲线同一换算），以 Q16 定点保存，记录时只需一次整数乘法；
+            // 跨阻小于约 25Ω 时系数超出 Q16 范围，钳位
+            const uint32_t gain = info.gain[c] ? info.gain[c] : 1;
+            const float k = 1.0e9f / (NS_ADC::ADC::stepPerVolt * (float)gain) * 65536.0f + 0.5f;
+            AddOp(OpKind::CUR, c, 32, (k < 2147483647.0f) ? (int32_t)k : 2147483647, kCurKeys[c]);
+        }
+        if (has(Field::CODE)) AddOp(OpKind::CODE, 0, 12, 0, "Code12");
+
+        // GAIN/MIN/MAX 跟随被选中的通道
+        uint8_t chMask = 0;
+        for (uint8_t c = 0; c < 3; ++c) {
+            if (has(static_cast<Field>(To_uint8(Field::CH0) + c)) || has(static_cast<Field>(To_uint8(Field::I0) + c))) {
+                chMask |= static_cast<uint8_t>(1u << c);
+            }
+        }
+        for (uint8_t c = 0; c < 3; ++c) {
+            if (!(chMask & (1u << c))) continue;
+            if (has(Field::GAIN)) AddOp(OpKind::CONST, c, 32, (int32_t)info.gain[c], kGainKeys[c]);
+        }
+        for (uint8_t c = 0; c < 3; ++c) {
+            if (!(chMask & (1u << c))) continue;
+            if (has(Field::MIN)) AddOp(OpKind::MIN, c, 12, 0, kMinKeys[c]);
+            if (has(Field::MAX)) AddOp(OpKind::MAX, c, 12, 0, kMaxKeys[c]);
+        }
+        if (has(Field::US)) AddOp(OpKind::US, 0, 32, 0, "Us");
+
+        // 单条记录最坏字节数：DELTA 每字段 varint 最多 5 字节，FIXED 按位宽
+        uint16_t bits = 0;
+        for (uint8_t i = 0; i < m_opCount; ++i) bits = static_cast<uint16_t>(bits + m_ops[i].bits);
+        const uint16_t fixedBytes = static_cast<uint16_t>((bits + 7) / 8 + 1);
+        const uint16_t deltaBytes = static_cast<uint16_t>(m_opCount * 5);
+        m_maxRecordBytes = (fixedBytes > deltaBytes) ? fixedBytes : deltaBytes;
+
+        m_count = 0;
+        m_decimCount = 0;
+    }
+
+    bool TelemetryEncoder::ParseFields(const char* str, uint16_t* out_mask) {
+        if (!str || !out_mask) return false;
+        uint16_t mask = 0;
+        char name[8];
+        while (*str) {
+            uint8_t n = 0;
+            while (*str && *str != '+' && *str != '|') {
+                if (n >= sizeof(name) - 1) return false;
+                char c = *str++;
+                if (c >= 'a' && c <= 'z') c = (char)(c - 'a' + 'A');
+                name[n++] = c;
+            }
+            name[n] = '\0';
+            if (*str) ++str;
+            if (n == 0) continue;
+
+            if (strcmp(name, "ALL") == 0) {
+                mask = static_cast<uint16_t>(FieldBit(Field::END) - 1);
+                continue;
+            }
+            uint8_t i = 0;
+            for (; i < To_uint8(Field::END); ++i) {
+                if (strcmp(name, kFieldNames[i]) == 0) break;
+            }
+            if (i >= To_uint8(Field::END)) return false;
+            mask |= static_cast<uint16_t>(1u << i);
+        }
+        if (mask == 0) return false;
+        *out_mask = mask;
+        return true;
+    }
+
+    void TelemetryEncoder::FieldsToString(uint16_t mask, char* out, uint16_t cap) {
+        NS_FMT::FmtBuf f(out, cap);
+        for (uint8_t i = 0; i < To_uint8(Field::END); ++i) {
+            if (!(mask & (1u << i))) continue;
+            if (f.size()) f.Char('+');
+            f.Str(kFieldNames[i]);
+        }
+    }
+
+    // ---------------- 记录 ----------------
+
+    void TelemetryEncoder::MakeRecord(const Sample& s, int32_t* vals) const {
+        for (uint8_t i = 0; i < m_opCount; ++i) {
+            const Op& op = m_ops[i];
+            switch (op.kind) {
+            case OpKind::MS:    vals[i] = (int32_t)s.ms; break;
+            case OpKind::RAW:   vals[i] = s.ch[op.ch]; break;
+            case OpKind::CUR:   vals[i] = (int32_t)(((int64_t)((int32_t)s.ch[op.ch] - (int32_t)m_ref) * op.k) / 65536); break;
+            case OpKind::CODE:  vals[i] = s.code & 0x0FFF; break;
+            case OpKind::CONST: vals[i] = op.k; break;
+            case OpKind::MIN:   vals[i] = m_winMin[op.ch]; break;
+            case OpKind::MAX:   vals[i] = m_winMax[op.ch]; break;
+            case OpKind::US:    vals[i] = (int32_t)(uint32_t)s.us; break;
+            }
+        }
+    }
+
+    void TelemetryEncoder::Push(USART_Controller& usart, const Sample& s) {
+        // 抽取窗口：MIN/MAX 统计窗口内全部样本，其余字段取窗口最后一个样本
+        if (m_decimCount == 0) {
+            for (uint8_t c = 0; c < 3; ++c) m_winMin[c] = m_winMax[c] = s.ch[c];
+        } else {
+            for (uint8_t c = 0; c < 3; ++c) {
+                if (s.ch[c] < m_winMin[c]) m_winMin[c] = s.ch[c];
+                if (s.ch[c] > m_winMax[c]) m_winMax[c] = s.ch[c];
+            }
+        }
+        if (++m_decimCount < m_decim) return;
+        m_decimCount = 0;
+
+        int32_t vals[MAX_OPS];
+        MakeRecord(s, vals);
+        m_recUs = s.us;
+
+        if (m_format == Format::JSON) {
+            SendJson(usart, vals);
+        } else {
+            AppendBin(usart, vals);
+        }
+    }
+
+    void TelemetryEncoder::Flush(USART_Controller& usart) {
+        if (m_format == Format::BIN && m_count > 0) {
+            FinishFrame(usart);
+        }
+    }
+
+    void TelemetryEncoder::PushEvent(USART_Controller& usart, const Event& ev) {
+        if (m_format == Format::JSON) {
+            char outBuf[96];
+            NS_FMT::FmtBuf f(outBuf);
+            f.Str("{\"Seq\":").U32(m_seq);
+            f.Str(",\"Evt\":\"").Str((ev.kind == EventKind::SWAP) ? "SWAP" : "?");
+            f.Str("\",\"Id\":").U32(ev.id);
+            f.Str(",\"Ms\":").U32(ev.ms);
+            f.Str(",\"Us\":").U64(ev.us);
+            f.Str(",\"Code12\":").U32(ev.code);
+            f.Str("}\n");
+            Emit(usart, f.data(), f.size());
+            return;
+        }
+
+        Flush(usart);
+        uint8_t raw[14];
+        raw[0]  = FRAME_EVENT;
+        raw[1]  = static_cast<uint8_t>(ev.kind);
+        raw[2]  = static_cast<uint8_t>(m_seq);
+        raw[3]  = static_cast<uint8_t>(m_seq >> 8);
+        raw[4]  = static_cast<uint8_t>(ev.id);
+        raw[5]  = static_cast<uint8_t>(ev.id >> 8);
+        raw[6]  = static_cast<uint8_t>(ev.ms);
+        raw[7]  = static_cast<uint8_t>(ev.ms >> 8);
+        raw[8]  = static_cast<uint8_t>(ev.ms >> 16);
+        raw[9]  = static_cast<uint8_t>(ev.ms >> 24);
+        raw[10] = static_cast<uint8_t>(ev.code);
+        raw[11] = static_cast<uint8_t>(ev.code >> 8);
+        const uint16_t crc = FrameCodec::Crc16(raw, 12);
+        raw[12] = static_cast<uint8_t>(crc);
+        raw[13] = static_cast<uint8_t>(crc >> 8);
+
+        uint8_t wire[FrameCodec::CobsMaxLen(sizeof(raw)) + 1];
+        uint16_t n = FrameCodec::CobsEncode(raw, sizeof(raw), wire);
+        wire[n++] = 0x00;
+        Emit(usart, wire, n);
+    }
+
+    void TelemetryEncoder::SendJson(USART_Controller& usart, const int32_t* vals) {
+        char outBuf[256];
+        NS_FMT::FmtBuf f(outBuf);
+        f.Str("{\"Seq\":").U32(m_seq);
+        for (uint8_t i = 0; i < m_opCount; ++i) {
+            f.Str(",\"").Str(m_ops[i].key).Str("\":");
+            if (m_ops[i].kind == OpKind::US) {
+                f.U64(m_recUs);
+            } else if (m_ops[i].kind == OpKind::MS || m_ops[i].kind == OpKind::CONST) {
+                f.U32((uint32_t)vals[i]);
+            } else {
+                f.I32(vals[i]);
+            }
+        }
+        f.Str("}\n");
+        // 整行写入 TX 缓冲（非阻塞）；缓冲满时整行丢弃并计入 TxDropCount
+        Emit(usart, f.data(), f.size());
+    }
+
+    uint16_t TelemetryEncoder::PutVarint(uint8_t* p, uint32_t v) {
+        uint16_t n = 0;
+        while (v >= 0x80) {
+            p[n++] = static_cast<uint8_t>(v | 0x80);
+            v >>= 7;
+        }
+        p[n++] = static_cast<uint8_t>(v);
+        return n;
+    }
+
+    // LSB-first 位流：bits <= 16 一次写入，32 位字段拆成两半
+    void TelemetryEncoder::PutBits(uint32_t v, uint8_t bits) {
+        if (bits > 16) {
+            PutBits(v & 0xFFFF, 16);
+            PutBits(v >> 16, static_cast<uint8_t>(bits - 16));
+            return;
+        }
+        m_bitAcc |= (v & ((1u << bits) - 1)) << m_bitCnt;
+        m_bitCnt = static_cast<uint8_t>(m_bitCnt + bits);
+        while (m_bitCnt >= 8) {
+            m_raw[m_rawLen++] = static_cast<uint8_t>(m_bitAcc);
+            m_bitAcc >>= 8;
+            m_bitCnt = static_cast<uint8_t>(m_bitCnt - 8);
+        }
+    }
+
+    void TelemetryEncoder::BeginFrame(uint32_t base_ms) {
+        uint8_t* p = m_raw.data();
+        p[0] = FRAME_SAMPLES;
+        p[1] = (m_encoding == Encoding::DELTA) ? FLAG_DELTA : 0;
+        p[2] = static_cast<uint8_t>(m_seq);
+        p[3] = static_cast<uint8_t>(m_seq >> 8);
+        p[4] = 0;                               // N，发送时回填
+        p[5] = static_cast<uint8_t>(m_fields);
+        p[6] = static_cast<uint8_t>(m_fields >> 8);
+        p[7] = static_cast<uint8_t>(base_ms);
+        p[8] = static_cast<uint8_t>(base_ms >> 8);
+        p[9] = static_cast<uint8_t>(base_ms >> 16);
+        p[10] = static_cast<uint8_t>(base_ms >> 24);
+        m_rawLen = HEADER_LEN;
+        m_baseMs = base_ms;
+        m_bitAcc = 0;
+        m_bitCnt = 0;
+        m_prev.fill(0);
+    }
+
+    void TelemetryEncoder::AppendBin(USART_Controller& usart, const int32_t* vals) {
+        // 记录中 MS 总在第一项（若被选中）
+        const bool hasMs = (m_opCount > 0 && m_ops[0].kind == OpKind::MS);
+        if (m_count == 0) BeginFrame(hasMs ? (uint32_t)vals[0] : 0);
+
+        if (m_encoding == Encoding::FIXED) {
+            for (uint8_t i = 0; i < m_opCount; ++i) {
+                uint32_t v = (uint32_t)vals[i];
+                if (m_ops[i].kind == OpKind::MS) {
+                    // dt 超出 u16 时钳位（批次跨度 > 65s 说明上报极慢，精度不再重要）
+                    const uint32_t dt32 = v - m_baseMs;
+                    v = (dt32 > 0xFFFF) ? 0xFFFF : dt32;
+                }
+                PutBits(v, m_ops[i].bits);
+            }
+        } else {
+            for (uint8_t i = 0; i < m_opCount; ++i) {
+                if (m_ops[i].kind == OpKind::MS) {
+                    const int32_t prev = (m_count == 0) ? (int32_t)m_baseMs : m_prev[i];
+                    m_rawLen = static_cast<uint16_t>(m_rawLen + PutVarint(&m_raw[m_rawLen], (uint32_t)(vals[i] - prev)));
+                } else {
+                    m_rawLen = static_cast<uint16_t>(m_rawLen + PutVarint(&m_raw[m_rawLen], ZigZag(vals[i] - m_prev[i])));
+                }
+                m_prev[i] = vals[i];
+            }
+        }
+        ++m_count;
+
+        // 满批次，或下一条可能放不下（留出位流尾字节与 CRC）
+        if (m_count >= m_batch || m_rawLen + m_maxRecordBytes + 3 > RAW_MAX) {
+            FinishFrame(usart);
+        }
+    }
+
+    void TelemetryEncoder::FinishFrame(USART_Controller& usart) {
+        if (m_bitCnt) {
+            m_raw[m_rawLen++] = static_cast<uint8_t>(m_bitAcc);
+            m_bitAcc = 0;
+            m_bitCnt = 0;
+        }
+        m_raw[4] = m_count;
+
+        const uint16_t crc = FrameCodec::Crc16(m_raw.data(), m_rawLen);
+        m_raw[m_rawLen++] = static_cast<uint8_t>(crc);
+        m_raw[m_rawLen++] = static_cast<uint8_t>(crc >> 8);
+        m_count = 0;
+
+        uint16_t n = FrameCodec::CobsEncode(m_raw.data(), m_rawLen, m_wire.data());
+        m_wire[n++] = 0x00;   // 帧分隔符
+        Emit(usart, m_wire.data(), n);
+    }
+
+} // namespace NS_TLM
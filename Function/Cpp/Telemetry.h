@@ -0,0 +1,264 @@
+#pragma once
+#include "stm32f10x.h"
+#include <array>
+#include <cstdint>
+
+class USART_Controller;
+
+namespace NS_TLM
+{
+    // 输出协议：JSON 文本行（兼容旧上位机）/ 二进制帧（COBS + CRC16）
+    enum class Format : uint8_t { JSON = 0, BIN = 1 };
+
+    // 二进制帧内字段编码：定宽 12bit 打包 / 与上一样本的 zigzag-varint 差分
+    enum class Encoding : uint8_t { FIXED = 0, DELTA = 1 };
+
+    // 一组采样：时间戳 + 三路 12bit ADC 原始值 + 当前 DAC 码
+    struct Sample {
+        uint32_t ms = 0;
+        uint64_t us = 0;            // 相对本次 START 的微秒（64 位时间基准，长期部署不回绕）
+        uint16_t ch[3] = {0, 0, 0};
+        uint16_t code = 0;
+    };
+
+    // 插入数据流的事件（与样本共用序号）：SWAP = 运行中参数在此刻替换
+    enum class EventKind : uint8_t { SWAP = 1 };
+
+    struct Event {
+        EventKind kind = EventKind::SWAP;
+        uint16_t id = 0;        // 事件编号（SystemController 自增）
+        uint32_t ms = 0;        // 与样本相同的时间轴（相对本次 START）
+        uint64_t us = 0;        // 同一时间轴的微秒值
+        uint16_t code = 0;      // 替换后的 DAC 码
+    };
+
+    // 帧编解码工具：COBS 去零 + CRC16-CCITT（多项式 0x1021，初值 0xFFFF）
+    // 线上格式：COBS(payload + crc16_le) + 0x00，0x00 仅作帧分隔符
+    class FrameCodec {
+    public:
+        static uint16_t Crc16(const uint8_t* data, uint16_t len, uint16_t crc = 0xFFFF);
+
+        // COBS 编码：out 至少 len + len / 254 + 1 字节，返回编码后长度（不含结尾 0x00）
+        static uint16_t CobsEncode(const uint8_t* in, uint16_t len, uint8_t* out);
+
+        // COBS 解码：输入不含结尾 0x00，格式错误返回 0
+        static uint16_t CobsDecode(const uint8_t* in, uint16_t len, uint8_t* out, uint16_t out_max);
+
+        static constexpr uint16_t CobsMaxLen(uint16_t len) { return static_cast<uint16_t>(len + len / 254 + 1); }
+    };
+
+    // 重传窗口：按线上字节原样保存最近的数据帧（JSON 行或 COBS 帧），按序号回放。
+    // 字节存储与索引都是环形的，空间不够时淘汰最旧的帧。
+    class RetransmitRing {
+    public:
+        static const uint16_t STORE_SIZE = 2048;
+        static const uint8_t  MAX_FRAMES = 32;
+
+        void Clear() { m_first = 0; m_count = 0; m_used = 0; m_writeOff = 0; }
+
+        // 保存一帧（超过 STORE_SIZE 的帧不保存）
+        void Store(uint16_t seq, const uint8_t* data, uint16_t len);
+
+        // 按序号取回一帧，拷贝到 out（需 >= 帧长），返回帧长；已淘汰返回 0
+        uint16_t Fetch(uint16_t seq, uint8_t* out, uint16_t out_max) const;
+        uint16_t FrameLen(uint16_t seq) const;
+
+        bool     Empty() const     { return m_count == 0; }
+        uint16_t OldestSeq() const { return m_entries[m_first].seq; }
+        uint16_t NewestSeq() const { return m_entries[(m_first + m_count - 1) % MAX_FRAMES].seq; }
+
+    private:
+        struct Entry { uint16_t seq; uint16_t off; uint16_t len; };
+
+        std::array<uint8_t, STORE_SIZE> m_store{};
+        std::array<Entry, MAX_FRAMES> m_entries{};
+        uint8_t  m_first = 0;
+        uint8_t  m_count = 0;
+        uint16_t m_used = 0;
+        uint16_t m_writeOff = 0;
+
+        int16_t Find(uint16_t seq) const;
+        void DropOldest();
+    };
+
+    // 记录字段（STREAM FIELDS=...），按位组成字段掩码，顺序即记录内字段顺序
+    //   MS   时间戳              CH0..CH2 原始 12bit 码      I0..I2 电流（nA，有符号）
+    //   CODE DAC 码              GAIN 所选通道的增益（常量）  MIN/MAX 抽取窗口内所选通道的最小/最大原始码
+    //   US   微秒时间戳（JSON 为完整 64 位值；BIN 为低 32 位，主机按单调性展开）
+    // GAIN/MIN/MAX 作用于 CHx 或 Ix 被选中的通道
+    enum class Field : uint8_t { MS = 0, CH0, CH1, CH2, I0, I1, I2, CODE, GAIN, MIN, MAX, US, END };
+
+    inline constexpr uint16_t FieldBit(Field f) { return static_cast<uint16_t>(1u << static_cast<uint8_t>(f)); }
+
+    // 与旧上位机一致的默认字段：Ms, Uric, Ascorbic, Glucose, Code12
+    const uint16_t FIELDS_LEGACY = FieldBit(Field::MS) | FieldBit(Field::CH0) | FieldBit(Field::CH1) |
+                                   FieldBit(Field::CH2) | FieldBit(Field::CODE);
+
+    // 换算电流所需的通道信息（START 时从 ADC 配置取一次）
+    struct ChannelInfo {
+        uint16_t ref = 0;                   // 参考电压对应的 ADC 码
+        uint32_t gain[3] = {1, 1, 1};       // 跨阻（Ω）
+    };
+
+    // 遥测编码器：主循环按样本 Push，按当前协议组帧写入 USART 的 TX 环形缓冲
+    // START 时按字段掩码生成“字段计划”（op 列表，电流换算系数预先算好），
+    // 之后每条记录只是按计划逐项取值的短循环。
+    // 每个数据帧带 16 位序号（JSON 为 "Seq" 字段），发出的同时存入重传窗口；
+    // 即使本地 TX 缓冲满整帧丢弃，序号照常递增，主机可按缺口 NACK 找回。
+    //
+    // 二进制样本帧（COBS 之前，小端）：
+    //   [0]     type = FRAME_SAMPLES
+    //   [1]     flags（bit0: 1=DELTA 编码）
+    //   [2..3]  帧序号 seq
+    //   [4]     N 记录数
+    //   [5..6]  字段掩码（Field 位）
+    //   [7..10] 基准时间戳 ms（第一条记录）
+    //   FIXED：按字段顺序 LSB-first 位流，MS 为相对基准的 u16，原始码/CODE/MIN/MAX 各 12bit，
+    //          电流 i32、GAIN u32；帧尾补齐到整字节
+    //          （默认字段下与原 8 字节/样本的打包格式完全相同）
+    //   DELTA：MS 为相对上一记录的 varint，其余字段为相对上一记录差值的 zigzag varint
+    //          （帧内第一条记录：MS 相对帧头基准时间戳，即 0；其余字段相对 0，即绝对值）
+    //   末尾 CRC16（u16）
+    //
+    // 二进制事件帧：[0] type = FRAME_EVENT  [1] kind  [2..3] seq  [4..5] id  [6..9] ms  [10..11] code  + CRC16
+    // JSON 事件行：{"Seq":n,"Evt":"SWAP","Id":k,"Ms":t,"Us":u,"Code12":c}
+    class TelemetryEncoder {
+    public:
+        static const uint8_t  FRAME_SAMPLES = 0x01;
+        static const uint8_t  FRAME_EVENT   = 0x02;
+        static const uint8_t  FLAG_DELTA    = 0x01;
+        static const uint8_t  MAX_BATCH     = 16;
+
+        TelemetryEncoder() = default;
+
+        void SetFormat(Format fmt);
+        void SetEncoding(Encoding enc);
+        // 批量大小 1..MAX_BATCH，超出范围自动钳位
+        void SetBatch(uint8_t n);
+
+        Format   GetFormat() const   { return m_format; }
+        Encoding GetEncoding() const { return m_encoding; }
+        uint8_t  GetBatch() const    { return m_batch; }
+
+        // 字段掩码与抽取倍数：下一次 BuildPlan 时生效
+        bool     SetFields(uint16_t mask);
+        void     SetDecim(uint8_t n) { m_decimCfg = n ? n : 1; }
+        uint16_t GetFields() const   { return m_fieldsCfg; }
+        uint8_t  GetDecim() const    { return m_decimCfg; }
+        uint16_t GetActiveFields() const { return m_fields; }
+
+        // 生成字段计划（START 时调用）
+        void BuildPlan(const ChannelInfo& info);
+
+        // 压入一组样本：满一个抽取窗口产生一条记录；JSON 每条记录一行，BIN 攒满 N 条后发送一帧
+        void Push(USART_Controller& usart, const Sample& s);
+
+        // 把未满的批次立即发出（STOP 或切换协议时调用）
+        void Flush(USART_Controller& usart);
+
+        // 插入一个事件：先发出未满的批次，保证事件与样本在流中的先后与时间轴一致
+        void PushEvent(USART_Controller& usart, const Event& ev);
+
+        // 丢弃未发送的批次并从序号 0 重新开始（重新 START 时调用，避免跨次实验的帧混在一起）
+        void Reset();
+
+        // 重传：登记 [from, to] 区间（含两端），由 ServiceResend 在 TX 有余量时逐帧回放，
+        // 不阻塞采样。区间内已淘汰的帧跳过并计入 missing。返回 false 表示整段都不在窗口内。
+        bool RequestResend(uint16_t from, uint16_t to);
+        void ServiceResend(USART_Controller& usart);
+        bool IsResendPending() const { return m_resendActive; }
+
+        uint16_t GetNextSeq() const { return m_seq; }
+        const RetransmitRing& GetRing() const { return m_ring; }
+
+        // 统计：成功写入 TX 缓冲的帧数 / 因 TX 缓冲不足被整帧丢弃的帧数 / 重传帧数 / 请求时已淘汰的帧数
+        uint32_t GetFramesSent() const    { return m_framesSent; }
+        uint32_t GetFramesDropped() const { return m_framesDropped; }
+        uint32_t GetFramesResent() const  { return m_framesResent; }
+        uint32_t GetResendMissing() const { return m_resendMissing; }
+        void ClearStats() { m_framesSent = m_framesDropped = m_framesResent = m_resendMissing = 0; }
+
+        static const char* FormatToString(Format fmt)       { return (fmt == Format::BIN) ? "BIN" : "JSON"; }
+        static const char* EncodingToString(Encoding enc)   { return (enc == Encoding::DELTA) ? "DELTA" : "FIXED"; }
+
+        // 字段名 <-> 掩码："MS+CH0+I0"（分隔符 '+' 或 '|'；ALL 表示全部），未知字段返回 false
+        static bool ParseFields(const char* str, uint16_t* out_mask);
+        static void FieldsToString(uint16_t mask, char* out, uint16_t cap);
+
+    private:
+        static const uint16_t RAW_MAX = 256;
+        static const uint8_t  HEADER_LEN = 11;
+        static const uint8_t  MAX_OPS = 1 + 3 + 3 + 1 + 3 * 3 + 1;
+        // 一次最多登记的重传帧数，防止误请求占满链路
+        static const uint16_t MAX_RESEND_SPAN = RetransmitRing::MAX_FRAMES;
+
+        // 字段计划中的一项：取值方式 + 通道 + FIXED 位宽 + 预计算常量（电流系数 Q16 / 增益）
+        enum class OpKind : uint8_t { MS, RAW, CUR, CODE, CONST, MIN, MAX, US };
+        struct Op {
+            OpKind   kind;
+            uint8_t  ch;
+            uint8_t  bits;
+            int32_t  k;
+            const char* key;    // JSON 键名
+        };
+
+        Format   m_format   = Format::JSON;
+        Encoding m_encoding = Encoding::FIXED;
+        uint8_t  m_batch    = 8;
+
+        // 配置（命令写入）与生效中的计划（BuildPlan 生成）
+        uint16_t m_fieldsCfg = FIELDS_LEGACY;
+        uint8_t  m_decimCfg  = 1;
+        uint16_t m_fields    = FIELDS_LEGACY;
+        uint8_t  m_decim     = 1;
+        std::array<Op, MAX_OPS> m_ops{};
+        uint8_t  m_opCount   = 0;
+        uint16_t m_ref       = 0;
+        uint16_t m_maxRecordBytes = 0;
+
+        // 抽取窗口
+        uint8_t  m_decimCount = 0;
+        uint16_t m_winMin[3] = {0, 0, 0};
+        uint16_t m_winMax[3] = {0, 0, 0};
+        uint64_t m_recUs = 0;           // 当前记录的 64 位时间戳（JSON 的 US 字段完整输出）
+
+        // 当前帧（增量编码进 m_raw）
+        uint8_t  m_count = 0;
+        uint16_t m_rawLen = 0;
+        uint32_t m_baseMs = 0;
+        std::array<int32_t, MAX_OPS> m_prev{};
+        uint32_t m_bitAcc = 0;
+        uint8_t  m_bitCnt = 0;
+
+        uint16_t m_seq = 0;
+        RetransmitRing m_ring;
+
+        bool     m_resendActive = false;
+        uint16_t m_resendNext = 0;
+        uint16_t m_resendLast = 0;
+
+        uint32_t m_framesSent    = 0;
+        uint32_t m_framesDropped = 0;
+        uint32_t m_framesResent  = 0;
+        uint32_t m_resendMissing = 0;
+
+        std::array<uint8_t, RAW_MAX> m_raw{};
+        std::array<uint8_t, FrameCodec::CobsMaxLen(RAW_MAX) + 1> m_wire{};
+
+        void AddOp(OpKind kind, uint8_t ch, uint8_t bits, int32_t k, const char* key);
+        void MakeRecord(const Sample& s, int32_t* vals) const;
+        void SendJson(USART_Controller& usart, const int32_t* vals);
+        void AppendBin(USART_Controller& usart, const int32_t* vals);
+        void BeginFrame(uint32_t base_ms);
+        void FinishFrame(USART_Controller& usart);
+        void PutBits(uint32_t v, uint8_t bits);
+        // 发出一帧线上字节并存入重传窗口，序号 +1
+        void Emit(USART_Controller& usart, const uint8_t* data, uint16_t len);
+
+        static uint16_t PutVarint(uint8_t* p, uint32_t v);
+        static uint32_t ZigZag(int32_t v) { return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31); }
+    };
+
+    // 编码器不再是单例：每个输出端（NS_STREAM::StreamSink）各持有一个
+
+} // namespace NS_TLM
@@ -0,0 +1,97 @@
+#include "ThreadStats.h"
+#include "SysTickTimer.h"
+
+#ifdef USE_CMSIS_RTOS2
+#include "cmsis_os2.h"
+#endif
+
+namespace NS_THREAD
+{
+#ifdef USE_CMSIS_RTOS2
+
+    static const uint32_t WINDOW_US = 1000000u;
+
+    struct Slot {
+        const char*       name  = nullptr;
+        osThreadId_t      id    = nullptr;
+        uint32_t          busyStartUs = 0;
+        volatile uint32_t busyTotalUs = 0;      // 只由本线程写
+        volatile uint32_t runs        = 0;      // 只由本线程写
+        // 以下只由 Roll 写
+        uint32_t          lastBusyUs  = 0;
+        uint32_t          lastRuns    = 0;
+        uint16_t          loadPermille = 0;
+        uint32_t          wakeups      = 0;
+    };
+
+    static Slot     s_slots[MAX_THREADS];
+    static uint8_t  s_count = 0;
+    static uint32_t s_winStartUs = 0;
+
+    uint8_t Register(const char* name, void* thread_id) {
+        if (s_count >= MAX_THREADS || thread_id == nullptr) return MAX_THREADS;
+        Slot& s = s_slots[s_count];
+        s.name = name;
+        s.id   = static_cast<osThreadId_t>(thread_id);
+        return s_count++;
+    }
+
+    void BeginBusy(uint8_t slot) {
+        if (slot >= s_count) return;
+        s_slots[slot].busyStartUs = SysTickTimer::GetMicros();
+    }
+
+    void EndBusy(uint8_t slot) {
+        if (slot >= s_count) return;
+        Slot& s = s_slots[slot];
+        s.busyTotalUs = s.busyTotalUs + (SysTickTimer::GetMicros() - s.busyStartUs);
+        s.runs = s.runs + 1;
+    }
+
+    void Roll() {
+        const uint32_t now = SysTickTimer::GetMicros();
+        const uint32_t span = now - s_winStartUs;
+        if (span < WINDOW_US) return;
+        for (uint8_t i = 0; i < s_count; ++i) {
+            Slot& s = s_slots[i];
+            const uint32_t busy = s.busyTotalUs;
+            const uint32_t runs = s.runs;
+            uint32_t d = busy - s.lastBusyUs;
+            if (d > span) d = span;
+            s.loadPermille = static_cast<uint16_t>((uint64_t)d * 1000u / span);
+            s.wakeups      = runs - s.lastRuns;
+            s.lastBusyUs   = busy;
+            s.lastRuns     = runs;
+        }
+        s_winStartUs = now;
+    }
+
+    uint8_t GetCount() {
+        return s_count;
+    }
+
+    bool GetInfo(uint8_t slot, Info* out) {
+        if (slot >= s_count || out == nullptr) return false;
+        const Slot& s = s_slots[slot];
+        out->name         = s.name;
+        out->priority     = static_cast<int32_t>(osThreadGetPriority(s.id));
+        out->stackSize    = osThreadGetStackSize(s.id);
+        const uint32_t space = osThreadGetStackSpace(s.id);   // 水印以上从未写过的字节
+        out->stackUsed    = (out->stackSize > space) ? (out->stackSize - space) : 0;
+        out->loadPermille = s.loadPermille;
+        out->wakeups      = s.wakeups;
+        return true;
+    }
+
+#else
+
+    uint8_t Register(const char*, void*) { return MAX_THREADS; }
+    void BeginBusy(uint8_t) {}
+    void EndBusy(uint8_t) {}
+    void Roll() {}
+    uint8_t GetCount() { return 0; }
+    bool GetInfo(uint8_t, Info*) { return false; }
+
+#endif // USE_CMSIS_RTOS2
+
+} // namespace NS_THREAD
@@ -0,0 +1,44 @@
+#pragma once
+#include <stdint.h>
+
+// 线程负载与栈水位统计（USE_CMSIS_RTOS2 构建）。
+// 各线程在一次处理前后调用 BeginBusy/EndBusy（墙钟时间，含被更高优先级线程/中断抢占的部分），
+// Roll 按 1s 窗口把累计忙时间折算成占比；栈水位来自 RTX 的栈水印（OS_STACK_WATERMARK=1）。
+// 裸机构建没有线程，GetCount 返回 0。
+namespace NS_THREAD
+{
+    static const uint8_t MAX_THREADS = 4;
+
+    struct Info {
+        const char* name;
+        int32_t     priority;       // osPriority_t
+        uint32_t    stackSize;      // 字节
+        uint32_t    stackUsed;      // 历史最高用量（字节）
+        uint16_t    loadPermille;   // 上一窗口忙时间占比（‰）
+        uint32_t    wakeups;        // 上一窗口处理次数
+    };
+
+    // 登记一个线程（创建后由创建者调用），返回槽号；满了返回 MAX_THREADS
+    uint8_t Register(const char* name, void* thread_id);
+
+    void BeginBusy(uint8_t slot);
+    void EndBusy(uint8_t slot);
+
+    // 窗口滚动：任一线程周期调用即可（各槽只读不写对方的计数）
+    void Roll();
+
+    uint8_t GetCount();
+    bool GetInfo(uint8_t slot, Info* out);
+
+    // 作用域内计为忙
+    class BusyScope {
+    public:
+        explicit BusyScope(uint8_t slot) : m_slot(slot) { BeginBusy(m_slot); }
+        ~BusyScope() { EndBusy(m_slot); }
+        BusyScope(const BusyScope&) = delete;
+        BusyScope& operator=(const BusyScope&) = delete;
+    private:
+        uint8_t m_slot;
+    };
+
+} // namespace NS_THREAD
@@ -20,6 +20,25 @@ namespace NS_DAC {
         stepVal = DacMath::STEP_PER_V * c.rate * c.duration;
         if (c.dir == ScanDIR::REVERSE) stepVal = -stepVal;
         if (stepVal == 0.0f) stepVal = (c.dir == ScanDIR::REVERSE) ? -1.0f : 1.0f;
+        startUp = (stepVal > 0.0f);
+        cycleDone = false;
+    }
+
+    void CV_Controller::Retune(const CV_VoltParams& v, const CV_Params& c) {
+        const bool goingUp = (stepVal > 0.0f);
+        cvParams = c;
+        cvParams.initVal = DacMath::VoltToCode(0.0f, v.voltOffset);
+
+        maxVal = DacMath::VoltToCode(v.highVolt, v.voltOffset);
+        minVal = DacMath::VoltToCode(v.lowVolt,  v.voltOffset);
+
+        float mag = std::fabs(DacMath::STEP_PER_V * c.rate * c.duration);
+        if (mag == 0.0f) mag = 1.0f;
+        stepVal = goingUp ? mag : -mag;
+
+        if (currentVal > maxVal) currentVal = (float)maxVal;
+        if (currentVal < minVal) currentVal = (float)minVal;
+        valBuf = (uint16_t)currentVal;
     }
 
     void CV_Controller::ResetToInit() {
@@ -35,11 +54,13 @@ namespace NS_DAC {
             if (currentVal >= maxVal) {
                 currentVal = (float)maxVal;
                 stepVal = -std::fabs(stepVal);
+                if (!startUp) cycleDone = true;
             }
         } else {
             if (currentVal <= minVal) {
                 currentVal = (float)minVal;
                 stepVal = std::fabs(stepVal);
+                if (startUp) cycleDone = true;
             }
         }
 
@@ -58,9 +79,28 @@ namespace NS_DAC {
         constantVal = val;
     }
 
+    void WaveDataManager::StageCV(const CV_VoltParams& v, const CV_Params& c, SwapAt at) {
+        stageKind = STAGE_NONE;         // 撤销尚未生效的暂存，中断此后不再读暂存区
+        stagedCvVolt = v;
+        stagedCv = c;
+        stageAt = at;
+        __DMB();
+        stageKind = STAGE_CV;
+    }
+
+    void WaveDataManager::StageDPV(const DPV_Params& p, SwapAt at) {
+        stageKind = STAGE_NONE;
+        stagedDpv = p;
+        stageAt = at;
+        __DMB();
+        stageKind = STAGE_DPV;
+    }
+
     void WaveDataManager::SwitchMode(GenMode mode) {
         currentMode = mode;
-        dpvSampleFlags = 0;
+        (void)dpvSampleFlags.Take();
+        stageKind = STAGE_NONE;
+        swapped = false;
 
         switch (mode) {
             case GenMode::CV_SCAN:
@@ -86,19 +126,33 @@ namespace NS_DAC {
         bool updated = false;
 
         switch (currentMode) {
-            case GenMode::CV_SCAN:
+            case GenMode::CV_SCAN: {
                 cvCtrl.UpdateCurrentVal();
+                const bool cycle = cvCtrl.ConsumeCycleDone();
+                if (stageKind == STAGE_CV && (stageAt == SwapAt::STEP || cycle)) {
+                    cvCtrl.Retune(stagedCvVolt, stagedCv);
+                    stageKind = STAGE_NONE;
+                    swapped = true;
+                }
                 unifiedValToSend = cvCtrl.GetValToSend();
                 updated = true;
                 break;
+            }
 
             case GenMode::DPV_PULSE: {
                 const bool changed = dpvCtrl.StepTick();
+                // DPV 为单次扫描：STEP/CYCLE 都在新阶梯开始时替换（扫描已结束则立即替换）
+                if (stageKind == STAGE_DPV && (dpvCtrl.ConsumeStepStarted() || !dpvCtrl.IsRunning())) {
+                    dpvCtrl.Retune(stagedDpv);
+                    stageKind = STAGE_NONE;
+                    swapped = true;
+                }
                 unifiedValToSend = dpvCtrl.GetCurrentCode();
                 updated = changed;
 
                 // 汇总采样标记（bit0/bit1）
-                dpvSampleFlags |= dpvCtrl.ConsumeSampleFlags();
+                const uint8_t marks = dpvCtrl.ConsumeSampleFlags();
+                if (marks) dpvSampleFlags.Set(marks);
                 break;
             }
 
@@ -1,6 +1,7 @@
 #pragma once
 #include "stm32f10x.h"
 #include "DPVController.h"
+#include "LockFree.h"
 #include <algorithm> // std::swap
 
 namespace NS_DAC {
@@ -8,6 +9,8 @@ namespace NS_DAC {
     // 运行模式
     enum class GenMode { IDLE, CV_SCAN, DPV_PULSE, CONSTANT };
     enum class ScanDIR : uint8_t { FORWARD, REVERSE };
+    // 运行中参数热切换的生效点：下一步（CV 每个定时周期 / DPV 每个新阶梯）或下一个完整周期
+    enum class SwapAt : uint8_t { STEP = 0, CYCLE = 1 };
 
     // CV 参数定义（相对电位 + 中点偏置 voltOffset）
     struct CV_VoltParams {
@@ -37,6 +40,10 @@ namespace NS_DAC {
         float stepVal = 0.0f;
         uint16_t maxVal=4095, minVal=0;
 
+        // 起始方向；扫描回到起始方向的那个顶点即一个完整周期结束
+        bool startUp = true;
+        bool cycleDone = false;
+
         // ADCManager 需要地址稳定的缓存
         volatile uint16_t valBuf = 2048;
 
@@ -47,6 +54,16 @@ namespace NS_DAC {
         void ResetToInit();
         void UpdateCurrentVal();
 
+        // 运行中换参：保留当前码值与扫描方向，只替换上下限与步长（当前值越界时钳到新边界）
+        void Retune(const CV_VoltParams& v, const CV_Params& c);
+
+        // 本步是否完成了一个周期（读后清零，中断上下文）
+        bool ConsumeCycleDone() {
+            const bool f = cycleDone;
+            cycleDone = false;
+            return f;
+        }
+
         uint16_t GetValToSend() const { return (uint16_t)valBuf; }
 
         // 兼容 ADCManager 的接口
@@ -63,7 +80,7 @@ namespace NS_DAC {
         volatile uint16_t unifiedValToSend = 2048;
 
         // DPV 采样标记（bit0=I1, bit1=I2），由主循环读取后清零
-        volatile uint8_t dpvSampleFlags = 0;
+        NS_LF::AtomicFlags<uint8_t> dpvSampleFlags;     // TIM2 中断置位，主循环 Take
 
         // 子控制器
         CV_Controller cvCtrl;
@@ -72,12 +89,41 @@ namespace NS_DAC {
         // 常量输出
         uint16_t constantVal = 2048;
 
+        // 热切换暂存区：主循环先清 stageKind 再写参数、最后置 stageKind；
+        // 中断只在 stageKind != 0 时读取，且中断总是完整执行，因此读到的一定是完整的一组参数
+        enum : uint8_t { STAGE_NONE = 0, STAGE_CV = 1, STAGE_DPV = 2 };
+        volatile uint8_t stageKind = STAGE_NONE;
+        SwapAt stageAt = SwapAt::STEP;
+        CV_VoltParams stagedCvVolt;
+        CV_Params stagedCv;
+        DPV_Params stagedDpv{};
+        bool swapped = false;       // 中断内：本步发生了替换
+
     public:
         void SetupCV(const CV_VoltParams& v, const CV_Params& c);
         void SetupDPV(const DPV_Params& p);
         void SetupConstant(uint16_t val);
 
         void SwitchMode(GenMode mode);
+
+        // 运行中暂存新参数，由 UpdateNextStep 在 at 指定的边界原子替换
+        void StageCV(const CV_VoltParams& v, const CV_Params& c, SwapAt at);
+        void StageDPV(const DPV_Params& p, SwapAt at);
+        void CancelStage() { stageKind = STAGE_NONE; }
+        bool IsStagePending() const { return stageKind != STAGE_NONE; }
+
+        // 常量模式下立即改值（不经定时器），返回新值
+        void SetConstantNow(uint16_t val) {
+            constantVal = val;
+            if (currentMode == GenMode::CONSTANT) unifiedValToSend = val;
+        }
+
+        // 本步是否发生了参数替换（读后清零，中断上下文）
+        bool ConsumeSwapped() {
+            const bool f = swapped;
+            swapped = false;
+            return f;
+        }
         GenMode GetMode() const { return currentMode; }
 
         // 核心更新函数（由定时器中断调用）
@@ -89,11 +135,7 @@ namespace NS_DAC {
         uint16_t GetCurrentData() const { return unifiedValToSend; }
 
         // DPV 采样标记读取（读后清零）
-        uint8_t ConsumeDpvSampleFlags() {
-            uint8_t f = dpvSampleFlags;
-            dpvSampleFlags = 0;
-            return f;
-        }
+        uint8_t ConsumeDpvSampleFlags() { return dpvSampleFlags.Take(); }
 
         // 获取子控制器
         CV_Controller& GetCV() { return cvCtrl; }
@@ -0,0 +1,250 @@
+#include "stm32f10x.h"                  // Device header
+#include "Key.h"
+#include "IRQnManage.h"
+#include "LockFree.h"
+#include "EventFlags.h"
+
+/*
+ * 非阻塞按键：下降沿 EXTI 只屏蔽本线并启动 TIM6（5ms 节拍），消抖、长按与连发都在节拍中断里
+ * 按状态机判断，事件放进无锁队列并 Post(NS_EVT::KEY)，由主循环（RTOS：命令线程）取走。
+ *   IDLE ──下降沿──> PRESS_DEBOUNCE ──稳定 20ms──> HELD ──松开──> RELEASE_DEBOUNCE ──稳定 20ms──> IDLE
+ * 回到 IDLE 时清挂起位并重新打开 EXTI；所有按键都空闲后 TIM6 停止，平时没有任何周期中断。
+ * EXTI 与 TIM6 同一抢占优先级，二者互不打断，启停定时器不会交错。
+ */
+
+#define KEY_PORT		GPIOB
+#define KEY_PORT_SOURCE	GPIO_PortSourceGPIOB
+#define KEY_TIM			TIM6
+
+static const uint32_t KEY_TICK_MS     = 5;
+static const uint16_t DEBOUNCE_TICKS  = 20 / KEY_TICK_MS;
+static const uint16_t LONG_TICKS      = 600 / KEY_TICK_MS;
+static const uint16_t REPEAT_TICKS    = 150 / KEY_TICK_MS;
+
+enum KeyState : uint8_t { KS_IDLE = 0, KS_PRESS_DEBOUNCE, KS_HELD, KS_RELEASE_DEBOUNCE };
+
+typedef struct {
+	uint16_t Pin;
+	uint8_t  Line;
+	volatile uint8_t State;
+	uint8_t  Deb;			//消抖计数
+	uint8_t  LongSent;		//本次按下已产生长按
+	uint16_t Held;			//按住计数（长按 / 连发）
+} KeyCtx;
+
+static KeyCtx s_keys[KEY_COUNT] = {
+	{KEY1_PIN, 0, KS_IDLE, 0, 0, 0},
+	{KEY2_PIN, 0, KS_IDLE, 0, 0, 0},
+};
+
+static NS_LF::SpscRing<KeyEvent, 8> s_events;
+static volatile uint32_t s_dropped = 0;
+static volatile uint8_t  s_timerOn = 0;
+
+static uint8_t PinToLine(uint16_t Pin)
+{
+	return (uint8_t)(31u - __CLZ(Pin));
+}
+
+static uint8_t Key_IsDown(const KeyCtx& k)
+{
+	return (KEY_PORT->IDR & k.Pin) == 0;
+}
+
+static void Key_Emit(uint8_t Index, uint8_t Action)
+{
+	KeyEvent e;
+	e.Key = (uint8_t)(Index + 1);
+	e.Action = Action;
+	if (!s_events.Push(e))
+	{
+		++s_dropped;		//主循环长时间没取，丢新的
+		return;
+	}
+	NS_EVT::Post(NS_EVT::KEY);
+}
+
+static void Key_StartTimer(void)
+{
+	if (s_timerOn) return;
+	s_timerOn = 1;
+	TIM_SetCounter(KEY_TIM, 0);
+	TIM_ClearITPendingBit(KEY_TIM, TIM_IT_Update);
+	TIM_Cmd(KEY_TIM, ENABLE);
+}
+
+/*进入按下消抖：屏蔽本线，抖动期间不再进 EXTI*/
+static void Key_BeginPress(KeyCtx& k)
+{
+	EXTI->IMR &= ~(1u << k.Line);
+	k.State = KS_PRESS_DEBOUNCE;
+	k.Deb = 0;
+	k.Held = 0;
+	k.LongSent = 0;
+	Key_StartTimer();
+}
+
+/*回到空闲：清掉抖动留下的挂起位再打开 EXTI；若此时已经按下（不会再有下降沿）直接开始消抖*/
+static void Key_Rearm(KeyCtx& k)
+{
+	const uint32_t bit = 1u << k.Line;
+	k.State = KS_IDLE;
+	EXTI->PR = bit;
+	EXTI->IMR |= bit;
+	if (Key_IsDown(k)) Key_BeginPress(k);
+}
+
+static void Key_OnEdge(uint8_t Index)
+{
+	KeyCtx& k = s_keys[Index];
+	if (k.State == KS_IDLE) Key_BeginPress(k);
+}
+
+static void Key1_ExtiCallback(void) { Key_OnEdge(0); }
+static void Key2_ExtiCallback(void) { Key_OnEdge(1); }
+
+/**
+  * @brief  5ms 节拍：推进各按键状态机，全部空闲后停止定时器
+  * @param  无
+  * @retval 无
+  */
+static void Key_TimCallback(void)
+{
+	uint8_t busy = 0;
+	for (uint8_t i = 0; i < KEY_COUNT; i++)
+	{
+		KeyCtx& k = s_keys[i];
+		const uint8_t down = Key_IsDown(k);
+		switch (k.State)
+		{
+		case KS_PRESS_DEBOUNCE:
+			if (!down)
+			{
+				Key_Rearm(k);							//毛刺
+			}
+			else if (++k.Deb >= DEBOUNCE_TICKS)
+			{
+				k.State = KS_HELD;
+			}
+			break;
+		case KS_HELD:
+			if (!down)
+			{
+				k.State = KS_RELEASE_DEBOUNCE;
+				k.Deb = 0;
+				break;
+			}
+			++k.Held;
+			if (!k.LongSent && k.Held >= LONG_TICKS)
+			{
+				k.LongSent = 1;
+				k.Held = 0;
+				Key_Emit(i, KEY_LONG);
+			}
+			else if (k.LongSent && k.Held >= REPEAT_TICKS)
+			{
+				k.Held = 0;
+				Key_Emit(i, KEY_REPEAT);
+			}
+			break;
+		case KS_RELEASE_DEBOUNCE:
+			if (down)
+			{
+				k.State = KS_HELD;						//松手抖动，按住计数接着算
+			}
+			else if (++k.Deb >= DEBOUNCE_TICKS)
+			{
+				if (!k.LongSent) Key_Emit(i, KEY_SHORT);
+				Key_Rearm(k);
+			}
+			break;
+		default:
+			break;
+		}
+		if (k.State != KS_IDLE) busy = 1;
+	}
+	if (!busy)
+	{
+		TIM_Cmd(KEY_TIM, DISABLE);
+		s_timerOn = 0;
+	}
+}
+
+/**
+  * 函    数：按键初始化（上拉输入 + 下降沿 EXTI + TIM6 消抖节拍，定时器平时停止）
+  * 参    数：无
+  * 返 回 值：无
+  */
+void Key_Init(void)
+{
+	/*开启时钟*/
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOB | RCC_APB2Periph_AFIO, ENABLE);
+
+	/*GPIO初始化*/
+	GPIO_InitTypeDef GPIO_InitStructure;
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_IPU;
+	GPIO_InitStructure.GPIO_Pin = KEY1_PIN | KEY2_PIN;
+	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_Init(KEY_PORT, &GPIO_InitStructure);					//按键引脚初始化为上拉输入
+
+	/*消抖节拍*/
+	TIM::InitTIM(KEY_TIM, KEY_TICK_MS / 1000.0f);
+	TIM::TIM_ITConfig(KEY_TIM, TIM::IT::UP, ENABLE);
+	(void)TIM_IRQnManage::Add(KEY_TIM, TIM::IT::UP, Key_TimCallback, 2, 3, ENABLE);
+
+	/*下降沿 EXTI*/
+	void (* const callbacks[KEY_COUNT])(void) = { Key1_ExtiCallback, Key2_ExtiCallback };
+	for (uint8_t i = 0; i < KEY_COUNT; i++)
+	{
+		KeyCtx& k = s_keys[i];
+		k.Line = PinToLine(k.Pin);
+		const uint32_t bit = 1u << k.Line;
+		GPIO_EXTILineConfig(KEY_PORT_SOURCE, k.Line);
+		EXTI->IMR  &= ~bit;
+		EXTI->EMR  &= ~bit;
+		EXTI->RTSR &= ~bit;
+		EXTI->FTSR |= bit;
+		(void)EXTI_IRQnManage::Add(k.Line, callbacks[i], 2, 2);
+		Key_Rearm(k);
+	}
+}
+
+/**
+  * 函    数：取一个按键事件（主循环 / 命令线程，单消费者）
+  * 参    数：Event 输出
+  * 返 回 值：1 取到，0 没有事件
+  */
+uint8_t Key_GetEvent(KeyEvent* Event)
+{
+	return Event && s_events.Pop(*Event) ? 1 : 0;
+}
+
+/**
+  * 函    数：按键获取键码（兼容旧接口，不再阻塞）
+  * 参    数：无
+  * 返 回 值：短按的键码 1~2；0 代表没有短按（长按 / 连发事件也会被取走丢弃，不要与 Key_GetEvent 混用）
+  */
+uint8_t Key_GetNum(void)
+{
+	KeyEvent e;
+	while (s_events.Pop(e))
+	{
+		if (e.Action == KEY_SHORT) return e.Key;
+	}
+	return 0;
+}
+
+/**
+  * 函    数：是否有按键正在消抖 / 按住，或有事件未取走（CGM 进 Stop 前检查）
+  * 参    数：无
+  * 返 回 值：1 忙，0 空闲
+  */
+uint8_t Key_IsActive(void)
+{
+	return (s_timerOn || !s_events.Empty()) ? 1 : 0;
+}
+
+uint32_t Key_GetDropped(void)
+{
+	return s_dropped;
+}
@@ -1,12 +1,34 @@
 #ifndef __KEY_H
 #define __KEY_H
+#include <stdint.h>
 
 #ifdef __cplusplus
  extern "C" {
 #endif 
 
+/*按键引脚（GPIOB，按下接地）；KEY2 原在 PB11，与蓝牙 USART3 RX 冲突，移到 PB12*/
+#ifndef KEY1_PIN
+#define KEY1_PIN	GPIO_Pin_1
+#endif
+#ifndef KEY2_PIN
+#define KEY2_PIN	GPIO_Pin_12
+#endif
+
+#define KEY_COUNT	2
+
+/*按键事件：短按在松手时产生（已产生长按则不再产生），按住 600ms 产生长按，之后每 150ms 产生连发*/
+enum KeyAction { KEY_NONE = 0, KEY_SHORT, KEY_LONG, KEY_REPEAT };
+
+typedef struct {
+	uint8_t Key;		//1~KEY_COUNT
+	uint8_t Action;		//KeyAction
+} KeyEvent;
+
 void Key_Init(void);
+uint8_t Key_GetEvent(KeyEvent* Event);
 uint8_t Key_GetNum(void);
+uint8_t Key_IsActive(void);
+uint32_t Key_GetDropped(void);
      
      
 #ifdef __cplusplus
@@ -0,0 +1,547 @@
+#include "stm32f10x.h"
+#include "OLED.h"
+#include "OLED_Font.h"
+#include "IRQnManage.h"
+#include "LockFree.h"
+#include "SysTickTimer.h"
+#include <string.h>
+
+/*
+ * 显存 + 硬件 I2C1（重映射到 PB8/PB9，400kHz）+ DMA1 通道 6 后台刷新。
+ * OLED_ShowXxx 只改 RAM 显存并标记脏页（一个字符拷 16 字节）；OLED_Flush 把第一个到最后一个
+ * 脏页之间的区间作为一次 I2C 传输交给 DMA 后立即返回：
+ *   START → SB 中断发地址 → ADDR 中断启动 DMA 发命令头（列 0~127、页 p0~p1，水平寻址）
+ *   → DMA 完成中断换到显存段 → DMA 完成中断等 BTF → BTF 中断发 STOP
+ * 整屏 1037 字节约 23ms 总线时间，CPU 只在上面几个节点进中断。
+ */
+
+#define OLED_ADDR		0x78		//从机地址（写）
+#define OLED_PAGES		8
+#define OLED_WIDTH		128
+
+#define OLED_I2C		I2C1
+#define OLED_DMA		DMA1_Channel6	//I2C1_TX 的 DMA 请求由硬件固定在 DMA1 通道 6
+
+static_assert(DMA::ClaimOf(DMA::User::OLED_TX) == DMA::ChanIndex::D1CH6,
+              "OLED: I2C1 TX DMA channel is not registered in DMA::kClaims");
+
+/*显存：按 SSD1306 的页排布，第 p 页第 x 列的字节在 s_fb[p * 128 + x]，低位在上*/
+static uint8_t s_fb[OLED_PAGES * OLED_WIDTH];
+static NS_LF::AtomicFlags<uint8_t> s_dirty;
+
+/*命令头：Co=1 时每个命令字节前带一个控制字节 0x80，最后 0x40 之后全是显存数据*/
+static uint8_t s_hdr[] = {
+	0x80, 0x21, 0x80, 0x00, 0x80, OLED_WIDTH - 1,	//列地址 0~127
+	0x80, 0x22, 0x80, 0x00, 0x80, OLED_PAGES - 1,	//页地址 p0~p1（发送前填写）
+	0x40,
+};
+static const uint8_t HDR_P0 = 9, HDR_P1 = 11;
+
+enum OledState : uint8_t { OLED_IDLE = 0, OLED_ADDRESSING, OLED_SEG1, OLED_SEG2, OLED_WAIT_BTF };
+
+static volatile uint8_t  s_state = OLED_IDLE;
+static const uint8_t*    s_seg2 = nullptr;
+static uint16_t          s_seg2Len = 0;
+static uint8_t           s_inflight = 0;	//正在发送的页（出错时重新标脏）
+static uint32_t          s_startTick = 0;
+static uint32_t          s_retryTick = 0;
+static volatile uint8_t  s_failed = 0;
+static volatile uint32_t s_frames = 0;
+static volatile uint32_t s_errors = 0;
+
+static const uint32_t OLED_TIMEOUT_MS = 100;	//整屏约 23ms
+static const uint32_t OLED_RETRY_MS   = 1000;	//NACK（未接屏）后重试间隔
+
+/**
+  * @brief  I2C1 外设初始化（引脚重映射到 PB8/PB9，开漏复用）
+  * @param  无
+  * @retval 无
+  */
+static void OLED_I2C_Init(void)
+{
+	RCC_APB2PeriphClockCmd(RCC_APB2Periph_GPIOB | RCC_APB2Periph_AFIO, ENABLE);
+	RCC_APB1PeriphClockCmd(RCC_APB1Periph_I2C1, ENABLE);
+	GPIO_PinRemapConfig(GPIO_Remap_I2C1, ENABLE);
+
+	GPIO_InitTypeDef GPIO_InitStructure;
+	GPIO_InitStructure.GPIO_Mode = GPIO_Mode_AF_OD;
+	GPIO_InitStructure.GPIO_Speed = GPIO_Speed_50MHz;
+	GPIO_InitStructure.GPIO_Pin = GPIO_Pin_8 | GPIO_Pin_9;
+	GPIO_Init(GPIOB, &GPIO_InitStructure);
+
+	//软件复位：上电时总线上有毛刺，BUSY 可能被锁住（勘误 2.13.7）
+	I2C_SoftwareResetCmd(OLED_I2C, ENABLE);
+	I2C_SoftwareResetCmd(OLED_I2C, DISABLE);
+
+	I2C_InitTypeDef I2C_InitStructure;
+	I2C_InitStructure.I2C_Mode = I2C_Mode_I2C;
+	I2C_InitStructure.I2C_DutyCycle = I2C_DutyCycle_2;
+	I2C_InitStructure.I2C_OwnAddress1 = 0x00;
+	I2C_InitStructure.I2C_Ack = I2C_Ack_Disable;
+	I2C_InitStructure.I2C_AcknowledgedAddress = I2C_AcknowledgedAddress_7bit;
+	I2C_InitStructure.I2C_ClockSpeed = 400000;
+	I2C_Init(OLED_I2C, &I2C_InitStructure);
+	I2C_Cmd(OLED_I2C, ENABLE);
+}
+
+/**
+  * @brief  DMA1 通道 6 初始化：内存 → I2C1->DR，每段发送前重设地址与长度
+  * @param  无
+  * @retval 无
+  */
+static void OLED_DMA_Init(void)
+{
+	RCC_AHBPeriphClockCmd(RCC_AHBPeriph_DMA1, ENABLE);
+
+	DMA_DeInit(OLED_DMA);
+	DMA_InitTypeDef dma;
+	dma.DMA_PeripheralBaseAddr = (uint32_t)&(OLED_I2C->DR);
+	dma.DMA_MemoryBaseAddr     = (uint32_t)s_hdr;
+	dma.DMA_DIR                = DMA_DIR_PeripheralDST;
+	dma.DMA_BufferSize         = 1;
+	dma.DMA_PeripheralInc      = DMA_PeripheralInc_Disable;
+	dma.DMA_MemoryInc          = DMA_MemoryInc_Enable;
+	dma.DMA_PeripheralDataSize = DMA_PeripheralDataSize_Byte;
+	dma.DMA_MemoryDataSize     = DMA_MemoryDataSize_Byte;
+	dma.DMA_Mode               = DMA_Mode_Normal;
+	dma.DMA_Priority           = DMA_Priority_Low;
+	dma.DMA_M2M                = DMA_M2M_Disable;
+	DMA_Init(OLED_DMA, &dma);
+	DMA_ITConfig(OLED_DMA, DMA_IT_TC, ENABLE);
+}
+
+static void OLED_LoadSegment(const uint8_t* data, uint16_t len)
+{
+	OLED_DMA->CCR &= ~(uint32_t)DMA_CCR1_EN;
+	OLED_DMA->CMAR = (uint32_t)data;
+	OLED_DMA->CNDTR = len;
+	OLED_DMA->CCR |= DMA_CCR1_EN;
+}
+
+/**
+  * @brief  放弃当前传输：关 DMA 与 I2C 中断，发 STOP，本次的页重新标脏
+  * @retval 无
+  */
+static void OLED_Abort(void)
+{
+	OLED_DMA->CCR &= ~(uint32_t)DMA_CCR1_EN;
+	OLED_I2C->CR2 &= (uint16_t)~(I2C_CR2_DMAEN | I2C_CR2_ITEVTEN | I2C_CR2_ITERREN);
+	if (OLED_I2C->SR2 & I2C_SR2_MSL) OLED_I2C->CR1 |= I2C_CR1_STOP;
+	s_dirty.Set(s_inflight);
+	s_inflight = 0;
+	s_failed = 1;
+	s_errors = s_errors + 1;
+	s_state = OLED_IDLE;
+}
+
+/*DMA 传输完成（DMA_IRQnManage 已清除 TC 标志）*/
+static void OLED_DmaTcHandler(void)
+{
+	OLED_DMA->CCR &= ~(uint32_t)DMA_CCR1_EN;
+	if (s_state == OLED_SEG1 && s_seg2Len != 0)
+	{
+		//I2C 在 DR 空时拉低 SCL 等待，换段期间总线只是暂停
+		s_state = OLED_SEG2;
+		OLED_LoadSegment(s_seg2, s_seg2Len);
+		return;
+	}
+	//最后一个字节还在移位寄存器里：等 BTF 再发 STOP
+	OLED_I2C->CR2 &= (uint16_t)~I2C_CR2_DMAEN;
+	s_state = OLED_WAIT_BTF;
+	OLED_I2C->CR2 |= I2C_CR2_ITEVTEN;
+}
+
+extern "C" void I2C1_EV_IRQHandler(void)
+{
+	const uint16_t sr1 = OLED_I2C->SR1;
+	if (sr1 & I2C_SR1_SB)
+	{
+		OLED_I2C->DR = OLED_ADDR;				//读 SR1 + 写 DR 清除 SB
+	}
+	else if (sr1 & I2C_SR1_ADDR)
+	{
+		//数据阶段全部交给 DMA：关事件中断，免得 DMA 偶尔跟不上时 BTF 打断
+		OLED_I2C->CR2 = (uint16_t)((OLED_I2C->CR2 & ~I2C_CR2_ITEVTEN) | I2C_CR2_DMAEN);
+		s_state = OLED_SEG1;
+		OLED_DMA->CCR |= DMA_CCR1_EN;
+		(void)OLED_I2C->SR2;					//读 SR1 后读 SR2 清除 ADDR，总线开始发数据
+	}
+	else if (sr1 & I2C_SR1_BTF)
+	{
+		OLED_I2C->CR1 |= I2C_CR1_STOP;
+		OLED_I2C->CR2 &= (uint16_t)~(I2C_CR2_ITEVTEN | I2C_CR2_ITERREN);
+		s_inflight = 0;
+		s_frames = s_frames + 1;
+		s_state = OLED_IDLE;
+	}
+}
+
+extern "C" void I2C1_ER_IRQHandler(void)
+{
+	//AF：从机不应答（未接屏）；BERR/ARLO：总线干扰。写 0 清除
+	OLED_I2C->SR1 = (uint16_t)~(I2C_SR1_AF | I2C_SR1_BERR | I2C_SR1_ARLO | I2C_SR1_OVR);
+	OLED_Abort();
+}
+
+/**
+  * @brief  发起一次传输：seg1 先发，seg2（可为空）紧随其后，同一个 START/STOP 之内
+  * @retval 无
+  */
+static void OLED_Begin(const uint8_t* seg1, uint16_t len1, const uint8_t* seg2, uint16_t len2)
+{
+	OLED_DMA->CCR &= ~(uint32_t)DMA_CCR1_EN;
+	OLED_DMA->CMAR = (uint32_t)seg1;
+	OLED_DMA->CNDTR = len1;
+	s_seg2 = seg2;
+	s_seg2Len = len2;
+	s_startTick = SysTickTimer::GetTick();
+	s_state = OLED_ADDRESSING;
+	OLED_I2C->CR2 |= I2C_CR2_ITEVTEN | I2C_CR2_ITERREN;
+	OLED_I2C->CR1 |= I2C_CR1_START;
+}
+
+/**
+  * @brief  阻塞发送一组命令（仅初始化时使用），超时放弃
+  * @param  Cmds 第一个字节须为控制字节 0x00
+  * @retval 无
+  */
+static void OLED_WriteCommandsBlocking(const uint8_t* Cmds, uint16_t Length)
+{
+	OLED_Begin(Cmds, Length, nullptr, 0);
+	const uint32_t c0 = SysTickTimer::GetCycles();
+	const uint32_t limit = SystemCoreClock / 1000U * 20U;
+	while (s_state != OLED_IDLE)
+	{
+		if (SysTickTimer::GetCycles() - c0 > limit)
+		{
+			OLED_Abort();
+			break;
+		}
+	}
+}
+
+/**
+  * @brief  把脏页送出（后台 DMA，立即返回）。上一次还没发完时什么也不做，脏页留到下次
+  * @param  无
+  * @retval 无
+  */
+void OLED_Flush(void)
+{
+	const uint32_t now = SysTickTimer::GetTick();
+	if (s_state != OLED_IDLE)
+	{
+		//丢了中断或总线被拉死：复位外设，下次重发
+		if (now - s_startTick > OLED_TIMEOUT_MS)
+		{
+			__disable_irq();
+			OLED_Abort();
+			__enable_irq();
+			OLED_I2C_Init();
+			s_retryTick = now;
+		}
+		return;
+	}
+	if (s_failed)
+	{
+		if (now - s_retryTick < OLED_RETRY_MS) return;
+		s_failed = 0;
+	}
+	if (OLED_I2C->CR1 & I2C_CR1_STOP) return;		//上一次的 STOP 还没发出
+	if (OLED_I2C->SR2 & I2C_SR2_BUSY) return;
+
+	const uint8_t dirty = s_dirty.Take();
+	if (dirty == 0) return;
+
+	//连续区间：中间的干净页一起重发，换一次 START 与地址设置
+	const uint8_t p0 = (uint8_t)__CLZ(__RBIT(dirty));
+	const uint8_t p1 = (uint8_t)(31U - __CLZ(dirty));
+	s_inflight = (uint8_t)((0xFFU >> (7U - p1)) & (0xFFU << p0));
+	s_hdr[HDR_P0] = p0;
+	s_hdr[HDR_P1] = p1;
+	s_retryTick = now;
+	OLED_Begin(s_hdr, sizeof(s_hdr), &s_fb[p0 * OLED_WIDTH], (uint16_t)((p1 - p0 + 1) * OLED_WIDTH));
+}
+
+/**
+  * @brief  是否有传输正在进行（进 Stop 模式前确认）
+  * @retval 1 忙，0 空闲
+  */
+uint8_t OLED_IsBusy(void)
+{
+	return (s_state != OLED_IDLE || (OLED_I2C->CR1 & I2C_CR1_STOP)) ? 1 : 0;
+}
+
+/**
+  * @brief  还有未送出的脏页
+  * @retval 1 有，0 无
+  */
+uint8_t OLED_IsDirty(void)
+{
+	return s_dirty.Peek() != 0 ? 1 : 0;
+}
+
+/**
+  * @brief  传输统计：完成的帧数与出错次数
+  * @retval 无
+  */
+void OLED_GetStats(uint32_t* Frames, uint32_t* Errors)
+{
+	if (Frames) *Frames = s_frames;
+	if (Errors) *Errors = s_errors;
+}
+
+/**
+  * @brief  OLED清屏
+  * @param  无
+  * @retval 无
+  */
+void OLED_Clear(void)
+{
+	memset(s_fb, 0, sizeof(s_fb));
+	s_dirty.Set(0xFF);
+}
+
+/**
+  * @brief  点亮/熄灭一个像素
+  * @param  X 以左上角为原点，向右方向的坐标，范围：0~127
+  * @param  Y 以左上角为原点，向下方向的坐标，范围：0~63
+  * @param  On 1 点亮，0 熄灭
+  * @retval 无
+  */
+void OLED_DrawPixel(uint8_t X, uint8_t Y, uint8_t On)
+{
+	if (X >= OLED_WIDTH || Y >= OLED_PAGES * 8) return;
+	const uint8_t page = (uint8_t)(Y >> 3);
+	const uint8_t bit = (uint8_t)(1U << (Y & 7U));
+	uint8_t* p = &s_fb[page * OLED_WIDTH + X];
+	*p = On ? (uint8_t)(*p | bit) : (uint8_t)(*p & ~bit);
+	s_dirty.Set((uint8_t)(1U << page));
+}
+
+/**
+  * @brief  画线（Bresenham），端点都画
+  * @retval 无
+  */
+void OLED_DrawLine(uint8_t X0, uint8_t Y0, uint8_t X1, uint8_t Y1)
+{
+	int16_t x = X0, y = Y0;
+	const int16_t dx = (int16_t)(X1 > X0 ? X1 - X0 : X0 - X1);
+	const int16_t dy = (int16_t)-(Y1 > Y0 ? Y1 - Y0 : Y0 - Y1);
+	const int16_t sx = (X0 < X1) ? 1 : -1;
+	const int16_t sy = (Y0 < Y1) ? 1 : -1;
+	int16_t err = (int16_t)(dx + dy);
+	for (;;)
+	{
+		OLED_DrawPixel((uint8_t)x, (uint8_t)y, 1);
+		if (x == X1 && y == Y1) break;
+		const int16_t e2 = (int16_t)(2 * err);
+		if (e2 >= dy) { err = (int16_t)(err + dy); x = (int16_t)(x + sx); }
+		if (e2 <= dx) { err = (int16_t)(err + dx); y = (int16_t)(y + sy); }
+	}
+}
+
+/**
+  * @brief  清除一块区域（按页，高度为 8 的整数倍）
+  * @param  X 起始列，范围：0~127
+  * @param  Page 起始页，范围：0~7
+  * @param  Width 列数
+  * @param  Pages 页数
+  * @retval 无
+  */
+void OLED_ClearArea(uint8_t X, uint8_t Page, uint8_t Width, uint8_t Pages)
+{
+	if (X >= OLED_WIDTH || Page >= OLED_PAGES) return;
+	if (Width > OLED_WIDTH - X) Width = (uint8_t)(OLED_WIDTH - X);
+	if (Pages > OLED_PAGES - Page) Pages = (uint8_t)(OLED_PAGES - Page);
+	for (uint8_t p = Page; p < Page + Pages; p++)
+	{
+		memset(&s_fb[p * OLED_WIDTH + X], 0, Width);
+	}
+	s_dirty.Set((uint8_t)(((1U << Pages) - 1U) << Page));
+}
+
+/**
+  * @brief  OLED显示一个字符（写入显存）
+  * @param  Line 行位置，范围：1~4
+  * @param  Column 列位置，范围：1~16
+  * @param  Char 要显示的一个字符，范围：ASCII可见字符
+  * @retval 无
+  */
+void OLED_ShowChar(uint8_t Line, uint8_t Column, char Char)
+{
+	if (Line < 1 || Line > 4 || Column < 1 || Column > 16) return;
+	if (Char < ' ' || Char > '~') Char = ' ';
+	const uint8_t page = (uint8_t)((Line - 1) * 2);
+	uint8_t* upper = &s_fb[page * OLED_WIDTH + (Column - 1) * 8];
+	memcpy(upper, &OLED_F8x16[Char - ' '][0], 8);				//上半部分
+	memcpy(upper + OLED_WIDTH, &OLED_F8x16[Char - ' '][8], 8);	//下半部分
+	s_dirty.Set((uint8_t)(3U << page));
+}
+
+/**
+  * @brief  OLED显示字符串
+  * @param  Line 起始行位置，范围：1~4
+  * @param  Column 起始列位置，范围：1~16
+  * @param  String 要显示的字符串，范围：ASCII可见字符
+  * @retval 无
+  */
+void OLED_ShowString(uint8_t Line, uint8_t Column,const char *String)
+{
+	uint8_t i;
+	for (i = 0; String[i] != '\0'; i++)
+	{
+		OLED_ShowChar(Line, Column + i, String[i]);
+	}
+}
+
+/**
+  * @brief  OLED次方函数
+  * @retval 返回值等于X的Y次方
+  */
+uint32_t OLED_Pow(uint32_t X, uint32_t Y)
+{
+	uint32_t Result = 1;
+	while (Y--)
+	{
+		Result *= X;
+	}
+	return Result;
+}
+
+/**
+  * @brief  OLED显示数字（十进制，正数）
+  * @param  Line 起始行位置，范围：1~4
+  * @param  Column 起始列位置，范围：1~16
+  * @param  Number 要显示的数字，范围：0~4294967295
+  * @param  Length 要显示数字的长度，范围：1~10
+  * @retval 无
+  */
+void OLED_ShowNum(uint8_t Line, uint8_t Column, uint32_t Number, uint8_t Length)
+{
+	uint8_t i;
+	for (i = 0; i < Length; i++)							
+	{
+		OLED_ShowChar(Line, Column + i, Number / OLED_Pow(10, Length - i - 1) % 10 + '0');
+	}
+}
+
+/**
+  * @brief  OLED显示数字（十进制，带符号数）
+  * @param  Line 起始行位置，范围：1~4
+  * @param  Column 起始列位置，范围：1~16
+  * @param  Number 要显示的数字，范围：-2147483648~2147483647
+  * @param  Length 要显示数字的长度，范围：1~10
+  * @retval 无
+  */
+void OLED_ShowSignedNum(uint8_t Line, uint8_t Column, int32_t Number, uint8_t Length)
+{
+	uint8_t i;
+	uint32_t Number1;
+	if (Number >= 0)
+	{
+		OLED_ShowChar(Line, Column, '+');
+		Number1 = Number;
+	}
+	else
+	{
+		OLED_ShowChar(Line, Column, '-');
+		Number1 = -Number;
+	}
+	for (i = 0; i < Length; i++)							
+	{
+		OLED_ShowChar(Line, Column + i + 1, Number1 / OLED_Pow(10, Length - i - 1) % 10 + '0');
+	}
+}
+
+/**
+  * @brief  OLED显示数字（十六进制，正数）
+  * @param  Line 起始行位置，范围：1~4
+  * @param  Column 起始列位置，范围：1~16
+  * @param  Number 要显示的数字，范围：0~0xFFFFFFFF
+  * @param  Length 要显示数字的长度，范围：1~8
+  * @retval 无
+  */
+void OLED_ShowHexNum(uint8_t Line, uint8_t Column, uint32_t Number, uint8_t Length)
+{
+	uint8_t i, SingleNumber;
+	for (i = 0; i < Length; i++)							
+	{
+		SingleNumber = Number / OLED_Pow(16, Length - i - 1) % 16;
+		if (SingleNumber < 10)
+		{
+			OLED_ShowChar(Line, Column + i, SingleNumber + '0');
+		}
+		else
+		{
+			OLED_ShowChar(Line, Column + i, SingleNumber - 10 + 'A');
+		}
+	}
+}
+
+/**
+  * @brief  OLED显示数字（二进制，正数）
+  * @param  Line 起始行位置，范围：1~4
+  * @param  Column 起始列位置，范围：1~16
+  * @param  Number 要显示的数字，范围：0~1111 1111 1111 1111
+  * @param  Length 要显示数字的长度，范围：1~16
+  * @retval 无
+  */
+void OLED_ShowBinNum(uint8_t Line, uint8_t Column, uint32_t Number, uint8_t Length)
+{
+	uint8_t i;
+	for (i = 0; i < Length; i++)							
+	{
+		OLED_ShowChar(Line, Column + i, Number / OLED_Pow(2, Length - i - 1) % 2 + '0');
+	}
+}
+
+/**
+  * @brief  OLED初始化
+  * @param  无
+  * @retval 无
+  */
+void OLED_Init(void)
+{
+	static uint8_t InitFlag = 0;
+	if (InitFlag != 0) { return; }
+	InitFlag = 1;
+
+	uint32_t i, j;
+	
+	for (i = 0; i < 1000; i++)			//上电延时
+	{
+		for (j = 0; j < 1000; j++);
+	}
+	
+	OLED_I2C_Init();			//端口初始化
+	OLED_DMA_Init();
+
+	//事件/错误中断与 DMA 完成中断：最低优先级，刷屏可以等
+	MyNVIC::SetPriority(I2C1_EV_IRQn, 3, 3);
+	MyNVIC::SetPriority(I2C1_ER_IRQn, 3, 3);
+	(void)DMA_IRQnManage::Add(OLED_DMA, DMA::IT::TC, OLED_DmaTcHandler, 3, 3);
+
+	static const uint8_t InitCmds[] = {
+		0x00,			//控制字节：后面全是命令
+		0xAE,			//关闭显示
+		0xD5, 0x80,		//设置显示时钟分频比/振荡器频率
+		0xA8, 0x3F,		//设置多路复用率
+		0xD3, 0x00,		//设置显示偏移
+		0x40,			//设置显示开始行
+		0x20, 0x00,		//水平寻址：一次传输可以跨页连续写
+		0xA1,			//设置左右方向，0xA1正常 0xA0左右反置
+		0xC8,			//设置上下方向，0xC8正常 0xC0上下反置
+		0xDA, 0x12,		//设置COM引脚硬件配置
+		0x81, 0xCF,		//设置对比度控制
+		0xD9, 0xF1,		//设置预充电周期
+		0xDB, 0x30,		//设置VCOMH取消选择级别
+		0xA4,			//设置整个显示打开/关闭
+		0xA6,			//设置正常/倒转显示
+		0x8D, 0x14,		//设置充电泵
+		0xAF,			//开启显示
+	};
+	OLED_WriteCommandsBlocking(InitCmds, sizeof(InitCmds));
+
+	OLED_Clear();				//OLED清屏
+	OLED_Flush();
+}
@@ -1,6 +1,8 @@
 #ifndef __OLED_H
 #define __OLED_H
+#include <stdint.h>
 
+// ShowXxx 只写 RAM 显存并标记脏页；OLED_Flush 在后台（I2C1 + DMA）把脏页送到屏上，需要周期调用
 extern "C" {
     void OLED_Init(void);
     void OLED_Clear(void);
@@ -10,6 +12,16 @@ extern "C" {
     void OLED_ShowSignedNum(uint8_t Line, uint8_t Column, int32_t Number, uint8_t Length);
     void OLED_ShowHexNum(uint8_t Line, uint8_t Column, uint32_t Number, uint8_t Length);
     void OLED_ShowBinNum(uint8_t Line, uint8_t Column, uint32_t Number, uint8_t Length);
+
+    // 像素绘图：X 0~127 向右，Y 0~63 向下（第 1 行文字占 Y 0~15）
+    void OLED_DrawPixel(uint8_t X, uint8_t Y, uint8_t On);
+    void OLED_DrawLine(uint8_t X0, uint8_t Y0, uint8_t X1, uint8_t Y1);
+    void OLED_ClearArea(uint8_t X, uint8_t Page, uint8_t Width, uint8_t Pages);
+
+    void OLED_Flush(void);
+    uint8_t OLED_IsBusy(void);
+    uint8_t OLED_IsDirty(void);
+    void OLED_GetStats(uint32_t* Frames, uint32_t* Errors);
 }
 
 #endif
@@ -0,0 +1,15 @@
+/*
+ * RTE_Components.h for the RTX5 target (USE_CMSIS_RTOS2).
+ * The RTX sources include this file to find the device header.
+ */
+
+#ifndef RTE_COMPONENTS_H
+#define RTE_COMPONENTS_H
+
+#define CMSIS_device_header "stm32f10x.h"
+
+#define RTE_CMSIS_RTOS2                 /* CMSIS-RTOS2 */
+#define RTE_CMSIS_RTOS2_RTX5            /* CMSIS-RTOS2 Keil RTX5 */
+#define RTE_CMSIS_RTOS2_RTX5_SOURCE     /* CMSIS-RTOS2 Keil RTX5 Source */
+
+#endif /* RTE_COMPONENTS_H */
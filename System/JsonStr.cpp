@@ -1,4 +0,0 @@
-#include <JsonStr.h>
-
-
-
@@ -1,10 +1,18 @@
 #include "SysTickTimer.h"
 
+#ifdef USE_CMSIS_RTOS2
+// RTOS 构建：SysTick 归 RTX（osKernelStart 时按 OS_TICK_FREQ=1000 配置，SysTick_Handler 在 irq_armv7m.S），
+// 毫秒 tick 取内核计数；内核启动前用 DWT 折算
+#include "cmsis_os2.h"
+#endif
+
 // 1) 静态成员定义
 volatile uint32_t SysTickTimer::msTicks = 0;
+volatile uint32_t SysTickTimer::msTicksHi = 0;
 
 // 2) C++ 接口实现
 void SysTickTimer::Init() {
+#ifndef USE_CMSIS_RTOS2
     // SystemCoreClock 通常在 system_stm32f10x.c 中定义
     // 配置 SysTick 为 1ms 中断一次
     if (SysTick_Config(SystemCoreClock / 1000U)) {
@@ -12,13 +20,144 @@ void SysTickTimer::Init() {
         while (1) {
         }
     }
+#endif
+
+    // 开启 DWT 周期计数器，用于中断级延迟测量
+    CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk;
+    DWT->CYCCNT = 0;
+    DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;
+}
+
+#ifdef USE_CMSIS_RTOS2
+static bool KernelRunning() {
+    return osKernelGetState() == osKernelRunning || osKernelGetState() == osKernelLocked;
+}
+#endif
+
+#ifdef USE_CMSIS_RTOS2
+// 内核 tick 只有 32 位：在关中断的读取里检测回绕来扩展高位（任何上下文每 49 天内至少读一次即可，
+// 遥测与 EventFlags 的负载统计每秒都会读）
+static uint32_t s_kernelTickLast = 0;
+static uint32_t s_kernelTickHi = 0;
+
+// 内核启动前按 DWT 计时，内核节拍却从 0 开始：锁存内核启动时刻的 DWT 值作为偏移，之后的读数都加上它，
+// 跨 osKernelStart 单调不回退。main 在 osKernelStart 前调用 MarkKernelStart 锁存；漏调时由内核运行后的
+// 第一次读取补锁（同一次关中断里 DWT 减去内核已走的周期，若其间空闲线程 WFI 过，DWT 少计，偏移偏小）。
+// 要求内核在 Init 之后约 59s 内启动（DWT 32 位回绕）。µs/ms 偏移向上取整，保证不小于切换前的读数
+static volatile bool s_epochLatched = false;
+static uint32_t s_preKernelCycles = 0;
+static uint32_t s_preKernelUs = 0;
+static uint32_t s_preKernelMs = 0;
+
+static void LatchPreKernel(uint32_t cycles) {
+    const uint32_t perUs = SystemCoreClock / 1000000U;
+    const uint32_t perMs = SystemCoreClock / 1000U;
+    s_preKernelCycles = cycles;
+    s_preKernelUs = (cycles + perUs - 1U) / perUs;
+    s_preKernelMs = (cycles + perMs - 1U) / perMs;
+    s_epochLatched = true;
+}
+
+void SysTickTimer::MarkKernelStart() {
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (!s_epochLatched) LatchPreKernel(DWT->CYCCNT);
+    __set_PRIMASK(primask);
 }
+#endif
 
 uint32_t SysTickTimer::GetTick() {
+#ifdef USE_CMSIS_RTOS2
+    if (!KernelRunning()) return DWT->CYCCNT / (SystemCoreClock / 1000U);
+    if (!s_epochLatched) {
+        uint64_t ms;
+        uint32_t elapsed, load;
+        ReadEpoch(&ms, &elapsed, &load);
+    }
+    return s_preKernelMs + osKernelGetTickCount();
+#else
     return msTicks;
+#endif
+}
+
+void SysTickTimer::ReadEpoch(uint64_t* ms, uint32_t* elapsed, uint32_t* load) {
+    uint32_t hi, lo, val;
+    bool pending;
+#ifdef USE_CMSIS_RTOS2
+    // 关中断：SysTick 中断（RTX 的 tick）无法在读取过程中推进计数
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    lo  = osKernelGetTickCount();
+    val = SysTick->VAL;
+    const uint32_t dwt = DWT->CYCCNT;
+    pending = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0;
+    if (pending) val = SysTick->VAL;
+    if (lo < s_kernelTickLast) ++s_kernelTickHi;
+    s_kernelTickLast = lo;
+    hi = s_kernelTickHi;
+    if (!s_epochLatched) {
+        // 32 位回绕运算：差值即内核启动时刻的 DWT 值
+        const uint32_t ld = SysTick->LOAD + 1U;
+        LatchPreKernel(dwt - ((lo + (pending ? 1U : 0U)) * ld + (ld - 1U - val)));
+    }
+    __set_PRIMASK(primask);
+#else
+    // 无锁：毫秒计数在读取期间变化就重读
+    do {
+        hi  = msTicksHi;
+        lo  = msTicks;
+        val = SysTick->VAL;
+    } while (lo != msTicks || hi != msTicksHi);
+    // SysTick 已回绕但中断尚未执行（关中断或更高优先级中断中）：补上这 1ms，重读回绕后的计数值
+    pending = (SCB->ICSR & SCB_ICSR_PENDSTSET_Msk) != 0;
+    if (pending) val = SysTick->VAL;
+#endif
+    *load = SysTick->LOAD + 1U;
+    *ms = ((static_cast<uint64_t>(hi) << 32) | lo) + (pending ? 1U : 0U);
+    *elapsed = *load - 1U - val;
+}
+
+uint64_t SysTickTimer::GetCycles64() {
+#ifdef USE_CMSIS_RTOS2
+    if (!KernelRunning()) return DWT->CYCCNT;
+#endif
+    uint64_t ms;
+    uint32_t elapsed, load;
+    ReadEpoch(&ms, &elapsed, &load);
+#ifdef USE_CMSIS_RTOS2
+    return s_preKernelCycles + ms * load + elapsed;
+#else
+    return ms * load + elapsed;
+#endif
+}
+
+uint64_t SysTickTimer::GetMicros64() {
+#ifdef USE_CMSIS_RTOS2
+    if (!KernelRunning()) return DWT->CYCCNT / (SystemCoreClock / 1000000U);
+#endif
+    uint64_t ms;
+    uint32_t elapsed, load;
+    ReadEpoch(&ms, &elapsed, &load);
+    // elapsed < load（72000），乘 1000 仍在 32 位内
+#ifdef USE_CMSIS_RTOS2
+    return s_preKernelUs + ms * 1000U + (elapsed * 1000U) / load;
+#else
+    return ms * 1000U + (elapsed * 1000U) / load;
+#endif
+}
+
+uint32_t SysTickTimer::GetMicros() {
+    return static_cast<uint32_t>(GetMicros64());
 }
 
 void SysTickTimer::DelayMs(uint32_t ms) {
+#ifdef USE_CMSIS_RTOS2
+    // 线程里让出 CPU；内核启动前与中断里仍然忙等
+    if (KernelRunning() && (__get_IPSR() == 0U)) {
+        (void)osDelay(ms);
+        return;
+    }
+#endif
     const uint32_t start = GetTick();
     // 利用无符号溢出回绕特性，差值比较是安全的
     while ((GetTick() - start) < ms) {
@@ -27,7 +166,30 @@ void SysTickTimer::DelayMs(uint32_t ms) {
 }
 
 void SysTickTimer::IncTick() {
-    ++msTicks;
+    const uint32_t next = msTicks + 1U;
+    if (next != 0U) {
+        msTicks = next;
+        return;
+    }
+    // 低位回绕：高低位成组更新，不让更高优先级中断里的读取看到一半
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    msTicksHi = msTicksHi + 1U;
+    msTicks = 0U;
+    __set_PRIMASK(primask);
+}
+
+void SysTickTimer::AdvanceMs(uint32_t ms) {
+#ifndef USE_CMSIS_RTOS2
+    const uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    const uint32_t lo = msTicks;
+    msTicks = lo + ms;
+    if (lo + ms < lo) msTicksHi = msTicksHi + 1U;
+    __set_PRIMASK(primask);
+#else
+    (void)ms;
+#endif
 }
 
 // 3) C 接口实现
@@ -49,9 +211,11 @@ void C_Delay_ms(uint32_t ms) {
     SysTickTimer::DelayMs(ms);
 }
 
-// 4) SysTick ISR
+// 4) SysTick ISR（RTOS 构建由 RTX 提供）
+#ifndef USE_CMSIS_RTOS2
 void SysTick_Handler(void) {
     SysTickTimer::IncTick();
 }
+#endif
 
 } // extern "C"
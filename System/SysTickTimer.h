@@ -13,8 +13,12 @@
 
 class SysTickTimer {
 private:
-    // 毫秒计数（必须 volatile，防止编译器优化）
+    // 毫秒计数（必须 volatile，防止编译器优化）；msTicksHi 为回绕次数，拼成 64 位毫秒
     static volatile uint32_t msTicks;
+    static volatile uint32_t msTicksHi;
+
+    // 64 位毫秒 + 当前毫秒内已走过的 SysTick 计数（load 为每毫秒计数数）
+    static void ReadEpoch(uint64_t* ms, uint32_t* elapsed, uint32_t* load);
 
 public:
     // 初始化 SysTick：1ms 中断一次
@@ -23,11 +27,34 @@ public:
     // 获取当前毫秒 tick
     static uint32_t GetTick();
 
+    // DWT 周期计数（Init 时开启，72MHz 下约 59s 回绕，只用于短间隔差值）
+    static uint32_t GetCycles() { return DWT->CYCCNT; }
+
+    // 微秒时间（SysTick 计数值 + 毫秒 tick，约 71 分钟回绕，只用于差值）。
+    // 与 DWT 不同，睡眠（WFI）期间 SysTick 照常计数；关中断时也能正确计入已挂起的那一次进位
+    static uint32_t GetMicros();
+
+    // 64 位单调时间基准（不回绕），任意上下文可调用：
+    // 毫秒部分为 64 位 SysTick 计数，毫秒内部分直接取 SysTick 的递减计数器（按内核时钟计数，
+    // 72MHz 下 1/72 µs 分辨率），两者同源，天然与 GetTick 对齐；WFI 睡眠期间照常走时（DWT 不会）。
+    // 内核启动前（RTOS 构建）退回 DWT；内核启动后加上锁存的启动前时长，切换时不回退。
+    static uint64_t GetCycles64();      // 内核时钟周期
+    static uint64_t GetMicros64();      // 微秒
+    static uint32_t CyclesPerUs() { return SystemCoreClock / 1000000U; }
+#ifdef USE_CMSIS_RTOS2
+    // 紧挨 osKernelStart 之前调用：锁存内核启动前已走的时间，GetTick/GetCycles64/GetMicros64 跨启动连续
+    static void MarkKernelStart();
+#endif
+
     // 阻塞延时（不要再使用 Delay_ms/Delay_us 这类会重配 SysTick 的函数）
     static void DelayMs(uint32_t ms);
 
     // 供 SysTick_Handler 调用
     static void IncTick();
+
+    // Stop 模式期间 HCLK 停止、SysTick 不走：唤醒后按 RTC 测得的睡眠时长补齐毫秒计数。
+    // 只用于裸机构建（RTOS 下由内核管理节拍，不进 Stop）
+    static void AdvanceMs(uint32_t ms);
 };
 
 #endif // __cplusplus
@@ -41,7 +68,7 @@ void SysTickTimer_Init_C(void);
 uint32_t SysTickTimer_GetTick_C(void);
 void SysTickTimer_DelayMs_C(uint32_t ms);
 
-// 兼容你现有 Key.c 的调用方式
+// 旧 C 接口（原 Key.c 按键消抖用）；Key.cpp 已改为 EXTI + TIM6 消抖、不再忙等，当前无调用方，保留给 .c 文件
 void C_Delay_ms(uint32_t ms);
 
 #ifdef __cplusplus
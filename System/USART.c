@@ -2,7 +2,6 @@
 #include <stdio.h>
 #include "Gpio.h"
 #include <stdarg.h>
-#include "stdlib.h"
 
 USART_TypeDef * My_USARTx = USART1;
 void Fputc_Switch(USART_TypeDef * USARTx) {
@@ -70,21 +69,14 @@ int fputc(int ch, FILE *f)
 
 void My_USART_Printf(USART_TypeDef* USARTx,const char *format, ...)
 {
-    // char String[100];
+    // 栈上定长缓冲，不走堆；超长部分截断
+    char String[128];
     va_list arg;
     va_start(arg, format);
-    int len = vsnprintf(NULL, 0, format, arg) + 1;  // +1 为终止符
+    vsnprintf(String, sizeof(String), format, arg);
     va_end(arg);
 
-    char * String = (char *)malloc(len);
-    // 格式化字符串
-    va_start(arg, format);
-    vsnprintf(String, len, format, arg);
-    va_end(arg);
-    
     My_USART_SendString(USARTx, String);
-
-    free(String);
 }
 
 
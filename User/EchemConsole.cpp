@@ -1,7 +1,22 @@
 #include "EchemConsole.h"
+#include "Telemetry.h"
+#include "StreamSink.h"
+#include "ADCManager.h"
+#include "CmdSchema.h"
+#include "SysTickTimer.h"
+#include "JsonCfg.h"
+#include "EventFlags.h"
+#include "ThreadStats.h"
+#include "FastFmt.h"
+#include "CgmScheduler.h"
+#include "OledPlot.h"
+#include "OLED.h"
+#include "FlashLog.h"
+#include "ParamStore.h"
 
 #include <cstring>
 #include <cstdlib>
+#include <cstddef>
 
 // ------------------------ helpers ------------------------
 
@@ -55,17 +70,6 @@ bool EchemConsole::TokenKeyEqualsI(const char* token, const char* key, const cha
     return true;
 }
 
-bool EchemConsole::ParseFloatKV(const char* token, const char* key, float* io_val) {
-    if (!token || !key || !io_val) return false;
-    const char* vstr = nullptr;
-    if (!TokenKeyEqualsI(token, key, &vstr) || !vstr || !vstr[0]) return false;
-    char* endp = nullptr;
-    const float v = (float)::strtof(vstr, &endp);
-    if (endp == vstr) return false;
-    *io_val = v;
-    return true;
-}
-
 bool EchemConsole::ParseU32KV(const char* token, const char* key, uint32_t* io_val) {
     if (!token || !key || !io_val) return false;
     const char* vstr = nullptr;
@@ -77,35 +81,90 @@ bool EchemConsole::ParseU32KV(const char* token, const char* key, uint32_t* io_v
     return true;
 }
 
-bool EchemConsole::ParseDirKV(const char* token, const char* key, NS_DAC::ScanDIR* io_dir) {
-    if (!token || !key || !io_dir) return false;
-    const char* vstr = nullptr;
-    if (!TokenKeyEqualsI(token, key, &vstr) || !vstr) return false;
-    if (StrIcmp(vstr, "FWD") == 0 || StrIcmp(vstr, "FORWARD") == 0) {
-        *io_dir = NS_DAC::ScanDIR::FORWARD;
-        return true;
-    }
-    if (StrIcmp(vstr, "REV") == 0 || StrIcmp(vstr, "REVERSE") == 0) {
-        *io_dir = NS_DAC::ScanDIR::REVERSE;
-        return true;
-    }
-    return false;
-}
-
 uint16_t EchemConsole::Clamp12U16(int32_t v) {
     if (v < 0) return 0;
     if (v > 4095) return 4095;
     return (uint16_t)v;
 }
 
+// Channel reference/gain snapshot for the telemetry field plan (current conversion).
+static NS_TLM::ChannelInfo MakeChannelInfo() {
+    NS_TLM::ChannelInfo info;
+    const auto& adc = NS_ADC::GetStaticADC();
+    const auto& p = adc.GetInitParams();
+    info.ref = adc.GetRefVal();
+    for (uint8_t i = 0; i < 3; ++i) {
+        if (p.channels != nullptr && i < p.nbr_of_channels) info.gain[i] = p.channels[i].gain;
+    }
+    return info;
+}
+
+// Output sink bound to the link a command arrived on (BT commands configure the BT sink, etc.).
+static NS_STREAM::StreamSink& SinkFor(const USART_Controller& usart) {
+    NS_STREAM::StreamSink* sink = NS_STREAM::FindSink(usart);
+    return sink ? *sink : NS_STREAM::GetSink(0);
+}
+
+bool EchemConsole::ApplySinkToken(USART_Controller& usart, NS_STREAM::StreamSink& sink, const char* t, bool* fields_changed) {
+    auto& tlm = sink.Encoder();
+    USART_Controller& link = sink.Link();
+    uint32_t tmp_u32 = 0;
+    const char* vstr = nullptr;
+    if (TokenKeyEqualsI(t, "PROTO", &vstr)) t = vstr;
+
+    if (StrIcmp(t, "JSON") == 0) {
+        tlm.Flush(link);
+        tlm.SetFormat(NS_TLM::Format::JSON);
+    } else if (StrIcmp(t, "BIN") == 0) {
+        tlm.SetFormat(NS_TLM::Format::BIN);
+    } else if (ParseU32KV(t, "BATCH", &tmp_u32)) {
+        tlm.Flush(link);
+        tlm.SetBatch((uint8_t)((tmp_u32 > 255) ? 255 : tmp_u32));
+    } else if (TokenKeyEqualsI(t, "ENC", &vstr)) {
+        tlm.Flush(link);
+        if (StrIcmp(vstr, "DELTA") == 0)      tlm.SetEncoding(NS_TLM::Encoding::DELTA);
+        else if (StrIcmp(vstr, "FIXED") == 0) tlm.SetEncoding(NS_TLM::Encoding::FIXED);
+        else Fail(usart).Printf("Error: unknown ENC=%s\r\n", vstr);
+    } else if (TokenKeyEqualsI(t, "FIELDS", &vstr)) {
+        uint16_t mask = 0;
+        if (NS_TLM::TelemetryEncoder::ParseFields(vstr, &mask)) {
+            if (tlm.SetFields(mask) && fields_changed) *fields_changed = true;
+        } else {
+            Fail(usart).Printf("Error: bad FIELDS=%s\r\n", vstr);
+        }
+    } else if (ParseU32KV(t, "EVERY", &tmp_u32)) {
+        // 固定抽取：每 n 个样本出一条记录，取代 SINK RATE 的换算（与 POLICY=DECIM 的自适应抽取无关）
+        sink.SetRate(0);
+        tlm.SetDecim((uint8_t)((tmp_u32 > 255) ? 255 : tmp_u32));
+        if (fields_changed) *fields_changed = true;
+    } else if (TokenKeyEqualsI(t, "POLICY", &vstr)) {
+        if (StrIcmp(vstr, "DROP") == 0)       sink.SetPolicy(NS_STREAM::Policy::DROP);
+        else if (StrIcmp(vstr, "DECIM") == 0) sink.SetPolicy(NS_STREAM::Policy::DECIM);
+        else if (StrIcmp(vstr, "PAUSE") == 0) sink.SetPolicy(NS_STREAM::Policy::PAUSE);
+        else Fail(usart).Printf("Error: unknown POLICY=%s\r\n", vstr);
+    } else {
+        return false;
+    }
+    return true;
+}
+
 // ------------------------ public APIs ------------------------
 
-EchemConsole::EchemConsole()
-    : m_mode(NS_DAC::RunMode::CV)
-    , m_cvVolt(0.8f, -0.8f, 1.65f)
-    , m_cvParams(0.05f, 0.05f, NS_DAC::ScanDIR::FORWARD)
-    , m_dpvParams()
-    , m_biasCode(2048) {
+EchemConsole::EchemConsole(const Params& factory)
+    : m_mode(factory.mode)
+    , m_cvVolt(factory.cvVolt)
+    , m_cvParams(factory.cvParams)
+    , m_dpvParams(factory.dpv)
+    , m_biasCode(factory.bias)
+    , m_factory(factory)
+    , m_swapAt(factory.at) {
+}
+
+NS_PARAM::Status EchemConsole::RestoreParams() {
+    Params p;
+    const NS_PARAM::Status st = LoadStored(&p);
+    SetParams(st == NS_PARAM::Status::OK ? p : m_factory);
+    return st;
 }
 
 void EchemConsole::ApplyCachedToController() {
@@ -130,12 +189,34 @@ void EchemConsole::PrintHelp(USART_Controller& usart) const {
     usart.Printf("  START | STOP | PAUSE | RESUME\r\n");
     usart.Printf("  HELP  | SHOW\r\n");
     usart.Printf("  MODE CV|DPV|IT\r\n");
-    usart.Printf("  CV  HIGH=.. LOW=.. OFF=.. DUR=.. RATE=.. DIR=FWD|REV\r\n");
-    usart.Printf("  DPV START=.. END=.. STEP=.. PULSE=.. PER=.. WIDTH=.. LEAD=.. OFF=..\r\n");
+    usart.Printf("  CV  HIGH=.. LOW=.. OFF=.. DUR=.. RATE=.. DIR=FWD|REV [AT=STEP|CYCLE]\r\n");
+    usart.Printf("  DPV START=.. END=.. STEP=.. PULSE=.. PER=.. WIDTH=.. LEAD=.. OFF=.. [AT=STEP|CYCLE]\r\n");
     usart.Printf("  IT  CODE=0..4095   (or) IT VABS=0..3.3\r\n");
+    usart.Printf("  PROTO JSON|BIN [BATCH=1..16] [ENC=FIXED|DELTA]\r\n");
+    usart.Printf("  STREAM [RATE=1..1000] [POLICY=DROP|DECIM|PAUSE] [FIELDS=MS+CH0+..] [EVERY=n]\r\n");
+    usart.Printf("    FIELDS: MS CH0 CH1 CH2 I0 I1 I2 CODE GAIN MIN MAX US | ALL\r\n");
+    usart.Printf("  SINK [BT|WIRED [ON|OFF] [PROTO=JSON|BIN] [BATCH=..] [ENC=..] [RATE=hz] [EVERY=n]\r\n");
+    usart.Printf("        [POLICY=..] [FIELDS=..]]\r\n");
+    usart.Printf("  BAUD [<rate> [FLOW=ON|OFF] [TIMEOUT=ms]] | BAUD OK\r\n");
+    usart.Printf("  NACK <seq> | RESEND <from>..<to>\r\n");
+    usart.Printf("  CFG [{\"mode\":..,\"at\":..,\"cv\":{..},\"dpv\":{..},\"bias\":..,\"cal\":{\"gain0\":..}}]\r\n");
+    usart.Printf("  CPU                          (idle %% over the last second)\r\n");
+    usart.Printf("  THREADS                      (RTOS build: per-thread load and stack high-water)\r\n");
+    usart.Printf("  IRQSTAT [RESET]              (TIM2 vector entry -> step handler, CPU cycles)\r\n");
+    usart.Printf("  TIME                         (64-bit us timebase: now, command arrival, last DAC step)\r\n");
+    usart.Printf("  ABORT [SAFE=0..4095|AUTO]   (fast path: send 0x18 0x18 0x18)\r\n");
+    usart.Printf("  CGM [ON|OFF|LOG] [PERIOD=10..3600] [SETTLE=ms] [BURST=n] [SPAN=0..200] [LP=0|1]\r\n");
+    usart.Printf("      [RUNMA=..] [STOPUA=..] [IDLEMA=..] [VDD=..] [CAP=mAh]  (periodic low-power mode)\r\n");
+    usart.Printf("  VIEW [TEXT|IV|TREND] [CH=0..2] [AVG=1..1000]  (OLED: values, I-E curve, current trend)\r\n");
+    usart.Printf("  LOG [ON|OFF|ERASE] [DECIM=1..1000] [PREP=1..29]  (flash sample log, off at boot; 30 pages, erased only while stopped)\r\n");
+    usart.Printf("  BACKFILL SINCE=ms [RUN=n] | BACKFILL STOP  (replay logged samples; live stream continues)\r\n");
+    usart.Printf("  SAVE | LOAD | FACTORY        (parameter set incl. CAL in flash, applied at boot; need STOP)\r\n");
     usart.Printf("Notes:\r\n");
     usart.Printf("  - Incremental update: fields not provided stay unchanged.\r\n");
-    usart.Printf("  - If modified while running, changes take effect after STOP then START.\r\n");
+    usart.Printf("  - While running: CV/DPV swap at the next step (AT=STEP) or cycle (AT=CYCLE) and the\r\n");
+    usart.Printf("    swap point is sent in the stream (Evt SWAP); IT/BIAS apply at once; MODE after STOP/START.\r\n");
+    usart.Printf("  - PROTO/STREAM POLICY/FIELDS/EVERY/NACK apply to the link the command came from.\r\n");
+    usart.Printf("  - EVERY=n keeps every n-th sample (fixed); POLICY=DECIM thins adaptively only when the link lags.\r\n");
     usart.Printf("  - Voltage units are in V (e.g., PULSE=0.05 means 50mV).\r\n");
 }
 
@@ -160,182 +241,1448 @@ void EchemConsole::PrintShow(USART_Controller& usart) const {
         (double)m_dpvParams.midVolt);
 
     usart.Printf("BIAS CODE=%u\r\n", (unsigned)m_biasCode);
+
+    const auto& tlm = SinkFor(usart).Encoder();
+    usart.Printf("PROTO %s BATCH=%u ENC=%s SEQ=%u SENT=%lu DROP=%lu RESENT=%lu MISSING=%lu\r\n",
+        NS_TLM::TelemetryEncoder::FormatToString(tlm.GetFormat()),
+        (unsigned)tlm.GetBatch(),
+        NS_TLM::TelemetryEncoder::EncodingToString(tlm.GetEncoding()),
+        (unsigned)tlm.GetNextSeq(),
+        (unsigned long)tlm.GetFramesSent(),
+        (unsigned long)tlm.GetFramesDropped(),
+        (unsigned long)tlm.GetFramesResent(),
+        (unsigned long)tlm.GetResendMissing());
+    PrintStream(usart);
 }
 
-EchemConsole::State EchemConsole::ProcessLine(USART_Controller& usart, const char* line, State last_state, bool* out_reset_timebase) {
-    if (out_reset_timebase) *out_reset_timebase = false;
-    if (!line || !line[0]) return last_state;
+void EchemConsole::PrintStream(USART_Controller& usart) const {
+    const auto& src = NS_STREAM::GetStaticStream();
+    usart.Printf("STREAM RATE=%u PROD=%lu%s\r\n",
+        (unsigned)src.GetRate(),
+        (unsigned long)src.GetProduced(),
+        NS_STREAM::IsLinkPaused() ? " LINK-PAUSED" : "");
+    for (uint8_t i = 0; i < NS_STREAM::SINK_COUNT; ++i) {
+        PrintSink(usart, NS_STREAM::GetSink(i));
+    }
+}
 
-    const bool is_running = (last_state == State::START || last_state == State::PAUSE || last_state == State::RESUME);
+void EchemConsole::PrintSink(USART_Controller& usart, const NS_STREAM::StreamSink& sink) const {
+    const auto& src = NS_STREAM::GetStaticStream();
+    const auto& tlm = sink.Encoder();
+    char fields[64];
+    NS_TLM::TelemetryEncoder::FieldsToString(tlm.GetFields(), fields, sizeof(fields));
+    usart.Printf("SINK %s %s%s PROTO=%s BATCH=%u ENC=%s RATE=%u FIELDS=%s EVERY=%u\r\n",
+        sink.GetName(),
+        sink.IsEnabled() ? "ON" : "OFF",
+        (&sink.Link() == &usart) ? "*" : "",
+        NS_TLM::TelemetryEncoder::FormatToString(tlm.GetFormat()),
+        (unsigned)tlm.GetBatch(),
+        NS_TLM::TelemetryEncoder::EncodingToString(tlm.GetEncoding()),
+        (unsigned)sink.GetRate(),
+        fields,
+        (unsigned)tlm.GetDecim());
+    usart.Printf("  POLICY=%s SENT=%lu DROP=%lu DECIM=%lu(x%u) LAG=%lu/%u HW=%u\r\n",
+        NS_STREAM::StreamSink::PolicyToString(sink.GetPolicy()),
+        (unsigned long)sink.GetSent(),
+        (unsigned long)sink.GetDropped(),
+        (unsigned long)sink.GetDecimated(),
+        (unsigned)sink.GetDecim(),
+        (unsigned long)sink.GetLag(src),
+        (unsigned)NS_STREAM::StreamSource::QUEUE_SIZE,
+        (unsigned)sink.GetHighWater());
+}
+
+void EchemConsole::PrintCgm(USART_Controller& usart) const {
+    const auto& cfg = NS_CGM::GetConfig();
+    usart.Printf("CGM %s PHASE=%s PERIOD=%lus SETTLE=%lums BURST=%lu SPAN=%lums LP=%s RTC=%s(%luHz)\r\n",
+        NS_CGM::IsActive() ? "ON" : "OFF", NS_CGM::PhaseToString(NS_CGM::GetPhase()),
+        (unsigned long)cfg.periodS, (unsigned long)cfg.settleMs, (unsigned long)cfg.burst,
+        (unsigned long)cfg.spanMs, cfg.lowPower ? "STOP" : "WFI",
+        NS_CGM::IsRtcLse() ? "LSE" : "LSI", (unsigned long)NS_CGM::GetRtcHz());
+    usart.Printf("CGM MODEL RUN=%.1fmA STOP=%.0fuA IDLE=%.1fmA VDD=%.2fV CAP=%lumAh\r\n",
+        (double)cfg.runMa, (double)cfg.stopUa, (double)cfg.idleMa, (double)cfg.vdd, (unsigned long)cfg.capMah);
 
+    // Cumulative over completed cycles: duty = awake / (awake + sleep), IAVG = E / VDD / t
+    const auto& tot = NS_CGM::GetTotals();
+    const uint64_t spanUs = tot.awakeUs + tot.sleepUs;
+    const uint32_t dutyPpm = spanUs ? (uint32_t)(tot.awakeUs * 1000000u / spanUs) : 0;
+    const uint32_t avgUa = (spanUs && cfg.vdd > 0.0f)
+        ? (uint32_t)((float)tot.energyUj * 1.0e6f / (cfg.vdd * (float)spanUs) + 0.5f) : 0;
+    const uint32_t lifeH = avgUa ? (uint32_t)((uint64_t)cfg.capMah * 1000u / avgUa) : 0;
+    char buf[192];
+    NS_FMT::FmtBuf f(buf);
+    f.Str("CGM CYCLES=").U32(tot.cycles).Str(" STOPS=").U32(tot.stops).Str(" OVERRUN=").U32(tot.overruns)
+     .Str(" LINKWAKE=").U32(tot.linkWakes).Str(" HSERETRY=").U32(tot.hseRetries)
+     .Str(" AWAKE=").U64(tot.awakeUs / 1000u).Str("ms SLEEP=").U64(tot.sleepUs / 1000u)
+     .Str("ms DUTY=").Fixed((int32_t)(dutyPpm / 10u), 3).Str("% E=").U64(tot.energyUj)
+     .Str("uJ IAVG=").U32(avgUa).Str("uA LIFE=").U32(lifeH).Str("h\r\n");
+    usart.Send(f.c_str());
+}
+
+void EchemConsole::PrintLog(USART_Controller& usart) const {
+    const auto& cfg = NS_LOG::GetConfig();
+    const NS_LOG::Stats st = NS_LOG::GetStats();
+    const NS_LOG::Backfill bf = NS_LOG::GetBackfill();
+    char buf[320];
+    NS_FMT::FmtBuf f(buf);
+    f.Str("LOG ").Str(cfg.enabled ? "ON" : "OFF").Str(" DECIM=").U32(cfg.decim).Str(" PREP=").U32(cfg.prep)
+     .Str(" RUN=").U32(st.run).Str(" PAGES=").U32(st.valid).Char('/').U32(NS_LOG::PAGES)
+     .Str(" SEQ=").U32(st.oldestSeq).Str("..").U32(st.nextSeq)
+     .Str(" WRAPS=").U32(st.nextSeq / NS_LOG::PAGES)
+     .Str(" STAGE=").U32(st.stageRecords).Char('/').U32(st.stageBytes).Char('B')
+     .Str(st.holding ? " HOLDING" : st.committing ? " WRITING" : "")
+     .Str(" REC=").U32(st.records).Str(" WRITTEN=").U32(st.pages)
+     .Str(" DROP=").U32(st.dropped).Str(" ERR=").U32(st.errors)
+     .Str(" BLANK=").U32(st.blankAhead).Str(" ERASES=").U32(st.erases).Str(" HELD=").U32(st.held)
+     .Str(" WEAR=").U32(st.cycles).Str("/10000")
+     .Str(" BACKFILL=").Str(bf.active ? "ACTIVE" : "IDLE").Str(" SENT=").U32(bf.sent).Str(" LOST=").U32(bf.lost)
+     .Str("\r\n");
+    usart.Send(f.c_str());
+}
+
+void EchemConsole::PrintParams(USART_Controller& usart) const {
+    const NS_PARAM::Info info = NS_PARAM::GetInfo();
+    char buf[96];
+    NS_FMT::FmtBuf f(buf);
+    f.Str("PARAMS ");
+    if (!info.valid) {
+        f.Str("STORED=NONE (factory defaults at boot)\r\n");
+        usart.Send(f.c_str());
+        return;
+    }
+    Params stored;
+    const Params cur = GetParams();
+    const bool same = LoadStored(&stored) == NS_PARAM::Status::OK && ::memcmp(&stored, &cur, sizeof(cur)) == 0;
+    f.Str("STORED=").Char(info.page ? 'B' : 'A').Str(" GEN=").U32(info.gen)
+     .Str(" VER=").U32(info.version).Str(" LEN=").U32(info.len)
+     .Str(info.version != PARAMS_VERSION ? " (other version, ignored)" : same ? " SAME" : " CHANGED")
+     .Str("\r\n");
+    usart.Send(f.c_str());
+}
+
+void EchemConsole::PrintView(USART_Controller& usart) const {
+    const auto& cfg = NS_PLOT::GetConfig();
+    const NS_PLOT::Stats st = NS_PLOT::GetStats();
+    uint32_t frames = 0, errors = 0;
+    OLED_GetStats(&frames, &errors);
     char buf[160];
-    ::strncpy(buf, line, sizeof(buf) - 1);
-    buf[sizeof(buf) - 1] = '\0';
-    TrimInPlace(buf);
-    if (buf[0] == '\0') return last_state;
+    NS_FMT::FmtBuf f(buf);
+    f.Str("VIEW ").Str(NS_PLOT::ViewToString(cfg.view)).Str(" CH=").U32(cfg.ch).Str(" AVG=").U32(cfg.avg)
+     .Str(" POINTS=").U32(st.points).Str(" STORED=").U32(st.stored).Str(" DECIM=").U32(st.decim)
+     .Str(" REDRAW=").U32(st.redraws).Str(" SKIP=").U32(st.skipped)
+     .Str(" OLED FRAMES=").U32(frames).Str(" ERR=").U32(errors).Str("\r\n");
+    usart.Send(f.c_str());
+}
 
-    // Tokenize: CMD [ARG...], separators: space/tab/comma
-    char* cmd = ::strtok(buf, "\t ,");
-    if (!cmd) return last_state;
+// ------------------------ command tables ------------------------
 
-    // HELP/SHOW
-    if (StrIcmp(cmd, "HELP") == 0) {
-        PrintHelp(usart);
-        return last_state;
+// Command names -> ids. Case labels are compile-time hashes: a collision between two
+// names is a duplicate-case compile error, so the table is a perfect hash by construction.
+EchemConsole::CmdId EchemConsole::LookupCmd(const char* s) {
+    using NS_CMD::Hash;
+    const uint16_t n = (uint16_t)::strlen(s);
+    CmdId id = CmdId::NONE;
+    const char* name = "";
+    switch (NS_CMD::HashN(s, n)) {
+    case Hash("HELP"):   id = CmdId::HELP;   name = "HELP";   break;
+    case Hash("SHOW"):   id = CmdId::SHOW;   name = "SHOW";   break;
+    case Hash("START"):  id = CmdId::START;  name = "START";  break;
+    case Hash("STOP"):   id = CmdId::STOP;   name = "STOP";   break;
+    case Hash("PAUSE"):  id = CmdId::PAUSE;  name = "PAUSE";  break;
+    case Hash("RESUME"): id = CmdId::RESUME; name = "RESUME"; break;
+    case Hash("MODE"):   id = CmdId::MODE;   name = "MODE";   break;
+    case Hash("CV"):     id = CmdId::CV;     name = "CV";     break;
+    case Hash("DPV"):    id = CmdId::DPV;    name = "DPV";    break;
+    case Hash("IT"):     id = CmdId::IT;     name = "IT";     break;
+    case Hash("BIAS"):   id = CmdId::BIAS;   name = "BIAS";   break;
+    case Hash("PROTO"):  id = CmdId::PROTO;  name = "PROTO";  break;
+    case Hash("STREAM"): id = CmdId::STREAM; name = "STREAM"; break;
+    case Hash("SINK"):   id = CmdId::SINK;   name = "SINK";   break;
+    case Hash("NACK"):   id = CmdId::NACK;   name = "NACK";   break;
+    case Hash("RESEND"): id = CmdId::RESEND; name = "RESEND"; break;
+    case Hash("BAUD"):   id = CmdId::BAUD;   name = "BAUD";   break;
+    case Hash("ABORT"):  id = CmdId::ABORT;  name = "ABORT";  break;
+    case Hash("CFG"):    id = CmdId::CFG;    name = "CFG";    break;
+    case Hash("CPU"):    id = CmdId::CPU;    name = "CPU";    break;
+    case Hash("THREADS"): id = CmdId::THREADS; name = "THREADS"; break;
+    case Hash("IRQSTAT"): id = CmdId::IRQSTAT; name = "IRQSTAT"; break;
+    case Hash("TIME"):   id = CmdId::TIME;   name = "TIME";   break;
+    case Hash("CGM"):    id = CmdId::CGM;    name = "CGM";    break;
+    case Hash("VIEW"):   id = CmdId::VIEW;   name = "VIEW";   break;
+    case Hash("LOG"):    id = CmdId::LOG;    name = "LOG";    break;
+    case Hash("BACKFILL"): id = CmdId::BACKFILL; name = "BACKFILL"; break;
+    case Hash("SAVE"):   id = CmdId::SAVE;   name = "SAVE";   break;
+    case Hash("LOAD"):   id = CmdId::LOAD;   name = "LOAD";   break;
+    case Hash("FACTORY"): id = CmdId::FACTORY; name = "FACTORY"; break;
+    default: return CmdId::NONE;
     }
-    if (StrIcmp(cmd, "SHOW") == 0) {
-        PrintShow(usart);
-        return last_state;
+    // 未知输入恰好撞上已知哈希时按未知处理
+    return NS_CMD::EqualsN(s, n, name) ? id : CmdId::NONE;
+}
+
+// Typed argument schemas. The key id is also the key byte of binary command frames.
+enum : uint8_t { CV_HIGH = 0, CV_LOW, CV_OFF, CV_DUR, CV_RATE, CV_DIR, CV_AT };
+static constexpr NS_CMD::KeySpec kCvKeys[] = {
+    { NS_CMD::Hash("HIGH"), "HIGH", CV_HIGH, NS_CMD::ArgType::F32, -3.3f, 3.3f },
+    { NS_CMD::Hash("LOW"),  "LOW",  CV_LOW,  NS_CMD::ArgType::F32, -3.3f, 3.3f },
+    { NS_CMD::Hash("OFF"),  "OFF",  CV_OFF,  NS_CMD::ArgType::F32,  0.0f, 3.3f },
+    { NS_CMD::Hash("DUR"),  "DUR",  CV_DUR,  NS_CMD::ArgType::F32,  0.0f, 3600.0f },
+    { NS_CMD::Hash("RATE"), "RATE", CV_RATE, NS_CMD::ArgType::F32,  0.0f, 100.0f },
+    { NS_CMD::Hash("DIR"),  "DIR",  CV_DIR,  NS_CMD::ArgType::DIR,  0.0f, 1.0f },
+    { NS_CMD::Hash("AT"),   "AT",   CV_AT,   NS_CMD::ArgType::SWAP, 0.0f, 1.0f },
+};
+
+enum : uint8_t { DPV_START = 0, DPV_END, DPV_STEP, DPV_PULSE, DPV_PER, DPV_WIDTH, DPV_LEAD, DPV_OFF, DPV_AT };
+static constexpr NS_CMD::KeySpec kDpvKeys[] = {
+    { NS_CMD::Hash("START"), "START", DPV_START, NS_CMD::ArgType::F32, -3.3f, 3.3f },
+    { NS_CMD::Hash("END"),   "END",   DPV_END,   NS_CMD::ArgType::F32, -3.3f, 3.3f },
+    { NS_CMD::Hash("STEP"),  "STEP",  DPV_STEP,  NS_CMD::ArgType::F32, -1.0f, 1.0f },
+    { NS_CMD::Hash("PULSE"), "PULSE", DPV_PULSE, NS_CMD::ArgType::F32, -1.0f, 1.0f },
+    { NS_CMD::Hash("PER"),   "PER",   DPV_PER,   NS_CMD::ArgType::U32,  0.0f, 65535.0f },
+    { NS_CMD::Hash("WIDTH"), "WIDTH", DPV_WIDTH, NS_CMD::ArgType::U32,  0.0f, 65535.0f },
+    { NS_CMD::Hash("LEAD"),  "LEAD",  DPV_LEAD,  NS_CMD::ArgType::U32,  0.0f, 65535.0f },
+    { NS_CMD::Hash("OFF"),   "OFF",   DPV_OFF,   NS_CMD::ArgType::F32,  0.0f, 3.3f },
+    { NS_CMD::Hash("AT"),    "AT",    DPV_AT,    NS_CMD::ArgType::SWAP, 0.0f, 1.0f },
+};
+
+enum : uint8_t { IT_CODE = 0, IT_VABS };
+static constexpr NS_CMD::KeySpec kItKeys[] = {
+    { NS_CMD::Hash("CODE"), "CODE", IT_CODE, NS_CMD::ArgType::U32, 0.0f, 4095.0f },
+    { NS_CMD::Hash("VABS"), "VABS", IT_VABS, NS_CMD::ArgType::F32, 0.0f, 3.3f },
+};
+
+enum : uint8_t { MODE_MODE = 0 };
+static constexpr NS_CMD::KeySpec kModeKeys[] = {
+    { NS_CMD::Hash("MODE"), "MODE", MODE_MODE, NS_CMD::ArgType::MODE, 0.0f, 2.0f },
+};
+
+static_assert(NS_CMD::KeysUnique(kCvKeys,  sizeof(kCvKeys)  / sizeof(kCvKeys[0])),  "CV key hash/id collision");
+static_assert(NS_CMD::KeysUnique(kDpvKeys, sizeof(kDpvKeys) / sizeof(kDpvKeys[0])), "DPV key hash/id collision");
+static_assert(NS_CMD::KeysUnique(kItKeys,  sizeof(kItKeys)  / sizeof(kItKeys[0])),  "IT key hash/id collision");
+
+static const NS_CMD::Schema kCvSchema   = { kCvKeys,   sizeof(kCvKeys)   / sizeof(kCvKeys[0]) };
+static const NS_CMD::Schema kDpvSchema  = { kDpvKeys,  sizeof(kDpvKeys)  / sizeof(kDpvKeys[0]) };
+static const NS_CMD::Schema kItSchema   = { kItKeys,   sizeof(kItKeys)   / sizeof(kItKeys[0]) };
+static const NS_CMD::Schema kModeSchema = { kModeKeys, sizeof(kModeKeys) / sizeof(kModeKeys[0]) };
+
+enum : uint8_t { CGM_PERIOD = 0, CGM_SETTLE, CGM_BURST, CGM_SPAN, CGM_LP, CGM_RUNMA, CGM_STOPUA, CGM_IDLEMA, CGM_VDD, CGM_CAP };
+static constexpr NS_CMD::KeySpec kCgmKeys[] = {
+    { NS_CMD::Hash("PERIOD"), "PERIOD", CGM_PERIOD, NS_CMD::ArgType::U32, 10.0f, 3600.0f },
+    { NS_CMD::Hash("SETTLE"), "SETTLE", CGM_SETTLE, NS_CMD::ArgType::U32,  0.0f, 60000.0f },
+    { NS_CMD::Hash("BURST"),  "BURST",  CGM_BURST,  NS_CMD::ArgType::U32,  1.0f, 1024.0f },
+    { NS_CMD::Hash("SPAN"),   "SPAN",   CGM_SPAN,   NS_CMD::ArgType::U32,  0.0f, 200.0f },
+    { NS_CMD::Hash("LP"),     "LP",     CGM_LP,     NS_CMD::ArgType::U32,  0.0f, 1.0f },
+    { NS_CMD::Hash("RUNMA"),  "RUNMA",  CGM_RUNMA,  NS_CMD::ArgType::F32,  0.0f, 200.0f },
+    { NS_CMD::Hash("STOPUA"), "STOPUA", CGM_STOPUA, NS_CMD::ArgType::F32,  0.0f, 100000.0f },
+    { NS_CMD::Hash("IDLEMA"), "IDLEMA", CGM_IDLEMA, NS_CMD::ArgType::F32,  0.0f, 200.0f },
+    { NS_CMD::Hash("VDD"),    "VDD",    CGM_VDD,    NS_CMD::ArgType::F32,  1.8f, 3.6f },
+    { NS_CMD::Hash("CAP"),    "CAP",    CGM_CAP,    NS_CMD::ArgType::U32,  1.0f, 100000.0f },
+};
+static_assert(NS_CMD::KeysUnique(kCgmKeys, sizeof(kCgmKeys) / sizeof(kCgmKeys[0])), "CGM key hash/id collision");
+static const NS_CMD::Schema kCgmSchema  = { kCgmKeys,  sizeof(kCgmKeys)  / sizeof(kCgmKeys[0]) };
+
+static void ApplyCgmArg(NS_CGM::Config& cfg, const NS_CMD::Arg& a) {
+    switch (a.id) {
+    case CGM_PERIOD: cfg.periodS  = a.u; break;
+    case CGM_SETTLE: cfg.settleMs = a.u; break;
+    case CGM_BURST:  cfg.burst    = a.u; break;
+    case CGM_SPAN:   cfg.spanMs   = a.u; break;
+    case CGM_LP:     cfg.lowPower = (a.u != 0); break;
+    case CGM_RUNMA:  cfg.runMa    = a.f; break;
+    case CGM_STOPUA: cfg.stopUa   = a.f; break;
+    case CGM_IDLEMA: cfg.idleMa   = a.f; break;
+    case CGM_VDD:    cfg.vdd      = a.f; break;
+    case CGM_CAP:    cfg.capMah   = a.u; break;
+    default: break;
     }
+}
 
-    // START/STOP/PAUSE/RESUME
-    if (StrIcmp(cmd, "START") == 0) {
+enum : uint8_t { VIEW_CH = 0, VIEW_AVG };
+static constexpr NS_CMD::KeySpec kViewKeys[] = {
+    { NS_CMD::Hash("CH"),  "CH",  VIEW_CH,  NS_CMD::ArgType::U32, 0.0f, (float)(NS_PLOT::MAX_CH - 1) },
+    { NS_CMD::Hash("AVG"), "AVG", VIEW_AVG, NS_CMD::ArgType::U32, 1.0f, (float)NS_PLOT::MAX_AVG },
+};
+static_assert(NS_CMD::KeysUnique(kViewKeys, sizeof(kViewKeys) / sizeof(kViewKeys[0])), "VIEW key hash/id collision");
+static const NS_CMD::Schema kViewSchema = { kViewKeys, sizeof(kViewKeys) / sizeof(kViewKeys[0]) };
+
+enum : uint8_t { LOG_DECIM = 0, LOG_PREP };
+static constexpr NS_CMD::KeySpec kLogKeys[] = {
+    { NS_CMD::Hash("DECIM"), "DECIM", LOG_DECIM, NS_CMD::ArgType::U32, 1.0f, (float)NS_LOG::MAX_DECIM },
+    { NS_CMD::Hash("PREP"),  "PREP",  LOG_PREP,  NS_CMD::ArgType::U32, 1.0f, (float)NS_LOG::MAX_PREP },
+};
+static_assert(NS_CMD::KeysUnique(kLogKeys, sizeof(kLogKeys) / sizeof(kLogKeys[0])), "LOG key hash/id collision");
+static const NS_CMD::Schema kLogSchema = { kLogKeys, sizeof(kLogKeys) / sizeof(kLogKeys[0]) };
+
+enum : uint8_t { BF_SINCE = 0, BF_RUN };
+static constexpr NS_CMD::KeySpec kBackfillKeys[] = {
+    { NS_CMD::Hash("SINCE"), "SINCE", BF_SINCE, NS_CMD::ArgType::U32, 0.0f, 4.0e9f },
+    { NS_CMD::Hash("RUN"),   "RUN",   BF_RUN,   NS_CMD::ArgType::U32, 0.0f, 65535.0f },
+};
+static_assert(NS_CMD::KeysUnique(kBackfillKeys, sizeof(kBackfillKeys) / sizeof(kBackfillKeys[0])), "BACKFILL key hash/id collision");
+static const NS_CMD::Schema kBackfillSchema = { kBackfillKeys, sizeof(kBackfillKeys) / sizeof(kBackfillKeys[0]) };
+
+static const NS_CMD::Schema* SchemaFor(EchemConsole::CmdId id) {
+    switch (id) {
+    case EchemConsole::CmdId::MODE: return &kModeSchema;
+    case EchemConsole::CmdId::CV:   return &kCvSchema;
+    case EchemConsole::CmdId::DPV:  return &kDpvSchema;
+    case EchemConsole::CmdId::IT:
+    case EchemConsole::CmdId::BIAS: return &kItSchema;
+    default: return nullptr;
+    }
+}
+
+// ------------------------ typed parameter application ------------------------
+
+void EchemConsole::ApplyCvArgs(const NS_CMD::Arg* args, uint8_t n) {
+    for (uint8_t i = 0; i < n; ++i) {
+        switch (args[i].id) {
+        case CV_HIGH: m_cvVolt.highVolt   = args[i].f; break;
+        case CV_LOW:  m_cvVolt.lowVolt    = args[i].f; break;
+        case CV_OFF:  m_cvVolt.voltOffset = args[i].f; break;
+        case CV_DUR:  m_cvParams.duration = args[i].f; break;
+        case CV_RATE: m_cvParams.rate     = args[i].f; break;
+        case CV_DIR:  m_cvParams.dir = args[i].u ? NS_DAC::ScanDIR::REVERSE : NS_DAC::ScanDIR::FORWARD; break;
+        case CV_AT:   m_swapAt = args[i].u ? NS_DAC::SwapAt::CYCLE : NS_DAC::SwapAt::STEP; break;
+        default: break;
+        }
+    }
+    GuardCvParams();
+}
+
+void EchemConsole::GuardCvParams() {
+    // basic guards
+    if (m_cvVolt.highVolt < m_cvVolt.lowVolt) {
+        const float tmp = m_cvVolt.highVolt;
+        m_cvVolt.highVolt = m_cvVolt.lowVolt;
+        m_cvVolt.lowVolt = tmp;
+    }
+    if (m_cvParams.duration <= 0.0f) m_cvParams.duration = 0.001f;
+    if (m_cvParams.rate <= 0.0f) m_cvParams.rate = 0.001f;
+}
+
+void EchemConsole::ApplyDpvArgs(const NS_CMD::Arg* args, uint8_t n) {
+    for (uint8_t i = 0; i < n; ++i) {
+        switch (args[i].id) {
+        case DPV_START: m_dpvParams.startVolt     = args[i].f; break;
+        case DPV_END:   m_dpvParams.endVolt       = args[i].f; break;
+        case DPV_STEP:  m_dpvParams.stepVolt      = args[i].f; break;
+        case DPV_PULSE: m_dpvParams.pulseAmp      = args[i].f; break;
+        case DPV_PER:   m_dpvParams.pulsePeriodMs = (uint16_t)args[i].u; break;
+        case DPV_WIDTH: m_dpvParams.pulseWidthMs  = (uint16_t)args[i].u; break;
+        case DPV_LEAD:  m_dpvParams.sampleLeadMs  = (uint16_t)args[i].u; break;
+        case DPV_OFF:   m_dpvParams.midVolt       = args[i].f; break;
+        case DPV_AT:    m_swapAt = args[i].u ? NS_DAC::SwapAt::CYCLE : NS_DAC::SwapAt::STEP; break;
+        default: break;
+        }
+    }
+    GuardDpvParams();
+}
+
+void EchemConsole::GuardDpvParams() {
+    // guards
+    if (m_dpvParams.pulsePeriodMs == 0) m_dpvParams.pulsePeriodMs = 1;
+    if (m_dpvParams.pulseWidthMs == 0)  m_dpvParams.pulseWidthMs = 1;
+    if (m_dpvParams.pulseWidthMs >= m_dpvParams.pulsePeriodMs) {
+        m_dpvParams.pulseWidthMs = (m_dpvParams.pulsePeriodMs > 1) ? (uint16_t)(m_dpvParams.pulsePeriodMs - 1) : 1;
+    }
+
+    // base hold time in ms
+    const uint16_t base_ms = (m_dpvParams.pulsePeriodMs > m_dpvParams.pulseWidthMs)
+        ? (uint16_t)(m_dpvParams.pulsePeriodMs - m_dpvParams.pulseWidthMs)
+        : 1;
+    if (m_dpvParams.sampleLeadMs == 0) m_dpvParams.sampleLeadMs = 1;
+    if (m_dpvParams.sampleLeadMs >= base_ms) {
+        m_dpvParams.sampleLeadMs = 1;
+    }
+    if (m_dpvParams.stepVolt == 0.0f) {
+        m_dpvParams.stepVolt = 0.001f;
+    }
+}
+
+void EchemConsole::ApplyItArgs(const NS_CMD::Arg* args, uint8_t n) {
+    for (uint8_t i = 0; i < n; ++i) {
+        switch (args[i].id) {
+        case IT_CODE:
+            m_biasCode = Clamp12U16((int32_t)args[i].u);
+            break;
+        case IT_VABS: {
+            const float code_f = (args[i].f / 3.3f) * 4095.0f;
+            m_biasCode = Clamp12U16((int32_t)(code_f + 0.5f));
+            break;
+        }
+        default: break;
+        }
+    }
+}
+
+bool EchemConsole::ApplyArgs(CmdId id, const NS_CMD::Arg* args, uint8_t n, bool is_running, bool* out_live) {
+    if (out_live) *out_live = false;
+    m_swapAt = NS_DAC::SwapAt::STEP;
+    switch (id) {
+    case CmdId::MODE:
+        if (n != 1) return false;
+        m_mode = (args[0].u == 1) ? NS_DAC::RunMode::DPV : (args[0].u == 2) ? NS_DAC::RunMode::IT : NS_DAC::RunMode::CV;
+        break;
+    case CmdId::CV:   ApplyCvArgs(args, n);  break;
+    case CmdId::DPV:  ApplyDpvArgs(args, n); break;
+    case CmdId::IT:
+    case CmdId::BIAS: ApplyItArgs(args, n);  break;
+    default: return false;
+    }
+    if (!is_running) {
+        ApplyCachedToController();
+        return true;
+    }
+    const bool live = CommitLive(id);
+    if (out_live) *out_live = live;
+    return true;
+}
+
+// Running: no STOP/START, so the electrochemistry and the time base are kept.
+// CV/DPV swap inside the TIM2 ISR at the next step/cycle boundary (only if the running mode matches);
+// the bias constant is written straight to the DAC. MODE still waits for STOP then START.
+bool EchemConsole::CommitLive(CmdId id) {
+    auto& sys = NS_DAC::SystemController::GetInstance();
+    switch (id) {
+    case CmdId::CV:  return sys.StageCV(m_cvVolt, m_cvParams, m_swapAt);
+    case CmdId::DPV: return sys.StageDPV(m_dpvParams, m_swapAt);
+    case CmdId::IT:
+    case CmdId::BIAS: {
+        const bool live = sys.ApplyBiasNow(m_biasCode);
+        (void)sys.ApplyScanConstantNow(m_biasCode);
+        return live;
+    }
+    default: return false;
+    }
+}
+
+// ------------------------ CFG (JSON parameter sets) ------------------------
+
+namespace {
+
+// Parse target: a copy of the console cache, so a failed parse changes nothing.
+struct CfgImage {
+    uint8_t               mode;
+    uint8_t               at;
+    NS_DAC::CV_VoltParams cvVolt;
+    NS_DAC::CV_Params     cvParams;
+    DPV_Params            dpv;
+    uint16_t              bias;
+    uint32_t              gain[3];
+};
+
+constexpr NS_JSON::Binding Num(const char* name, NS_JSON::ValType type, size_t offset, float lo, float hi) {
+    return { NS_CMD::Hash(name), name, type, static_cast<uint16_t>(offset), lo, hi, nullptr, 0, nullptr, 0 };
+}
+constexpr NS_JSON::Binding Enum(const char* name, size_t offset, const char* const* names, uint8_t n) {
+    return { NS_CMD::Hash(name), name, NS_JSON::ValType::ENUM, static_cast<uint16_t>(offset), 0.0f, 0.0f, nullptr, 0, names, n };
+}
+constexpr NS_JSON::Binding Obj(const char* name, const NS_JSON::Binding* child, uint8_t n) {
+    return { NS_CMD::Hash(name), name, NS_JSON::ValType::OBJECT, 0, 0.0f, 0.0f, child, n, nullptr, 0 };
+}
+
+#define CFG_OFF(member, field) (offsetof(CfgImage, member) + offsetof(decltype(CfgImage::member), field))
+
+const char* const kModeNames[] = { "CV", "DPV", "IT" };
+const char* const kDirNames[]  = { "FWD", "REV" };
+const char* const kAtNames[]   = { "STEP", "CYCLE" };
+
+// Key names are upper case (matching is case-insensitive); ranges follow the text schemas.
+const NS_JSON::Binding kCfgCv[] = {
+    Num("HIGH", NS_JSON::ValType::F32, CFG_OFF(cvVolt, highVolt),   -3.3f, 3.3f),
+    Num("LOW",  NS_JSON::ValType::F32, CFG_OFF(cvVolt, lowVolt),    -3.3f, 3.3f),
+    Num("OFF",  NS_JSON::ValType::F32, CFG_OFF(cvVolt, voltOffset),  0.0f, 3.3f),
+    Num("DUR",  NS_JSON::ValType::F32, CFG_OFF(cvParams, duration),  0.0f, 3600.0f),
+    Num("RATE", NS_JSON::ValType::F32, CFG_OFF(cvParams, rate),      0.0f, 100.0f),
+    Enum("DIR", CFG_OFF(cvParams, dir), kDirNames, 2),
+};
+const NS_JSON::Binding kCfgDpv[] = {
+    Num("START", NS_JSON::ValType::F32, CFG_OFF(dpv, startVolt),     -3.3f, 3.3f),
+    Num("END",   NS_JSON::ValType::F32, CFG_OFF(dpv, endVolt),       -3.3f, 3.3f),
+    Num("STEP",  NS_JSON::ValType::F32, CFG_OFF(dpv, stepVolt),      -1.0f, 1.0f),
+    Num("PULSE", NS_JSON::ValType::F32, CFG_OFF(dpv, pulseAmp),      -1.0f, 1.0f),
+    Num("PER",   NS_JSON::ValType::U16, CFG_OFF(dpv, pulsePeriodMs),  0.0f, 65535.0f),
+    Num("WIDTH", NS_JSON::ValType::U16, CFG_OFF(dpv, pulseWidthMs),   0.0f, 65535.0f),
+    Num("LEAD",  NS_JSON::ValType::U16, CFG_OFF(dpv, sampleLeadMs),   0.0f, 65535.0f),
+    Num("OFF",   NS_JSON::ValType::F32, CFG_OFF(dpv, midVolt),        0.0f, 3.3f),
+};
+// Transimpedance per ADC channel (ohm); integers are exact up to 2^24 after float parsing.
+const NS_JSON::Binding kCfgCal[] = {
+    Num("GAIN0", NS_JSON::ValType::U32, offsetof(CfgImage, gain) + 0 * sizeof(uint32_t), 1.0f, 16777216.0f),
+    Num("GAIN1", NS_JSON::ValType::U32, offsetof(CfgImage, gain) + 1 * sizeof(uint32_t), 1.0f, 16777216.0f),
+    Num("GAIN2", NS_JSON::ValType::U32, offsetof(CfgImage, gain) + 2 * sizeof(uint32_t), 1.0f, 16777216.0f),
+};
+
+enum : uint8_t { CFG_MODE = 0, CFG_AT, CFG_CV, CFG_DPV, CFG_BIAS, CFG_CAL };
+const NS_JSON::Binding kCfgTop[] = {
+    Enum("MODE", offsetof(CfgImage, mode), kModeNames, 3),
+    Enum("AT",   offsetof(CfgImage, at), kAtNames, 2),
+    Obj("CV",  kCfgCv,  sizeof(kCfgCv)  / sizeof(kCfgCv[0])),
+    Obj("DPV", kCfgDpv, sizeof(kCfgDpv) / sizeof(kCfgDpv[0])),
+    Num("BIAS", NS_JSON::ValType::U16, offsetof(CfgImage, bias), 0.0f, 4095.0f),
+    Obj("CAL", kCfgCal, sizeof(kCfgCal) / sizeof(kCfgCal[0])),
+};
+
+#undef CFG_OFF
+
+} // namespace
+
+// Fixed-point float for JSON output (no %f / soft-float printf).
+static void CfgFloat(NS_FMT::FmtBuf& f, const char* key, float v, uint8_t decimals) {
+    int32_t scale = 1;
+    for (uint8_t i = 0; i < decimals; ++i) scale *= 10;
+    const float scaled = v * (float)scale;
+    f.Char('"').Str(key).Str("\":").Fixed((int32_t)(scaled + ((scaled < 0.0f) ? -0.5f : 0.5f)), decimals);
+}
+
+void EchemConsole::PrintConfig(USART_Controller& usart) const {
+    // Worst case is 368 bytes (every number at full int32 fixed-point width, 32-bit gains);
+    // the last two bytes are kept out of FmtBuf's reach so "\r\n" always fits.
+    char out[384];
+    NS_FMT::FmtBuf f(out, sizeof(out) - 2);
+    f.Str("{\"mode\":\"").Str(ModeToString(m_mode))
+     .Str("\",\"at\":\"").Str((m_swapAt == NS_DAC::SwapAt::CYCLE) ? "CYCLE" : "STEP")
+     .Str("\",\"cv\":{");
+    CfgFloat(f, "high", m_cvVolt.highVolt, 3);   f.Char(',');
+    CfgFloat(f, "low",  m_cvVolt.lowVolt, 3);    f.Char(',');
+    CfgFloat(f, "off",  m_cvVolt.voltOffset, 3); f.Char(',');
+    CfgFloat(f, "dur",  m_cvParams.duration, 4); f.Char(',');
+    CfgFloat(f, "rate", m_cvParams.rate, 4);
+    f.Str(",\"dir\":\"").Str((m_cvParams.dir == NS_DAC::ScanDIR::FORWARD) ? "FWD" : "REV").Str("\"},\"dpv\":{");
+    CfgFloat(f, "start", m_dpvParams.startVolt, 3); f.Char(',');
+    CfgFloat(f, "end",   m_dpvParams.endVolt, 3);   f.Char(',');
+    CfgFloat(f, "step",  m_dpvParams.stepVolt, 4);  f.Char(',');
+    CfgFloat(f, "pulse", m_dpvParams.pulseAmp, 4);
+    f.Str(",\"per\":").U32(m_dpvParams.pulsePeriodMs);
+    f.Str(",\"width\":").U32(m_dpvParams.pulseWidthMs);
+    f.Str(",\"lead\":").U32(m_dpvParams.sampleLeadMs).Char(',');
+    CfgFloat(f, "off", m_dpvParams.midVolt, 3);
+    f.Str("},\"bias\":").U32(m_biasCode).Str(",\"cal\":{");
+    // Only channels that exist: a gain of 0 would fail the CAL range check on replay.
+    const auto& p = NS_ADC::GetStaticADC().GetInitParams();
+    const uint8_t nch = p.channels ? p.nbr_of_channels : 0;
+    for (uint8_t i = 0; i < 3 && i < nch; ++i) {
+        if (i) f.Char(',');
+        f.Str("\"gain").U32(i).Str("\":").U32(p.channels[i].gain);
+    }
+    f.Str("}}");
+    if (f.Overflowed()) {
+        Fail(usart).Printf("Error: CFG output truncated\r\n");
+        return;
+    }
+    const uint16_t n = f.size();
+    out[n] = '\r';
+    out[n + 1] = '\n';
+    usart.WriteFrame(reinterpret_cast<const uint8_t*>(out), static_cast<uint16_t>(n + 2));
+}
+
+EchemConsole::Params EchemConsole::GetParams() const {
+    const auto& adcParams = NS_ADC::GetStaticADC().GetInitParams();
+    const uint8_t nch = (adcParams.channels != nullptr) ? adcParams.nbr_of_channels : 0;
+
+    Params p;
+    // Padding goes to flash as well: keep it zero so stored and current sets compare bytewise.
+    ::memset(static_cast<void*>(&p), 0, sizeof(p));
+    p.mode = m_mode;
+    p.at = m_swapAt;
+    p.cvVolt = m_cvVolt;
+    p.cvParams = m_cvParams;
+    p.dpv = m_dpvParams;
+    p.bias = m_biasCode;
+    for (uint8_t i = 0; i < 3; ++i) p.gain[i] = (i < nch) ? adcParams.channels[i].gain : 1;
+    return p;
+}
+
+void EchemConsole::SetParams(const Params& p) {
+    const auto& adcParams = NS_ADC::GetStaticADC().GetInitParams();
+    const uint8_t nch = (adcParams.channels != nullptr) ? adcParams.nbr_of_channels : 0;
+
+    m_mode = p.mode;
+    m_swapAt = p.at;
+    m_cvVolt = p.cvVolt;
+    m_cvParams = p.cvParams;
+    m_dpvParams = p.dpv;
+    m_biasCode = p.bias;
+    GuardCvParams();
+    GuardDpvParams();
+    for (uint8_t i = 0; i < 3 && i < nch; ++i) adcParams.channels[i].gain = p.gain[i];
+    ApplyCachedToController();
+}
+
+// Same ranges as the CFG bindings; NaN fails every comparison.
+bool EchemConsole::ValidParams(const Params& p) {
+    const auto in = [](float v, float lo, float hi) { return v >= lo && v <= hi; };
+    if (static_cast<uint32_t>(p.mode) > static_cast<uint32_t>(NS_DAC::RunMode::IT)) return false;
+    if (static_cast<uint8_t>(p.at) > static_cast<uint8_t>(NS_DAC::SwapAt::CYCLE)) return false;
+    if (static_cast<uint8_t>(p.cvParams.dir) > static_cast<uint8_t>(NS_DAC::ScanDIR::REVERSE)) return false;
+    if (!in(p.cvVolt.highVolt, -3.3f, 3.3f) || !in(p.cvVolt.lowVolt, -3.3f, 3.3f) ||
+        !in(p.cvVolt.voltOffset, 0.0f, 3.3f) || !in(p.cvParams.duration, 0.0f, 3600.0f) ||
+        !in(p.cvParams.rate, 0.0f, 100.0f)) return false;
+    if (!in(p.dpv.startVolt, -3.3f, 3.3f) || !in(p.dpv.endVolt, -3.3f, 3.3f) ||
+        !in(p.dpv.stepVolt, -1.0f, 1.0f) || !in(p.dpv.pulseAmp, -1.0f, 1.0f) ||
+        !in(p.dpv.midVolt, 0.0f, 3.3f)) return false;
+    if (p.bias > 4095) return false;
+    for (uint8_t i = 0; i < 3; ++i) {
+        if (p.gain[i] < 1u || p.gain[i] > 16777216u) return false;
+    }
+    return true;
+}
+
+NS_PARAM::Status EchemConsole::LoadStored(Params* out) const {
+    const NS_PARAM::Status st = NS_PARAM::Load(PARAMS_VERSION, out, sizeof(*out));
+    if (st != NS_PARAM::Status::OK) return st;
+    return ValidParams(*out) ? NS_PARAM::Status::OK : NS_PARAM::Status::VERSION;
+}
+
+bool EchemConsole::ApplyConfig(USART_Controller& usart, const char* json, bool is_running) {
+    const auto& adcParams = NS_ADC::GetStaticADC().GetInitParams();
+    const uint8_t nch = (adcParams.channels != nullptr) ? adcParams.nbr_of_channels : 0;
+
+    CfgImage img;
+    img.mode = static_cast<uint8_t>(m_mode);
+    img.at = (m_swapAt == NS_DAC::SwapAt::CYCLE) ? 1 : 0;
+    img.cvVolt = m_cvVolt;
+    img.cvParams = m_cvParams;
+    img.dpv = m_dpvParams;
+    img.bias = m_biasCode;
+    for (uint8_t i = 0; i < 3; ++i) img.gain[i] = (i < nch) ? adcParams.channels[i].gain : 1;
+
+    NS_JSON::Result res;
+    if (!NS_JSON::Parse(json, (uint16_t)::strlen(json), kCfgTop, sizeof(kCfgTop) / sizeof(kCfgTop[0]), &img, &res)) {
+        Fail(usart).Printf("Error: CFG %s%s%s at %u\r\n", res.key, res.key[0] ? ": " : "",
+            NS_JSON::ErrorToString(res.err), (unsigned)res.pos);
+        return false;
+    }
+
+    const auto has = [&res](uint8_t k) { return (res.seen & (1u << k)) != 0; };
+    m_swapAt = img.at ? NS_DAC::SwapAt::CYCLE : NS_DAC::SwapAt::STEP;
+    if (has(CFG_MODE)) m_mode = static_cast<NS_DAC::RunMode>(img.mode);
+    if (has(CFG_CV)) {
+        m_cvVolt = img.cvVolt;
+        m_cvParams = img.cvParams;
+        GuardCvParams();
+    }
+    if (has(CFG_DPV)) {
+        m_dpvParams = img.dpv;
+        GuardDpvParams();
+    }
+    if (has(CFG_BIAS)) m_biasCode = img.bias;
+    if (has(CFG_CAL)) {
+        // Gains feed the current conversion plan, which is rebuilt at the next START.
+        for (uint8_t i = 0; i < 3 && i < nch; ++i) adcParams.channels[i].gain = img.gain[i];
+    }
+
+    if (!is_running) {
+        ApplyCachedToController();
+        usart.Printf("CFG applied\r\n");
+        return true;
+    }
+    const bool cvLive   = has(CFG_CV)   && CommitLive(CmdId::CV);
+    const bool dpvLive  = has(CFG_DPV)  && CommitLive(CmdId::DPV);
+    const bool biasLive = has(CFG_BIAS) && CommitLive(CmdId::BIAS);
+    usart.Printf("CFG applied%s%s%s%s\r\n",
+        cvLive ? " CV:staged" : "", dpvLive ? " DPV:staged" : "", biasLive ? " BIAS:now" : "",
+        has(CFG_MODE) ? " (MODE after STOP/START)" : "");
+    return true;
+}
+
+// Parse all remaining strtok tokens against a schema; nothing is applied unless every token is valid.
+bool EchemConsole::ParseTextArgs(USART_Controller& usart, const char* cmd, const NS_CMD::Schema& schema,
+                                 NS_CMD::Arg* args, uint8_t* n) {
+    bool ok = true;
+    *n = 0;
+    char* t = nullptr;
+    while ((t = ::strtok(nullptr, "\t ,")) != nullptr) {
+        if (*n >= NS_CMD::MAX_ARGS) {
+            Fail(usart).Printf("Error: %s: too many args\r\n", cmd);
+            return false;
+        }
+        const NS_CMD::KeySpec* spec = nullptr;
+        const NS_CMD::ArgError err = schema.ParseText(t, &args[*n], &spec);
+        if (err == NS_CMD::ArgError::OK) {
+            ++*n;
+            continue;
+        }
+        ok = false;
+        if (err == NS_CMD::ArgError::RANGE && spec && spec->type == NS_CMD::ArgType::F32) {
+            Fail(usart).Printf("Error: %s %s: %s (%.4g..%.4g)\r\n", cmd, t, NS_CMD::ArgErrorToString(err),
+                (double)spec->lo, (double)spec->hi);
+        } else if (err == NS_CMD::ArgError::RANGE && spec) {
+            Fail(usart).Printf("Error: %s %s: %s (%lu..%lu)\r\n", cmd, t, NS_CMD::ArgErrorToString(err),
+                (unsigned long)spec->lo, (unsigned long)spec->hi);
+        } else {
+            Fail(usart).Printf("Error: %s %s: %s\r\n", cmd, t, NS_CMD::ArgErrorToString(err));
+        }
+    }
+    return ok;
+}
+
+// ------------------------ state transitions ------------------------
+
+EchemConsole::State EchemConsole::Transition(USART_Controller& usart, CmdId id, State last_state, bool* out_reset_timebase) {
+    const bool is_running = (last_state == State::START || last_state == State::PAUSE || last_state == State::RESUME);
+
+    switch (id) {
+    case CmdId::START:
         if (is_running) {
+            m_failed = true;
             usart.Printf("START ignored: already running.\r\n");
             return last_state;
         }
+        if (NS_CGM::IsActive()) {
+            Fail(usart).Printf("Error: CGM periodic mode active, send CGM OFF first.\r\n");
+            return last_state;
+        }
         usart.Printf("Starting...\r\n");
         NS_DAC::SystemController::GetInstance().Start();
+        // Field plan is built once per run; per-sample encoding is a straight loop over it.
+        NS_STREAM::PrepareSinks(MakeChannelInfo());
+        NS_PLOT::Prepare(MakeChannelInfo());
         if (out_reset_timebase) *out_reset_timebase = true;
         return State::START;
-    }
-    if (StrIcmp(cmd, "STOP") == 0) {
+    case CmdId::STOP:
         usart.Printf("Stopping...\r\n");
         NS_DAC::SystemController::GetInstance().Stop();
+        // 未攒满的二进制批次立即发出，避免最后几个样本丢在缓冲里
+        for (uint8_t i = 0; i < NS_STREAM::SINK_COUNT; ++i) {
+            auto& sink = NS_STREAM::GetSink(i);
+            if (sink.IsEnabled()) sink.Encoder().Flush(sink.Link());
+        }
         // Ensure cached parameters are pushed into SystemController for next run.
         ApplyCachedToController();
         return State::STOP;
-    }
-    if (StrIcmp(cmd, "PAUSE") == 0) {
+    case CmdId::PAUSE:
         if (last_state != State::START && last_state != State::RESUME) {
-            usart.Printf("Error: PAUSE only valid after START/RESUME.\r\n");
+            Fail(usart).Printf("Error: PAUSE only valid after START/RESUME.\r\n");
             return last_state;
         }
         usart.Printf("Paused.\r\n");
         NS_DAC::SystemController::GetInstance().Pause();
         return State::PAUSE;
-    }
-    if (StrIcmp(cmd, "RESUME") == 0) {
+    case CmdId::RESUME:
         if (last_state != State::PAUSE) {
+            m_failed = true;
             usart.Printf("RESUME ignored: device is not paused.\r\n");
             return last_state;
         }
         usart.Printf("Resumed.\r\n");
         NS_DAC::SystemController::GetInstance().Resume();
         return State::RESUME;
+    default:
+        return last_state;
     }
+}
+
+// ------------------------ abort ------------------------
 
-    // MODE
-    if (StrIcmp(cmd, "MODE") == 0) {
+EchemConsole::State EchemConsole::ProcessAbort(USART_Controller& usart, State last_state) {
+    auto& sys = NS_DAC::SystemController::GetInstance();
+    NS_DAC::AbortInfo info;
+    if (!sys.ConsumeAbort(&info)) {
+        usart.Printf("ABORT ignored: not running.\r\n");
+        return last_state;
+    }
+    // 72 cycles = 1 us at 72 MHz
+    usart.Printf("ABORTED CODE=%u LATENCY=%lu cycles (%lu us)\r\n",
+        (unsigned)info.code, (unsigned long)info.cycles, (unsigned long)(info.cycles / (SystemCoreClock / 1000000U)));
+    // Same bookkeeping as STOP, except the scan DAC stays enabled at the safe code.
+    for (uint8_t i = 0; i < NS_STREAM::SINK_COUNT; ++i) {
+        auto& sink = NS_STREAM::GetSink(i);
+        if (sink.IsEnabled()) sink.Encoder().Flush(sink.Link());
+    }
+    ApplyCachedToController();
+    return State::STOP;
+}
+
+// ------------------------ text commands ------------------------
+
+EchemConsole::State EchemConsole::ProcessLine(USART_Controller& usart, const char* line, State last_state, bool* out_reset_timebase) {
+    if (out_reset_timebase) *out_reset_timebase = false;
+    if (!line || !line[0]) return last_state;
+
+    char buf[LINE_MAX];
+    ::strncpy(buf, line, sizeof(buf) - 1);
+    buf[sizeof(buf) - 1] = '\0';
+    TrimInPlace(buf);
+    if (buf[0] == '\0') return last_state;
+
+    // Tokenize: [#id] CMD [ARG...], separators: space/tab/comma
+    char* cmd = ::strtok(buf, "\t ,");
+    if (!cmd) return last_state;
+
+    // Optional request id: every response to this command ends with "OK #id" / "ERR #id"
+    bool has_id = false;
+    unsigned long req_id = 0;
+    if (cmd[0] == '#') {
+        char* endp = nullptr;
+        req_id = ::strtoul(cmd + 1, &endp, 10);
+        has_id = (endp != cmd + 1 && *endp == '\0');
+        cmd = ::strtok(nullptr, "\t ,");
+        if (!has_id || !cmd) {
+            usart.Printf("ERR malformed request id\r\n");
+            return last_state;
+        }
+    }
+
+    m_failed = false;
+    const State next = Dispatch(usart, cmd, last_state, out_reset_timebase);
+    if (has_id) {
+        usart.Printf("%s #%lu\r\n", m_failed ? "ERR" : "OK", req_id);
+    }
+    return next;
+}
+
+EchemConsole::State EchemConsole::Dispatch(USART_Controller& usart, char* cmd, State last_state, bool* out_reset_timebase) {
+    const bool is_running = (last_state == State::START || last_state == State::PAUSE || last_state == State::RESUME);
+    const CmdId id = LookupCmd(cmd);
+
+    switch (id) {
+    // HELP/SHOW
+    case CmdId::HELP:
+        PrintHelp(usart);
+        return last_state;
+    case CmdId::SHOW:
+        PrintShow(usart);
+        return last_state;
+
+    // START/STOP/PAUSE/RESUME
+    case CmdId::START:
+    case CmdId::STOP:
+    case CmdId::PAUSE:
+    case CmdId::RESUME:
+        return Transition(usart, id, last_state, out_reset_timebase);
+
+    // MODE (positional: MODE CV|DPV|IT)
+    case CmdId::MODE: {
         char* m = ::strtok(nullptr, "\t ,");
         if (!m) {
-            usart.Printf("Error: MODE requires CV|DPV|IT\r\n");
+            Fail(usart).Printf("Error: MODE requires CV|DPV|IT\r\n");
             return last_state;
         }
-        if (StrIcmp(m, "CV") == 0)      m_mode = NS_DAC::RunMode::CV;
-        else if (StrIcmp(m, "DPV") == 0) m_mode = NS_DAC::RunMode::DPV;
-        else if (StrIcmp(m, "IT") == 0)  m_mode = NS_DAC::RunMode::IT;
-        else {
-            usart.Printf("Error: unknown MODE=%s\r\n", m);
+        char kv[16] = "MODE=";
+        ::strncat(kv, m, sizeof(kv) - 6);
+        NS_CMD::Arg arg;
+        if (kModeSchema.ParseText(kv, &arg, nullptr) != NS_CMD::ArgError::OK) {
+            Fail(usart).Printf("Error: unknown MODE=%s\r\n", m);
             return last_state;
         }
-
+        (void)ApplyArgs(id, &arg, 1, is_running);
         if (!is_running) {
-            ApplyCachedToController();
-            usart.Printf("MODE set to %s\r\n", m);
+            usart.Printf("MODE set to %s\r\n", ModeToString(m_mode));
         } else {
             usart.Printf("MODE updated (will take effect after STOP then START).\r\n");
         }
         return last_state;
     }
 
-    // CV params
-    if (StrIcmp(cmd, "CV") == 0) {
+    // CV / DPV / IT / BIAS params (typed schemas, all-or-nothing)
+    case CmdId::CV:
+    case CmdId::DPV:
+    case CmdId::IT:
+    case CmdId::BIAS: {
+        NS_CMD::Arg args[NS_CMD::MAX_ARGS];
+        uint8_t n = 0;
+        if (!ParseTextArgs(usart, cmd, *SchemaFor(id), args, &n)) {
+            usart.Printf("%s params unchanged\r\n", cmd);
+            return last_state;
+        }
+        // The bias is also live while the CGM periodic mode holds the DACs
+        const bool live_ctx = is_running || ((id == CmdId::IT || id == CmdId::BIAS) && NS_CGM::IsActive());
+        bool live = false;
+        (void)ApplyArgs(id, args, n, live_ctx, &live);
+        if (!live_ctx) {
+            const char* what = (id == CmdId::CV) ? "CV params" : (id == CmdId::DPV) ? "DPV params" : "BIAS";
+            usart.Printf("%s updated\r\n", what);
+        } else if (id == CmdId::IT || id == CmdId::BIAS) {
+            usart.Printf("BIAS applied (CODE=%u)\r\n", (unsigned)m_biasCode);
+        } else if (live) {
+            usart.Printf("%s params staged (swap at next %s)\r\n", (id == CmdId::CV) ? "CV" : "DPV",
+                (m_swapAt == NS_DAC::SwapAt::CYCLE) ? "cycle" : "step");
+        } else {
+            usart.Printf("%s params updated (mode %s running, apply after STOP/START)\r\n",
+                (id == CmdId::CV) ? "CV" : "DPV", ModeToString(NS_DAC::SystemController::GetInstance().GetMode()));
+        }
+        return last_state;
+    }
+
+    // PROTO: telemetry output format of this link's sink (takes effect immediately, also while running)
+    case CmdId::PROTO: {
+        auto& sink = SinkFor(usart);
         char* t = nullptr;
         while ((t = ::strtok(nullptr, "\t ,")) != nullptr) {
-            ParseFloatKV(t, "HIGH", &m_cvVolt.highVolt);
-            ParseFloatKV(t, "LOW",  &m_cvVolt.lowVolt);
-            ParseFloatKV(t, "OFF",  &m_cvVolt.voltOffset);
-            ParseFloatKV(t, "DUR",  &m_cvParams.duration);
-            ParseFloatKV(t, "RATE", &m_cvParams.rate);
-            ParseDirKV(t,   "DIR",  &m_cvParams.dir);
+            if (!ApplySinkToken(usart, sink, t, nullptr)) {
+                Fail(usart).Printf("Error: unknown PROTO arg %s\r\n", t);
+            }
         }
+        const auto& tlm = sink.Encoder();
+        usart.Printf("PROTO %s BATCH=%u ENC=%s\r\n",
+            NS_TLM::TelemetryEncoder::FormatToString(tlm.GetFormat()),
+            (unsigned)tlm.GetBatch(),
+            NS_TLM::TelemetryEncoder::EncodingToString(tlm.GetEncoding()));
+        return last_state;
+    }
 
-        // basic guards
-        if (m_cvVolt.highVolt < m_cvVolt.lowVolt) {
-            const float tmp = m_cvVolt.highVolt;
-            m_cvVolt.highVolt = m_cvVolt.lowVolt;
-            m_cvVolt.lowVolt = tmp;
+    // STREAM: acquisition rate (shared) + this link's backpressure policy / fields / decimation
+    case CmdId::STREAM: {
+        auto& src = NS_STREAM::GetStaticStream();
+        auto& sink = SinkFor(usart);
+        bool fields_changed = false;
+        uint32_t tmp_u32 = 0;
+        char* t = nullptr;
+        while ((t = ::strtok(nullptr, "\t ,")) != nullptr) {
+            if (ParseU32KV(t, "RATE", &tmp_u32)) {
+                if (tmp_u32 > 0xFFFF || !src.SetRate((uint16_t)tmp_u32)) {
+                    Fail(usart).Printf("Error: RATE must be 1..%u\r\n", (unsigned)NS_STREAM::StreamSource::MAX_RATE_HZ);
+                }
+            } else if (!ApplySinkToken(usart, sink, t, &fields_changed)) {
+                Fail(usart).Printf("Error: unknown STREAM arg %s\r\n", t);
+            }
         }
-        if (m_cvParams.duration <= 0.0f) m_cvParams.duration = 0.001f;
-        if (m_cvParams.rate <= 0.0f) m_cvParams.rate = 0.001f;
-
-        if (!is_running) ApplyCachedToController();
-        usart.Printf("CV params updated%s\r\n", is_running ? " (apply after STOP/START)" : "");
+        if (fields_changed && is_running) {
+            usart.Printf("FIELDS/EVERY will take effect after STOP then START.\r\n");
+        }
+        PrintStream(usart);
         return last_state;
     }
 
-    // DPV params
-    if (StrIcmp(cmd, "DPV") == 0) {
+    // SINK: list output sinks, or configure one sink by name (any link may configure any sink)
+    case CmdId::SINK: {
+        char* name = ::strtok(nullptr, "\t ,");
+        if (!name) {
+            PrintStream(usart);
+            return last_state;
+        }
+        NS_STREAM::StreamSink* sink = NS_STREAM::FindSink(name);
+        if (!sink) {
+            Fail(usart).Printf("Error: unknown SINK %s (BT|WIRED)\r\n", name);
+            return last_state;
+        }
+        bool fields_changed = false;
         uint32_t tmp_u32 = 0;
         char* t = nullptr;
         while ((t = ::strtok(nullptr, "\t ,")) != nullptr) {
-            ParseFloatKV(t, "START", &m_dpvParams.startVolt);
-            ParseFloatKV(t, "END",   &m_dpvParams.endVolt);
-            ParseFloatKV(t, "STEP",  &m_dpvParams.stepVolt);
-            ParseFloatKV(t, "PULSE", &m_dpvParams.pulseAmp);
-            if (ParseU32KV(t, "PER", &tmp_u32))   m_dpvParams.pulsePeriodMs = (uint16_t)tmp_u32;
-            if (ParseU32KV(t, "WIDTH", &tmp_u32)) m_dpvParams.pulseWidthMs  = (uint16_t)tmp_u32;
-            if (ParseU32KV(t, "LEAD", &tmp_u32))  m_dpvParams.sampleLeadMs  = (uint16_t)tmp_u32;
-            ParseFloatKV(t, "OFF",   &m_dpvParams.midVolt);
+            if (StrIcmp(t, "ON") == 0) {
+                sink->SetEnabled(true);
+            } else if (StrIcmp(t, "OFF") == 0) {
+                sink->SetEnabled(false);
+            } else if (ParseU32KV(t, "RATE", &tmp_u32)) {
+                // 0 = 全速；其余在 START 时按采样率换算成 EVERY
+                sink->SetRate((uint16_t)((tmp_u32 > NS_STREAM::StreamSource::MAX_RATE_HZ) ? NS_STREAM::StreamSource::MAX_RATE_HZ : tmp_u32));
+                if (tmp_u32 == 0) sink->Encoder().SetDecim(1);
+                fields_changed = true;
+            } else if (!ApplySinkToken(usart, *sink, t, &fields_changed)) {
+                Fail(usart).Printf("Error: unknown SINK arg %s\r\n", t);
+            }
+        }
+        if (fields_changed && is_running) {
+            usart.Printf("FIELDS/EVERY/RATE will take effect after STOP then START.\r\n");
         }
+        PrintSink(usart, *sink);
+        return last_state;
+    }
 
-        // guards
-        if (m_dpvParams.pulsePeriodMs == 0) m_dpvParams.pulsePeriodMs = 1;
-        if (m_dpvParams.pulseWidthMs == 0)  m_dpvParams.pulseWidthMs = 1;
-        if (m_dpvParams.pulseWidthMs >= m_dpvParams.pulsePeriodMs) {
-            m_dpvParams.pulseWidthMs = (m_dpvParams.pulsePeriodMs > 1) ? (uint16_t)(m_dpvParams.pulsePeriodMs - 1) : 1;
+    // NACK / RESEND: replay frames from the retransmit window (acquisition keeps running)
+    case CmdId::NACK:
+    case CmdId::RESEND: {
+        char* t = ::strtok(nullptr, "\t ,");
+        char* endp = nullptr;
+        const unsigned long from = t ? ::strtoul(t, &endp, 10) : 0;
+        if (!t || endp == t || from > 0xFFFF) {
+            Fail(usart).Printf("Error: %s requires a sequence number\r\n", cmd);
+            return last_state;
+        }
+        unsigned long to = from;
+        const char* to_str = nullptr;
+        if (endp[0] == '.' && endp[1] == '.') {
+            // RESEND a..b
+            to_str = endp + 2;
+        } else if (endp[0] != '\0') {
+            Fail(usart).Printf("Error: %s %s: bad sequence number\r\n", cmd, t);
+            return last_state;
+        } else if ((t = ::strtok(nullptr, "\t ,")) != nullptr) {
+            // RESEND a b
+            to_str = t;
+        }
+        if (to_str) {
+            char* to_end = nullptr;
+            to = ::strtoul(to_str, &to_end, 10);
+            if (to_end == to_str || *to_end != '\0' || to > 0xFFFF) {
+                Fail(usart).Printf("Error: %s %lu..%s: bad end sequence number\r\n", cmd, from, to_str);
+                return last_state;
+            }
+        }
+        // to < from is only a wrap across 65535 when the span fits the window (65530..3); otherwise it is reversed
+        if (to < from && static_cast<uint16_t>(to - from) >= NS_TLM::RetransmitRing::MAX_FRAMES) {
+            Fail(usart).Printf("Error: %s %lu..%lu: end before start (wrap across 65535 only within %u frames)\r\n",
+                cmd, from, to, (unsigned)NS_TLM::RetransmitRing::MAX_FRAMES);
+            return last_state;
         }
 
-        // base hold time in ms
-        const uint16_t base_ms = (m_dpvParams.pulsePeriodMs > m_dpvParams.pulseWidthMs)
-            ? (uint16_t)(m_dpvParams.pulsePeriodMs - m_dpvParams.pulseWidthMs)
-            : 1;
-        if (m_dpvParams.sampleLeadMs == 0) m_dpvParams.sampleLeadMs = 1;
-        if (m_dpvParams.sampleLeadMs >= base_ms) {
-            m_dpvParams.sampleLeadMs = 1;
+        auto& tlm = SinkFor(usart).Encoder();
+        if (!tlm.RequestResend((uint16_t)from, (uint16_t)to)) {
+            const auto& ring = tlm.GetRing();
+            if (ring.Empty()) {
+                usart.Printf("RESEND %lu..%lu: window empty\r\n", from, to);
+            } else {
+                usart.Printf("RESEND %lu..%lu: not in window %u..%u\r\n",
+                    from, to, (unsigned)ring.OldestSeq(), (unsigned)ring.NewestSeq());
+            }
         }
-        if (m_dpvParams.stepVolt == 0.0f) {
-            m_dpvParams.stepVolt = 0.001f;
+        return last_state;
+    }
+
+    // CFG: whole parameter sets as one JSON object (the rest of the line, spaces/commas included)
+    case CmdId::CFG: {
+        const char* json = ::strtok(nullptr, "");
+        if (!json) {
+            PrintConfig(usart);
+            return last_state;
         }
+        (void)ApplyConfig(usart, json, is_running);
+        return last_state;
+    }
 
-        if (!is_running) ApplyCachedToController();
-        usart.Printf("DPV params updated%s\r\n", is_running ? " (apply after STOP/START)" : "");
+    // CPU: main-loop load, measured as time spent asleep in WFI
+    case CmdId::CPU: {
+        const auto& load = NS_EVT::GetLoad();
+        usart.Printf("CPU IDLE=%u.%u%% WAKE=%lu/s TIMEOUT=%lu/s WINDOW=%lums POSTED=%lu\r\n",
+            (unsigned)(load.idlePermille / 10), (unsigned)(load.idlePermille % 10),
+            (unsigned long)load.wakeups, (unsigned long)load.timeouts,
+            (unsigned long)load.windowMs, (unsigned long)load.posted);
         return last_state;
     }
 
-    // IT / BIAS
-    if (StrIcmp(cmd, "IT") == 0 || StrIcmp(cmd, "BIAS") == 0) {
-        uint32_t tmp_u32 = 0;
-        float vabs = 0.0f;
-        char* t = nullptr;
-        while ((t = ::strtok(nullptr, "\t ,")) != nullptr) {
-            if (ParseU32KV(t, "CODE", &tmp_u32)) {
-                m_biasCode = Clamp12U16((int32_t)tmp_u32);
+    // THREADS: per-thread load over the last second and stack high-water mark (RTOS build only)
+    case CmdId::THREADS: {
+        const uint8_t n = NS_THREAD::GetCount();
+        if (n == 0) {
+            usart.Printf("THREADS: single-loop build (USE_CMSIS_RTOS2 not set), see CPU\r\n");
+            return last_state;
+        }
+        NS_THREAD::Info info;
+        for (uint8_t i = 0; i < n; ++i) {
+            if (!NS_THREAD::GetInfo(i, &info)) continue;
+            usart.Printf("THREAD %s PRIO=%ld LOAD=%u.%u%% RUNS=%lu/s STACK=%lu/%lu\r\n",
+                info.name, (long)info.priority,
+                (unsigned)(info.loadPermille / 10), (unsigned)(info.loadPermille % 10),
+                (unsigned long)info.wakeups,
+                (unsigned long)info.stackUsed, (unsigned long)info.stackSize);
+        }
+        const auto& load = NS_EVT::GetLoad();
+        usart.Printf("THREAD idle LOAD=%u.%u%%\r\n",
+            (unsigned)(load.idlePermille / 10), (unsigned)(load.idlePermille % 10));
+        return last_state;
+    }
+
+    // IRQSTAT: TIM2 dispatch cost (DWT cycles from vector entry to the scan-step callback)
+    case CmdId::IRQSTAT: {
+        char* t = ::strtok(nullptr, "\t ,");
+        if (t && StrIcmp(t, "RESET") == 0) {
+            TIM_IRQnManage::ResetProbeT2();
+            usart.Printf("OK IRQSTAT RESET\r\n");
+            return last_state;
+        }
+        static const char* const kModes[] = { "TABLE", "DIRECT", "LEGACY_SCAN" };
+        const auto p = TIM_IRQnManage::GetProbeT2();
+        const uint32_t avg = p.count ? (uint32_t)(p.sumCyc / p.count) : 0;
+        const uint32_t mhz = SystemCoreClock / 1000000U;
+        usart.Printf("IRQSTAT TIM2 MODE=%s N=%lu MIN=%lu AVG=%lu MAX=%lu LAST=%lu CYC (%luMHz)\r\n",
+            kModes[To_uint8(TIM_IRQnManage::GetModeT2())], (unsigned long)p.count,
+            (unsigned long)p.minCyc, (unsigned long)avg, (unsigned long)p.maxCyc,
+            (unsigned long)p.lastCyc, (unsigned long)mhz);
+        return last_state;
+    }
+
+    // TIME: 64-bit microsecond timebase; RX is when this command's line arrived (ISR/DMA block stamp)
+    case CmdId::TIME: {
+        const uint64_t now = SysTickTimer::GetMicros64();
+        const uint64_t rx = usart.GetLineStampUs();
+        const NS_DAC::StepStamp step = NS_DAC::DAC_Manager::Chan_Scan.GetLastStep();
+        char buf[160];
+        NS_FMT::FmtBuf f(buf);
+        f.Str("TIME US=").U64(now);
+        f.Str(" RX=").U64(rx).Str(" LAT=").U64((rx && now >= rx) ? now - rx : 0).Str("us");
+        f.Str(" STEP=").U64(step.us).Str(" STEPS=").U32(step.count);
+        f.Str(" TICK=").U32(SysTickTimer::GetTick()).Str("\r\n");
+        usart.Send(f.c_str());
+        return last_state;
+    }
+
+    // CGM: periodic low-power measurement (RTC alarm -> settle -> burst average -> report -> Stop)
+    case CmdId::CGM: {
+        char* t = ::strtok(nullptr, "\t ,");
+        if (t && StrIcmp(t, "OFF") == 0) {
+            NS_CGM::Stop();
+            // The scheduler switched the controller to IT; restore the console's mode and constants
+            ApplyCachedToController();
+            usart.Printf("CGM OFF\r\n");
+            PrintCgm(usart);
+            return last_state;
+        }
+        if (t && StrIcmp(t, "LOG") == 0) {
+            NS_CGM::Result r;
+            char buf[192];
+            NS_FMT::FmtBuf f(buf);
+            for (uint8_t age = NS_CGM::LOG_SIZE; age-- > 0;) {
+                if (!NS_CGM::GetResult(age, &r)) continue;
+                f.Clear();
+                NS_CGM::FormatResult(r, f);
+                usart.Send(f.c_str());
+            }
+            return last_state;
+        }
+        bool on = false;
+        if (t && StrIcmp(t, "ON") == 0) {
+            on = true;
+            t = ::strtok(nullptr, "\t ,");
+        }
+        // KEY=VALUE tokens, all-or-nothing
+        NS_CGM::Config cfg = NS_CGM::GetConfig();
+        bool ok = true;
+        for (; t != nullptr; t = ::strtok(nullptr, "\t ,")) {
+            NS_CMD::Arg a;
+            const NS_CMD::KeySpec* spec = nullptr;
+            const NS_CMD::ArgError err = kCgmSchema.ParseText(t, &a, &spec);
+            if (err == NS_CMD::ArgError::OK) {
+                ApplyCgmArg(cfg, a);
+            } else if (err == NS_CMD::ArgError::RANGE && spec) {
+                ok = false;
+                Fail(usart).Printf("Error: CGM %s: %s (%.4g..%.4g)\r\n", t, NS_CMD::ArgErrorToString(err),
+                    (double)spec->lo, (double)spec->hi);
+            } else {
+                ok = false;
+                Fail(usart).Printf("Error: CGM %s: %s\r\n", t, NS_CMD::ArgErrorToString(err));
+            }
+        }
+        if (!ok) {
+            usart.Printf("CGM params unchanged\r\n");
+            return last_state;
+        }
+        if (!on) {
+            // Settings only; an active schedule picks them up at the next cycle
+            NS_CGM::SetConfig(cfg);
+        } else {
+            if (is_running) {
+                Fail(usart).Printf("Error: CGM needs STOP first (scan running).\r\n");
+                return last_state;
+            }
+            const NS_CGM::Status st = NS_CGM::Start(cfg);
+            if (st == NS_CGM::Status::BUSY) {
+                Fail(usart).Printf("Error: CGM: DAC busy, send STOP first.\r\n");
+                return last_state;
+            }
+            if (st == NS_CGM::Status::NO_RTC) {
+                Fail(usart).Printf("Error: CGM: RTC clock (LSE/LSI) failed to start.\r\n");
+                return last_state;
+            }
+        }
+        PrintCgm(usart);
+        return last_state;
+    }
+
+    // VIEW [TEXT|IV|TREND] [CH=] [AVG=]: OLED view; drawing happens in the UI context, never in the sampler
+    case CmdId::VIEW: {
+        NS_PLOT::Config cfg = NS_PLOT::GetConfig();
+        bool ok = true;
+        for (char* t = ::strtok(nullptr, "\t ,"); t != nullptr; t = ::strtok(nullptr, "\t ,")) {
+            if (StrIcmp(t, "TEXT") == 0)  { cfg.view = NS_PLOT::View::TEXT;  continue; }
+            if (StrIcmp(t, "IV") == 0)    { cfg.view = NS_PLOT::View::IV;    continue; }
+            if (StrIcmp(t, "TREND") == 0) { cfg.view = NS_PLOT::View::TREND; continue; }
+            NS_CMD::Arg a;
+            const NS_CMD::KeySpec* spec = nullptr;
+            const NS_CMD::ArgError err = kViewSchema.ParseText(t, &a, &spec);
+            if (err == NS_CMD::ArgError::OK) {
+                if (a.id == VIEW_CH) cfg.ch = (uint8_t)a.u;
+                else                 cfg.avg = (uint16_t)a.u;
+            } else if (err == NS_CMD::ArgError::RANGE && spec) {
+                ok = false;
+                Fail(usart).Printf("Error: VIEW %s: %s (%.4g..%.4g)\r\n", t, NS_CMD::ArgErrorToString(err),
+                    (double)spec->lo, (double)spec->hi);
+            } else {
+                ok = false;
+                Fail(usart).Printf("Error: VIEW %s: %s\r\n", t, NS_CMD::ArgErrorToString(err));
+            }
+        }
+        if (!ok) {
+            usart.Printf("VIEW unchanged\r\n");
+            return last_state;
+        }
+        NS_PLOT::SetConfig(cfg);
+        PrintView(usart);
+        return last_state;
+    }
+
+    // LOG [ON|OFF|ERASE] [DECIM=] [PREP=]: the log reads the broadcast ring like a sink; flash writes happen in its Service
+    case CmdId::LOG: {
+        NS_LOG::Config cfg = NS_LOG::GetConfig();
+        bool ok = true;
+        bool erase = false;
+        for (char* t = ::strtok(nullptr, "\t ,"); t != nullptr; t = ::strtok(nullptr, "\t ,")) {
+            if (StrIcmp(t, "ON") == 0)    { cfg.enabled = true;  continue; }
+            if (StrIcmp(t, "OFF") == 0)   { cfg.enabled = false; continue; }
+            if (StrIcmp(t, "ERASE") == 0) { erase = true;        continue; }
+            NS_CMD::Arg a;
+            const NS_CMD::KeySpec* spec = nullptr;
+            const NS_CMD::ArgError err = kLogSchema.ParseText(t, &a, &spec);
+            if (err == NS_CMD::ArgError::OK) {
+                if (a.id == LOG_DECIM) cfg.decim = (uint16_t)a.u;
+                else                   cfg.prep = (uint8_t)a.u;
+            } else if (err == NS_CMD::ArgError::RANGE && spec) {
+                ok = false;
+                Fail(usart).Printf("Error: LOG %s: %s (%.4g..%.4g)\r\n", t, NS_CMD::ArgErrorToString(err),
+                    (double)spec->lo, (double)spec->hi);
+            } else {
+                ok = false;
+                Fail(usart).Printf("Error: LOG %s: %s\r\n", t, NS_CMD::ArgErrorToString(err));
+            }
+        }
+        if (!ok) {
+            usart.Printf("LOG unchanged\r\n");
+            return last_state;
+        }
+        if (erase && NS_LOG::Erase() != NS_LOG::Status::OK) {
+            Fail(usart).Printf("Error: LOG ERASE needs STOP first (stream and DAC idle, including CGM; or a page write is in progress).\r\n");
+            return last_state;
+        }
+        NS_LOG::SetConfig(cfg);
+        PrintLog(usart);
+        return last_state;
+    }
+
+    // BACKFILL SINCE=ms [RUN=n] | STOP: replay from the flash log on this link, paced by spare TX room
+    case CmdId::BACKFILL: {
+        uint32_t since = 0;
+        uint32_t run = NS_LOG::GetStats().run;
+        bool ok = true;
+        for (char* t = ::strtok(nullptr, "\t ,"); t != nullptr; t = ::strtok(nullptr, "\t ,")) {
+            if (StrIcmp(t, "STOP") == 0) {
+                NS_LOG::StopBackfill();
+                PrintLog(usart);
+                return last_state;
+            }
+            NS_CMD::Arg a;
+            const NS_CMD::KeySpec* spec = nullptr;
+            const NS_CMD::ArgError err = kBackfillSchema.ParseText(t, &a, &spec);
+            if (err == NS_CMD::ArgError::OK) {
+                if (a.id == BF_SINCE) since = a.u;
+                else                  run = a.u;
+            } else if (err == NS_CMD::ArgError::RANGE && spec) {
+                ok = false;
+                Fail(usart).Printf("Error: BACKFILL %s: %s (%.4g..%.4g)\r\n", t, NS_CMD::ArgErrorToString(err),
+                    (double)spec->lo, (double)spec->hi);
+            } else {
+                ok = false;
+                Fail(usart).Printf("Error: BACKFILL %s: %s\r\n", t, NS_CMD::ArgErrorToString(err));
+            }
+        }
+        if (!ok) return last_state;
+        if (NS_LOG::StartBackfill(usart, (uint16_t)run, since) != NS_LOG::Status::OK) {
+            Fail(usart).Printf("Error: BACKFILL: nothing logged at or after RUN=%lu SINCE=%lu\r\n",
+                (unsigned long)run, (unsigned long)since);
+            return last_state;
+        }
+        usart.Printf("BACKFILL BEGIN RUN=%lu SINCE=%lu\r\n", (unsigned long)run, (unsigned long)since);
+        return last_state;
+    }
+
+    // SAVE | LOAD | FACTORY: the stored parameter set (two flash pages, the newest valid one wins).
+    // A page erase stalls instruction fetch for ~20ms, so these are refused while a scan is running.
+    case CmdId::SAVE:
+    case CmdId::LOAD:
+    case CmdId::FACTORY: {
+        const char* name = (id == CmdId::SAVE) ? "SAVE" : (id == CmdId::LOAD) ? "LOAD" : "FACTORY";
+        if (is_running) {
+            Fail(usart).Printf("Error: %s needs STOP first.\r\n", name);
+            return last_state;
+        }
+        NS_PARAM::Status st = NS_PARAM::Status::OK;
+        if (id == CmdId::SAVE) {
+            const Params p = GetParams();
+            st = NS_PARAM::Save(PARAMS_VERSION, &p, sizeof(p));
+        } else if (id == CmdId::LOAD) {
+            Params p;
+            st = LoadStored(&p);
+            if (st == NS_PARAM::Status::OK) SetParams(p);
+        } else {
+            // Defaults apply even if the erase fails; the error says the old set would come back at boot.
+            st = NS_PARAM::Erase();
+            SetParams(m_factory);
+        }
+        if (st != NS_PARAM::Status::OK) {
+            Fail(usart).Printf("Error: %s: %s\r\n", name, NS_PARAM::StatusToString(st));
+        } else {
+            usart.Printf("%s done\r\n", name);
+        }
+        PrintParams(usart);
+        return last_state;
+    }
+
+    // ABORT: same as the 0x18 x3 fast path but through the main loop; SAFE= only sets the park code
+    case CmdId::ABORT: {
+        auto& sys = NS_DAC::SystemController::GetInstance();
+        char* t = ::strtok(nullptr, "\t ,");
+        if (!t) {
+            sys.Abort(SysTickTimer::GetCycles());
+            return ProcessAbort(usart, last_state);
+        }
+        const char* vstr = nullptr;
+        uint32_t code = 0;
+        if (TokenKeyEqualsI(t, "SAFE", &vstr) && StrIcmp(vstr, "AUTO") == 0) {
+            sys.SetSafeCode(0xFFFF);
+        } else if (ParseU32KV(t, "SAFE", &code) && code <= 4095) {
+            sys.SetSafeCode((uint16_t)code);
+        } else {
+            Fail(usart).Printf("Error: ABORT SAFE=0..4095|AUTO\r\n");
+            return last_state;
+        }
+        const auto& last = sys.GetLastAbort();
+        usart.Printf("ABORT SAFE=%u%s LAST=%lu cycles\r\n", (unsigned)sys.GetSafeCode(),
+            sys.IsSafeCodeAuto() ? " (AUTO=BIAS)" : "", (unsigned long)last.cycles);
+        return last_state;
+    }
+
+    // BAUD: runtime link renegotiation with confirmation handshake
+    case CmdId::BAUD: {
+        char* t = ::strtok(nullptr, "\t ,");
+        if (!t) {
+            uint32_t actual = 0;
+            (void)usart.IsBaudSupported(usart.GetBaudRate(), &actual);
+            usart.Printf("BAUD=%lu (actual %lu) FLOW=%s PCLK=%lu MAX=%lu%s\r\n",
+                (unsigned long)usart.GetBaudRate(),
+                (unsigned long)actual,
+                usart.GetFlowControl() ? "ON" : "OFF",
+                (unsigned long)usart.GetPclk(),
+                (unsigned long)(usart.GetPclk() / 16),
+                usart.IsBaudChangePending() ? " PENDING" : "");
+            return last_state;
+        }
+        if (StrIcmp(t, "OK") == 0) {
+            // 能以新波特率收到这一行，本身就证明链路可用
+            if (usart.ConfirmBaudChange()) {
+                usart.Printf("BAUD CONFIRMED %lu\r\n", (unsigned long)usart.GetBaudRate());
+            } else {
+                usart.Printf("BAUD OK ignored: no change pending.\r\n");
             }
-            if (ParseFloatKV(t, "VABS", &vabs)) {
-                if (vabs < 0.0f) vabs = 0.0f;
-                if (vabs > 3.3f) vabs = 3.3f;
-                const float code_f = (vabs / 3.3f) * 4095.0f;
-                m_biasCode = Clamp12U16((int32_t)(code_f + 0.5f));
+            return last_state;
+        }
+
+        char* endp = nullptr;
+        const unsigned long baud = ::strtoul(t, &endp, 10);
+        if (endp == t || *endp != '\0') {
+            Fail(usart).Printf("Error: BAUD requires a rate or OK\r\n");
+            return last_state;
+        }
+        bool flow = usart.GetFlowControl();
+        uint32_t timeout_ms = 3000;
+        const char* vstr = nullptr;
+        while ((t = ::strtok(nullptr, "\t ,")) != nullptr) {
+            if (TokenKeyEqualsI(t, "FLOW", &vstr)) {
+                flow = (StrIcmp(vstr, "ON") == 0 || StrIcmp(vstr, "1") == 0);
+            } else {
+                ParseU32KV(t, "TIMEOUT", &timeout_ms);
             }
         }
+        if (timeout_ms < 200) timeout_ms = 200;
+
+        uint32_t actual = 0;
+        if (usart.IsBaudChangePending()) {
+            Fail(usart).Printf("Error: BAUD change already pending.\r\n");
+            return last_state;
+        }
+        if (!usart.IsBaudSupported((uint32_t)baud, &actual)) {
+            Fail(usart).Printf("Error: BAUD %lu not reachable from PCLK=%lu\r\n",
+                baud, (unsigned long)usart.GetPclk());
+            return last_state;
+        }
+        // 先以旧波特率通知，再切换；对端需在超时内以新波特率发送 "BAUD OK"
+        usart.Printf("BAUD PENDING %lu (actual %lu) FLOW=%s: send 'BAUD OK' within %lu ms\r\n",
+            baud, (unsigned long)actual, flow ? "ON" : "OFF", (unsigned long)timeout_ms);
+        if (!usart.BeginBaudChange((uint32_t)baud, flow, timeout_ms)) {
+            Fail(usart).Printf("Error: BAUD change rejected (FLOW pins not available?)\r\n");
+        }
+        return last_state;
+    }
+
+    default:
+        break;
+    }
+
+    Fail(usart).Printf("Unknown command: %s. Use HELP.\r\n", cmd);
+    return last_state;
+}
+
+// ------------------------ binary commands ------------------------
+
+void EchemConsole::SendBinaryStatus(USART_Controller& usart, uint16_t req_id, uint8_t cmd, BinStatus status, uint8_t key) {
+    uint8_t raw[8];
+    raw[0] = BIN_CMD_RSP;
+    raw[1] = (uint8_t)req_id;
+    raw[2] = (uint8_t)(req_id >> 8);
+    raw[3] = cmd;
+    raw[4] = (uint8_t)status;
+    raw[5] = key;
+    const uint16_t crc = NS_TLM::FrameCodec::Crc16(raw, 6);
+    raw[6] = (uint8_t)crc;
+    raw[7] = (uint8_t)(crc >> 8);
 
-        if (!is_running) ApplyCachedToController();
-        usart.Printf("BIAS updated%s\r\n", is_running ? " (apply after STOP/START)" : "");
+    uint8_t wire[NS_TLM::FrameCodec::CobsMaxLen(sizeof(raw)) + 1];
+    uint16_t n = NS_TLM::FrameCodec::CobsEncode(raw, sizeof(raw), wire);
+    wire[n++] = 0x00;
+    (void)usart.WriteFrame(wire, n);
+}
+
+EchemConsole::State EchemConsole::ProcessFrame(USART_Controller& usart, const uint8_t* cobs, uint16_t len, State last_state, bool* out_reset_timebase) {
+    if (out_reset_timebase) *out_reset_timebase = false;
+
+    // 头 4 字节 + 最多 MAX_ARGS 个 5 字节参数 + CRC16
+    uint8_t raw[4 + NS_CMD::MAX_ARGS * 5 + 2];
+    const uint16_t n = NS_TLM::FrameCodec::CobsDecode(cobs, len, raw, sizeof(raw));
+    const uint16_t req_id = (n >= 3) ? (uint16_t)(raw[1] | (raw[2] << 8)) : 0;
+    const uint8_t cmd = (n >= 4) ? raw[3] : 0xFF;
+
+    if (n < 6 || raw[0] != BIN_CMD_REQ || ((n - 6) % 5) != 0 ||
+        NS_TLM::FrameCodec::Crc16(raw, (uint16_t)(n - 2)) != (uint16_t)(raw[n - 2] | (raw[n - 1] << 8))) {
+        SendBinaryStatus(usart, req_id, cmd, BinStatus::BAD_FRAME, 0xFF);
         return last_state;
     }
 
-    usart.Printf("Unknown command: %s. Use HELP.\r\n", cmd);
+    const bool is_running = (last_state == State::START || last_state == State::PAUSE || last_state == State::RESUME);
+    const CmdId id = (CmdId)cmd;
+    m_failed = false;
+
+    switch (id) {
+    case CmdId::START:
+    case CmdId::STOP:
+    case CmdId::PAUSE:
+    case CmdId::RESUME: {
+        const State next = Transition(usart, id, last_state, out_reset_timebase);
+        SendBinaryStatus(usart, req_id, cmd, m_failed ? BinStatus::REJECTED : BinStatus::OK, 0xFF);
+        return next;
+    }
+    default:
+        break;
+    }
+
+    const NS_CMD::Schema* schema = SchemaFor(id);
+    if (!schema) {
+        SendBinaryStatus(usart, req_id, cmd, BinStatus::UNSUPPORTED, 0xFF);
+        return last_state;
+    }
+
+    NS_CMD::Arg args[NS_CMD::MAX_ARGS];
+    const uint8_t argc = (uint8_t)((n - 6) / 5);
+    for (uint8_t i = 0; i < argc; ++i) {
+        const uint8_t* p = &raw[4 + i * 5];
+        const uint32_t value = (uint32_t)p[1] | ((uint32_t)p[2] << 8) | ((uint32_t)p[3] << 16) | ((uint32_t)p[4] << 24);
+        if (schema->ParseBinary(p[0], value, &args[i], nullptr) != NS_CMD::ArgError::OK) {
+            // 任一参数无效则整条命令不生效，status 中带回出错的键
+            SendBinaryStatus(usart, req_id, cmd, BinStatus::BAD_ARG, p[0]);
+            return last_state;
+        }
+    }
+
+    const bool ok = ApplyArgs(id, args, argc, is_running);
+    SendBinaryStatus(usart, req_id, cmd, ok ? BinStatus::OK : BinStatus::BAD_ARG, 0xFF);
     return last_state;
 }
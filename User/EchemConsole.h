@@ -6,6 +6,10 @@
 #include "DPVController.h"
 #include "BTCPP.h"   // USART_Controller
 
+namespace NS_STREAM { class StreamSink; }
+namespace NS_CMD { struct Arg; struct Schema; }
+namespace NS_PARAM { enum class Status : uint8_t; }
+
 // Command processor + cached configuration for CV/DPV/IT.
 class EchemConsole {
 public:
@@ -17,18 +21,74 @@ public:
         STOP
     };
 
-    EchemConsole();
+    // Command ids. The numbering is stable: it is also the command byte of binary command frames.
+    enum class CmdId : uint8_t {
+        HELP = 0, SHOW, START, STOP, PAUSE, RESUME, MODE, CV, DPV, IT, BIAS,
+        PROTO, STREAM, SINK, NACK, RESEND, BAUD, ABORT, CFG, CPU, THREADS, IRQSTAT, TIME, CGM, VIEW,
+        LOG, BACKFILL, SAVE, LOAD, FACTORY,
+        NONE = 0xFF
+    };
+
+    // Binary command channel: 0x00 <COBS(payload)> 0x00 on the same link as text commands.
+    //   request : [0x81][req_id u16][cmd u8] { [key u8][value u32 / f32 LE] }* [crc16]
+    //   response: [0x82][req_id u16][cmd u8][status u8][key u8] [crc16], COBS + trailing 0x00
+    // Supported: START/STOP/PAUSE/RESUME, MODE (key 0), CV, DPV, IT/BIAS (keys as in the text schemas).
+    static const uint8_t BIN_CMD_REQ = 0x81;
+    static const uint8_t BIN_CMD_RSP = 0x82;
+    enum class BinStatus : uint8_t { OK = 0, BAD_FRAME, UNSUPPORTED, BAD_ARG, REJECTED };
+
+    // Parameter set kept by the console: what CFG edits and SAVE/LOAD persist (NS_PARAM, flash).
+    // Stored as a raw image: bump PARAMS_VERSION whenever this layout changes.
+    struct Params {
+        NS_DAC::RunMode       mode;
+        NS_DAC::SwapAt        at;
+        NS_DAC::CV_VoltParams cvVolt;
+        NS_DAC::CV_Params     cvParams;
+        DPV_Params            dpv;
+        uint16_t              bias;
+        uint32_t              gain[3];  // transimpedance per ADC channel (ohm)
+    };
+    static const uint16_t PARAMS_VERSION = 1;
+
+    // factory: compiled defaults (main.h), used until a stored set is restored and by FACTORY.
+    explicit EchemConsole(const Params& factory);
+
+    // Boot: apply the newest valid stored set, or the factory set if there is none (or it is from
+    // another layout version). Either way the controller ends up matching the cache.
+    NS_PARAM::Status RestoreParams();
 
     // Apply cached parameters into NS_DAC::SystemController.
     void ApplyCachedToController();
 
     void PrintHelp(USART_Controller& usart) const;
     void PrintShow(USART_Controller& usart) const;
+    void PrintStream(USART_Controller& usart) const;
+    void PrintSink(USART_Controller& usart, const NS_STREAM::StreamSink& sink) const;
+    // Current parameter sets as the JSON object accepted by CFG.
+    void PrintConfig(USART_Controller& usart) const;
+    // CGM periodic-measurement settings, cumulative energy/duty estimate and battery-life projection.
+    void PrintCgm(USART_Controller& usart) const;
+    void PrintView(USART_Controller& usart) const;
+    // Flash sample log: settings, pages, write position and the running backfill.
+    void PrintLog(USART_Controller& usart) const;
+    // Stored parameter block: page, generation, and whether the cache differs from it.
+    void PrintParams(USART_Controller& usart) const;
+
+    // Longest command line (CFG carries a whole JSON parameter set).
+    static const uint16_t LINE_MAX = 320;
 
     // Process one command line. May call Start/Stop/Pause/Resume.
     // out_reset_timebase will be set to true if a fresh START should reset time base.
+    // An optional leading "#<id>" token makes the command end with "OK #<id>" or "ERR #<id>".
     State ProcessLine(USART_Controller& usart, const char* line, State last_state, bool* out_reset_timebase);
 
+    // Finish an abort that the RX ISR already performed (DAC parked): report latency and move to STOP.
+    // Called by the main loop when a link saw the abort byte sequence.
+    State ProcessAbort(USART_Controller& usart, State last_state);
+
+    // Process one binary command frame (COBS data without delimiters); replies with a binary status frame.
+    State ProcessFrame(USART_Controller& usart, const uint8_t* cobs, uint16_t len, State last_state, bool* out_reset_timebase);
+
     NS_DAC::RunMode GetMode() const { return m_mode; }
     uint16_t GetBiasCode() const { return m_biasCode; }
 
@@ -41,11 +101,45 @@ private:
     DPV_Params m_dpvParams;
     uint16_t m_biasCode;
 
+    const Params m_factory;
+
+    // Swap point for CV/DPV changes made while running (AT=STEP|CYCLE, per command, default STEP).
+    NS_DAC::SwapAt m_swapAt = NS_DAC::SwapAt::STEP;
+
+    // Set by any error/rejection while processing the current command (request-id status).
+    bool m_failed = false;
+    USART_Controller& Fail(USART_Controller& usart) { m_failed = true; return usart; }
+
+    static CmdId LookupCmd(const char* s);
+    State Dispatch(USART_Controller& usart, char* cmd, State last_state, bool* out_reset_timebase);
+    State Transition(USART_Controller& usart, CmdId id, State last_state, bool* out_reset_timebase);
+
+    bool ParseTextArgs(USART_Controller& usart, const char* cmd, const NS_CMD::Schema& schema, NS_CMD::Arg* args, uint8_t* n);
+    // While running, CV/DPV are staged for the waveform ISR and IT/BIAS are written at once;
+    // *out_live reports whether the change reached the hardware without STOP/START.
+    bool ApplyArgs(CmdId id, const NS_CMD::Arg* args, uint8_t n, bool is_running, bool* out_live = nullptr);
+    bool CommitLive(CmdId id);
+    void ApplyCvArgs(const NS_CMD::Arg* args, uint8_t n);
+    void ApplyDpvArgs(const NS_CMD::Arg* args, uint8_t n);
+    void GuardCvParams();
+    void GuardDpvParams();
+    // CFG {json}: all-or-nothing over a copy of the cache, then the same live/cached commit as the text commands.
+    bool ApplyConfig(USART_Controller& usart, const char* json, bool is_running);
+    void ApplyItArgs(const NS_CMD::Arg* args, uint8_t n);
+    // Cache (+ ADC gains) <-> Params. SetParams guards the values and applies them to the controller.
+    Params GetParams() const;
+    void SetParams(const Params& p);
+    static bool ValidParams(const Params& p);
+    // Newest stored set, range-checked (a CRC-clean block with values out of range counts as VERSION).
+    NS_PARAM::Status LoadStored(Params* out) const;
+    void SendBinaryStatus(USART_Controller& usart, uint16_t req_id, uint8_t cmd, BinStatus status, uint8_t key);
+
     static int StrIcmp(const char* s1, const char* s2);
     static void TrimInPlace(char* s);
     static bool TokenKeyEqualsI(const char* token, const char* key, const char** out_val_str);
-    static bool ParseFloatKV(const char* token, const char* key, float* io_val);
     static bool ParseU32KV(const char* token, const char* key, uint32_t* io_val);
-    static bool ParseDirKV(const char* token, const char* key, NS_DAC::ScanDIR* io_dir);
     static uint16_t Clamp12U16(int32_t v);
+
+    // Sink options shared by PROTO/STREAM/SINK; returns false if the token is not a sink option.
+    bool ApplySinkToken(USART_Controller& usart, NS_STREAM::StreamSink& sink, const char* t, bool* fields_changed);
 };
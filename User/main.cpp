@@ -5,153 +5,431 @@
 
 #include "main.h"
 #include "EchemConsole.h"
+#include "Telemetry.h"
+#include "FastFmt.h"
+#include "StreamSink.h"
+#include "EventFlags.h"
+#include "ThreadStats.h"
+#include "CgmScheduler.h"
+#include "OLED.h"
+#include "OledPlot.h"
+#include "KeyMenu.h"
+#include "Key.h"
+#include "FlashLog.h"
+#include "ParamStore.h"
+
+#ifdef USE_CMSIS_RTOS2
+#include "rtx_os.h"
+#endif
 
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
+// 命令回显：整行拼好后一次写入 TX 缓冲（不经 Printf/snprintf）；
+// 缓冲按最长命令行（CFG {json}）加 "ACK: " 与 "\r\n" 留足，FmtBuf 截断会吞掉行尾
+static void SendAck(USART_Controller& usart, const char* line) {
+    char buf[EchemConsole::LINE_MAX + 8];
+    NS_FMT::FmtBuf f(buf);
+    f.Str("ACK: ").Str(line).Str("\r\n");
+    usart.WriteFrame(f.data(), f.size());
+}
+
+// 链路维护：BAUD 握手超时则已回退到旧波特率，以旧波特率告知对端
+static void ServiceLink(USART_Controller& usart) {
+    if (usart.Service()) {
+        usart.Printf("BAUD REVERTED %lu\r\n", (unsigned long)usart.GetBaudRate());
+    }
+}
+
 /**
- * 【关键修复】安全的行读取函数
- * 每次只从底层读取一个字节，确保不会因为一次读多而丢弃缓冲区里剩余的命令。
+ * 消息读取：消息边界由串口接收中断（DMA HT/TC/IDLE）按块统计，这里只在确有完整消息时才拷贝。
+ * 文本行跳过 CRLF 产生的空行；超长行整行丢弃并提示，避免把半条命令当作命令执行。
+ * 二进制命令帧（0x00 分隔的 COBS）原样返回，由控制台解码。
  */
-static bool TryReadCommandLine(USART_Controller& usart, char* outLine, uint16_t outCap) {
-    static char lineBuf[96];
-    static uint16_t lineLen = 0;
-    
-    uint8_t ch;
-    // 循环读取，直到硬件缓冲区空或读到完整的一行
-    while (usart.Receiver(&ch, 1) > 0) {
-        // 遇到换行符，说明一行结束
-        if (ch == '\r' || ch == '\n') {
-            if (lineLen > 0) {
-                lineBuf[lineLen] = '\0';
-                if (outCap > 0) {
-                    strncpy(outLine, lineBuf, outCap - 1);
-                    outLine[outCap - 1] = '\0';
+static bool TryReadCommand(USART_Controller& usart, uint8_t* out, uint16_t outCap, uint16_t* outLen, bool* binary) {
+    bool truncated = false;
+    while (usart.ReadMessage(out, outCap, outLen, binary, &truncated)) {
+        if (truncated) {
+            usart.Printf("Error: Line buffer overflow\r\n");
+            continue;
+        }
+        if (*outLen != 0) return true; // 成功读取一条
+    }
+    return false; // 暂时没有读到完整的消息
+}
+
+// 处理某条链路上的一条命令，回显与应答都走同一链路
+static bool PollCommand(EchemConsole& console, USART_Controller& usart,
+                        EchemConsole::State& state, bool& resetTimebase) {
+    uint8_t msg[EchemConsole::LINE_MAX];
+    uint16_t len = 0;
+    bool binary = false;
+    if (!TryReadCommand(usart, msg, sizeof(msg), &len, &binary)) return false;
+    if (binary) {
+        // 二进制命令不回显，应答为二进制状态帧
+        state = console.ProcessFrame(usart, msg, len, state, &resetTimebase);
+        NS_CGM::NoteActivity();
+        return true;
+    }
+    const char* line = reinterpret_cast<const char*>(msg);
+    // 【调试】回显收到的命令，方便在手机端查看是否收到
+    SendAck(usart, line);
+    state = console.ProcessLine(usart, line, state, &resetTimebase);
+    NS_CGM::NoteActivity();
+    return true;
+}
+
+// 按键菜单：按键翻译成文本命令，走与串口命令相同的处理；应答发到蓝牙链路
+static bool PollKeys(EchemConsole& console, USART_Controller& usart,
+                     EchemConsole::State& state, bool& resetTimebase) {
+    NS_MENU::Status st;
+    st.running = (state == EchemConsole::State::START || state == EchemConsole::State::RESUME);
+    st.paused  = (state == EchemConsole::State::PAUSE);
+    st.mode    = console.GetMode();
+    char cmd[24];
+    if (!NS_MENU::Poll(st, cmd, sizeof(cmd))) return false;
+    SendAck(usart, cmd);
+    state = console.ProcessLine(usart, cmd, state, &resetTimebase);
+    NS_CGM::NoteActivity();
+    return true;
+}
+
+// 没有事件时的最长睡眠：链路维护（BAUD 握手超时）按毫秒计，不需要更密
+static const uint32_t IDLE_WAIT_MS = 10;
+
+// 急停收尾：接收中断已停好 DAC，这里只报告延迟并把状态切到 STOP
+static bool ServiceAbort(EchemConsole& console, USART_Controller& usart, EchemConsole::State& state) {
+    if (!usart.ConsumeAbort()) return false;
+    state = console.ProcessAbort(usart, state);
+    return true;
+}
+
+// 周期测量：到期就采一轮并在两条链路上报；本周期做完、链路发完且没有待处理命令时进 Stop，
+// 睡到下一次 RTC 闹钟（或 RX 引脚唤醒）。*wait_ms 收紧到测量状态机下次需要被调用的时刻
+static void ServiceCgm(USART_Controller& bt, USART_Controller& wired, uint32_t* wait_ms) {
+    if (NS_CGM::Service(wait_ms)) {
+        NS_CGM::Result r;
+        if (NS_CGM::GetResult(0, &r)) {
+            char buf[192];
+            NS_FMT::FmtBuf f(buf);
+            NS_CGM::FormatResult(r, f);
+            (void)bt.WriteFrame(f.data(), f.size());
+            (void)wired.WriteFrame(f.data(), f.size());
+            NS_PLOT::PushCgm(r.curPa, r.nch);
+        }
+    }
+#ifndef USE_CMSIS_RTOS2
+    if (NS_CGM::CanStop() && !bt.HasLine() && !wired.HasLine() && !OLED_IsBusy() &&
+        !Key_IsActive() && !NS_MENU::IsOpen()) {
+        (void)bt.Flush();
+        (void)wired.Flush();
+        NS_CGM::Sleep();
+    }
+#endif
+}
+
+// 串口中断注册：RXNE 退路、TX DMA 完成、RX 循环 DMA 半满/全满与总线空闲
+static void RegisterLinkIRQs(USART_Controller& usart, void (*rxne)(), void (*tx_dma)(),
+                             void (*rx_dma)(), void (*rx_idle)()) {
+    const auto& p = usart.GetParams();
+    // 确保中断优先级配置正确，防止丢数据
+    USART_IRQnManage::Add(p.USART, USART::IT::RXNE, rxne, 1, 3);
+    DMA_IRQnManage::Add(p.TX_DMA_Channel, DMA::IT::TC, tx_dma, 1, 3);
+    DMA_IRQnManage::Add(p.RX_DMA_Channel, DMA::IT::HT, rx_dma, 1, 3);
+    DMA_IRQnManage::Add(p.RX_DMA_Channel, DMA::IT::TC, rx_dma, 1, 3);
+    USART_IRQnManage::Add(p.USART, USART::IT::IDLE, rx_idle, 1, 3);
+    // CGM 周期测量的 Stop 期间由 RX 引脚下降沿唤醒
+    (void)NS_CGM::AddWakePin(p.GPIOx, p.USART_RX);
+}
+
+#ifdef USE_CMSIS_RTOS2
+// ============================================================
+// RTOS 构建（USE_CMSIS_RTOS2，RTX5）：主循环拆成三个线程
+// - tlm   （AboveNormal）：流控制 + 各输出端编码发送，样本/TX 完成唤醒
+// - comms （Normal）     ：命令解析、急停收尾、链路维护，RX/急停唤醒
+// - ui    （BelowNormal）：OLED 显存绘制 + 启动后台刷屏（I2C1 DMA），快照唤醒
+// 采样本身仍在 TIM4 中断里写广播环，不经线程；两个串口的 TX、输出端配置与 ui 线程的绘制由 linkMutex 串行，
+// 命令线程通过消息队列把 START/STOP 交给 tlm 线程执行。控制块、栈、队列全部静态分配。
+// ============================================================
+namespace {
+
+// ui 线程无事件时的最长等待
+static const uint32_t UI_WAIT_MS = 100;
+
+struct StreamCtl {
+    uint8_t running;
+    uint8_t fresh;
+};
+
+template <uint32_t STACK_BYTES>
+struct ThreadMem {
+    uint32_t cb[(osRtxThreadCbSize + 3) / 4];
+    uint64_t stack[STACK_BYTES / 8];
+};
+
+// comms：两级 LINE_MAX 行缓冲 + Printf 缓冲 + CFG 输出缓冲
+ThreadMem<2048> s_commsMem;
+ThreadMem<1024> s_tlmMem;
+ThreadMem<1024> s_uiMem;     // 曲线视图：样本拷贝 + 标题格式化 + Bresenham
+
+uint32_t s_linkMutexCb[(osRtxMutexCbSize + 3) / 4];
+uint32_t s_ctlQueueCb[(osRtxMessageQueueCbSize + 3) / 4];
+uint32_t s_ctlQueueMem[(osRtxMessageQueueMemSize(4, sizeof(StreamCtl)) + 3) / 4];
+
+osMutexId_t        s_linkMutex = nullptr;
+osMessageQueueId_t s_ctlQueue  = nullptr;
+
+uint8_t s_commsSlot = NS_THREAD::MAX_THREADS;
+uint8_t s_tlmSlot   = NS_THREAD::MAX_THREADS;
+uint8_t s_uiSlot    = NS_THREAD::MAX_THREADS;
+
+void CommsThread(void* arg) {
+    auto& console = *static_cast<EchemConsole*>(arg);
+    auto& bt = GetStaticBt();
+    auto& wired = GetStaticWired();
+    EchemConsole::State state = EchemConsole::State::UNKNOWN;
+    bool resetTimebase = false;
+    bool wasRunning = false;
+
+    for (;;) {
+        uint32_t waitMs = IDLE_WAIT_MS;
+        {
+            NS_THREAD::BusyScope busy(s_commsSlot);
+            (void)osMutexAcquire(s_linkMutex, osWaitForever);
+            ServiceLink(bt);
+            ServiceLink(wired);
+            while (ServiceAbort(console, bt, state) || ServiceAbort(console, wired, state) ||
+                   PollCommand(console, bt, state, resetTimebase) ||
+                   PollCommand(console, wired, state, resetTimebase) ||
+                   PollKeys(console, bt, state, resetTimebase)) {
+                const bool running = (state == EchemConsole::State::START || state == EchemConsole::State::RESUME);
+                if (running != wasRunning || resetTimebase) {
+                    const StreamCtl ctl = { static_cast<uint8_t>(running), static_cast<uint8_t>(resetTimebase) };
+                    if (osMessageQueuePut(s_ctlQueue, &ctl, 0, 0) == osOK) {
+                        wasRunning = running;
+                        resetTimebase = false;
+                        NS_EVT::Post(NS_EVT::STREAM);
+                    }
                 }
-                lineLen = 0;
-                return true; // 成功读取一行
             }
-            // 如果 lineLen == 0，说明是空行（比如 \r 后的 \n），直接忽略，继续读下一个字符
-            continue;
+            ServiceCgm(bt, wired, &waitMs);
+            (void)osMutexRelease(s_linkMutex);
         }
+        NS_THREAD::Roll();
+        (void)NS_EVT::Wait(waitMs, NS_EVT::RX_LINE | NS_EVT::ABORT | NS_EVT::CGM | NS_EVT::KEY);
+    }
+}
 
-        // 普通字符，存入缓冲区
-        if (lineLen < sizeof(lineBuf) - 1) {
-            lineBuf[lineLen++] = (char)ch;
-        } else {
-            // 缓冲区溢出，重置
-            lineLen = 0;
-            usart.Printf("Error: Line buffer overflow\r\n");
+void TelemetryThread(void*) {
+    auto& stream = NS_STREAM::GetStaticStream();
+    bool inited = false;
+
+    for (;;) {
+        {
+            NS_THREAD::BusyScope busy(s_tlmSlot);
+            (void)osMutexAcquire(s_linkMutex, osWaitForever);
+            StreamCtl ctl;
+            while (osMessageQueueGet(s_ctlQueue, &ctl, nullptr, 0) == osOK) {
+                // 第一次 START 才初始化采样定时器（与裸机第二阶段入口一致）
+                if (!inited && ctl.running) {
+                    stream.Init(&NS_ADC::GetStaticADC(), &NS_DAC::GetCvValToSendRef());
+                    inited = true;
+                }
+                if (inited) NS_STREAM::SetStreaming(ctl.running != 0, ctl.fresh != 0);
+            }
+            if (inited) NS_STREAM::ServiceSinks();
+            NS_LOG::Service();
+            (void)osMutexRelease(s_linkMutex);
         }
+        (void)NS_EVT::Wait(IDLE_WAIT_MS, NS_EVT::SAMPLE | NS_EVT::TX_DONE | NS_EVT::STREAM);
     }
-    return false; // 暂时没有读到完整的一行
 }
 
-static void SendJsonLine(USART_Controller& usart,
-                         uint32_t ms,
-                         uint16_t uric_raw,
-                         uint16_t ascorbic_raw,
-                         uint16_t glucose_raw,
-                         uint16_t code12)
-{
-    char outBuf[160];
-    int n = snprintf(outBuf, sizeof(outBuf),
-        "{\"Ms\":%lu,\"Uric\":%u,\"Ascorbic\":%u,\"Glucose\":%u,\"Code12\":%u}\n",
-        (unsigned long)ms,
-        (unsigned)uric_raw,
-        (unsigned)ascorbic_raw,
-        (unsigned)glucose_raw,
-        (unsigned)code12
-    );
-    if (n <= 0) return;
-    if (n >= (int)sizeof(outBuf)) n = (int)sizeof(outBuf) - 1;
-    usart.Write((const uint8_t*)outBuf, (uint16_t)n);
+void UiThread(void*) {
+    auto& adc = NS_ADC::GetStaticADC();
+    for (;;) {
+        // 上次 Flush 时总线还忙、留下了脏页：尽快回来补发；否则等快照，最长 UI_WAIT_MS
+        // （VIEW 切换与 CGM 趋势点不发事件，靠这个超时取走）
+        (void)NS_EVT::Wait(OLED_IsDirty() ? IDLE_WAIT_MS : UI_WAIT_MS, NS_EVT::ADC_SNAP);
+        NS_THREAD::BusyScope busy(s_uiSlot);
+        // 绘制读取的量程/参比/视图配置由命令线程在 linkMutex 下改写，绘制期间同样持锁；
+        // 只写显存，不碰串口，持锁时间很短
+        (void)osMutexAcquire(s_linkMutex, osWaitForever);
+        adc.Service();
+        NS_MENU::Render();
+        NS_PLOT::Service();
+        (void)osMutexRelease(s_linkMutex);
+        // 显存只有本线程写，刷屏（I2C1 DMA）不必持锁；命令线程只读 OLED 的忙标志与计数
+        OLED_Flush();
+    }
+}
+
+template <uint32_t N>
+osThreadId_t StartThread(const char* name, osThreadFunc_t fn, void* arg, osPriority_t prio,
+                         ThreadMem<N>& mem, uint8_t* slot) {
+    osThreadAttr_t attr = {};
+    attr.name       = name;
+    attr.cb_mem     = mem.cb;
+    attr.cb_size    = sizeof(mem.cb);
+    attr.stack_mem  = mem.stack;
+    attr.stack_size = sizeof(mem.stack);
+    attr.priority   = prio;
+    const osThreadId_t id = osThreadNew(fn, arg, &attr);
+    *slot = NS_THREAD::Register(name, id);
+    return id;
 }
 
+__NO_RETURN void RunThreads(EchemConsole& console) {
+    osMutexAttr_t mattr = {};
+    mattr.name      = "link";
+    mattr.attr_bits = osMutexPrioInherit;
+    mattr.cb_mem    = s_linkMutexCb;
+    mattr.cb_size   = sizeof(s_linkMutexCb);
+    s_linkMutex = osMutexNew(&mattr);
+
+    osMessageQueueAttr_t qattr = {};
+    qattr.name    = "streamCtl";
+    qattr.cb_mem  = s_ctlQueueCb;
+    qattr.cb_size = sizeof(s_ctlQueueCb);
+    qattr.mq_mem  = s_ctlQueueMem;
+    qattr.mq_size = sizeof(s_ctlQueueMem);
+    s_ctlQueue = osMessageQueueNew(4, sizeof(StreamCtl), &qattr);
+
+    NS_EVT::Init();
+
+    (void)StartThread("tlm",   TelemetryThread, nullptr,  osPriorityAboveNormal, s_tlmMem,   &s_tlmSlot);
+    (void)StartThread("comms", CommsThread,     &console, osPriorityNormal,      s_commsMem, &s_commsSlot);
+    (void)StartThread("ui",    UiThread,        nullptr,  osPriorityBelowNormal, s_uiMem,    &s_uiSlot);
+
+    SysTickTimer::MarkKernelStart();
+    (void)osKernelStart();
+    for (;;) {}
+}
+
+} // namespace
+#endif // USE_CMSIS_RTOS2
+
 int main(void) {
     SysTickTimer::Init();
+#ifdef USE_CMSIS_RTOS2
+    // SysTick 由 RTX 在 osKernelStart 时配置（最低优先级）；对象须在内核初始化后创建
+    (void)osKernelInitialize();
+#else
     NVIC_SetPriority(SysTick_IRQn, 0);
+#endif
 
     OLED_Init();
+    Key_Init();
+
+    // TX 由 DMA 后台发送，完成中断推进环形缓冲；
+    // RX 由循环 DMA 接收：半满/全满与总线空闲时按块统计行结束符；RXNE 仅作无 DMA 时的退路
+    // 急停序列在接收中断里直接停 DAC，不等主循环
+    USART_Controller::SetAbortHook([](USART_Controller&, uint32_t t0_cycles) {
+        NS_DAC::SystemController::GetInstance().Abort(t0_cycles);
+    });
 
     auto& bt = GetStaticBt();
-    // 确保中断优先级配置正确，防止丢数据
-    USART_IRQnManage::Add(bt.GetParams().USART, USART::IT::RXNE, BT_IRQHandler, 1, 3);
+    RegisterLinkIRQs(bt, BT_IRQHandler, BT_TxDmaIRQHandler, BT_RxDmaIRQHandler, BT_RxIdleIRQHandler);
     bt.Start();
 
+    // 有线链路（USART1）：台架全速数据，命令与 BT 等价
+    auto& wired = GetStaticWired();
+    RegisterLinkIRQs(wired, Wired_IRQHandler, Wired_TxDmaIRQHandler, Wired_RxDmaIRQHandler, Wired_RxIdleIRQHandler);
+    wired.Start();
+
     ApplyDefaultParams();
+    NS_LOG::Init();
 
-    EchemConsole console;
+#ifdef USE_CMSIS_RTOS2
+    // 线程引用它，不能放在 main 的栈上
+    static EchemConsole console(MakeDefaultParams());
+#else
+    EchemConsole console(MakeDefaultParams());
+#endif
+    // 保存过的参数直接从 flash 恢复（只是一次 CRC），上电后一条 START 即可测量
+    const NS_PARAM::Status paramSt = console.RestoreParams();
 
     bt.Printf("System Ready.\r\n");
+    wired.Printf("System Ready.\r\n");
+    USART_Controller* const links[] = { &bt, &wired };
+    for (USART_Controller* link : links) {
+        console.PrintParams(*link);
+        if (paramSt != NS_PARAM::Status::OK && paramSt != NS_PARAM::Status::EMPTY) {
+            link->Printf("PARAMS not restored: %s, using defaults\r\n", NS_PARAM::StatusToString(paramSt));
+        }
+    }
+
+#ifdef USE_CMSIS_RTOS2
+    RunThreads(console);
+#else
 
     EchemConsole::State state = EchemConsole::State::UNKNOWN;
-    uint32_t startTime = 0;
     bool resetTimebase = false;
 
     // --- 第一阶段：等待 START ---
     while (state != EchemConsole::State::START) {
-        char line[64];
-        if (TryReadCommandLine(bt, line, sizeof(line))) {
-            // 【调试】回显收到的命令，方便在手机端查看是否收到
-            bt.Printf("ACK: %s\r\n", line);
-            
-            state = console.ProcessLine(bt, line, state, &resetTimebase);
-            
-            if (state == EchemConsole::State::START) {
-                startTime = SysTickTimer::GetTick();
-            }
+        ServiceLink(bt);
+        ServiceLink(wired);
+        // 未运行时的急停序列只提示，不改状态
+        (void)ServiceAbort(console, bt, state);
+        (void)ServiceAbort(console, wired, state);
+        (void)PollCommand(console, bt, state, resetTimebase);
+        if (state != EchemConsole::State::START) {
+            (void)PollCommand(console, wired, state, resetTimebase);
+            (void)PollKeys(console, bt, state, resetTimebase);
+            // 睡到下一条命令（或超时做链路维护）；处理期间到达的事件已留在标志里，不会睡过头
+            NS_MENU::Render();
+            NS_PLOT::Service();
+            OLED_Flush();
+            // 开机后、第一次 START 之前也能补发上次运行留在 flash 里的样本
+            NS_LOG::Service();
+            uint32_t waitMs = IDLE_WAIT_MS;
+            ServiceCgm(bt, wired, &waitMs);
+            (void)NS_EVT::Wait(waitMs);
         }
-        // 降低延时，提高响应速度，防止数据积压
-        SysTickTimer::DelayMs(5); 
     }
 
     auto& adc = NS_ADC::GetStaticADC();
-    const auto& adcBuf = adc.GetDmaBufferRef();
-    const auto& cvValRef = NS_DAC::GetCvValToSendRef();
 
-    uint32_t lastReportTime = 0;
-    constexpr uint32_t REPORT_INTERVAL_MS = 50;
+    // 采样由 TIM4 中断按 STREAM RATE 定速写入广播环，各输出端按自己的游标尽快发出
+    auto& stream = NS_STREAM::GetStaticStream();
+    stream.Init(&adc, &NS_DAC::GetCvValToSendRef());
+    NS_STREAM::SetStreaming(true, true);
 
-    // --- 第二阶段：主循环 ---
+    // --- 第二阶段：主循环（事件驱动：处理完一轮就 WFI，等 RX/TX/采样/急停中断唤醒） ---
     while (1) {
-        // 1. 处理命令
-        char line[64];
+        // 1. 处理命令（两条链路）
+        ServiceLink(bt);
+        ServiceLink(wired);
         // 这里使用 while 循环处理所有积压的命令，防止发送 JSON 阻塞导致命令处理不及时
-        while (TryReadCommandLine(bt, line, sizeof(line))) {
-            bt.Printf("ACK: %s\r\n", line); // 回显
-            
-            EchemConsole::State newState = console.ProcessLine(bt, line, state, &resetTimebase);
-            
-            if (resetTimebase) {
-                startTime = SysTickTimer::GetTick();
+        while (ServiceAbort(console, bt, state) || ServiceAbort(console, wired, state) ||
+               PollCommand(console, bt, state, resetTimebase) ||
+               PollCommand(console, wired, state, resetTimebase) ||
+               PollKeys(console, bt, state, resetTimebase)) {
+            // 采样只在 START/RESUME 下运行；新的 START 重置广播环、各输出端游标与时间基准
+            const bool running = (state == EchemConsole::State::START || state == EchemConsole::State::RESUME);
+            if (running != stream.IsActive() || resetTimebase) {
+                NS_STREAM::SetStreaming(running, resetTimebase);
             }
-            state = newState;
         }
 
-        // 2. 硬件服务
+        // 2. 硬件服务：OLED 只改显存（文本页或曲线视图），Flush 把脏页交给 I2C1 DMA 后台发送
         adc.Service();
+        NS_MENU::Render();
+        NS_PLOT::Service();
+        OLED_Flush();
 
-        // 3. 数据上报
-        const uint32_t now = SysTickTimer::GetTick();
-        if (now - lastReportTime >= REPORT_INTERVAL_MS) {
-            lastReportTime = now;
+        // 3. 数据上报：每个输出端按自己的 PROTO/DECIM 输出，TX 有余量就发，背压由各自的 POLICY 处理
+        NS_STREAM::ServiceSinks();
+        NS_LOG::Service();
 
-            if (state == EchemConsole::State::START || state == EchemConsole::State::RESUME) {
-                NS_DAC::SystemController::GetInstance().UpdateTick();
+        // 4. 周期测量（STOP 之后可用 CGM ON 进入）
+        uint32_t waitMs = IDLE_WAIT_MS;
+        ServiceCgm(bt, wired, &waitMs);
 
-                const uint32_t ms = now - startTime;
-                const uint16_t uric_raw     = adcBuf[0];
-                const uint16_t ascorbic_raw = adcBuf[1];
-                const uint16_t glucose_raw  = adcBuf[2];
-                const uint16_t code12 = ((uint16_t)cvValRef) & 0x0FFF;
-
-                SendJsonLine(bt, ms, uric_raw, ascorbic_raw, glucose_raw, code12);
-            }
-        }
-        
-        // 稍微减少延时，保证串口接收更流畅
-        SysTickTimer::DelayMs(2);
+        // 5. 睡眠：样本/TX 完成/命令/RTC 闹钟都会唤醒；每次唤醒把上面几步都走一遍（都是排空式，空转代价很小）
+        (void)NS_EVT::Wait(waitMs);
     }
-}
\ No newline at end of file
+#endif // USE_CMSIS_RTOS2
+}
@@ -10,7 +10,9 @@
 #include <stdlib.h>
 
 #include "DACManager.h"
+#include "ADCManager.h"
 #include "BTCPP.h"
+#include "EchemConsole.h"
 
 #define WE_uA_Port GPIO_Pin_1       // GPIOA_Pin_1
 #define WE_mA_Port GPIO_Pin_2       // GPIOA_Pin_2
@@ -115,6 +117,24 @@ static inline void ApplyDefaultParams() {
     sys.SetBiasConstantVal(kDefaultBiasCode);
 }
 
+// Factory parameter set for EchemConsole (FACTORY, and boot without a stored set).
+// Gains are the compiled ADC init values, read before any stored CAL is applied.
+static inline EchemConsole::Params MakeDefaultParams() {
+    const auto& adcParams = NS_ADC::GetStaticADC().GetInitParams();
+    const uint8_t nch = (adcParams.channels != nullptr) ? adcParams.nbr_of_channels : 0;
+
+    EchemConsole::Params p;
+    memset(static_cast<void*>(&p), 0, sizeof(p));
+    p.mode = kDefaultMode;
+    p.at = NS_DAC::SwapAt::STEP;
+    p.cvVolt = kDefaultCVVolt;
+    p.cvParams = kDefaultCVParams;
+    p.dpv = MakeDefaultDPV();
+    p.bias = kDefaultBiasCode;
+    for (uint8_t i = 0; i < 3; ++i) p.gain[i] = (i < nch) ? adcParams.channels[i].gain : 1;
+    return p;
+}
+
 // ============================================================
 // CLI outputs
 // ============================================================
@@ -105,9 +105,11 @@ void UsageFault_Handler(void)
   * @param  None
   * @retval None
   */
+#ifndef USE_CMSIS_RTOS2     /* RTOS 构建：SVC/PendSV 由 RTX 提供 */
 void SVC_Handler(void)
 {
 }
+#endif
 
 /**
   * @brief  This function handles Debug Monitor exception.
@@ -123,9 +125,11 @@ void DebugMon_Handler(void)
   * @param  None
   * @retval None
   */
+#ifndef USE_CMSIS_RTOS2
 void PendSV_Handler(void)
 {
 }
+#endif
 
 // /**
 //   * @brief  This function handles SysTick Handler.